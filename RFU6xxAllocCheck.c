@@ -0,0 +1,461 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+*
+* @contact: sebastian.heidepriem@sick.de
+*
+*
+* Heap allocation check of the tag request path (rfu6xx-alloccheck):
+*   1.) malloc, calloc, realloc and free are wrapped by the linker (-Wl,--wrap=...) and counted,
+*       for the client library as well as for open62541.
+*   2.) The device connects to the endpoint and finds a tag with a short scan.
+*   3.) readTag, writeTag, readTagBytes, writeTagBytes, callTagOperations, readTagAsync and startScan / stopScan
+*       are warmed up and run <iterations> times each. The same method calls are sent directly with UA_Client_call /
+*       UA_Client_Service_call / UA_Client_call_async and counted as reference: open62541 allocates while encoding and decoding,
+*       the library may not add a single allocation per operation to that.
+*   4.) Every allocation of an operation must be freed again (the read data is released by the caller).
+* The check fails if an operation allocates more than its reference or leaks.
+*
+* Usage: ./rfu6xx-alloccheck [-e endpoint] [-n iterations] [-l]
+*   -l starts ./mockserver as local stand-in for the reader and checks against opc.tcp://localhost:4840.
+*/
+
+#include "RFU6xxClient.h"
+#include <open62541/plugin/log_stdout.h>
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CHECK_USER_BANK 3
+#define CHECK_PAYLOAD_SIZE 16
+#define CHECK_BATCH_SIZE 4
+#define CHECK_WARMUP 10
+
+// ------------------------------------------------------------------------------------------------------------------------
+// Counting allocator, the client runs in one thread
+
+static size_t allocations;
+static long liveAllocations;
+
+void* __real_malloc (size_t size);
+void* __real_calloc (size_t count, size_t size);
+void* __real_realloc (void* ptr, size_t size);
+void __real_free (void* ptr);
+
+void* __wrap_malloc (size_t size)
+{
+    allocations++;
+    liveAllocations++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc (size_t count, size_t size)
+{
+    allocations++;
+    liveAllocations++;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc (void* ptr, size_t size)
+{
+    allocations++;
+    if (ptr == NULL) liveAllocations++;
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free (void* ptr)
+{
+    if (ptr != NULL) liveAllocations--;
+    __real_free(ptr);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+// Input arguments of one ReadTag / WriteTag call built without the library (reference)
+typedef struct {
+    UA_Variant variants[RFU6xx_TAG_CALL_PARAMS_SIZE];
+    UA_ExtensionObject eo;
+    unsigned char idBuffer[2*sizeof(UA_Int32) + RFU6xx_MAX_TAG_ID_SIZE];
+    UA_String codeType;
+    UA_Int16 bank;
+    UA_Int32 offset;
+    UA_Int32 length;
+    UA_ByteString data;
+    UA_String password;
+    UA_UInt32 methodId;
+} RawCall;
+
+typedef struct {
+    RFU6xx_Device* device;
+    UA_String tagId;
+    UA_String hexData;                          // writeTag
+    UA_ByteString binaryData;                   // writeTagBytes
+    UA_Byte readBuffer[CHECK_PAYLOAD_SIZE];     // readTagBytes
+    RFU6xx_TagOperation operations[CHECK_BATCH_SIZE];
+    RawCall raw[CHECK_BATCH_SIZE];
+    UA_Boolean completed;                       // Set by the callbacks of the asynchronous calls
+} CheckContext;
+
+typedef UA_StatusCode (*CheckFunction)(CheckContext* ctx);
+
+typedef struct {
+    const char* name;
+    CheckFunction library;
+    CheckFunction reference;
+} CheckOperation;
+
+static void setScalarNoDelete (UA_Variant* variant, void* data, const UA_DataType* type)
+{
+    UA_Variant_setScalar(variant, data, type);
+    variant->storageType = UA_VARIANT_DATA_NODELETE;
+}
+
+static UA_StatusCode setRawCall (CheckContext* ctx, RawCall* raw, UA_Boolean write, UA_Boolean binary)
+{
+    if (tagIdToExtentionObject(ctx->device, ctx->tagId, &raw->eo, raw->idBuffer, sizeof(raw->idBuffer)) != 0) return UA_STATUSCODE_BAD;
+    raw->codeType = UA_STRING(binary ? "RAW:BYTES" : "RAW:STRING");
+    raw->bank = CHECK_USER_BANK;
+    raw->offset = 0;
+    raw->length = CHECK_PAYLOAD_SIZE;
+    raw->data = binary ? ctx->binaryData : ctx->hexData;
+    raw->password = UA_STRING_NULL;
+    raw->methodId = write ? ctx->device->ndWriteTagID : ctx->device->ndReadTagID;
+
+    setScalarNoDelete(&raw->variants[0], &raw->eo, &UA_TYPES[UA_TYPES_EXTENSIONOBJECT]);
+    setScalarNoDelete(&raw->variants[1], &raw->codeType, &UA_TYPES[UA_TYPES_STRING]);
+    setScalarNoDelete(&raw->variants[2], &raw->bank, &UA_TYPES[UA_TYPES_INT16]);
+    setScalarNoDelete(&raw->variants[3], &raw->offset, &UA_TYPES[UA_TYPES_INT32]);
+    if (write) setScalarNoDelete(&raw->variants[4], &raw->data, &UA_TYPES[binary ? UA_TYPES_BYTESTRING : UA_TYPES_STRING]);
+    else setScalarNoDelete(&raw->variants[4], &raw->length, &UA_TYPES[UA_TYPES_INT32]);
+    setScalarNoDelete(&raw->variants[5], &raw->password, &UA_TYPES[UA_TYPES_STRING]);
+    return UA_STATUSCODE_GOOD;
+}
+
+// Sends count prepared method calls in one call request and releases the response
+static UA_StatusCode sendRawCalls (CheckContext* ctx, size_t count)
+{
+    UA_CallMethodRequest methods[CHECK_BATCH_SIZE];
+    for (size_t i = 0; i < count; i++)
+    {
+        UA_CallMethodRequest_init(&methods[i]);
+        methods[i].objectId = UA_NODEID_NUMERIC(ctx->device->nsRfu, ctx->device->ndRfu6xxNodeID);
+        methods[i].methodId = UA_NODEID_NUMERIC(ctx->device->nsRfu, ctx->raw[i].methodId);
+        methods[i].inputArguments = ctx->raw[i].variants;
+        methods[i].inputArgumentsSize = RFU6xx_TAG_CALL_PARAMS_SIZE;
+    }
+    UA_CallRequest cReq;
+    UA_CallRequest_init(&cReq);
+    cReq.methodsToCall = methods;
+    cReq.methodsToCallSize = count;
+    UA_CallResponse cResp = UA_Client_Service_call(ctx->device->client, cReq);
+    UA_StatusCode retval = cResp.responseHeader.serviceResult;
+    UA_CallResponse_clear(&cResp);
+    return retval;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+// Operations through the library
+
+static UA_StatusCode libraryReadTag (CheckContext* ctx)
+{
+    UA_String data = UA_STRING_NULL;
+    RFU6xx_StatusCode serverResponseCode;
+    UA_StatusCode retval = readTag(ctx->device, ctx->tagId, CHECK_USER_BANK, 0, CHECK_PAYLOAD_SIZE, &data, &serverResponseCode);
+    UA_String_clear(&data);
+    return retval;
+}
+
+static UA_StatusCode libraryWriteTag (CheckContext* ctx)
+{
+    RFU6xx_StatusCode serverResponseCode;
+    return writeTag(ctx->device, ctx->tagId, CHECK_USER_BANK, 0, ctx->hexData, &serverResponseCode);
+}
+
+static UA_StatusCode libraryReadTagBytes (CheckContext* ctx)
+{
+    size_t readLength;
+    RFU6xx_StatusCode serverResponseCode;
+    return readTagBytes(ctx->device, ctx->tagId, CHECK_USER_BANK, 0, CHECK_PAYLOAD_SIZE, ctx->readBuffer, &readLength, &serverResponseCode);
+}
+
+static UA_StatusCode libraryWriteTagBytes (CheckContext* ctx)
+{
+    RFU6xx_StatusCode serverResponseCode;
+    return writeTagBytes(ctx->device, ctx->tagId, CHECK_USER_BANK, 0, ctx->binaryData.data, ctx->binaryData.length, &serverResponseCode);
+}
+
+static UA_StatusCode libraryCallTagOperations (CheckContext* ctx)
+{
+    for (size_t i = 0; i < CHECK_BATCH_SIZE; i++)
+    {
+        RFU6xx_TagOperation* op = &ctx->operations[i];
+        op->write = false;
+        op->id = ctx->tagId;
+        op->bank = CHECK_USER_BANK;
+        op->offset = 0;
+        op->length = CHECK_PAYLOAD_SIZE;
+        op->writeData = UA_STRING_NULL;
+    }
+    UA_StatusCode retval = callTagOperations(ctx->device, ctx->operations, CHECK_BATCH_SIZE);
+    for (size_t i = 0; i < CHECK_BATCH_SIZE; i++) UA_String_clear(&ctx->operations[i].readData);
+    return retval;
+}
+
+static void readTagAsyncCompleted (RFU6xx_Device* device, UA_UInt32 requestId, UA_StatusCode status,
+    const UA_String* readData, RFU6xx_StatusCode serverResponseCode, void* context)
+{
+    ((CheckContext*) context)->completed = true;
+}
+
+static UA_StatusCode libraryReadTagAsync (CheckContext* ctx)
+{
+    ctx->completed = false;
+    UA_StatusCode retval = readTagAsync(ctx->device, ctx->tagId, CHECK_USER_BANK, 0, CHECK_PAYLOAD_SIZE,
+        readTagAsyncCompleted, ctx, NULL);
+    while (retval == UA_STATUSCODE_GOOD && !ctx->completed) retval = runIterate(ctx->device, 10);
+    return retval;
+}
+
+static UA_StatusCode libraryStartStopScan (CheckContext* ctx)
+{
+    UA_StatusCode retval = startScan(ctx->device, 0, 0, false);
+    if (retval == UA_STATUSCODE_GOOD) retval = stopScan(ctx->device);
+    return retval;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+// The same method calls without the library
+
+static UA_StatusCode referenceReadTag (CheckContext* ctx)
+{
+    setRawCall(ctx, &ctx->raw[0], false, false);
+    return sendRawCalls(ctx, 1);
+}
+
+static UA_StatusCode referenceWriteTag (CheckContext* ctx)
+{
+    setRawCall(ctx, &ctx->raw[0], true, false);
+    return sendRawCalls(ctx, 1);
+}
+
+static UA_StatusCode referenceReadTagBytes (CheckContext* ctx)
+{
+    setRawCall(ctx, &ctx->raw[0], false, true);
+    return sendRawCalls(ctx, 1);
+}
+
+static UA_StatusCode referenceWriteTagBytes (CheckContext* ctx)
+{
+    setRawCall(ctx, &ctx->raw[0], true, true);
+    return sendRawCalls(ctx, 1);
+}
+
+static UA_StatusCode referenceCallTagOperations (CheckContext* ctx)
+{
+    for (size_t i = 0; i < CHECK_BATCH_SIZE; i++) setRawCall(ctx, &ctx->raw[i], false, false);
+    return sendRawCalls(ctx, CHECK_BATCH_SIZE);
+}
+
+static void referenceCallCompleted (UA_Client* client, void* userdata, UA_UInt32 requestId, UA_CallResponse* response)
+{
+    ((CheckContext*) userdata)->completed = true;
+}
+
+static UA_StatusCode referenceReadTagAsync (CheckContext* ctx)
+{
+    ctx->completed = false;
+    setRawCall(ctx, &ctx->raw[0], false, false);
+    UA_StatusCode retval = UA_Client_call_async(ctx->device->client,
+        UA_NODEID_NUMERIC(ctx->device->nsRfu, ctx->device->ndRfu6xxNodeID),
+        UA_NODEID_NUMERIC(ctx->device->nsRfu, ctx->device->ndReadTagID),
+        RFU6xx_TAG_CALL_PARAMS_SIZE, ctx->raw[0].variants, referenceCallCompleted, ctx, NULL);
+    while (retval == UA_STATUSCODE_GOOD && !ctx->completed) retval = UA_Client_run_iterate(ctx->device->client, 10);
+    return retval;
+}
+
+static UA_StatusCode referenceStartStopScan (CheckContext* ctx)
+{
+    // Scan settings of startScan(device, 0, 0, false): reserved, duration, cycle and data available are all 0
+    UA_Byte sendBuffer[sizeof(UA_Int32)*2 + sizeof(UA_Int64) + sizeof(UA_Boolean)];
+    memset(sendBuffer, 0, sizeof(sendBuffer));
+
+    UA_ExtensionObject eo;
+    eo.encoding = UA_EXTENSIONOBJECT_ENCODED_BYTESTRING;
+    eo.content.encoded.typeId = UA_NODEID_NUMERIC(ctx->device->nsAutoID, RFU6xx_START_SCAN_E_O_TYPE_ID);
+    eo.content.encoded.body.data = sendBuffer;
+    eo.content.encoded.body.length = sizeof(sendBuffer);
+    UA_Variant sendParams[1];
+    setScalarNoDelete(&sendParams[0], &eo, &UA_TYPES[UA_TYPES_EXTENSIONOBJECT]);
+
+    size_t retParamsSize;
+    UA_Variant* retParams;
+    UA_StatusCode retval = UA_Client_call(ctx->device->client,
+        UA_NODEID_NUMERIC(ctx->device->nsRfu, ctx->device->ndRfu6xxNodeID),
+        UA_NODEID_NUMERIC(ctx->device->nsRfu, ctx->device->ndScanStartID),
+        1, sendParams, &retParamsSize, &retParams);
+    if (retval != UA_STATUSCODE_GOOD) return retval;
+    UA_Array_delete(retParams, retParamsSize, &UA_TYPES[UA_TYPES_VARIANT]);
+
+    return UA_Client_call(ctx->device->client,
+        UA_NODEID_NUMERIC(ctx->device->nsRfu, ctx->device->ndRfu6xxNodeID),
+        UA_NODEID_NUMERIC(ctx->device->nsRfu, ctx->device->ndScanStopID),
+        0, NULL, NULL, NULL);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+// Runs a function after a warm-up and returns the number of allocations of all iterations
+static size_t countAllocations (CheckFunction function, CheckContext* ctx, size_t iterations, long* leaked, UA_StatusCode* retval)
+{
+    *retval = UA_STATUSCODE_GOOD;
+    for (size_t i = 0; i < CHECK_WARMUP && *retval == UA_STATUSCODE_GOOD; i++) *retval = function(ctx);
+
+    size_t allocationsBefore = allocations;
+    long liveBefore = liveAllocations;
+    for (size_t i = 0; i < iterations && *retval == UA_STATUSCODE_GOOD; i++) *retval = function(ctx);
+    *leaked = liveAllocations - liveBefore;
+    return allocations - allocationsBefore;
+}
+
+static UA_String findTag (RFU6xx_Device* device)
+{
+    UA_String tagId = UA_STRING_NULL;
+    if (startScan(device, 0, 0, false) != UA_STATUSCODE_GOOD) return tagId;
+
+    for (int i = 0; i < 500; i++)
+    {
+        if (readLastScanData(device, &tagId) == UA_STATUSCODE_GOOD && tagId.length > 0) break;
+        UA_String_clear(&tagId);
+        usleep(10000);
+    }
+    stopScan(device);
+    return tagId;
+}
+
+static pid_t startMockServer (void)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        execl("./mockserver", "./mockserver", (char*) NULL);
+        _exit(EXIT_FAILURE);
+    }
+    // Give the server time to open its port
+    if (pid > 0) usleep(500000);
+    return pid;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+int main (int argc, char *argv[])
+{
+    const char* endpoint = "opc.tcp://localhost:4840";
+    size_t iterations = 1000;
+    UA_Boolean localServer = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "e:n:l")) != -1)
+    {
+        switch (opt)
+        {
+            case 'e': endpoint = optarg; break;
+            case 'n': iterations = (size_t) atol(optarg); break;
+            case 'l': localServer = true; break;
+            default:
+                fprintf(stderr, "Usage: %s [-e endpoint] [-n iterations] [-l]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (iterations == 0)
+    {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "At least one iteration is needed.");
+        return EXIT_FAILURE;
+    }
+
+    pid_t serverPid = 0;
+    if (localServer)
+    {
+        endpoint = "opc.tcp://localhost:4840";
+        serverPid = startMockServer();
+        if (serverPid < 0)
+        {
+            UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Could not start ./mockserver");
+            return EXIT_FAILURE;
+        }
+    }
+
+    CheckContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    UA_Byte binaryData[CHECK_PAYLOAD_SIZE];
+    char hexData[2*CHECK_PAYLOAD_SIZE];
+    for (size_t i = 0; i < CHECK_PAYLOAD_SIZE; i++)
+    {
+        binaryData[i] = (UA_Byte) i;
+        hexData[2*i] = '0';
+        hexData[2*i + 1] = "0123456789ABCDEF"[i % 16];
+    }
+    ctx.binaryData.data = binaryData;
+    ctx.binaryData.length = CHECK_PAYLOAD_SIZE;
+    ctx.hexData.data = (UA_Byte*) hexData;
+    ctx.hexData.length = 2*CHECK_PAYLOAD_SIZE;
+
+    int result = EXIT_FAILURE;
+    ctx.device = RFU6xx_Device_new(endpoint);
+    UA_StatusCode retval = ctx.device ? RFU6xx_Device_connect(ctx.device) : UA_STATUSCODE_BADOUTOFMEMORY;
+    if (retval == UA_STATUSCODE_GOOD) retval = init(ctx.device);
+    if (retval == UA_STATUSCODE_GOOD)
+    {
+        ctx.tagId = findTag(ctx.device);
+        if (ctx.tagId.length == 0) retval = UA_STATUSCODE_BADNOTFOUND;
+    }
+    if (retval != UA_STATUSCODE_GOOD)
+    {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Setup failed. ErrorCode: %x", retval);
+    }
+    else
+    {
+        CheckOperation operations[] = {
+            { "readTag", libraryReadTag, referenceReadTag },
+            { "writeTag", libraryWriteTag, referenceWriteTag },
+            { "readTagBytes", libraryReadTagBytes, referenceReadTagBytes },
+            { "writeTagBytes", libraryWriteTagBytes, referenceWriteTagBytes },
+            { "callTagOperations", libraryCallTagOperations, referenceCallTagOperations },
+            { "readTagAsync", libraryReadTagAsync, referenceReadTagAsync },
+            { "startScan/stopScan", libraryStartStopScan, referenceStartStopScan }
+        };
+        size_t failures = 0;
+        for (size_t i = 0; i < sizeof(operations) / sizeof(operations[0]); i++)
+        {
+            long leaked, referenceLeaked;
+            UA_StatusCode libraryRetval, referenceRetval;
+            size_t libraryCount = countAllocations(operations[i].library, &ctx, iterations, &leaked, &libraryRetval);
+            size_t referenceCount = countAllocations(operations[i].reference, &ctx, iterations, &referenceLeaked, &referenceRetval);
+
+            UA_Boolean passed = libraryRetval == UA_STATUSCODE_GOOD && referenceRetval == UA_STATUSCODE_GOOD
+                && libraryCount <= referenceCount && leaked == 0;
+            if (!passed) failures++;
+            printf("%-18s %8.2f allocations/op (open62541 %.2f, library %+.2f), %ld leaked, status %x / %x: %s\n",
+                operations[i].name, (double) libraryCount / iterations, (double) referenceCount / iterations,
+                ((double) libraryCount - (double) referenceCount) / iterations, leaked, libraryRetval, referenceRetval,
+                passed ? "ok" : "FAILED");
+        }
+        printf("%zu of %zu operations failed\n", failures, sizeof(operations) / sizeof(operations[0]));
+        result = failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    UA_String_clear(&ctx.tagId);
+    if (ctx.device != NULL) UA_Client_disconnect(ctx.device->client);
+    RFU6xx_Device_delete(ctx.device);
+    if (serverPid > 0)
+    {
+        kill(serverPid, SIGTERM);
+        waitpid(serverPid, NULL, 0);
+    }
+    return result;
+}
@@ -0,0 +1,536 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+*
+* @contact: sebastian.heidepriem@sick.de
+*
+*
+* Throughput and latency benchmark of the client operations (rfu6xx-bench):
+*   1.) <concurrency> devices are connected to the endpoint, each with its own session.
+*   2.) Each operation runs for <duration> seconds on all devices at once:
+*       init, readDeviceStatus, readLastScanData, startScan, stopScan
+*       and readTag / writeTag (hex) and readTagBytes / writeTagBytes (binary) for each payload size on the USER bank.
+*       Write with verify: writeTagBytes followed by readTagBytes (writeReadTagBytes) against writeTagVerified.
+*   3.) readTag from 1, 2, 4 and 8 threads sharing the first device through an executor (executorReadTag).
+*       readTag of the TID bank without and with the tag cache (readTid, readTidCached).
+*   4.) Optionally readDeviceStatus is repeated with 1, 2, 4, ... <scaling> devices.
+*   5.) ops/s, p50/p99/p999 latency, client CPU time and tag data bytes per operation of each run are written as JSON.
+*
+* Usage: ./rfu6xx-bench [-e endpoint] [-c concurrency] [-d duration s] [-p payload bytes,...]
+*                       [-S max devices] [-o output.json] [-l]
+*   -l starts ./mockserver as local stand-in for the reader and benchmarks opc.tcp://localhost:4840.
+*/
+
+#include "RFU6xxClient.h"
+#include "RFU6xxDeviceManager.h"
+#include "RFU6xxExecutor.h"
+#include "RFU6xxTagCache.h"
+#include <open62541/plugin/log_stdout.h>
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_MAX_PAYLOADS 16
+#define BENCH_USER_BANK 3
+#define BENCH_TID_SIZE 12
+#define BENCH_TAG_CACHE_CAPACITY 1024
+
+typedef enum {
+    BENCH_INIT,
+    BENCH_READ_DEVICE_STATUS,
+    BENCH_READ_LAST_SCAN_DATA,
+    BENCH_START_SCAN,
+    BENCH_STOP_SCAN,
+    BENCH_READ_TAG,
+    BENCH_WRITE_TAG,
+    BENCH_READ_TAG_BYTES,
+    BENCH_WRITE_TAG_BYTES,
+    BENCH_READ_TID,
+    BENCH_READ_TID_CACHED,
+    BENCH_WRITE_READ_TAG_BYTES,
+    BENCH_WRITE_TAG_VERIFIED
+} BenchOperation;
+
+static const char* benchOperationNames[] = {
+    "init", "readDeviceStatus", "readLastScanData", "startScan", "stopScan", "readTag", "writeTag", "readTagBytes", "writeTagBytes",
+    "readTid", "readTidCached", "writeReadTagBytes", "writeTagVerified"
+};
+
+// Latency samples of one device in one run
+typedef struct {
+    BenchOperation operation;
+    UA_Int32 payloadSize;
+    UA_String tagId;
+    UA_String writeData;                        // Hex digits (writeTag) or bytes (writeTagBytes)
+    UA_Byte* readBuffer;                        // readTagBytes, writeReadTagBytes
+    RFU6xx_Executor* executor;                  // Shared by the submitter threads of benchmarkExecutor
+    double deadlineNs;
+    double cpuNs;                               // CPU time of the worker thread during the run
+
+    double* samplesUs;
+    size_t samplesSize;
+    size_t samplesCapacity;
+    size_t errors;
+} BenchRun;
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+static double clockNs (clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double nowNs (void)
+{
+    return clockNs(CLOCK_MONOTONIC);
+}
+
+static void addSample (BenchRun* run, double us)
+{
+    if (run->samplesSize == run->samplesCapacity)
+    {
+        size_t capacity = run->samplesCapacity ? 2*run->samplesCapacity : 4096;
+        double* samples = (double*) realloc(run->samplesUs, capacity * sizeof(double));
+        if (samples == NULL) return;
+        run->samplesUs = samples;
+        run->samplesCapacity = capacity;
+    }
+    run->samplesUs[run->samplesSize++] = us;
+}
+
+static int compareDouble (const void* a, const void* b)
+{
+    double x = *(const double*) a, y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+static double percentile (const double* sorted, size_t size, double p)
+{
+    if (size == 0) return 0;
+    size_t index = (size_t) (p * (size - 1) + 0.5);
+    return sorted[index];
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+// Executes one operation, start and stop scan are executed as a pair and only one of them is measured
+static UA_StatusCode runOperation (RFU6xx_Device* device, BenchRun* run, double* latencyUs)
+{
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    RFU6xx_StatusCode serverResponseCode = RFU6xx_STATUSCODE_SUCCESS;
+    UA_Int32 deviceStatus;
+    UA_String data = UA_STRING_NULL;
+    size_t readLength;
+    RFU6xx_WriteVerifyResult writeResult;
+    double start = nowNs();
+
+    switch (run->operation)
+    {
+        case BENCH_INIT:
+            retval = init(device);
+            break;
+        case BENCH_READ_DEVICE_STATUS:
+            retval = readDeviceStatus(device, &deviceStatus);
+            break;
+        case BENCH_READ_LAST_SCAN_DATA:
+            retval = readLastScanData(device, &data);
+            break;
+        case BENCH_START_SCAN:
+            retval = startScan(device, 0, 0, false);
+            *latencyUs = (nowNs() - start) / 1e3;
+            if (retval == UA_STATUSCODE_GOOD) retval = stopScan(device);
+            return retval;
+        case BENCH_STOP_SCAN:
+            retval = startScan(device, 0, 0, false);
+            start = nowNs();
+            if (retval == UA_STATUSCODE_GOOD) retval = stopScan(device);
+            break;
+        case BENCH_READ_TAG:
+            retval = readTag(device, run->tagId, BENCH_USER_BANK, 0, run->payloadSize, &data, &serverResponseCode);
+            break;
+        case BENCH_WRITE_TAG:
+            retval = writeTag(device, run->tagId, BENCH_USER_BANK, 0, run->writeData, &serverResponseCode);
+            break;
+        case BENCH_READ_TAG_BYTES:
+            retval = readTagBytes(device, run->tagId, BENCH_USER_BANK, 0, run->payloadSize, run->readBuffer, &readLength, &serverResponseCode);
+            break;
+        case BENCH_WRITE_TAG_BYTES:
+            retval = writeTagBytes(device, run->tagId, BENCH_USER_BANK, 0, run->writeData.data, run->writeData.length, &serverResponseCode);
+            break;
+        case BENCH_READ_TID:
+        case BENCH_READ_TID_CACHED:
+            retval = readTag(device, run->tagId, RFU6xx_TID_BANK, 0, run->payloadSize, &data, &serverResponseCode);
+            break;
+        case BENCH_WRITE_READ_TAG_BYTES:
+            retval = writeTagBytes(device, run->tagId, BENCH_USER_BANK, 0, run->writeData.data, run->writeData.length, &serverResponseCode);
+            if (retval == UA_STATUSCODE_GOOD && serverResponseCode == RFU6xx_STATUSCODE_SUCCESS)
+            {
+                retval = readTagBytes(device, run->tagId, BENCH_USER_BANK, 0, run->payloadSize, run->readBuffer, &readLength, &serverResponseCode);
+            }
+            if (retval == UA_STATUSCODE_GOOD && serverResponseCode == RFU6xx_STATUSCODE_SUCCESS
+                && (readLength != run->writeData.length || memcmp(run->readBuffer, run->writeData.data, readLength) != 0))
+            {
+                retval = UA_STATUSCODE_BAD;
+            }
+            break;
+        case BENCH_WRITE_TAG_VERIFIED:
+            retval = writeTagVerified(device, run->tagId, BENCH_USER_BANK, 0, run->writeData.data, run->writeData.length, &writeResult);
+            if (retval == UA_STATUSCODE_GOOD && !writeResult.verified) retval = UA_STATUSCODE_BAD;
+            break;
+    }
+    *latencyUs = (nowNs() - start) / 1e3;
+    UA_String_clear(&data);
+
+    if (retval == UA_STATUSCODE_GOOD && serverResponseCode != RFU6xx_STATUSCODE_SUCCESS) retval = UA_STATUSCODE_BAD;
+    return retval;
+}
+
+static void benchJob (RFU6xx_Device* device, void* context)
+{
+    BenchRun* run = (BenchRun*) context;
+    double latencyUs;
+    double cpuStart = clockNs(CLOCK_THREAD_CPUTIME_ID);
+
+    while (nowNs() < run->deadlineNs)
+    {
+        if (runOperation(device, run, &latencyUs) == UA_STATUSCODE_GOOD) addSample(run, latencyUs);
+        else run->errors++;
+    }
+    run->cpuNs = clockNs(CLOCK_THREAD_CPUTIME_ID) - cpuStart;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+// Merges the samples of all runs and appends the result to the JSON output
+static void report (BenchRun* runs, size_t runCount, const char* name, UA_Int32 payloadSize, double elapsedS,
+    size_t dataBytes, FILE* out, UA_Boolean* first)
+{
+    size_t total = 0, errors = 0;
+    double cpuNs = 0;
+    for (size_t i = 0; i < runCount; i++)
+    {
+        total += runs[i].samplesSize;
+        errors += runs[i].errors;
+        cpuNs += runs[i].cpuNs;
+    }
+    double cpuUsPerOp = (total + errors) ? cpuNs / 1e3 / (total + errors) : 0;
+    double* samples = (double*) malloc((total ? total : 1) * sizeof(double));
+    size_t count = 0;
+    for (size_t i = 0; i < runCount; i++)
+    {
+        if (samples != NULL && runs[i].samplesSize > 0) memcpy(&samples[count], runs[i].samplesUs, runs[i].samplesSize * sizeof(double));
+        count += runs[i].samplesSize;
+        free(runs[i].samplesUs);
+        runs[i].samplesUs = NULL;
+    }
+    if (samples == NULL) total = 0;
+    else qsort(samples, total, sizeof(double), compareDouble);
+
+    double opsPerSec = total / elapsedS;
+    double p50 = percentile(samples, total, 0.50);
+    double p99 = percentile(samples, total, 0.99);
+    double p999 = percentile(samples, total, 0.999);
+    double max = total ? samples[total - 1] : 0;
+
+    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "%-16s %5d B %3zu dev: %10.1f ops/s  p50 %8.1f us  p99 %8.1f us  p999 %8.1f us  "
+        "cpu %6.1f us/op  data %5zu B/op  errors %zu",
+        name, payloadSize, runCount, opsPerSec, p50, p99, p999, cpuUsPerOp, dataBytes, errors);
+
+    fprintf(out, "%s\n    {\"operation\": \"%s\", \"payloadBytes\": %d, \"concurrency\": %zu, \"ops\": %zu, \"errors\": %zu, "
+        "\"opsPerSec\": %.1f, \"p50Us\": %.1f, \"p99Us\": %.1f, \"p999Us\": %.1f, \"maxUs\": %.1f, "
+        "\"cpuUsPerOp\": %.2f, \"dataBytesPerOp\": %zu}",
+        *first ? "" : ",", name, payloadSize, runCount, total, errors,
+        opsPerSec, p50, p99, p999, max, cpuUsPerOp, dataBytes);
+    *first = false;
+
+    free(samples);
+}
+
+// Runs one operation on the first deviceCount devices and appends the result to the JSON output
+static void benchmark (RFU6xx_DeviceManager* manager, size_t deviceCount, BenchOperation operation,
+    UA_Int32 payloadSize, UA_String tagId, double durationS, FILE* out, UA_Boolean* first)
+{
+    BenchRun* runs = (BenchRun*) calloc(deviceCount, sizeof(BenchRun));
+    if (runs == NULL) return;
+
+    // The write data is the same for all devices: payloadSize bytes as hex digits or as bytes
+    // Tag data bytes per operation: what the tag data occupies in the request or the response
+    UA_String writeData = UA_STRING_NULL;
+    size_t dataBytes = 0;
+    if (operation == BENCH_WRITE_TAG && UA_ByteString_allocBuffer(&writeData, 2 * (size_t) payloadSize) == UA_STATUSCODE_GOOD)
+    {
+        for (size_t i = 0; i < writeData.length; i++) writeData.data[i] = "0123456789ABCDEF"[i % 16];
+    }
+    if ((operation == BENCH_WRITE_TAG_BYTES || operation == BENCH_WRITE_READ_TAG_BYTES || operation == BENCH_WRITE_TAG_VERIFIED)
+        && UA_ByteString_allocBuffer(&writeData, (size_t) payloadSize) == UA_STATUSCODE_GOOD)
+    {
+        for (size_t i = 0; i < writeData.length; i++) writeData.data[i] = (UA_Byte) i;
+    }
+    if (operation == BENCH_READ_TAG || operation == BENCH_WRITE_TAG) dataBytes = 2 * (size_t) payloadSize;
+    if (operation == BENCH_READ_TAG_BYTES || operation == BENCH_WRITE_TAG_BYTES) dataBytes = (size_t) payloadSize;
+    if (operation == BENCH_READ_TID || operation == BENCH_READ_TID_CACHED) dataBytes = 2 * (size_t) payloadSize;
+    if (operation == BENCH_WRITE_READ_TAG_BYTES || operation == BENCH_WRITE_TAG_VERIFIED) dataBytes = 2 * (size_t) payloadSize;
+
+    double start = nowNs();
+    for (size_t i = 0; i < deviceCount; i++)
+    {
+        runs[i].operation = operation;
+        runs[i].payloadSize = payloadSize;
+        runs[i].tagId = tagId;
+        runs[i].writeData = writeData;
+        if (operation == BENCH_READ_TAG_BYTES || operation == BENCH_WRITE_READ_TAG_BYTES) runs[i].readBuffer = (UA_Byte*) malloc((size_t) payloadSize + 1);
+        if (operation == BENCH_READ_TID_CACHED) RFU6xx_TagCache_enable(RFU6xx_DeviceManager_getDevice(manager, i), BENCH_TAG_CACHE_CAPACITY);
+        runs[i].deadlineNs = start + durationS * 1e9;
+        RFU6xx_DeviceManager_submit(manager, RFU6xx_DeviceManager_getDevice(manager, i), benchJob, &runs[i]);
+    }
+    RFU6xx_DeviceManager_wait(manager);
+    for (size_t i = 0; i < deviceCount && operation == BENCH_READ_TID_CACHED; i++)
+    {
+        RFU6xx_Device* device = RFU6xx_DeviceManager_getDevice(manager, i);
+        RFU6xx_TagCacheStats stats;
+        RFU6xx_TagCache_getStats(device, &stats);
+        UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "tag cache of device %zu: %lu hits, %lu misses",
+            i, (unsigned long) stats.hits, (unsigned long) stats.misses);
+        RFU6xx_TagCache_disable(device);
+    }
+    report(runs, deviceCount, benchOperationNames[operation], payloadSize, (nowNs() - start) / 1e9, dataBytes, out, first);
+
+    for (size_t i = 0; i < deviceCount; i++) free(runs[i].readBuffer);
+    free(runs);
+    UA_String_clear(&writeData);
+}
+
+// Submitter thread of benchmarkExecutor: readTag through the executor, the latency includes queueing
+static void* executorJob (void* context)
+{
+    BenchRun* run = (BenchRun*) context;
+    double cpuStart = clockNs(CLOCK_THREAD_CPUTIME_ID);
+
+    while (nowNs() < run->deadlineNs)
+    {
+        double start = nowNs();
+        RFU6xx_Future* future = RFU6xx_Executor_readTag(run->executor, run->tagId, BENCH_USER_BANK, 0, run->payloadSize, NULL, NULL);
+        if (future == NULL)
+        {
+            run->errors++;
+            continue;
+        }
+        UA_StatusCode retval = RFU6xx_Future_wait(future, 0);
+        if (retval == UA_STATUSCODE_GOOD && RFU6xx_Future_getServerResponseCode(future) == RFU6xx_STATUSCODE_SUCCESS)
+        {
+            addSample(run, (nowNs() - start) / 1e3);
+        }
+        else run->errors++;
+        RFU6xx_Future_release(future);
+    }
+    run->cpuNs = clockNs(CLOCK_THREAD_CPUTIME_ID) - cpuStart;
+    return NULL;
+}
+
+// Runs readTag from threadCount threads on one device shared through an executor
+static void benchmarkExecutor (RFU6xx_Device* device, size_t threadCount, UA_Int32 payloadSize, UA_String tagId,
+    double durationS, FILE* out, UA_Boolean* first)
+{
+    BenchRun* runs = (BenchRun*) calloc(threadCount, sizeof(BenchRun));
+    pthread_t* threads = (pthread_t*) calloc(threadCount, sizeof(pthread_t));
+    RFU6xx_Executor* executor = RFU6xx_Executor_new(device);
+    if (runs == NULL || threads == NULL || executor == NULL)
+    {
+        RFU6xx_Executor_delete(executor);
+        free(threads);
+        free(runs);
+        return;
+    }
+
+    double start = nowNs();
+    size_t started = 0;
+    for (; started < threadCount; started++)
+    {
+        runs[started].operation = BENCH_READ_TAG;
+        runs[started].payloadSize = payloadSize;
+        runs[started].tagId = tagId;
+        runs[started].executor = executor;
+        runs[started].deadlineNs = start + durationS * 1e9;
+        if (pthread_create(&threads[started], NULL, executorJob, &runs[started]) != 0) break;
+    }
+    for (size_t i = 0; i < started; i++) pthread_join(threads[i], NULL);
+    double elapsedS = (nowNs() - start) / 1e9;
+
+    // CPU time of the I/O thread is not part of cpuUsPerOp
+    RFU6xx_ExecutorStats stats;
+    RFU6xx_Executor_getStats(executor, &stats);
+    RFU6xx_Executor_delete(executor);
+    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "executor: %lu commands in %lu calls, %lu coalesced, max batch %lu",
+        (unsigned long) stats.completed, (unsigned long) stats.serviceCalls, (unsigned long) stats.coalesced, (unsigned long) stats.maxBatch);
+
+    report(runs, started, "executorReadTag", payloadSize, elapsedS, 2 * (size_t) payloadSize, out, first);
+    free(threads);
+    free(runs);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+// Scans until a tag was seen and returns its id (empty if no tag was seen within 5 s)
+static UA_String findTag (RFU6xx_Device* device)
+{
+    UA_String tagId = UA_STRING_NULL;
+    if (startScan(device, 0, 0, false) != UA_STATUSCODE_GOOD) return tagId;
+
+    double deadline = nowNs() + 5e9;
+    while (nowNs() < deadline)
+    {
+        if (readLastScanData(device, &tagId) == UA_STATUSCODE_GOOD && tagId.length > 0) break;
+        UA_String_clear(&tagId);
+        usleep(10000);
+    }
+    stopScan(device);
+    return tagId;
+}
+
+static pid_t startMockServer (void)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        execl("./mockserver", "./mockserver", (char*) NULL);
+        _exit(EXIT_FAILURE);
+    }
+    // Give the server time to open its port
+    if (pid > 0) usleep(500000);
+    return pid;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+int main (int argc, char *argv[])
+{
+    const char* endpoint = "opc.tcp://localhost:4840";
+    size_t concurrency = 1;
+    size_t scalingDevices = 0;
+    double durationS = 2;
+    const char* outputFile = NULL;
+    UA_Boolean localServer = false;
+    UA_Int32 payloads[BENCH_MAX_PAYLOADS] = { 4, 16, 64, 256 };
+    size_t payloadsSize = 4;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "e:c:d:p:S:o:l")) != -1)
+    {
+        switch (opt)
+        {
+            case 'e': endpoint = optarg; break;
+            case 'c': concurrency = (size_t) atol(optarg); break;
+            case 'd': durationS = atof(optarg); break;
+            case 'S': scalingDevices = (size_t) atol(optarg); break;
+            case 'o': outputFile = optarg; break;
+            case 'l': localServer = true; break;
+            case 'p':
+                payloadsSize = 0;
+                for (char* token = strtok(optarg, ","); token != NULL && payloadsSize < BENCH_MAX_PAYLOADS; token = strtok(NULL, ","))
+                {
+                    payloads[payloadsSize++] = (UA_Int32) atoi(token);
+                }
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-e endpoint] [-c concurrency] [-d duration s] [-p payload bytes,...] "
+                    "[-S max devices] [-o output.json] [-l]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (concurrency == 0 || durationS <= 0)
+    {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Concurrency and duration must be positive.");
+        return EXIT_FAILURE;
+    }
+
+    pid_t serverPid = 0;
+    if (localServer)
+    {
+        endpoint = "opc.tcp://localhost:4840";
+        serverPid = startMockServer();
+        if (serverPid < 0)
+        {
+            UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Could not start ./mockserver");
+            return EXIT_FAILURE;
+        }
+    }
+
+    size_t deviceCount = scalingDevices > concurrency ? scalingDevices : concurrency;
+    RFU6xx_DeviceManager* manager = RFU6xx_DeviceManager_new(deviceCount);
+    UA_StatusCode retval = manager ? UA_STATUSCODE_GOOD : UA_STATUSCODE_BADOUTOFMEMORY;
+    for (size_t i = 0; i < deviceCount && retval == UA_STATUSCODE_GOOD; i++)
+    {
+        if (RFU6xx_DeviceManager_addDevice(manager, endpoint) == NULL) retval = UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    if (retval == UA_STATUSCODE_GOOD) retval = RFU6xx_DeviceManager_connectAll(manager, NULL, NULL);
+
+    FILE* out = outputFile ? fopen(outputFile, "w") : stdout;
+    if (retval == UA_STATUSCODE_GOOD && out == NULL) retval = UA_STATUSCODE_BADINTERNALERROR;
+
+    if (retval == UA_STATUSCODE_GOOD)
+    {
+        UA_Boolean first = true;
+        fprintf(out, "{\n  \"endpoint\": \"%s\",\n  \"durationS\": %.1f,\n  \"results\": [", endpoint, durationS);
+
+        benchmark(manager, concurrency, BENCH_INIT, 0, UA_STRING_NULL, durationS, out, &first);
+        benchmark(manager, concurrency, BENCH_READ_DEVICE_STATUS, 0, UA_STRING_NULL, durationS, out, &first);
+        benchmark(manager, concurrency, BENCH_READ_LAST_SCAN_DATA, 0, UA_STRING_NULL, durationS, out, &first);
+        benchmark(manager, concurrency, BENCH_START_SCAN, 0, UA_STRING_NULL, durationS, out, &first);
+        benchmark(manager, concurrency, BENCH_STOP_SCAN, 0, UA_STRING_NULL, durationS, out, &first);
+
+        UA_String tagId = findTag(RFU6xx_DeviceManager_getDevice(manager, 0));
+        if (tagId.length == 0) UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "No tag found, readTag and writeTag are skipped.");
+        for (size_t p = 0; p < payloadsSize && tagId.length > 0; p++)
+        {
+            benchmark(manager, concurrency, BENCH_WRITE_TAG, payloads[p], tagId, durationS, out, &first);
+            benchmark(manager, concurrency, BENCH_WRITE_TAG_BYTES, payloads[p], tagId, durationS, out, &first);
+            benchmark(manager, concurrency, BENCH_READ_TAG, payloads[p], tagId, durationS, out, &first);
+            benchmark(manager, concurrency, BENCH_READ_TAG_BYTES, payloads[p], tagId, durationS, out, &first);
+            benchmark(manager, concurrency, BENCH_WRITE_READ_TAG_BYTES, payloads[p], tagId, durationS, out, &first);
+            benchmark(manager, concurrency, BENCH_WRITE_TAG_VERIFIED, payloads[p], tagId, durationS, out, &first);
+        }
+
+        // Threads sharing one device through the executor
+        for (size_t n = 1; n <= 8 && tagId.length > 0; n *= 2)
+        {
+            benchmarkExecutor(RFU6xx_DeviceManager_getDevice(manager, 0), n, payloads[0], tagId, durationS, out, &first);
+        }
+        // TID of the same tag read from the reader and from the tag cache
+        if (tagId.length > 0)
+        {
+            benchmark(manager, concurrency, BENCH_READ_TID, BENCH_TID_SIZE, tagId, durationS, out, &first);
+            benchmark(manager, concurrency, BENCH_READ_TID_CACHED, BENCH_TID_SIZE, tagId, durationS, out, &first);
+        }
+        UA_String_clear(&tagId);
+
+        // Scaling of one device per worker thread: the powers of two below scalingDevices, then scalingDevices once
+        for (size_t n = 1; n <= scalingDevices; n = (2*n > scalingDevices && n < scalingDevices) ? scalingDevices : 2*n)
+        {
+            benchmark(manager, n, BENCH_READ_DEVICE_STATUS, 0, UA_STRING_NULL, durationS, out, &first);
+            if (n >= scalingDevices) break;
+        }
+        fprintf(out, "\n  ]\n}\n");
+    }
+    else
+    {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Benchmark setup failed. ErrorCode: %x", retval);
+    }
+
+    if (out != NULL && out != stdout) fclose(out);
+    RFU6xx_DeviceManager_delete(manager);
+    if (serverPid > 0)
+    {
+        kill(serverPid, SIGTERM);
+        waitpid(serverPid, NULL, 0);
+    }
+    return retval == UA_STATUSCODE_GOOD ? EXIT_SUCCESS : EXIT_FAILURE;
+}
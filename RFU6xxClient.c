@@ -8,10 +8,116 @@
 */
 
 #include "RFU6xxClient.h"
+#include "RFU6xxHex.h"
+#include "RFU6xxMetrics.h"
+#include "RFU6xxScanEvents.h"
+#include "RFU6xxTagCache.h"
 #include <open62541/client_config_default.h>
 #include <open62541/client_highlevel.h>
+#include <open62541/client_subscriptions.h>
 #include <open62541/plugin/log_stdout.h>
 
+#include <pthread.h>
+#include <stddef.h>
+#include <unistd.h>
+
+// Operations of a supervised device first recover a lost connection (see RFU6xx_Device_supervise)
+#define AWAIT_CONNECTION(device) do { \
+        UA_StatusCode connectionRetval = RFU6xx_Device_checkConnection(device); \
+        if (connectionRetval != UA_STATUSCODE_GOOD) return connectionRetval; \
+    } while (0)
+
+// LastScanData subscription of the device (stored as monitored item context). 
+// The device owns it, so it can be re-created after the session was lost.
+typedef struct RFU6xx_LastScanDataSubscription {
+    RFU6xx_LastScanDataCallback callback;
+    void* context;
+    UA_Double samplingInterval;
+    UA_UInt32 queueSize;
+    UA_UInt32 handle;                           // Id returned by subscribeLastScanData (device->nextSubscriptionHandle)
+    UA_UInt32 subscriptionId;                   // Id of the current subscription on the server, 0 if re-creating it failed
+    struct RFU6xx_LastScanDataSubscription* next;
+} LastScanDataSubscription;
+
+// Callbacks and context of an asynchronous ReadTag / WriteTag call.
+// Answered requests are kept in a free list of the device and reused by the next calls.
+typedef struct RFU6xx_TagCallRequest {
+    RFU6xx_ReadTagCallback readCallback;
+    RFU6xx_WriteTagCallback writeCallback;
+    void* context;
+    uint64_t startNs;                           // Send time (metrics)
+    size_t bytesSent;
+    struct RFU6xx_TagCallRequest* next;         // Free list of the device
+} TagCallRequest;
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+RFU6xx_Device* RFU6xx_Device_new (const char* endpointUrl)
+{
+    RFU6xx_Device* device = (RFU6xx_Device*) UA_calloc(1, sizeof(RFU6xx_Device));
+    if (device == NULL) return NULL;
+
+    device->endpointUrl = (char*) UA_malloc(strlen(endpointUrl) + 1);
+    device->client = UA_Client_new();
+    if (device->endpointUrl == NULL || device->client == NULL)
+    {
+        RFU6xx_Device_delete(device);
+        return NULL;
+    }
+    strcpy(device->endpointUrl, endpointUrl);
+
+#ifndef RFU6xx_METRICS_DISABLED
+    device->metrics = (RFU6xx_Metrics*) UA_calloc(1, sizeof(RFU6xx_Metrics));
+    if (device->metrics == NULL)
+    {
+        RFU6xx_Device_delete(device);
+        return NULL;
+    }
+#endif
+
+    // Create client and set default configuration settings, the device is the client context
+    UA_ClientConfig* config = UA_Client_getConfig(device->client);
+    UA_ClientConfig_setDefault(config);
+    config->clientContext = device;
+    device->maxInFlightCalls = RFU6xx_DEFAULT_MAX_IN_FLIGHT_CALLS;
+    device->bankChunkSize = RFU6xx_DEFAULT_BANK_CHUNK_SIZE;
+    device->nextSubscriptionHandle = 1;
+    device->writeRetryPolicy.maxAttempts = RFU6xx_DEFAULT_WRITE_ATTEMPTS;
+    device->writeRetryPolicy.retryDelay = RFU6xx_DEFAULT_WRITE_RETRY_DELAY;
+    return device;
+}
+
+void RFU6xx_Device_delete (RFU6xx_Device* device)
+{
+    if (device == NULL) return;
+    // Deleting the client completes the calls in flight, so their requests are in the free list afterwards
+    if (device->client != NULL) UA_Client_delete(device->client);
+    while (device->freeTagCallRequests != NULL)
+    {
+        TagCallRequest* request = device->freeTagCallRequests;
+        device->freeTagCallRequests = request->next;
+        UA_free(request);
+    }
+    UA_free(device->tagCallParams);
+    while (device->lastScanDataSubscriptions != NULL)
+    {
+        LastScanDataSubscription* sub = device->lastScanDataSubscriptions;
+        device->lastScanDataSubscriptions = sub->next;
+        UA_free(sub);
+    }
+    RFU6xx_ScanEvents_deleteAll(device);
+    UA_free(device->endpointUrl);
+    UA_free(device->metrics);
+    RFU6xx_TagCache_delete(device->tagCache);
+    UA_free(device);
+}
+
+UA_StatusCode RFU6xx_Device_connect (RFU6xx_Device* device)
+{
+    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Client connect to server: %s", device->endpointUrl);
+    return UA_Client_connect(device->client, device->endpointUrl);
+}
+
 // ------------------------------------------------------------------------------------------------------------------------
 
 void serialize32Bit(char** pBit, unsigned int value) 
@@ -45,211 +151,519 @@ uint64_t encodeDouble(double value)
 
 // ------------------------------------------------------------------------------------------------------------------------
 
-UA_StatusCode getChildNodeIdByString (UA_Client* client, UA_Int16 nsStartNode, UA_Int16 idStartNode,  char* searchNodeName, UA_Int16* ndID)
+// Sets a variant that references the data without taking ownership (no copy, not freed by UA_Variant_clear)
+static void setScalarNoDelete (UA_Variant* variant, void* data, const UA_DataType* type)
+{
+    UA_Variant_setScalar(variant, data, type);
+    variant->storageType = UA_VARIANT_DATA_NODELETE;
+}
+
+// Constant input arguments of ReadTag / WriteTag
+static UA_String tagCallCodeType = { sizeof("RAW:STRING") - 1, (UA_Byte*) "RAW:STRING" };
+static UA_String tagCallCodeTypeBytes = { sizeof("RAW:BYTES") - 1, (UA_Byte*) "RAW:BYTES" };
+static UA_String tagCallPassword = { 0, NULL };
+
+// Storage of the ReadTag / WriteTag input arguments, see setTagCallParams
+typedef struct RFU6xx_TagCallParams {
+    UA_Variant variants[RFU6xx_TAG_CALL_PARAMS_SIZE];
+    UA_ExtensionObject eo;
+    unsigned char idBuffer[2*sizeof(UA_Int32) + RFU6xx_MAX_TAG_ID_SIZE];
+    UA_Int16 bank;
+    UA_Int32 offset;
+    UA_Int32 length;
+    UA_String writeData;
+} TagCallParams;
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+UA_StatusCode getChildNodeIdsByStrings (RFU6xx_Device* device, UA_UInt16 nsStartNode, UA_UInt32 idStartNode, 
+    char* searchNodeNames[], UA_UInt32* ndIDs[], size_t searchNodeCount)
 {
+    size_t foundCount = 0;
+    UA_Boolean found[searchNodeCount];
+    memset(found, 0, sizeof(found));
+
+    // Only the browse name is needed, the node id of the target is always returned
     UA_BrowseRequest bReq;
     UA_BrowseRequest_init(&bReq);
     bReq.requestedMaxReferencesPerNode = 0;
     bReq.nodesToBrowse = UA_BrowseDescription_new();
     bReq.nodesToBrowseSize = 1;
     bReq.nodesToBrowse[0].nodeId = UA_NODEID_NUMERIC(nsStartNode, idStartNode);
-    bReq.nodesToBrowse[0].resultMask = UA_BROWSERESULTMASK_ALL;
-    UA_BrowseResponse bResp = UA_Client_Service_browse(client, bReq);
+    bReq.nodesToBrowse[0].resultMask = UA_BROWSERESULTMASK_BROWSENAME;
+    UA_BrowseResponse bResp = UA_Client_Service_browse(device->client, bReq);
+    device->discoveryRoundTrips++;
+
+    // Service errors are passed through, only missing names are reported as BADNOTFOUND
+    UA_StatusCode retval = bResp.responseHeader.serviceResult;
+    if (retval == UA_STATUSCODE_GOOD && bResp.resultsSize != 1) retval = UA_STATUSCODE_BADUNEXPECTEDERROR;
+    if (retval == UA_STATUSCODE_GOOD) retval = bResp.results[0].statusCode;
     
-    for(size_t i = 0; i < bResp.resultsSize; ++i) {
-        for(size_t j = 0; j < bResp.results[i].referencesSize; ++j) {
+    for(size_t i = 0; retval == UA_STATUSCODE_GOOD && i < bResp.resultsSize && foundCount < searchNodeCount; ++i) {
+        for(size_t j = 0; j < bResp.results[i].referencesSize && foundCount < searchNodeCount; ++j) {
             UA_ReferenceDescription *ref = &(bResp.results[i].references[j]);
-            if(ref->nodeId.nodeId.identifierType == UA_NODEIDTYPE_NUMERIC) {
-                if (strcmp(ref->browseName.name.data, searchNodeName) == 0)
+            if(ref->nodeId.nodeId.identifierType != UA_NODEIDTYPE_NUMERIC) continue;
+
+            // Match the browse name against all searched names
+            for (size_t k = 0; k < searchNodeCount; ++k)
+            {
+                if (!found[k] 
+                    && ref->browseName.name.length == strlen(searchNodeNames[k])
+                    && memcmp(ref->browseName.name.data, searchNodeNames[k], ref->browseName.name.length) == 0)
                 {
-                    *ndID = ref->nodeId.nodeId.identifier.numeric;
-                    return UA_STATUSCODE_GOOD;
+                    *ndIDs[k] = ref->nodeId.nodeId.identifier.numeric;
+                    found[k] = true;
+                    foundCount++;
+                    break;
                 }
             }
         }
     }
-    return UA_STATUSCODE_BADNOTFOUND;
+    UA_BrowseRequest_clear(&bReq);
+    UA_BrowseResponse_clear(&bResp);
+
+    if (retval != UA_STATUSCODE_GOOD) return retval;
+    return (foundCount == searchNodeCount) ? UA_STATUSCODE_GOOD : UA_STATUSCODE_BADNOTFOUND;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+UA_StatusCode getChildNodeIdByString (RFU6xx_Device* device, UA_UInt16 nsStartNode, UA_UInt32 idStartNode,  char* searchNodeName, UA_UInt32* ndID)
+{
+    return getChildNodeIdsByStrings(device, nsStartNode, idStartNode, &searchNodeName, &ndID, 1);
 }
 
 // ------------------------------------------------------------------------------------------------------------------------
 
-int tagIdToExtentionObject (UA_String id, UA_ExtensionObject* eo, unsigned char sendBuffer[], int sendBuffSize) 
+int tagIdToExtentionObject (RFU6xx_Device* device, UA_String id, UA_ExtensionObject* eo, unsigned char sendBuffer[], int sendBuffSize) 
 {
     int idLength = id.length;
-    char* pSendBuffer = sendBuffer;
-
-    // Convert UA_String id to char* idString
-    char* idString = (char*)UA_malloc(sizeof(char)*id.length+1);
-    memcpy(idString, id.data, id.length );
-    idString[id.length] = '\0';
-
-    // Convert char* idString to unsigned char sendBuffer
-    // -> converts a hex string into bytes
-    const char *pos = idString;
-    for (int count = 0; count < (id.length/2); count++) {
-        int res = sscanf(pos, "%2hhx", &sendBuffer[count + 8]);
-        if (res != 1){
-            return -1;
-        }
-        pos += 2;
-    }
-    free(idString);
+    char* pSendBuffer = (char*) sendBuffer;
+
+    if ((idLength/2) + 2*(int)sizeof(UA_Int32) > sendBuffSize) return -1;
+
+    // Convert the hex string of the id directly into bytes (behind the 8 byte header)
+    if (hexDecode(id.data, id.length, &sendBuffer[8]) != 0) return -1;
 	
     serialize32Bit(&pSendBuffer, 2);
     serialize32Bit(&pSendBuffer, (idLength/2));
 
     eo->encoding = UA_EXTENSIONOBJECT_ENCODED_BYTESTRING;
-    eo->content.encoded.typeId = UA_NODEID_NUMERIC(nsAutoID, RFU6xx_TAG_ID_E_O_TYPE_ID);
+    eo->content.encoded.typeId = UA_NODEID_NUMERIC(device->nsAutoID, RFU6xx_TAG_ID_E_O_TYPE_ID);
     eo->content.encoded.body.data = (UA_Byte*)sendBuffer;
-    eo->content.encoded.body.length = sendBuffSize;
+    eo->content.encoded.body.length = (idLength/2) + 2*sizeof(UA_Int32);
     return 0;
 }
 
 // ------------------------------------------------------------------------------------------------------------------------
 
-UA_StatusCode get_node_ids(UA_Client* client)
-{
-    UA_StatusCode retval;
-
-    // Search node ID for DeviceSet node (=> is child of root)
-    retval = getChildNodeIdByString(client, 0, UA_NS0ID_OBJECTSFOLDER, "DeviceSet", &ndDeviceSetID);
-    if(retval != UA_STATUSCODE_GOOD) 
-    { 
-        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Init failed could not find node id for DeviceSet");
-        return retval; 
-    }
-    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Node id DeviceSet: %i", ndDeviceSetID);
+// Nodes resolved by get_node_ids: DeviceSet, DeviceSet/RFU6xx and the children DeviceSet/RFU6xx/<name>
+#define RFU6xx_NODE_PATH_COUNT 8
 
-    // Search node ID for RFU6xx node (=> is child of deviceSet)
-    retval = getChildNodeIdByString(client, 2, ndDeviceSetID, "RFU6xx", &ndRfu6xxNodeID);
-    if(retval != UA_STATUSCODE_GOOD) 
-    { 
-        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Init failed could not find node id for Rfu6xx");
-        return retval; 
+// Fallback of get_node_ids for servers with other browse name namespaces: DeviceSet, RFU6xx and its
+// children are browsed one level after the other and matched by name only (3 round trips)
+static UA_StatusCode browseNodeIds (RFU6xx_Device* device, char* nodeNames[], UA_UInt32* nodeIDs[])
+{
+    UA_StatusCode retval = getChildNodeIdByString(device, 0, UA_NS0ID_OBJECTSFOLDER, nodeNames[0], nodeIDs[0]);
+    if (retval == UA_STATUSCODE_GOOD) retval = getChildNodeIdByString(device, device->nsOpcDI, *nodeIDs[0], nodeNames[1], nodeIDs[1]);
+    if (retval == UA_STATUSCODE_GOOD)
+    {
+        retval = getChildNodeIdsByStrings(device, device->nsRfu, *nodeIDs[1], &nodeNames[2], &nodeIDs[2], RFU6xx_NODE_PATH_COUNT - 2);
     }
-    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Node id DeviceSet: %i", ndRfu6xxNodeID);
+    return retval;
+}
 
-    // Search node ID for LastScanData node (=> is child of RFU6xx)
-    retval = getChildNodeIdByString(client, nsRfu, ndRfu6xxNodeID, "LastScanData", &ndLastScanDataID);
-    if(retval != UA_STATUSCODE_GOOD) 
-    { 
-        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Init failed could not find node id for LastScanData");
-        return retval; 
+UA_StatusCode get_node_ids(RFU6xx_Device* device)
+{
+    char* nodeNames[RFU6xx_NODE_PATH_COUNT] = { "DeviceSet", "RFU6xx", 
+        "LastScanData", "WriteTag", "ReadTag", "ScanStart", "ScanStop", "DeviceStatus" };
+    UA_UInt32* nodeIDs[RFU6xx_NODE_PATH_COUNT] = { &device->ndDeviceSetID, &device->ndRfu6xxNodeID, 
+        &device->ndLastScanDataID, &device->ndWriteTagID, &device->ndReadTagID, &device->ndScanStartID, &device->ndScanStopID, &device->ndDeviceStatusID };
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    UA_Boolean pathNotFound = false;
+    device->discoveryRoundTrips = 0;
+    device->ndRfidScanEventTypeID = 0;
+
+    // The browse names are qualified with the namespace indices read from the namespace array as on the
+    // RFU6xx: DeviceSet belongs to DI, the RFU6xx object to the RFU6xx namespace and its children to AutoID.
+    // Servers that name the nodes in other namespaces are handled by browseNodeIds.
+    UA_RelativePathElement elements[RFU6xx_NODE_PATH_COUNT][3];
+    UA_BrowsePath paths[RFU6xx_NODE_PATH_COUNT];
+    for (size_t i = 0; i < RFU6xx_NODE_PATH_COUNT; i++)
+    {
+        *nodeIDs[i] = 0;
+        for (size_t j = 0; j < 3; j++)
+        {
+            UA_RelativePathElement_init(&elements[i][j]);
+            elements[i][j].referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_HIERARCHICALREFERENCES);
+            elements[i][j].includeSubtypes = true;
+        }
+        elements[i][0].targetName = UA_QUALIFIEDNAME(device->nsOpcDI, "DeviceSet");
+        elements[i][1].targetName = UA_QUALIFIEDNAME(device->nsRfu, "RFU6xx");
+        elements[i][2].targetName = UA_QUALIFIEDNAME(device->nsAutoID, nodeNames[i]);
+
+        UA_BrowsePath_init(&paths[i]);
+        paths[i].startingNode = UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER);
+        paths[i].relativePath.elements = elements[i];
+        paths[i].relativePath.elementsSize = i < 2 ? i + 1 : 3;
     }
-    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Node id LastScanData: %i", ndLastScanDataID);
 
-    // Search node ID for WriteTag node (=> is child of RFU6xx)
-    retval = getChildNodeIdByString(client, nsRfu, ndRfu6xxNodeID, "WriteTag", &ndWriteTagID);
-    if(retval != UA_STATUSCODE_GOOD) 
-    { 
-        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Init failed could not find node id for WriteTag");
-        return retval; 
+    // Resolve all paths with one request
+    UA_TranslateBrowsePathsToNodeIdsRequest tReq;
+    UA_TranslateBrowsePathsToNodeIdsRequest_init(&tReq);
+    tReq.browsePaths = paths;
+    tReq.browsePathsSize = RFU6xx_NODE_PATH_COUNT;
+    UA_TranslateBrowsePathsToNodeIdsResponse tResp = UA_Client_Service_translateBrowsePathsToNodeIds(device->client, tReq);
+    device->discoveryRoundTrips++;
+
+    UA_StatusCode serviceResult = tResp.responseHeader.serviceResult;
+    if (serviceResult == UA_STATUSCODE_GOOD && tResp.resultsSize != RFU6xx_NODE_PATH_COUNT) serviceResult = UA_STATUSCODE_BADUNEXPECTEDERROR;
+    if (serviceResult != UA_STATUSCODE_GOOD)
+    {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Init failed, TranslateBrowsePathsToNodeIds failed. ErrorCode: %x", serviceResult);
+        UA_TranslateBrowsePathsToNodeIdsResponse_clear(&tResp);
+        return serviceResult;
     }
-    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Node id WriteTag: %i", ndWriteTagID);
 
-    // Search node ID for ReadTag node (=> is child of RFU6xx)
-    retval = getChildNodeIdByString(client, nsRfu, ndRfu6xxNodeID, "ReadTag", &ndReadTagID);
-    if(retval != UA_STATUSCODE_GOOD) 
-    { 
-        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Init failed could not find node id for ReadTag");
-        return retval; 
-    }
-    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Node id ReadTag: %i", ndReadTagID);
+    for (size_t i = 0; i < RFU6xx_NODE_PATH_COUNT; i++)
+    {
+        UA_BrowsePathResult* result = &tResp.results[i];
+        UA_StatusCode pathResult = result->statusCode;
+        if (pathResult == UA_STATUSCODE_GOOD && result->targetsSize == 0) pathResult = UA_STATUSCODE_BADNOTFOUND;
 
-    // Search node ID for ScanStart node (=> is child of RFU6xx)
-    retval = getChildNodeIdByString(client, nsRfu, ndRfu6xxNodeID, "ScanStart", &ndScanStartID);
-    if(retval != UA_STATUSCODE_GOOD) 
-    { 
-        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Init failed could not find node id for ScanStart");
-        return retval; 
-    }
-    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Node id ScanStart: %i", ndScanStartID);
+        // Only numeric node ids are stored
+        if (pathResult == UA_STATUSCODE_GOOD)
+        {
+            const UA_ExpandedNodeId* target = &result->targets[0].targetId;
+            if (result->targets[0].remainingPathIndex != UA_UINT32_MAX || target->serverIndex != 0
+                || target->nodeId.identifierType != UA_NODEIDTYPE_NUMERIC)
+            {
+                pathResult = UA_STATUSCODE_BADNODEIDUNKNOWN;
+            }
+            else
+            {
+                *nodeIDs[i] = target->nodeId.identifier.numeric;
+            }
+        }
 
-    // Search node ID for ScanStop node (=> is child of RFU6xx)
-    retval = getChildNodeIdByString(client, nsRfu, ndRfu6xxNodeID, "ScanStop", &ndScanStopID);
-    if(retval != UA_STATUSCODE_GOOD) 
-    { 
-        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Init failed could not find node id for ScanStop");
-        return retval; 
+        if (pathResult == UA_STATUSCODE_BADNOPATHFOUND)
+        {
+            pathNotFound = true;
+        }
+        else if (pathResult != UA_STATUSCODE_GOOD)
+        {
+            UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Init failed could not find node id for %s. ErrorCode: %x", nodeNames[i], pathResult);
+            if (retval == UA_STATUSCODE_GOOD) retval = pathResult;
+        }
+        else
+        {
+            UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Node id %s: %u", nodeNames[i], *nodeIDs[i]);
+        }
     }
-    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Node id ScanStop: %i", ndScanStopID);
+    UA_TranslateBrowsePathsToNodeIdsResponse_clear(&tResp);
+    if(retval != UA_STATUSCODE_GOOD) return retval;
 
-    // Search node ID for DeviceStatus node (=> is child of RFU6xx)
-    retval = getChildNodeIdByString(client, nsRfu, ndRfu6xxNodeID, "DeviceStatus", &ndDeviceStatusID);
-    if(retval != UA_STATUSCODE_GOOD) 
-    { 
-        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Init failed could not find node id for DeviceStatus");
-        return retval; 
+    if (pathNotFound)
+    {
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Browse paths not found, matching the browse names regardless of namespace");
+        for (size_t i = 0; i < RFU6xx_NODE_PATH_COUNT; i++) *nodeIDs[i] = 0;
+        retval = browseNodeIds(device, nodeNames, nodeIDs);
+        for (size_t i = 0; i < RFU6xx_NODE_PATH_COUNT; i++)
+        {
+            if (*nodeIDs[i] == 0) UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Init failed could not find node id for %s", nodeNames[i]);
+            else UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Node id %s: %u", nodeNames[i], *nodeIDs[i]);
+        }
+        if (retval != UA_STATUSCODE_GOOD) return retval;
     }
-    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Node id DeviceStatus: %i", ndDeviceStatusID);
 
+    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Node discovery finished with %u round trips", device->discoveryRoundTrips);
     return UA_STATUSCODE_GOOD;
 }
 
 // ------------------------------------------------------------------------------------------------------------------------
 
-UA_StatusCode get_namespace_index(UA_Client* client)
+UA_StatusCode get_namespace_index(RFU6xx_Device* device)
 {
     UA_StatusCode retval;
 
     // Search namespace index for "http://opcfoundation.org/UA/AutoID/"
     UA_String nsAutoIDStr = UA_String_fromChars("http://opcfoundation.org/UA/AutoID/");
-    retval = UA_Client_NamespaceGetIndex(client, &nsAutoIDStr, &nsAutoID);
+    retval = UA_Client_NamespaceGetIndex(device->client, &nsAutoIDStr, &device->nsAutoID);
     if(retval != UA_STATUSCODE_GOOD) 
     { 
         UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Init failed could not find namespace index for Auto ID");
         return retval; 
     }
-    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Namespace index AutoID: %i", nsAutoID);
+    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Namespace index AutoID: %i", device->nsAutoID);
     
     // Search namespace index for "http://opcfoundation.org/UA/DI/"
     UA_String nsOpcDIStr = UA_String_fromChars("http://opcfoundation.org/UA/DI/");
-    retval = UA_Client_NamespaceGetIndex(client, &nsOpcDIStr, &nsOpcDI);
+    retval = UA_Client_NamespaceGetIndex(device->client, &nsOpcDIStr, &device->nsOpcDI);
     if(retval != UA_STATUSCODE_GOOD) 
     { 
         UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Init failed could not find namespace index for Opc DI");
         return retval; 
     }
-    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Namespace index OpcDI: %i", nsOpcDI);
+    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Namespace index OpcDI: %i", device->nsOpcDI);
 
     // Search namespace index for "http://www.sick.com/RFU6xx/"
     UA_String nsRfuStr = UA_String_fromChars("http://www.sick.com/RFU6xx/");
-    retval = UA_Client_NamespaceGetIndex(client, &nsRfuStr, &nsRfu);
+    retval = UA_Client_NamespaceGetIndex(device->client, &nsRfuStr, &device->nsRfu);
     if(retval != UA_STATUSCODE_GOOD) 
     { 
         UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Init failed could not find namespace index for Rfu ID");
         return retval; 
     }
-    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Namespace index Rfu: %i", nsRfu);
+    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Namespace index Rfu: %i", device->nsRfu);
 
     return UA_STATUSCODE_GOOD;
 }
 
 // ------------------------------------------------------------------------------------------------------------------------
 
-UA_StatusCode init (UA_Client* client) 
+UA_StatusCode init (RFU6xx_Device* device) 
 {
     UA_StatusCode retval;
+    RFU6xx_METRICS_START(start);
     
-    retval = get_namespace_index(client);
-    if (retval != UA_STATUSCODE_GOOD) return retval;
+    retval = get_namespace_index(device);
+    if (retval == UA_STATUSCODE_GOOD) retval = get_node_ids(device);
+
+    RFU6xx_METRICS_RECORD(device, RFU6xx_OPERATION_INIT, start, retval, RFU6xx_STATUSCODE_SUCCESS, 0, 0);
+    return retval;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+// Node ids stored in one cache entry after the three namespace indices (order of the file format)
+static const size_t cachedNodeIdOffsets[] = { 
+    offsetof(RFU6xx_Device, ndDeviceSetID), offsetof(RFU6xx_Device, ndRfu6xxNodeID), 
+    offsetof(RFU6xx_Device, ndLastScanDataID), offsetof(RFU6xx_Device, ndWriteTagID), 
+    offsetof(RFU6xx_Device, ndReadTagID), offsetof(RFU6xx_Device, ndScanStartID), 
+    offsetof(RFU6xx_Device, ndScanStopID), offsetof(RFU6xx_Device, ndDeviceStatusID) 
+};
+#define CACHED_NODE_ID_COUNT (sizeof(cachedNodeIdOffsets) / sizeof(cachedNodeIdOffsets[0]))
+#define CACHED_ID_COUNT (3 + CACHED_NODE_ID_COUNT)
+#define CACHED_NODE_ID(device, i) ((UA_UInt32*) ((char*) (device) + cachedNodeIdOffsets[i]))
+#define CACHE_LINE_SIZE 1024
+
+static pthread_mutex_t cacheFileMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t fnv1a (uint64_t hash, const UA_Byte* data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static uint64_t fnv1aString (uint64_t hash, const UA_String* str)
+{
+    // Hash the length too, so that ("ab","c") and ("a","bc") differ
+    uint64_t length = str->length;
+    hash = fnv1a(hash, (const UA_Byte*) &length, sizeof(length));
+    return fnv1a(hash, str->data, str->length);
+}
+
+// Reads namespace array and build info with one read request and hashes them
+static UA_StatusCode readServerFingerprint (RFU6xx_Device* device, uint64_t* fingerprint)
+{
+    UA_ReadValueId ids[2];
+    UA_ReadValueId_init(&ids[0]);
+    ids[0].nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_NAMESPACEARRAY);
+    ids[0].attributeId = UA_ATTRIBUTEID_VALUE;
+    UA_ReadValueId_init(&ids[1]);
+    ids[1].nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERSTATUS_BUILDINFO);
+    ids[1].attributeId = UA_ATTRIBUTEID_VALUE;
+
+    UA_ReadRequest rReq;
+    UA_ReadRequest_init(&rReq);
+    rReq.nodesToRead = ids;
+    rReq.nodesToReadSize = 2;
+    UA_ReadResponse rResp = UA_Client_Service_read(device->client, rReq);
+
+    UA_StatusCode retval = rResp.responseHeader.serviceResult;
+    if (retval == UA_STATUSCODE_GOOD && rResp.resultsSize != 2) retval = UA_STATUSCODE_BADNOTFOUND;
+    if (retval != UA_STATUSCODE_GOOD)
+    {
+        UA_ReadResponse_clear(&rResp);
+        return retval;
+    }
+
+    UA_Variant* namespaces = &rResp.results[0].value;
+    UA_Variant* buildInfoValue = &rResp.results[1].value;
+    if (!UA_Variant_hasArrayType(namespaces, &UA_TYPES[UA_TYPES_STRING])
+        || !UA_Variant_hasScalarType(buildInfoValue, &UA_TYPES[UA_TYPES_BUILDINFO]))
+    {
+        UA_ReadResponse_clear(&rResp);
+        return UA_STATUSCODE_BADTYPEMISMATCH;
+    }
+
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < namespaces->arrayLength; i++)
+    {
+        hash = fnv1aString(hash, &((UA_String*) namespaces->data)[i]);
+    }
+    UA_BuildInfo* buildInfo = (UA_BuildInfo*) buildInfoValue->data;
+    hash = fnv1aString(hash, &buildInfo->productUri);
+    hash = fnv1aString(hash, &buildInfo->softwareVersion);
+    hash = fnv1aString(hash, &buildInfo->buildNumber);
+    hash = fnv1a(hash, (const UA_Byte*) &buildInfo->buildDate, sizeof(buildInfo->buildDate));
+    *fingerprint = hash;
+
+    UA_ReadResponse_clear(&rResp);
+    return UA_STATUSCODE_GOOD;
+}
+
+// Parses one cache line: <endpoint> <fingerprint> <id> ... <id>
+static int parseCacheLine (char* line, char* endpoint, uint64_t* fingerprint, long ids[])
+{
+    char* pos;
+    char* end;
+
+    pos = strchr(line, ' ');
+    if (pos == NULL || pos - line >= CACHE_LINE_SIZE) return -1;
+    memcpy(endpoint, line, pos - line);
+    endpoint[pos - line] = '\0';
+
+    *fingerprint = strtoull(pos, &end, 16);
+    if (end == pos) return -1;
+    pos = end;
+
+    for (size_t i = 0; i < CACHED_ID_COUNT; i++)
+    {
+        ids[i] = strtol(pos, &end, 10);
+        if (end == pos || ids[i] < 0) return -1;
+        pos = end;
+    }
+    return 0;
+}
+
+static UA_StatusCode loadNodeIdCache (RFU6xx_Device* device, const char* cacheFile, uint64_t fingerprint)
+{
+    char line[CACHE_LINE_SIZE];
+    char endpoint[CACHE_LINE_SIZE];
+    uint64_t entryFingerprint;
+    long ids[CACHED_ID_COUNT];
+
+    FILE* file = fopen(cacheFile, "r");
+    if (file == NULL) return UA_STATUSCODE_BADNOTFOUND;
+
+    UA_StatusCode retval = UA_STATUSCODE_BADNOTFOUND;
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        if (parseCacheLine(line, endpoint, &entryFingerprint, ids) != 0) continue;
+        if (strcmp(endpoint, device->endpointUrl) != 0) continue;
+
+        // Entry for this endpoint found, it is only valid for the same server fingerprint
+        if (entryFingerprint == fingerprint)
+        {
+            device->nsAutoID = (UA_UInt16) ids[0];
+            device->nsOpcDI = (UA_UInt16) ids[1];
+            device->nsRfu = (UA_UInt16) ids[2];
+            for (size_t i = 0; i < CACHED_NODE_ID_COUNT; i++) *CACHED_NODE_ID(device, i) = (UA_UInt32) ids[3 + i];
+            retval = UA_STATUSCODE_GOOD;
+        }
+        break;
+    }
+    fclose(file);
+    return retval;
+}
+
+static UA_StatusCode storeNodeIdCache (RFU6xx_Device* device, const char* cacheFile, uint64_t fingerprint)
+{
+    char line[CACHE_LINE_SIZE];
+    char endpoint[CACHE_LINE_SIZE];
+    uint64_t entryFingerprint;
+    long ids[CACHED_ID_COUNT];
+
+    char tmpFile[CACHE_LINE_SIZE];
+    if (snprintf(tmpFile, sizeof(tmpFile), "%s.tmp", cacheFile) >= (int) sizeof(tmpFile)) return UA_STATUSCODE_BADINTERNALERROR;
+
+    FILE* out = fopen(tmpFile, "w");
+    if (out == NULL) return UA_STATUSCODE_BADINTERNALERROR;
+
+    // Copy the entries of the other endpoints
+    FILE* in = fopen(cacheFile, "r");
+    if (in != NULL)
+    {
+        while (fgets(line, sizeof(line), in) != NULL)
+        {
+            char entry[CACHE_LINE_SIZE];
+            memcpy(entry, line, sizeof(line));
+            if (parseCacheLine(line, endpoint, &entryFingerprint, ids) != 0) continue;
+            if (strcmp(endpoint, device->endpointUrl) == 0) continue;
+            fputs(entry, out);
+        }
+        fclose(in);
+    }
+
+    // Append the entry of this endpoint
+    fprintf(out, "%s %016llx %u %u %u", device->endpointUrl, (unsigned long long) fingerprint, 
+        device->nsAutoID, device->nsOpcDI, device->nsRfu);
+    for (size_t i = 0; i < CACHED_NODE_ID_COUNT; i++) fprintf(out, " %u", *CACHED_NODE_ID(device, i));
+    fprintf(out, "\n");
+
+    if (fclose(out) != 0 || rename(tmpFile, cacheFile) != 0)
+    {
+        remove(tmpFile);
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode initCached (RFU6xx_Device* device, const char* cacheFile)
+{
+    uint64_t fingerprint;
+    UA_StatusCode retval;
+
+    // The fingerprint read is the only request needed with a valid cache entry
+    retval = readServerFingerprint(device, &fingerprint);
+    if (retval != UA_STATUSCODE_GOOD)
+    {
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Could not read server fingerprint, node id cache is not used");
+        return init(device);
+    }
+
+    device->serverFingerprint = fingerprint;
+
+    // Several devices may share one cache file
+    pthread_mutex_lock(&cacheFileMutex);
+    retval = loadNodeIdCache(device, cacheFile, fingerprint);
+    pthread_mutex_unlock(&cacheFileMutex);
+    if (retval == UA_STATUSCODE_GOOD)
+    {
+        UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Namespace indices and node ids loaded from cache %s", cacheFile);
+        return UA_STATUSCODE_GOOD;
+    }
 
-    retval = get_node_ids(client);
+    retval = init(device);
     if (retval != UA_STATUSCODE_GOOD) return retval;
 
+    pthread_mutex_lock(&cacheFileMutex);
+    retval = storeNodeIdCache(device, cacheFile, fingerprint);
+    pthread_mutex_unlock(&cacheFileMutex);
+    if (retval != UA_STATUSCODE_GOOD)
+    {
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Could not write node id cache %s", cacheFile);
+    }
     return UA_STATUSCODE_GOOD;
 }
 
 // ------------------------------------------------------------------------------------------------------------------------
 
-UA_StatusCode readLastScanData (UA_Client* client, UA_String* lastScanData) 
+UA_StatusCode readLastScanData (RFU6xx_Device* device, UA_String* lastScanData) 
 {
+    AWAIT_CONNECTION(device);
     UA_Variant readData;
     UA_StatusCode retval;
+    RFU6xx_METRICS_START(start);
 
     // Read value
-    retval = UA_Client_readValueAttribute(client, 
-        UA_NODEID_NUMERIC(nsRfu, ndLastScanDataID), 
+    retval = UA_Client_readValueAttribute(device->client, 
+        UA_NODEID_NUMERIC(device->nsRfu, device->ndLastScanDataID), 
         &readData);
 
     // Check if read was successfully
@@ -258,26 +672,128 @@ UA_StatusCode readLastScanData (UA_Client* client, UA_String* lastScanData)
         // Check if value type is string
         if (UA_Variant_hasScalarType(&readData, &UA_TYPES[UA_TYPES_STRING])) 
         {
+            // Move the string out of the variant, the caller owns it
             *lastScanData = *(UA_String *) readData.data;
+            *(UA_String *) readData.data = UA_STRING_NULL;
         } 
         else 
         {
-            return UA_STATUSCODE_BADTYPEMISMATCH;
+            retval = UA_STATUSCODE_BADTYPEMISMATCH;
         }
+        UA_Variant_clear(&readData);
     }   
+    RFU6xx_METRICS_RECORD(device, RFU6xx_OPERATION_READ_LAST_SCAN_DATA, start, retval, RFU6xx_STATUSCODE_SUCCESS, 
+        0, retval == UA_STATUSCODE_GOOD ? lastScanData->length : 0);
     return retval;
 }
 
 // ------------------------------------------------------------------------------------------------------------------------
 
-UA_StatusCode readDeviceStatus (UA_Client* client, UA_Int32* deviceStatus) 
+static void lastScanDataChanged (UA_Client* client, UA_UInt32 subId, void* subContext, 
+    UA_UInt32 monId, void* monContext, UA_DataValue* value)
+{
+    LastScanDataSubscription* sub = (LastScanDataSubscription*) monContext;
+    RFU6xx_Device* device = (RFU6xx_Device*) UA_Client_getContext(client);
+
+    // Check if value type is string
+    if (!value->hasValue || !UA_Variant_hasScalarType(&value->value, &UA_TYPES[UA_TYPES_STRING]))
+    {
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "LastScanData notification without string value");
+        return;
+    }
+    sub->callback(device, (UA_String *) value->value.data, sub->context);
+}
+
+// Creates the subscription and the monitored item of sub on the server
+static UA_StatusCode createLastScanDataSubscription (RFU6xx_Device* device, LastScanDataSubscription* sub)
+{
+    // Create subscription, the publishing interval follows the sampling interval
+    UA_CreateSubscriptionRequest subReq = UA_CreateSubscriptionRequest_default();
+    subReq.requestedPublishingInterval = sub->samplingInterval;
+    UA_CreateSubscriptionResponse subResp = UA_Client_Subscriptions_create(device->client, subReq, NULL, NULL, NULL);
+    if (subResp.responseHeader.serviceResult != UA_STATUSCODE_GOOD)
+    {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Could not create subscription for LastScanData");
+        return subResp.responseHeader.serviceResult;
+    }
+
+    // Create monitored item on LastScanData node
+    UA_MonitoredItemCreateRequest monReq = UA_MonitoredItemCreateRequest_default(UA_NODEID_NUMERIC(device->nsRfu, device->ndLastScanDataID));
+    monReq.requestedParameters.samplingInterval = sub->samplingInterval;
+    monReq.requestedParameters.queueSize = sub->queueSize;
+    monReq.requestedParameters.discardOldest = true;
+    UA_MonitoredItemCreateResult monResp = UA_Client_MonitoredItems_createDataChange(device->client, subResp.subscriptionId, 
+        UA_TIMESTAMPSTORETURN_SOURCE, monReq, sub, lastScanDataChanged, NULL);
+    if (monResp.statusCode != UA_STATUSCODE_GOOD)
+    {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Could not create monitored item for LastScanData");
+        UA_Client_Subscriptions_deleteSingle(device->client, subResp.subscriptionId);
+        return monResp.statusCode;
+    }
+    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "LastScanData subscription: %u, monitored item: %u", 
+        subResp.subscriptionId, monResp.monitoredItemId);
+
+    sub->subscriptionId = subResp.subscriptionId;
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode subscribeLastScanData (RFU6xx_Device* device, UA_Double samplingInterval, UA_UInt32 queueSize, 
+    RFU6xx_LastScanDataCallback callback, void* context, UA_UInt32* subscriptionId)
+{
+    AWAIT_CONNECTION(device);
+
+    LastScanDataSubscription* sub = (LastScanDataSubscription*) UA_calloc(1, sizeof(LastScanDataSubscription));
+    if (sub == NULL) return UA_STATUSCODE_BADOUTOFMEMORY;
+    sub->callback = callback;
+    sub->context = context;
+    sub->samplingInterval = samplingInterval;
+    sub->queueSize = queueSize;
+
+    UA_StatusCode retval = createLastScanDataSubscription(device, sub);
+    if (retval != UA_STATUSCODE_GOOD)
+    {
+        UA_free(sub);
+        return retval;
+    }
+    sub->handle = device->nextSubscriptionHandle++;
+    sub->next = device->lastScanDataSubscriptions;
+    device->lastScanDataSubscriptions = sub;
+
+    *subscriptionId = sub->handle;
+    return UA_STATUSCODE_GOOD;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+UA_StatusCode unsubscribeLastScanData (RFU6xx_Device* device, UA_UInt32 subscriptionId)
+{
+    for (LastScanDataSubscription** pSub = &device->lastScanDataSubscriptions; *pSub != NULL; pSub = &(*pSub)->next)
+    {
+        LastScanDataSubscription* sub = *pSub;
+        if (sub->handle != subscriptionId) continue;
+
+        // Deleting the subscription also deletes the monitored item
+        UA_StatusCode retval = UA_STATUSCODE_GOOD;
+        if (sub->subscriptionId != 0) retval = UA_Client_Subscriptions_deleteSingle(device->client, sub->subscriptionId);
+        *pSub = sub->next;
+        UA_free(sub);
+        return retval;
+    }
+    return UA_STATUSCODE_BADSUBSCRIPTIONIDINVALID;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+UA_StatusCode readDeviceStatus (RFU6xx_Device* device, UA_Int32* deviceStatus) 
 {
+    AWAIT_CONNECTION(device);
     UA_Variant readData;
     UA_StatusCode retval;
+    RFU6xx_METRICS_START(start);
 
     // Read value
-    retval = UA_Client_readValueAttribute(client, 
-        UA_NODEID_NUMERIC(nsRfu, ndDeviceStatusID), 
+    retval = UA_Client_readValueAttribute(device->client, 
+        UA_NODEID_NUMERIC(device->nsRfu, device->ndDeviceStatusID), 
         &readData);
 
     // Check if read was successfully
@@ -287,43 +803,146 @@ UA_StatusCode readDeviceStatus (UA_Client* client, UA_Int32* deviceStatus)
         if (UA_Variant_hasScalarType(&readData, &UA_TYPES[UA_TYPES_INT32])) 
         {
             *deviceStatus = *(UA_Int32 *) readData.data;
+            device->deviceStatus = (RFU6xx_DeviceStatusCode) *deviceStatus;
+            device->deviceStatusValid = true;
         } 
         else 
         {
-            return UA_STATUSCODE_BADTYPEMISMATCH;
+            retval = UA_STATUSCODE_BADTYPEMISMATCH;
         }
+        UA_Variant_clear(&readData);
     }   
+    RFU6xx_METRICS_RECORD(device, RFU6xx_OPERATION_READ_DEVICE_STATUS, start, retval, RFU6xx_STATUSCODE_SUCCESS, 0, 0);
     return retval;
 }
 
 // ------------------------------------------------------------------------------------------------------------------------
 
-UA_StatusCode stopScan (UA_Client* client)
+// Checks the precondition of startScan / stopScan against the tracked device status.
+// The server is only asked if the tracked status is unknown, does not match or strict mode is on.
+static UA_StatusCode checkDeviceStatus (RFU6xx_Device* device, RFU6xx_DeviceStatusCode expectedStatus, const char* functionName)
 {
-    RFU6xx_DeviceStatusCode deviceStatus;
-    UA_StatusCode retval = readDeviceStatus(client, &deviceStatus);
+    if (!device->strictStatusCheck && device->deviceStatusValid && device->deviceStatus == expectedStatus)
+    {
+        return UA_STATUSCODE_GOOD;
+    }
 
+    // Re-verify, the tracked status is unknown or does not match
+    UA_Int32 deviceStatus;
+    UA_StatusCode retval = readDeviceStatus(device, &deviceStatus);
     if (retval != UA_STATUSCODE_GOOD)
     {
         return retval;
     } 
-    else if (deviceStatus != RFU6xx_DEVICESTATUSCODE_SCANNING)
+    else if ((RFU6xx_DeviceStatusCode) deviceStatus != expectedStatus)
     {
-        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "The stop scan function was called, but the device is in the status:: %i", deviceStatus);
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "The %s function was called, but the device is in the status:: %i", functionName, deviceStatus);
         return UA_STATUSCODE_BADINVALIDSTATE;
     }
+    return UA_STATUSCODE_GOOD;
+}
+
+// Updates the tracked device status after a ScanStart / ScanStop call
+static void trackDeviceStatus (RFU6xx_Device* device, UA_StatusCode callResult, RFU6xx_DeviceStatusCode newStatus)
+{
+    if (callResult == UA_STATUSCODE_GOOD)
+    {
+        device->deviceStatus = newStatus;
+        device->deviceStatusValid = true;
+    }
+    else
+    {
+        // The state of the device is unknown after a failed call
+        device->deviceStatusValid = false;
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+static void deviceStatusChanged (UA_Client* client, UA_UInt32 subId, void* subContext, 
+    UA_UInt32 monId, void* monContext, UA_DataValue* value)
+{
+    RFU6xx_Device* device = (RFU6xx_Device*) UA_Client_getContext(client);
+
+    if (value->hasValue && UA_Variant_hasScalarType(&value->value, &UA_TYPES[UA_TYPES_INT32]))
+    {
+        device->deviceStatus = (RFU6xx_DeviceStatusCode) *(UA_Int32 *) value->value.data;
+        device->deviceStatusValid = true;
+    }
+    else
+    {
+        device->deviceStatusValid = false;
+    }
+}
+
+static void deviceStatusSubscriptionDeleted (UA_Client* client, UA_UInt32 subId, void* subContext)
+{
+    RFU6xx_Device* device = (RFU6xx_Device*) UA_Client_getContext(client);
+
+    // Without notifications the tracked status can not be trusted anymore
+    if (device->deviceStatusSubscriptionId == subId)
+    {
+        device->deviceStatusSubscriptionId = 0;
+        device->deviceStatusValid = false;
+    }
+}
+
+UA_StatusCode subscribeDeviceStatus (RFU6xx_Device* device, UA_Double samplingInterval)
+{
+    AWAIT_CONNECTION(device);
+    if (device->deviceStatusSubscriptionId != 0) return UA_STATUSCODE_GOOD;
+
+    UA_CreateSubscriptionRequest subReq = UA_CreateSubscriptionRequest_default();
+    subReq.requestedPublishingInterval = samplingInterval;
+    UA_CreateSubscriptionResponse subResp = UA_Client_Subscriptions_create(device->client, subReq, 
+        NULL, NULL, deviceStatusSubscriptionDeleted);
+    if (subResp.responseHeader.serviceResult != UA_STATUSCODE_GOOD)
+    {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Could not create subscription for DeviceStatus");
+        return subResp.responseHeader.serviceResult;
+    }
 
-    // Call StartScan methode with no params
-    return UA_Client_call(client, 
-        UA_NODEID_NUMERIC(nsRfu, ndRfu6xxNodeID),
-        UA_NODEID_NUMERIC(nsRfu, ndScanStopID),
-        0 , NULL, NULL, NULL);
+    UA_MonitoredItemCreateRequest monReq = UA_MonitoredItemCreateRequest_default(UA_NODEID_NUMERIC(device->nsRfu, device->ndDeviceStatusID));
+    monReq.requestedParameters.samplingInterval = samplingInterval;
+    UA_MonitoredItemCreateResult monResp = UA_Client_MonitoredItems_createDataChange(device->client, subResp.subscriptionId, 
+        UA_TIMESTAMPSTORETURN_NEITHER, monReq, NULL, deviceStatusChanged, NULL);
+    if (monResp.statusCode != UA_STATUSCODE_GOOD)
+    {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Could not create monitored item for DeviceStatus");
+        UA_Client_Subscriptions_deleteSingle(device->client, subResp.subscriptionId);
+        return monResp.statusCode;
+    }
+
+    device->deviceStatusSubscriptionId = subResp.subscriptionId;
+    device->deviceStatusSamplingInterval = samplingInterval;
+    return UA_STATUSCODE_GOOD;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+UA_StatusCode stopScan (RFU6xx_Device* device)
+{
+    AWAIT_CONNECTION(device);
+    RFU6xx_METRICS_START(start);
+    UA_StatusCode retval = checkDeviceStatus(device, RFU6xx_DEVICESTATUSCODE_SCANNING, "stop scan");
+    if (retval == UA_STATUSCODE_GOOD) 
+    {
+        // Call StopScan methode with no params
+        retval = UA_Client_call(device->client, 
+            UA_NODEID_NUMERIC(device->nsRfu, device->ndRfu6xxNodeID),
+            UA_NODEID_NUMERIC(device->nsRfu, device->ndScanStopID),
+            0 , NULL, NULL, NULL);
+        trackDeviceStatus(device, retval, RFU6xx_DEVICESTATUSCODE_IDLE);
+    }
+    RFU6xx_METRICS_RECORD(device, RFU6xx_OPERATION_STOP_SCAN, start, retval, RFU6xx_STATUSCODE_SUCCESS, 0, 0);
+    return retval;
 }
 
 // ------------------------------------------------------------------------------------------------------------------------
 
-UA_StatusCode startScan (UA_Client* client, UA_Double duration, UA_Int32 cycle, UA_Boolean dataAvailable)
+UA_StatusCode startScan (RFU6xx_Device* device, UA_Double duration, UA_Int32 cycle, UA_Boolean dataAvailable)
 {
+    AWAIT_CONNECTION(device);
     size_t sendParamsSize = 1;
     UA_Variant sendParams[sendParamsSize];
 
@@ -336,17 +955,12 @@ UA_StatusCode startScan (UA_Client* client, UA_Double duration, UA_Int32 cycle,
     char sendBuffer[sendBuffSize];
 	char* pSendBuffer = sendBuffer;
 
-    RFU6xx_DeviceStatusCode deviceStatus;
-    UA_StatusCode retval = readDeviceStatus(client, &deviceStatus);
-
-    if (retval != UA_STATUSCODE_GOOD)
+    RFU6xx_METRICS_START(start);
+    UA_StatusCode retval = checkDeviceStatus(device, RFU6xx_DEVICESTATUSCODE_IDLE, "start scan");
+    if (retval != UA_STATUSCODE_GOOD) 
     {
+        RFU6xx_METRICS_RECORD(device, RFU6xx_OPERATION_START_SCAN, start, retval, RFU6xx_STATUSCODE_SUCCESS, 0, 0);
         return retval;
-    } 
-    else if (deviceStatus != RFU6xx_DEVICESTATUSCODE_IDLE)
-    {
-        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "The start scan function was called, but the device is in the status:: %i", deviceStatus);
-        return UA_STATUSCODE_BADINVALIDSTATE;
     }
 
     // Serialize parameters to byte array
@@ -357,124 +971,1233 @@ UA_StatusCode startScan (UA_Client* client, UA_Double duration, UA_Int32 cycle,
 
     // Convert byte array to extension object
     eo.encoding = UA_EXTENSIONOBJECT_ENCODED_BYTESTRING;
-    eo.content.encoded.typeId = UA_NODEID_NUMERIC(nsAutoID, RFU6xx_START_SCAN_E_O_TYPE_ID);
+    eo.content.encoded.typeId = UA_NODEID_NUMERIC(device->nsAutoID, RFU6xx_START_SCAN_E_O_TYPE_ID);
     eo.content.encoded.body.data = (UA_Byte*)sendBuffer;
     eo.content.encoded.body.length = sendBuffSize;
-    UA_Variant_setScalarCopy(sendParams, &eo, &UA_TYPES[UA_TYPES_EXTENSIONOBJECT]);        
+    setScalarNoDelete(sendParams, &eo, &UA_TYPES[UA_TYPES_EXTENSIONOBJECT]);        
 
     // Call StartScan methode with params
-    retval = UA_Client_call(client, 
-        UA_NODEID_NUMERIC(nsRfu, ndRfu6xxNodeID),
-        UA_NODEID_NUMERIC(nsRfu, ndScanStartID), 
+    retval = UA_Client_call(device->client, 
+        UA_NODEID_NUMERIC(device->nsRfu, device->ndRfu6xxNodeID),
+        UA_NODEID_NUMERIC(device->nsRfu, device->ndScanStartID), 
         sendParamsSize, sendParams, &retParamsSize, &retParams);
+    trackDeviceStatus(device, retval, RFU6xx_DEVICESTATUSCODE_SCANNING);
+    if (duration > 0 && device->deviceStatusSubscriptionId == 0)
+    {
+        // A timed scan ends on its own, without the subscription nobody tells us when
+        device->deviceStatusValid = false;
+    }
+    if (retval == UA_STATUSCODE_GOOD) UA_Array_delete(retParams, retParamsSize, &UA_TYPES[UA_TYPES_VARIANT]);
 
+    RFU6xx_METRICS_RECORD(device, RFU6xx_OPERATION_START_SCAN, start, retval, RFU6xx_STATUSCODE_SUCCESS, sendBuffSize, 0);
     return retval;
 }
 
 // ------------------------------------------------------------------------------------------------------------------------
 
-UA_StatusCode readTag (UA_Client* client, UA_String id, UA_Int32 bank, UA_Int32 offset, 
+// Fills the input arguments of the ReadTag and WriteTag methods.
+// The variants reference the members of params and the caller's strings without copying them,
+// so params and the strings must stay valid until the request is sent.
+// In binary mode (RAW:BYTES) the data is transferred as plain bytes instead of hex digits.
+static UA_StatusCode setTagCallParams (RFU6xx_Device* device, TagCallParams* params, UA_String id, 
+    UA_Int32 bank, UA_Int32 offset, UA_Boolean write, UA_Int32 length, UA_String writeData, UA_Boolean binary)
+{
+    if (tagIdToExtentionObject(device, id, &params->eo, params->idBuffer, sizeof(params->idBuffer)) != 0)
+    {
+        return UA_STATUSCODE_BAD;
+    }
+
+    // The reader expects the data in RAW:STRING format (hex digits)
+    if (write && !binary && hexValidate(writeData.data, writeData.length) != 0)
+    {
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Write data is no valid hex string");
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    }
+    // Every write drops the cached ranges it overlaps, even if it fails later (partially written tag)
+    if (write) RFU6xx_TagCache_invalidate(device->tagCache, id, bank, offset, binary ? writeData.length : writeData.length / 2);
+
+    params->bank = (UA_Int16) bank;
+    params->offset = offset;
+    params->length = length;
+    params->writeData = writeData;
+
+    setScalarNoDelete(&params->variants[0], &params->eo, &UA_TYPES[UA_TYPES_EXTENSIONOBJECT]);    
+    setScalarNoDelete(&params->variants[1], binary ? &tagCallCodeTypeBytes : &tagCallCodeType, &UA_TYPES[UA_TYPES_STRING]);
+    setScalarNoDelete(&params->variants[2], &params->bank, &UA_TYPES[UA_TYPES_INT16]);
+    setScalarNoDelete(&params->variants[3], &params->offset, &UA_TYPES[UA_TYPES_INT32]);
+    if (write) setScalarNoDelete(&params->variants[4], &params->writeData, &UA_TYPES[binary ? UA_TYPES_BYTESTRING : UA_TYPES_STRING]);
+    else setScalarNoDelete(&params->variants[4], &params->length, &UA_TYPES[UA_TYPES_INT32]);
+    setScalarNoDelete(&params->variants[5], &tagCallPassword, &UA_TYPES[UA_TYPES_STRING]);
+    return UA_STATUSCODE_GOOD;
+}
+
+// Checks the output arguments of ReadTag (data, status code)
+static UA_StatusCode getReadTagResult (size_t retParamsSize, UA_Variant* retParams, 
+    UA_String* readData, RFU6xx_StatusCode* serverResponseCode)
+{
+    // Check if response has 2 parameters and the types are correct
+    if (retParamsSize == 2
+        && UA_Variant_hasScalarType(&retParams[0], &UA_TYPES[UA_TYPES_BYTESTRING]) 
+        && UA_Variant_hasScalarType(&retParams[1], &UA_TYPES[UA_TYPES_INT32])) 
+    {
+        *readData = *(UA_String *) retParams[0].data;
+        *serverResponseCode = *(RFU6xx_StatusCode *) retParams[1].data;
+        return UA_STATUSCODE_GOOD;
+    } 
+    return UA_STATUSCODE_BADTYPEMISMATCH;
+}
+
+// Checks the output arguments of WriteTag (status code)
+static UA_StatusCode getWriteTagResult (size_t retParamsSize, UA_Variant* retParams, RFU6xx_StatusCode* serverResponseCode)
+{
+    // Check if response has 1 parameters and the type is correct
+    if (retParamsSize == 1 && UA_Variant_hasScalarType(&retParams[0], &UA_TYPES[UA_TYPES_INT32])) 
+    {
+        *serverResponseCode = *(RFU6xx_StatusCode *) retParams[0].data;
+        return UA_STATUSCODE_GOOD;
+    } 
+    return UA_STATUSCODE_BADTYPEMISMATCH;
+}
+
+// Answers a ReadTag of immutable memory from the tag cache of the device (data as hex digits like the reader)
+static UA_Boolean readTagCached (RFU6xx_Device* device, UA_String id, UA_Int32 bank, UA_Int32 offset, UA_Int32 length,
+    UA_String* readData)
+{
+    UA_Byte data[RFU6xx_TAG_CACHE_MAX_DATA_SIZE];
+    if (RFU6xx_TagCache_lookup(device->tagCache, id, bank, offset, length, data) != RFU6xx_TAG_CACHE_HIT) return false;
+    if (UA_ByteString_allocBuffer(readData, 2 * (size_t) length) != UA_STATUSCODE_GOOD) return false;
+    hexEncode(data, (size_t) length, readData->data, 1);
+    return true;
+}
+
+// Stores the hex data of a successful ReadTag in the tag cache, if the range is immutable
+static void storeTagCached (RFU6xx_Device* device, UA_String id, UA_Int32 bank, UA_Int32 offset, const UA_String* readData)
+{
+    UA_Byte data[RFU6xx_TAG_CACHE_MAX_DATA_SIZE];
+    if (device->tagCache == NULL || readData->length > 2*RFU6xx_TAG_CACHE_MAX_DATA_SIZE
+        || hexDecode(readData->data, readData->length, data) != 0) return;
+    RFU6xx_TagCache_insert(device->tagCache, id, bank, offset, data, readData->length / 2);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+UA_StatusCode readTag (RFU6xx_Device* device, UA_String id, UA_Int32 bank, UA_Int32 offset, 
     UA_Int32 length, UA_String* readData, RFU6xx_StatusCode* serverResponseCode)
 {
-    size_t sendParamsSize = 6;
-    UA_Variant sendParams[sendParamsSize];
+    // Immutable memory read before needs no connection
+    if (readTagCached(device, id, bank, offset, length, readData))
+    {
+        *serverResponseCode = RFU6xx_STATUSCODE_SUCCESS;
+        return UA_STATUSCODE_GOOD;
+    }
+    AWAIT_CONNECTION(device);
+    TagCallParams params;
 
     size_t retParamsSize;
     UA_Variant* retParams;
+    RFU6xx_METRICS_START(start);
 
-    UA_ExtensionObject eo;
+    UA_StatusCode retval = setTagCallParams(device, &params, id, bank, offset, false, length, UA_STRING_NULL, false);
+    if (retval == UA_STATUSCODE_GOOD)
+    {
+        retval = UA_Client_call(device->client, 
+            UA_NODEID_NUMERIC(device->nsRfu, device->ndRfu6xxNodeID),
+            UA_NODEID_NUMERIC(device->nsRfu, device->ndReadTagID), 
+            RFU6xx_TAG_CALL_PARAMS_SIZE, params.variants, &retParamsSize, &retParams);
+    }
+    else
+    {
+        retval = UA_STATUSCODE_BAD;
+    }
 
-    UA_String codeType = UA_STRING("RAW:STRING");
-    UA_String password = UA_STRING("");
+    // Check if read was successfully
+    if(retval == UA_STATUSCODE_GOOD)
+    {
+        retval = getReadTagResult(retParamsSize, retParams, readData, serverResponseCode);
 
-    int idLength = id.length;
-    int sendBuffSize = (idLength/2) + 2*sizeof(UA_Int32);
-    unsigned char sendBuffer[sendBuffSize];
-    if (tagIdToExtentionObject(id, &eo, sendBuffer, sendBuffSize) != 0)
+        // Move the data out of the output arguments, the caller owns it
+        if (retval == UA_STATUSCODE_GOOD) *(UA_String*) retParams[0].data = UA_STRING_NULL;
+        UA_Array_delete(retParams, retParamsSize, &UA_TYPES[UA_TYPES_VARIANT]);
+        if (retval == UA_STATUSCODE_GOOD && *serverResponseCode == RFU6xx_STATUSCODE_SUCCESS) storeTagCached(device, id, bank, offset, readData);
+    }   
+    RFU6xx_METRICS_RECORD(device, RFU6xx_OPERATION_READ_TAG, start, retval, 
+        retval == UA_STATUSCODE_GOOD ? *serverResponseCode : RFU6xx_STATUSCODE_SUCCESS, 
+        id.length / 2, retval == UA_STATUSCODE_GOOD ? readData->length : 0);
+    return retval;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+UA_StatusCode writeTag (RFU6xx_Device* device, UA_String id, UA_Int32 bank, UA_Int32 offset, 
+    UA_String writeData, RFU6xx_StatusCode* serverResponseCode)
+{
+    AWAIT_CONNECTION(device);
+    TagCallParams params;
+
+    size_t retParamsSize;
+    UA_Variant* retParams;
+    RFU6xx_METRICS_START(start);
+
+    UA_StatusCode retval = setTagCallParams(device, &params, id, bank, offset, true, 0, writeData, false);
+    if (retval == UA_STATUSCODE_GOOD)
     {
-        return UA_STATUSCODE_BAD;
+        retval = UA_Client_call(device->client, 
+            UA_NODEID_NUMERIC(device->nsRfu, device->ndRfu6xxNodeID),
+            UA_NODEID_NUMERIC(device->nsRfu, device->ndWriteTagID), 
+            RFU6xx_TAG_CALL_PARAMS_SIZE, params.variants, &retParamsSize, &retParams);
     }
-    
-    UA_Variant_setScalarCopy(&sendParams[0], &eo, &UA_TYPES[UA_TYPES_EXTENSIONOBJECT]);    
-    UA_Variant_setScalarCopy(&sendParams[1], &codeType, &UA_TYPES[UA_TYPES_STRING]);
-    UA_Variant_setScalarCopy(&sendParams[2], (UA_Int16*) &bank, &UA_TYPES[UA_TYPES_INT16]);
-    UA_Variant_setScalarCopy(&sendParams[3], &offset, &UA_TYPES[UA_TYPES_INT32]);
-    UA_Variant_setScalarCopy(&sendParams[4], &length, &UA_TYPES[UA_TYPES_INT32]);
-    UA_Variant_setScalarCopy(&sendParams[5], &password, &UA_TYPES[UA_TYPES_STRING]);
-    
-    UA_StatusCode retval = UA_Client_call(client, 
-        UA_NODEID_NUMERIC(nsRfu, ndRfu6xxNodeID),
-        UA_NODEID_NUMERIC(nsRfu, ndReadTagID), 
-        sendParamsSize, sendParams, &retParamsSize, &retParams);
+    else
+    {
+        retval = UA_STATUSCODE_BAD;
+    }
+ 
+     // Check if write was successfully
+    if(retval == UA_STATUSCODE_GOOD)
+    {
+        retval = getWriteTagResult(retParamsSize, retParams, serverResponseCode);
+        UA_Array_delete(retParams, retParamsSize, &UA_TYPES[UA_TYPES_VARIANT]);
+    }   
+    RFU6xx_METRICS_RECORD(device, RFU6xx_OPERATION_WRITE_TAG, start, retval, 
+        retval == UA_STATUSCODE_GOOD ? *serverResponseCode : RFU6xx_STATUSCODE_SUCCESS, 
+        id.length / 2 + writeData.length, 0);
+    return retval;
+}
 
-    // Check if read was successfully
+// ------------------------------------------------------------------------------------------------------------------------
+
+UA_StatusCode readTagBytes (RFU6xx_Device* device, UA_String id, UA_Int32 bank, UA_Int32 offset, 
+    UA_Int32 length, UA_Byte* buffer, size_t* readLength, RFU6xx_StatusCode* serverResponseCode)
+{
+    // Immutable memory read before needs no connection
+    if (RFU6xx_TagCache_lookup(device->tagCache, id, bank, offset, length, buffer) == RFU6xx_TAG_CACHE_HIT)
+    {
+        *readLength = (size_t) length;
+        *serverResponseCode = RFU6xx_STATUSCODE_SUCCESS;
+        return UA_STATUSCODE_GOOD;
+    }
+    AWAIT_CONNECTION(device);
+    TagCallParams params;
+
+    size_t retParamsSize;
+    UA_Variant* retParams;
+    RFU6xx_METRICS_START(start);
+    *readLength = 0;
+
+    UA_StatusCode retval = setTagCallParams(device, &params, id, bank, offset, false, length, UA_STRING_NULL, true);
+    if (retval == UA_STATUSCODE_GOOD)
+    {
+        retval = UA_Client_call(device->client, 
+            UA_NODEID_NUMERIC(device->nsRfu, device->ndRfu6xxNodeID),
+            UA_NODEID_NUMERIC(device->nsRfu, device->ndReadTagID), 
+            RFU6xx_TAG_CALL_PARAMS_SIZE, params.variants, &retParamsSize, &retParams);
+    }
+    else
+    {
+        retval = UA_STATUSCODE_BAD;
+    }
+
+    // Check if read was successfully, the bytes go straight into the caller buffer
     if(retval == UA_STATUSCODE_GOOD)
     {
-        // Check if response has 2 parameters and the types are correct
-        if (retParamsSize == 2
-            && UA_Variant_hasScalarType(&retParams[0], &UA_TYPES[UA_TYPES_BYTESTRING]) 
-            && UA_Variant_hasScalarType(&retParams[1], &UA_TYPES[UA_TYPES_INT32])) 
+        UA_ByteString readData;
+        retval = getReadTagResult(retParamsSize, retParams, &readData, serverResponseCode);
+        if (retval == UA_STATUSCODE_GOOD && readData.length > (size_t) length) retval = UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+        if (retval == UA_STATUSCODE_GOOD && readData.length > 0)
         {
-            *readData = *(UA_String *) retParams[0].data;
-            *serverResponseCode = *(RFU6xx_StatusCode *) retParams[1].data;
-        } 
-        else 
+            memcpy(buffer, readData.data, readData.length);
+            *readLength = readData.length;
+        }
+        UA_Array_delete(retParams, retParamsSize, &UA_TYPES[UA_TYPES_VARIANT]);
+        if (retval == UA_STATUSCODE_GOOD && *serverResponseCode == RFU6xx_STATUSCODE_SUCCESS)
         {
-            return UA_STATUSCODE_BADTYPEMISMATCH;
+            RFU6xx_TagCache_insert(device->tagCache, id, bank, offset, buffer, *readLength);
         }
     }   
+    RFU6xx_METRICS_RECORD(device, RFU6xx_OPERATION_READ_TAG_BYTES, start, retval, 
+        retval == UA_STATUSCODE_GOOD ? *serverResponseCode : RFU6xx_STATUSCODE_SUCCESS, id.length / 2, *readLength);
     return retval;
 }
 
 // ------------------------------------------------------------------------------------------------------------------------
 
-UA_StatusCode writeTag (UA_Client* client, UA_String id, UA_Int32 bank, UA_Int32 offset, 
-    UA_String writeData, RFU6xx_StatusCode* serverResponseCode)
+UA_StatusCode writeTagBytes (RFU6xx_Device* device, UA_String id, UA_Int32 bank, UA_Int32 offset, 
+    const UA_Byte* data, size_t length, RFU6xx_StatusCode* serverResponseCode)
 {
-    size_t sendParamsSize = 6;
-    UA_Variant sendParams[sendParamsSize];
+    AWAIT_CONNECTION(device);
+    TagCallParams params;
 
     size_t retParamsSize;
     UA_Variant* retParams;
+    RFU6xx_METRICS_START(start);
 
-    UA_ExtensionObject eo;
+    // The request references the caller's bytes, they are encoded directly into the message
+    UA_ByteString writeData = { length, (UA_Byte*) data };
+    UA_StatusCode retval = setTagCallParams(device, &params, id, bank, offset, true, 0, writeData, true);
+    if (retval == UA_STATUSCODE_GOOD)
+    {
+        retval = UA_Client_call(device->client, 
+            UA_NODEID_NUMERIC(device->nsRfu, device->ndRfu6xxNodeID),
+            UA_NODEID_NUMERIC(device->nsRfu, device->ndWriteTagID), 
+            RFU6xx_TAG_CALL_PARAMS_SIZE, params.variants, &retParamsSize, &retParams);
+    }
+    else
+    {
+        retval = UA_STATUSCODE_BAD;
+    }
+
+    if(retval == UA_STATUSCODE_GOOD)
+    {
+        retval = getWriteTagResult(retParamsSize, retParams, serverResponseCode);
+        UA_Array_delete(retParams, retParamsSize, &UA_TYPES[UA_TYPES_VARIANT]);
+    }   
+    RFU6xx_METRICS_RECORD(device, RFU6xx_OPERATION_WRITE_TAG_BYTES, start, retval, 
+        retval == UA_STATUSCODE_GOOD ? *serverResponseCode : RFU6xx_STATUSCODE_SUCCESS, id.length / 2 + length, 0);
+    return retval;
+}
 
-    UA_String codeType = UA_STRING("RAW:STRING");
-    UA_String password = UA_STRING("");
+// ------------------------------------------------------------------------------------------------------------------------
 
-    int idLength = id.length;
-    int sendBuffSize = (idLength/2) + 2*sizeof(UA_Int32);
-    unsigned char sendBuffer[sendBuffSize];
-    if (tagIdToExtentionObject(id, &eo, sendBuffer, sendBuffSize) != 0)
+// Reads the MaxNodesPerMethodCall operation limit of the server once and keeps it in the device
+static UA_UInt32 getMaxMethodsPerCall (RFU6xx_Device* device)
+{
+    if (device->maxMethodsPerCall != 0) return device->maxMethodsPerCall;
+
+    UA_Variant value;
+    UA_Variant_init(&value);
+    device->maxMethodsPerCall = RFU6xx_DEFAULT_MAX_METHODS_PER_CALL;
+    UA_StatusCode retval = UA_Client_readValueAttribute(device->client, 
+        UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERCAPABILITIES_OPERATIONLIMITS_MAXNODESPERMETHODCALL), &value);
+
+    // A limit of 0 means that the server does not define one
+    if (retval == UA_STATUSCODE_GOOD && UA_Variant_hasScalarType(&value, &UA_TYPES[UA_TYPES_UINT32]))
     {
+        UA_UInt32 serverLimit = *(UA_UInt32*) value.data;
+        if (serverLimit > 0 && serverLimit < RFU6xx_DEFAULT_MAX_METHODS_PER_CALL) device->maxMethodsPerCall = serverLimit;
+    }
+    UA_Variant_clear(&value);
+    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Max method calls per call request: %u", device->maxMethodsPerCall);
+    return device->maxMethodsPerCall;
+}
+
+// Sends one call request with all operations and stores the per item results
+static UA_StatusCode callTagOperationsOnce (RFU6xx_Device* device, RFU6xx_TagOperation operations[], size_t operationsSize)
+{
+    // The method calls reference the parameter storage of the device, nothing is copied.
+    // It grows to the largest batch once and is reused afterwards.
+    UA_CallMethodRequest methods[operationsSize];
+    if (device->tagCallParamsCapacity < operationsSize)
+    {
+        UA_free(device->tagCallParams);
+        device->tagCallParamsCapacity = 0;
+        device->tagCallParams = (TagCallParams*) UA_malloc(operationsSize * sizeof(TagCallParams));
+        if (device->tagCallParams == NULL) return UA_STATUSCODE_BADOUTOFMEMORY;
+        device->tagCallParamsCapacity = operationsSize;
+    }
+    TagCallParams* params = device->tagCallParams;
+
+    // Build one method call per operation, operations with an invalid id are not sent
+    size_t operationIndex[operationsSize];
+    size_t methodsSize = 0;
+    for (size_t i = 0; i < operationsSize; i++)
+    {
+        RFU6xx_TagOperation* op = &operations[i];
+        if (!op->write && readTagCached(device, op->id, op->bank, op->offset, op->length, &op->readData))
+        {
+            op->status = UA_STATUSCODE_GOOD;
+            op->serverResponseCode = RFU6xx_STATUSCODE_SUCCESS;
+            continue;
+        }
+        op->status = setTagCallParams(device, &params[methodsSize], op->id, op->bank, op->offset, op->write, op->length, op->writeData, false);
+        if (op->status != UA_STATUSCODE_GOOD) continue;
+
+        UA_CallMethodRequest* method = &methods[methodsSize];
+        UA_CallMethodRequest_init(method);
+        method->objectId = UA_NODEID_NUMERIC(device->nsRfu, device->ndRfu6xxNodeID);
+        method->methodId = UA_NODEID_NUMERIC(device->nsRfu, op->write ? device->ndWriteTagID : device->ndReadTagID);
+        method->inputArguments = params[methodsSize].variants;
+        method->inputArgumentsSize = RFU6xx_TAG_CALL_PARAMS_SIZE;
+        operationIndex[methodsSize++] = i;
+    }
+    if (methodsSize == 0) return UA_STATUSCODE_GOOD;
+
+    UA_CallRequest cReq;
+    UA_CallRequest_init(&cReq);
+    cReq.methodsToCall = methods;
+    cReq.methodsToCallSize = methodsSize;
+    UA_CallResponse cResp = UA_Client_Service_call(device->client, cReq);
+
+    UA_StatusCode retval = cResp.responseHeader.serviceResult;
+    if (retval == UA_STATUSCODE_GOOD && cResp.resultsSize != methodsSize) retval = UA_STATUSCODE_BADUNEXPECTEDERROR;
+    if (retval != UA_STATUSCODE_GOOD)
+    {
+        // The batch may be sent again (BadTooManyOperations), the data of the cache hits is taken again then
+        for (size_t i = 0; i < operationsSize; i++) UA_String_clear(&operations[i].readData);
+        UA_CallResponse_clear(&cResp);
+        return retval;
+    }
+
+    // Results are in the order of the method calls. A read cached here may precede a write of the same
+    // request, so the writes invalidate the cache again in order.
+    for (size_t i = 0; i < methodsSize; i++)
+    {
+        RFU6xx_TagOperation* op = &operations[operationIndex[i]];
+        UA_CallMethodResult* result = &cResp.results[i];
+        if (op->write) RFU6xx_TagCache_invalidate(device->tagCache, op->id, op->bank, op->offset, op->writeData.length / 2);
+        op->status = result->statusCode;
+        if (op->status != UA_STATUSCODE_GOOD) continue;
+
+        if (op->write)
+        {
+            op->status = getWriteTagResult(result->outputArgumentsSize, result->outputArguments, &op->serverResponseCode);
+        }
+        else
+        {
+            op->status = getReadTagResult(result->outputArgumentsSize, result->outputArguments, &op->readData, &op->serverResponseCode);
+
+            // The data is moved out of the response, so it survives UA_CallResponse_clear
+            if (op->status == UA_STATUSCODE_GOOD) *(UA_String*) result->outputArguments[0].data = UA_STRING_NULL;
+            if (op->status == UA_STATUSCODE_GOOD && op->serverResponseCode == RFU6xx_STATUSCODE_SUCCESS)
+            {
+                storeTagCached(device, op->id, op->bank, op->offset, &op->readData);
+            }
+        }
+    }
+    UA_CallResponse_clear(&cResp);
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode callTagOperations (RFU6xx_Device* device, RFU6xx_TagOperation operations[], size_t operationsSize)
+{
+    AWAIT_CONNECTION(device);
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    RFU6xx_METRICS_START(start);
+
+    for (size_t i = 0; i < operationsSize; i++)
+    {
+        operations[i].status = UA_STATUSCODE_BADNOTHINGTODO;
+        operations[i].serverResponseCode = 0;
+        operations[i].readData = UA_STRING_NULL;
+    }
+
+    // Split the operations into call requests the server accepts
+    size_t done = 0;
+    while (done < operationsSize)
+    {
+        size_t batchSize = getMaxMethodsPerCall(device);
+        if (batchSize > operationsSize - done) batchSize = operationsSize - done;
+
+        retval = callTagOperationsOnce(device, &operations[done], batchSize);
+        if (retval == UA_STATUSCODE_BADTOOMANYOPERATIONS && batchSize > 1)
+        {
+            // The limit reported by the server was too high, retry with half of the batch
+            device->maxMethodsPerCall = batchSize / 2;
+            UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Too many operations in call request, reduced batch size to %u", device->maxMethodsPerCall);
+            continue;
+        }
+        if (retval != UA_STATUSCODE_GOOD)
+        {
+            for (size_t i = done; i < done + batchSize; i++) operations[i].status = retval;
+            break;
+        }
+        done += batchSize;
+    }
+
+    // One latency sample for the whole batch, the status codes of the items are counted separately
+    RFU6xx_METRICS_RECORD(device, RFU6xx_OPERATION_CALL_TAG_OPERATIONS, start, retval, RFU6xx_STATUSCODE_SUCCESS, 0, 0);
+    for (size_t i = 0; i < operationsSize; i++)
+    {
+        RFU6xx_METRICS_COUNT_RESPONSE(device, operations[i].status, operations[i].serverResponseCode, 
+            operations[i].id.length / 2 + (operations[i].write ? operations[i].writeData.length : 0), operations[i].readData.length);
+    }
+    return retval;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+// Offset of the first byte of the read-back that differs from the written data, -1 if they are equal
+static UA_Int32 findMismatch (const UA_Byte* data, size_t length, const UA_ByteString* readData)
+{
+    size_t compareLength = readData->length < length ? readData->length : length;
+    if (compareLength > 0 && memcmp(data, readData->data, compareLength) != 0)
+    {
+        for (size_t i = 0; i < compareLength; i++)
+        {
+            if (data[i] != readData->data[i]) return (UA_Int32) i;
+        }
+    }
+    // A short read-back differs at its end
+    return readData->length < length ? (UA_Int32) readData->length : -1;
+}
+
+// One call request with the WriteTag and the verifying ReadTag, the read-back is compared in the response.
+// binary == false sends the data as hex digits (RAW:STRING) for readers without RAW:BYTES. codeTypeRejected
+// is set if the server rejected the code type argument of WriteTag, then nothing was written.
+static UA_StatusCode writeAndReadBack (RFU6xx_Device* device, UA_String id, UA_Int32 bank, UA_Int32 offset, 
+    const UA_Byte* data, size_t length, UA_Boolean binary, RFU6xx_WriteVerifyResult* result, size_t* readLength,
+    UA_Boolean* codeTypeRejected)
+{
+    *codeTypeRejected = false;
+    TagCallParams params[2];
+    UA_ByteString writeData = { length, (UA_Byte*) data };
+    if (!binary)
+    {
+        if (UA_ByteString_allocBuffer(&writeData, 2 * length) != UA_STATUSCODE_GOOD) return UA_STATUSCODE_BADOUTOFMEMORY;
+        hexEncode(data, length, writeData.data, 1);
+    }
+    if (setTagCallParams(device, &params[0], id, bank, offset, true, 0, writeData, binary) != UA_STATUSCODE_GOOD
+        || setTagCallParams(device, &params[1], id, bank, offset, false, (UA_Int32) length, UA_STRING_NULL, binary) != UA_STATUSCODE_GOOD)
+    {
+        if (!binary) UA_ByteString_clear(&writeData);
         return UA_STATUSCODE_BAD;
     }
 
-    UA_Variant_setScalarCopy(&sendParams[0], &eo, &UA_TYPES[UA_TYPES_EXTENSIONOBJECT]);    
-    UA_Variant_setScalarCopy(&sendParams[1], &codeType, &UA_TYPES[UA_TYPES_STRING]);
-    UA_Variant_setScalarCopy(&sendParams[2], (UA_Int16*) &bank, &UA_TYPES[UA_TYPES_INT16]);
-    UA_Variant_setScalarCopy(&sendParams[3], &offset, &UA_TYPES[UA_TYPES_INT32]);
-    UA_Variant_setScalarCopy(&sendParams[4], &writeData, &UA_TYPES[UA_TYPES_STRING]);
-    UA_Variant_setScalarCopy(&sendParams[5], &password, &UA_TYPES[UA_TYPES_STRING]);
-    
-    UA_StatusCode retval = UA_Client_call(client, 
-        UA_NODEID_NUMERIC(nsRfu, ndRfu6xxNodeID),
-        UA_NODEID_NUMERIC(nsRfu, ndWriteTagID), 
-        sendParamsSize, sendParams, &retParamsSize, &retParams);
- 
-     // Check if write was successfully
-    if(retval == UA_STATUSCODE_GOOD)
+    UA_CallMethodRequest methods[2];
+    for (size_t i = 0; i < 2; i++)
+    {
+        UA_CallMethodRequest_init(&methods[i]);
+        methods[i].objectId = UA_NODEID_NUMERIC(device->nsRfu, device->ndRfu6xxNodeID);
+        methods[i].inputArguments = params[i].variants;
+        methods[i].inputArgumentsSize = RFU6xx_TAG_CALL_PARAMS_SIZE;
+    }
+    methods[0].methodId = UA_NODEID_NUMERIC(device->nsRfu, device->ndWriteTagID);
+    methods[1].methodId = UA_NODEID_NUMERIC(device->nsRfu, device->ndReadTagID);
+
+    UA_CallRequest cReq;
+    UA_CallRequest_init(&cReq);
+    cReq.methodsToCall = methods;
+    cReq.methodsToCallSize = 2;
+    UA_CallResponse cResp = UA_Client_Service_call(device->client, cReq);
+    if (!binary) UA_ByteString_clear(&writeData);
+
+    UA_StatusCode retval = cResp.responseHeader.serviceResult;
+    if (retval == UA_STATUSCODE_GOOD && cResp.resultsSize != 2) retval = UA_STATUSCODE_BADUNEXPECTEDERROR;
+    if (retval == UA_STATUSCODE_GOOD)
+    {
+        // The result of the second input argument (code type) tells a missing RAW:BYTES support from other errors
+        const UA_CallMethodResult* writeResult = &cResp.results[0];
+        retval = writeResult->statusCode;
+        *codeTypeRejected = binary && retval != UA_STATUSCODE_GOOD && writeResult->inputArgumentResultsSize > 1 
+            && writeResult->inputArgumentResults[1] != UA_STATUSCODE_GOOD;
+    }
+    if (retval == UA_STATUSCODE_GOOD)
     {
-        // Check if response has 1 parameters and the type is correct
-        if (retParamsSize == 1 && UA_Variant_hasScalarType(&retParams[0], &UA_TYPES[UA_TYPES_INT32])) 
+        retval = getWriteTagResult(cResp.results[0].outputArgumentsSize, cResp.results[0].outputArguments, &result->writeResponseCode);
+    }
+
+    // The read-back only counts if the write succeeded
+    if (retval == UA_STATUSCODE_GOOD && result->writeResponseCode == RFU6xx_STATUSCODE_SUCCESS)
+    {
+        UA_ByteString readData;
+        retval = cResp.results[1].statusCode;
+        if (retval == UA_STATUSCODE_GOOD)
         {
-            *serverResponseCode = *(RFU6xx_StatusCode *) retParams[0].data;
-        } 
-        else 
+            retval = getReadTagResult(cResp.results[1].outputArgumentsSize, cResp.results[1].outputArguments, 
+                &readData, &result->readResponseCode);
+        }
+        if (retval == UA_STATUSCODE_GOOD && result->readResponseCode == RFU6xx_STATUSCODE_SUCCESS)
         {
-            return UA_STATUSCODE_BADTYPEMISMATCH;
+            *readLength = readData.length;
+            if (!binary)
+            {
+                // The hex digits are decoded in place, the response is cleared afterwards anyway
+                if (hexDecode(readData.data, readData.length, readData.data) != 0)
+                {
+                    UA_CallResponse_clear(&cResp);
+                    return UA_STATUSCODE_BADDECODINGERROR;
+                }
+                readData.length /= 2;
+            }
+            result->mismatchOffset = findMismatch(data, length, &readData);
+            result->verified = result->mismatchOffset < 0;
         }
-    }   
+    }
+    UA_CallResponse_clear(&cResp);
+    return retval;
+}
+
+UA_StatusCode writeTagVerified (RFU6xx_Device* device, UA_String id, UA_Int32 bank, UA_Int32 offset, 
+    const UA_Byte* data, size_t length, RFU6xx_WriteVerifyResult* result)
+{
+    // The result is complete even if the call fails before the first attempt
+    result->writeResponseCode = RFU6xx_STATUSCODE_SUCCESS;
+    result->readResponseCode = RFU6xx_STATUSCODE_SUCCESS;
+    result->verified = false;
+    result->mismatchOffset = -1;
+    result->attempts = 0;
+    AWAIT_CONNECTION(device);
+    const RFU6xx_WriteRetryPolicy* policy = &device->writeRetryPolicy;
+    UA_StatusCode retval;
+    size_t readLength;
+    UA_Boolean codeTypeRejected;
+    RFU6xx_METRICS_START(start);
+
+    if (length == 0 || length > UA_INT32_MAX / 2) return UA_STATUSCODE_BADINVALIDARGUMENT;
+    while (true)
+    {
+        result->writeResponseCode = RFU6xx_STATUSCODE_SUCCESS;
+        result->readResponseCode = RFU6xx_STATUSCODE_SUCCESS;
+        result->verified = false;
+        result->mismatchOffset = -1;
+        readLength = 0;
+        result->attempts++;
+
+        retval = writeAndReadBack(device, id, bank, offset, data, length, !device->rawBytesRejected, result, &readLength, &codeTypeRejected);
+        if (codeTypeRejected)
+        {
+            // Readers without RAW:BYTES reject the code type before writing, they get hex digits from now on
+            UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Server %s rejected RAW:BYTES (%x), using RAW:STRING", 
+                device->endpointUrl, retval);
+            device->rawBytesRejected = true;
+            retval = writeAndReadBack(device, id, bank, offset, data, length, false, result, &readLength, &codeTypeRejected);
+        }
+        if (retval != UA_STATUSCODE_GOOD || result->verified || result->attempts >= policy->maxAttempts) break;
+
+        // Only failed writes (and mismatches if configured) are worth another attempt
+        UA_Boolean mismatch = result->writeResponseCode == RFU6xx_STATUSCODE_SUCCESS 
+            && result->readResponseCode == RFU6xx_STATUSCODE_SUCCESS;
+        if (!(result->writeResponseCode == RFU6xx_STATUSCODE_WRITE_ERROR || (mismatch && policy->retryOnMismatch))) break;
+
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Write of %zu bytes not verified (attempt %u, status %u, mismatch at %d), retrying", 
+            length, result->attempts, result->writeResponseCode, result->mismatchOffset);
+        if (policy->retryDelay > 0) usleep((useconds_t) policy->retryDelay * 1000);
+    }
+
+    RFU6xx_METRICS_RECORD(device, RFU6xx_OPERATION_WRITE_TAG_VERIFIED, start, retval, 
+        retval != UA_STATUSCODE_GOOD ? RFU6xx_STATUSCODE_SUCCESS 
+            : (result->writeResponseCode != RFU6xx_STATUSCODE_SUCCESS ? result->writeResponseCode : result->readResponseCode), 
+        result->attempts * (id.length / 2 + length), readLength);
+    return retval;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+static void tagCallCompleted (UA_Client* client, void* userdata, UA_UInt32 requestId, UA_CallResponse* response)
+{
+    TagCallRequest* request = (TagCallRequest*) userdata;
+    RFU6xx_Device* device = (RFU6xx_Device*) UA_Client_getContext(client);
+    RFU6xx_StatusCode serverResponseCode = 0;
+    UA_String readData = UA_STRING_NULL;
+    size_t retParamsSize = 0;
+    UA_Variant* retParams = NULL;
+
+    device->inFlightCalls--;
+
+    // Service result first, then the result of the method call
+    UA_StatusCode retval = response->responseHeader.serviceResult;
+    if (retval == UA_STATUSCODE_GOOD)
+    {
+        if (response->resultsSize != 1) retval = UA_STATUSCODE_BADUNEXPECTEDERROR;
+        else retval = response->results[0].statusCode;
+    }
+    if (retval == UA_STATUSCODE_GOOD)
+    {
+        retParamsSize = response->results[0].outputArgumentsSize;
+        retParams = response->results[0].outputArguments;
+    }
+
+    if (request->readCallback != NULL)
+    {
+        if (retval == UA_STATUSCODE_GOOD) retval = getReadTagResult(retParamsSize, retParams, &readData, &serverResponseCode);
+        RFU6xx_METRICS_RECORD(device, RFU6xx_OPERATION_READ_TAG_ASYNC, request->startNs, retval, serverResponseCode, 
+            request->bytesSent, readData.length);
+        request->readCallback(device, requestId, retval, &readData, serverResponseCode, request->context);
+    }
+    else
+    {
+        if (retval == UA_STATUSCODE_GOOD) retval = getWriteTagResult(retParamsSize, retParams, &serverResponseCode);
+        RFU6xx_METRICS_RECORD(device, RFU6xx_OPERATION_WRITE_TAG_ASYNC, request->startNs, retval, serverResponseCode, 
+            request->bytesSent, 0);
+        request->writeCallback(device, requestId, retval, serverResponseCode, request->context);
+    }
+    request->next = device->freeTagCallRequests;
+    device->freeTagCallRequests = request;
+}
+
+// Drives the client until the number of in-flight calls is below the configured limit
+static UA_StatusCode waitForCallSlot (RFU6xx_Device* device)
+{
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    while (retval == UA_STATUSCODE_GOOD && device->inFlightCalls >= device->maxInFlightCalls)
+    {
+        retval = runIterate(device, RFU6xx_ASYNC_ITERATE_TIMEOUT);
+    }
+    return retval;
+}
+
+static UA_StatusCode callTagMethodAsync (RFU6xx_Device* device, UA_UInt32 methodId, UA_Variant sendParams[RFU6xx_TAG_CALL_PARAMS_SIZE], 
+    size_t bytesSent, RFU6xx_ReadTagCallback readCallback, RFU6xx_WriteTagCallback writeCallback, void* context, UA_UInt32* requestId)
+{
+    UA_StatusCode retval = waitForCallSlot(device);
+    if (retval != UA_STATUSCODE_GOOD) return retval;
+
+    TagCallRequest* request = device->freeTagCallRequests;
+    if (request != NULL) device->freeTagCallRequests = request->next;
+    else request = (TagCallRequest*) UA_malloc(sizeof(TagCallRequest));
+    if (request == NULL) return UA_STATUSCODE_BADOUTOFMEMORY;
+    request->readCallback = readCallback;
+    request->writeCallback = writeCallback;
+    request->context = context;
+    request->startNs = RFU6xx_METRICS_NOW();
+    request->bytesSent = bytesSent;
+
+    // The request is encoded and sent before the call returns, the parameters may be released afterwards
+    retval = UA_Client_call_async(device->client, 
+        UA_NODEID_NUMERIC(device->nsRfu, device->ndRfu6xxNodeID),
+        UA_NODEID_NUMERIC(device->nsRfu, methodId), 
+        RFU6xx_TAG_CALL_PARAMS_SIZE, sendParams, tagCallCompleted, request, requestId);
+    if (retval != UA_STATUSCODE_GOOD)
+    {
+        request->next = device->freeTagCallRequests;
+        device->freeTagCallRequests = request;
+        return retval;
+    }
+    device->inFlightCalls++;
+    return UA_STATUSCODE_GOOD;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+UA_StatusCode readTagAsync (RFU6xx_Device* device, UA_String id, UA_Int32 bank, UA_Int32 offset, UA_Int32 length, 
+    RFU6xx_ReadTagCallback callback, void* context, UA_UInt32* requestId)
+{
+    AWAIT_CONNECTION(device);
+    TagCallParams params;
+
+    if (setTagCallParams(device, &params, id, bank, offset, false, length, UA_STRING_NULL, false) != UA_STATUSCODE_GOOD)
+    {
+        return UA_STATUSCODE_BAD;
+    }
+    return callTagMethodAsync(device, device->ndReadTagID, params.variants, id.length / 2, callback, NULL, context, requestId);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+UA_StatusCode writeTagAsync (RFU6xx_Device* device, UA_String id, UA_Int32 bank, UA_Int32 offset, UA_String writeData, 
+    RFU6xx_WriteTagCallback callback, void* context, UA_UInt32* requestId)
+{
+    AWAIT_CONNECTION(device);
+    TagCallParams params;
+
+    if (setTagCallParams(device, &params, id, bank, offset, true, 0, writeData, false) != UA_STATUSCODE_GOOD)
+    {
+        return UA_STATUSCODE_BAD;
+    }
+    return callTagMethodAsync(device, device->ndWriteTagID, params.variants, id.length / 2 + writeData.length, 
+        NULL, callback, context, requestId);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
 
+UA_StatusCode runIterate (RFU6xx_Device* device, UA_UInt32 timeout)
+{
+    AWAIT_CONNECTION(device);
+    return UA_Client_run_iterate(device->client, timeout);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+UA_StatusCode waitForAsyncCalls (RFU6xx_Device* device)
+{
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    while (retval == UA_STATUSCODE_GOOD && device->inFlightCalls > 0)
+    {
+        retval = runIterate(device, RFU6xx_ASYNC_ITERATE_TIMEOUT);
+    }
     return retval;
 }
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+struct BankTransfer;
+
+// A part of the region that is sent as one ReadTag / WriteTag call
+typedef struct BankChunk {
+    struct BankTransfer* transfer;
+    UA_Int32 offset;
+    UA_Int32 length;
+    UA_UInt32 attempts;
+    UA_Int32 probeLength;                       // != 0: sent with the minimum size after this length was out of range
+    UA_DateTime sent;
+    struct BankChunk* next;
+} BankChunk;
+
+typedef struct BankTransfer {
+    RFU6xx_Device* device;
+    UA_String id;
+    UA_Int32 bank;
+    UA_Int32 offset;
+    UA_Int32 length;
+    UA_Byte* buffer;                            // Read target
+    UA_String hexData;                          // Write source as hex digits
+
+    UA_Int32 nextOffset;                        // Start of the part that was not sent yet
+    BankChunk* retries;                         // Chunks that have to be sent again
+    size_t inFlight;
+    UA_Boolean abandoned;                       // The caller returned with chunks in flight, the last one frees the transfer
+    UA_StatusCode status;
+    RFU6xx_StatusCode serverResponseCode;
+} BankTransfer;
+
+static UA_UInt32 bankChunkSize (RFU6xx_Device* device)
+{
+    if (device->bankChunkSize == 0) device->bankChunkSize = RFU6xx_DEFAULT_BANK_CHUNK_SIZE;
+    if (device->bankChunkLimit != 0 && device->bankChunkSize > device->bankChunkLimit) device->bankChunkSize = device->bankChunkLimit;
+    return device->bankChunkSize;
+}
+
+// Chunk sizes stay even, tag memory is organized in 16 bit words
+static void setBankChunkSize (RFU6xx_Device* device, UA_UInt32 size)
+{
+    size &= ~1u;
+    if (size < RFU6xx_BANK_CHUNK_MIN_SIZE) size = RFU6xx_BANK_CHUNK_MIN_SIZE;
+    if (size > RFU6xx_BANK_CHUNK_MAX_SIZE) size = RFU6xx_BANK_CHUNK_MAX_SIZE;
+    if (device->bankChunkLimit != 0 && size > device->bankChunkLimit) size = device->bankChunkLimit;
+    device->bankChunkSize = size;
+}
+
+static void deleteBankTransfer (BankTransfer* transfer)
+{
+    while (transfer->retries != NULL)
+    {
+        BankChunk* chunk = transfer->retries;
+        transfer->retries = chunk->next;
+        UA_free(chunk);
+    }
+    UA_ByteString_clear(&transfer->hexData);
+    UA_free(transfer);
+}
+
+static void failBankTransfer (BankTransfer* transfer, UA_StatusCode status, RFU6xx_StatusCode serverResponseCode)
+{
+    if (transfer->status != UA_STATUSCODE_GOOD) return;
+    transfer->status = status != UA_STATUSCODE_GOOD ? status : UA_STATUSCODE_BAD;
+    transfer->serverResponseCode = serverResponseCode;
+}
+
+// Evaluates the result of a chunk, adapts the chunk size and requeues the chunk if it has to be repeated
+static void bankChunkCompleted (BankChunk* chunk, UA_StatusCode status, RFU6xx_StatusCode serverResponseCode)
+{
+    BankTransfer* transfer = chunk->transfer;
+    RFU6xx_Device* device = transfer->device;
+    transfer->inFlight--;
+
+    // Late answers of a transfer the caller gave up on are dropped
+    if (transfer->abandoned)
+    {
+        UA_free(chunk);
+        if (transfer->inFlight == 0) deleteBankTransfer(transfer);
+        return;
+    }
+
+    if (status == UA_STATUSCODE_GOOD && serverResponseCode == RFU6xx_STATUSCODE_SUCCESS)
+    {
+        if (chunk->probeLength != 0)
+        {
+            // The offset is inside the bank, the reader does not accept chunks of the probed size
+            UA_UInt32 limit = ((UA_UInt32) chunk->probeLength - 1) & ~1u;
+            if (limit < RFU6xx_BANK_CHUNK_MIN_SIZE) limit = RFU6xx_BANK_CHUNK_MIN_SIZE;
+            if (device->bankChunkLimit == 0 || limit < device->bankChunkLimit) device->bankChunkLimit = limit;
+            device->bankChunkLimitSuccesses = 0;
+            setBankChunkSize(device, (UA_UInt32) chunk->probeLength / 2);
+        }
+        else
+        {
+            UA_DateTime latency = UA_DateTime_nowMonotonic() - chunk->sent;
+            if (latency > RFU6xx_BANK_CHUNK_TARGET_LATENCY * UA_DATETIME_MSEC) setBankChunkSize(device, chunk->length / 2);
+            else if ((UA_UInt32) chunk->length >= device->bankChunkSize) setBankChunkSize(device, 2 * device->bankChunkSize);
+
+            // A limit learned once (maybe from a busy or restarted reader) is tried again after a while
+            if (device->bankChunkLimit != 0 && ++device->bankChunkLimitSuccesses >= RFU6xx_BANK_CHUNK_LIMIT_RECOVERY)
+            {
+                device->bankChunkLimit = 0;
+                device->bankChunkLimitSuccesses = 0;
+            }
+        }
+        UA_free(chunk);
+        return;
+    }
+
+    if (status == UA_STATUSCODE_GOOD && serverResponseCode == RFU6xx_STATUSCODE_READ_OUT_OF_RANGE)
+    {
+        // Too large for the reader or beyond the end of the bank: the same offset is tried with the minimum size.
+        // If even that is out of range, the region does not fit into the bank and the limit stays as it is.
+        if (chunk->probeLength != 0 || chunk->length <= RFU6xx_BANK_CHUNK_MIN_SIZE)
+        {
+            failBankTransfer(transfer, status, serverResponseCode);
+            UA_free(chunk);
+            return;
+        }
+        chunk->probeLength = chunk->length;
+    }
+    else if (++chunk->attempts < RFU6xx_BANK_CHUNK_RETRIES)
+    {
+        setBankChunkSize(device, chunk->length / 2);
+    }
+    else
+    {
+        failBankTransfer(transfer, status, serverResponseCode);
+        UA_free(chunk);
+        return;
+    }
+    chunk->next = transfer->retries;
+    transfer->retries = chunk;
+}
+
+static void bankReadCompleted (RFU6xx_Device* device, UA_UInt32 requestId, UA_StatusCode status, 
+    const UA_String* readData, RFU6xx_StatusCode serverResponseCode, void* context)
+{
+    BankChunk* chunk = (BankChunk*) context;
+    BankTransfer* transfer = chunk->transfer;
+
+    // The data of a successful chunk goes straight into its place in the caller buffer (if the caller still waits)
+    if (!transfer->abandoned && status == UA_STATUSCODE_GOOD && serverResponseCode == RFU6xx_STATUSCODE_SUCCESS)
+    {
+        if (readData->length != 2 * (size_t) chunk->length 
+            || hexDecode(readData->data, readData->length, &transfer->buffer[chunk->offset - transfer->offset]) != 0)
+        {
+            status = UA_STATUSCODE_BADDECODINGERROR;
+        }
+    }
+    bankChunkCompleted(chunk, status, serverResponseCode);
+}
+
+static void bankWriteCompleted (RFU6xx_Device* device, UA_UInt32 requestId, UA_StatusCode status, 
+    RFU6xx_StatusCode serverResponseCode, void* context)
+{
+    bankChunkCompleted((BankChunk*) context, status, serverResponseCode);
+}
+
+// Sends the next chunk: a requeued one (cut to the current chunk size, probes to the minimum size) 
+// or the next part of the region
+static UA_StatusCode sendBankChunk (BankTransfer* transfer, UA_Boolean write)
+{
+    RFU6xx_Device* device = transfer->device;
+    UA_Int32 chunkSize = (UA_Int32) bankChunkSize(device);
+    BankChunk* chunk = transfer->retries;
+
+    if (chunk != NULL)
+    {
+        transfer->retries = chunk->next;
+        if (chunk->probeLength != 0) chunkSize = RFU6xx_BANK_CHUNK_MIN_SIZE;
+        if (chunk->length > chunkSize)
+        {
+            BankChunk* rest = (BankChunk*) UA_malloc(sizeof(BankChunk));
+            if (rest == NULL) return UA_STATUSCODE_BADOUTOFMEMORY;
+            *rest = *chunk;
+            rest->offset += chunkSize;
+            rest->length -= chunkSize;
+            rest->probeLength = 0;
+            rest->next = transfer->retries;
+            transfer->retries = rest;
+            chunk->length = chunkSize;
+        }
+    }
+    else
+    {
+        chunk = (BankChunk*) UA_malloc(sizeof(BankChunk));
+        if (chunk == NULL) return UA_STATUSCODE_BADOUTOFMEMORY;
+        chunk->transfer = transfer;
+        chunk->offset = transfer->nextOffset;
+        chunk->length = transfer->offset + transfer->length - transfer->nextOffset;
+        if (chunk->length > chunkSize) chunk->length = chunkSize;
+        chunk->attempts = 0;
+        chunk->probeLength = 0;
+        transfer->nextOffset += chunk->length;
+    }
+    chunk->sent = UA_DateTime_nowMonotonic();
+
+    UA_StatusCode retval;
+    if (write)
+    {
+        UA_String hexChunk = { 2 * (size_t) chunk->length, &transfer->hexData.data[2 * (size_t) (chunk->offset - transfer->offset)] };
+        retval = writeTagAsync(device, transfer->id, transfer->bank, chunk->offset, hexChunk, bankWriteCompleted, chunk, NULL);
+    }
+    else
+    {
+        retval = readTagAsync(device, transfer->id, transfer->bank, chunk->offset, chunk->length, bankReadCompleted, chunk, NULL);
+    }
+    if (retval != UA_STATUSCODE_GOOD)
+    {
+        UA_free(chunk);
+        return retval;
+    }
+    transfer->inFlight++;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode runBankTransfer (BankTransfer* transfer, UA_Boolean write, RFU6xx_StatusCode* serverResponseCode)
+{
+    RFU6xx_Device* device = transfer->device;
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    transfer->nextOffset = transfer->offset;
+    transfer->status = UA_STATUSCODE_GOOD;
+    transfer->serverResponseCode = RFU6xx_STATUSCODE_SUCCESS;
+
+    while (retval == UA_STATUSCODE_GOOD)
+    {
+        // Fill the pipeline, nothing new is sent after a chunk finally failed
+        while (transfer->status == UA_STATUSCODE_GOOD && device->inFlightCalls < device->maxInFlightCalls
+            && (transfer->retries != NULL || transfer->nextOffset < transfer->offset + transfer->length))
+        {
+            retval = sendBankChunk(transfer, write);
+            if (retval != UA_STATUSCODE_GOOD) break;
+        }
+        if (transfer->inFlight == 0) break;
+        UA_StatusCode iterateRetval = runIterate(device, RFU6xx_ASYNC_ITERATE_TIMEOUT);
+        if (retval == UA_STATUSCODE_GOOD) retval = iterateRetval;
+    }
+
+    // After a send or connection error the answers of the chunks in flight are still collected
+    while (transfer->inFlight > 0 && runIterate(device, RFU6xx_ASYNC_ITERATE_TIMEOUT) == UA_STATUSCODE_GOOD);
+
+    if (retval == UA_STATUSCODE_GOOD) retval = transfer->status;
+    *serverResponseCode = transfer->serverResponseCode;
+
+    // Chunks that are still queued in the client (the connection check stopped the iteration) keep the
+    // transfer alive, the last answer frees it. They no longer touch the caller buffer.
+    if (transfer->inFlight > 0)
+    {
+        if (retval == UA_STATUSCODE_GOOD) retval = UA_STATUSCODE_BADCONNECTIONCLOSED;
+        transfer->abandoned = true;
+        return retval;
+    }
+    deleteBankTransfer(transfer);
+    return retval;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+UA_StatusCode readTagBank (RFU6xx_Device* device, UA_String id, UA_Int32 bank, UA_Int32 offset, UA_Int32 length, 
+    UA_Byte* buffer, RFU6xx_StatusCode* serverResponseCode)
+{
+    if (offset < 0 || length < 0) return UA_STATUSCODE_BADINVALIDARGUMENT;
+
+    // On the heap, chunks in flight may outlive the call (runBankTransfer)
+    BankTransfer* transfer = (BankTransfer*) UA_calloc(1, sizeof(BankTransfer));
+    if (transfer == NULL) return UA_STATUSCODE_BADOUTOFMEMORY;
+    transfer->device = device;
+    transfer->id = id;
+    transfer->bank = bank;
+    transfer->offset = offset;
+    transfer->length = length;
+    transfer->buffer = buffer;
+    return runBankTransfer(transfer, false, serverResponseCode);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+UA_StatusCode writeTagBank (RFU6xx_Device* device, UA_String id, UA_Int32 bank, UA_Int32 offset, UA_Int32 length, 
+    const UA_Byte* data, RFU6xx_StatusCode* serverResponseCode)
+{
+    if (offset < 0 || length < 0) return UA_STATUSCODE_BADINVALIDARGUMENT;
+
+    // On the heap, chunks in flight may outlive the call (runBankTransfer)
+    BankTransfer* transfer = (BankTransfer*) UA_calloc(1, sizeof(BankTransfer));
+    if (transfer == NULL) return UA_STATUSCODE_BADOUTOFMEMORY;
+    transfer->device = device;
+    transfer->id = id;
+    transfer->bank = bank;
+    transfer->offset = offset;
+    transfer->length = length;
+
+    // The region is converted once, the chunks reference their part of it
+    if (UA_ByteString_allocBuffer(&transfer->hexData, 2 * (size_t) length) != UA_STATUSCODE_GOOD)
+    {
+        UA_free(transfer);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    hexEncode(data, (size_t) length, transfer->hexData.data, 1);
+    return runBankTransfer(transfer, true, serverResponseCode);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+// Client state callback of a supervised device. A session that is created (instead of reactivated)
+// marks the node ids and subscriptions for restoring.
+static void supervisedStateChanged (UA_Client* client, UA_SecureChannelState channelState, 
+    UA_SessionState sessionState, UA_StatusCode connectStatus)
+{
+    RFU6xx_Device* device = (RFU6xx_Device*) UA_Client_getContext(client);
+    if (sessionState == UA_SESSIONSTATE_CREATE_REQUESTED) device->sessionCreated = true;
+    if (device->userStateCallback != NULL) device->userStateCallback(client, channelState, sessionState, connectStatus);
+}
+
+// Creates the subscriptions that do not exist on the server (subscriptionId 0), after a new session all of them.
+// Deleting the old ones removes them from the client (the server answers BadSubscriptionIdInvalid).
+// A failed subscription does not hold up the others, it is tried again by RFU6xx_Device_checkConnection
+// after RFU6xx_SUBSCRIPTION_RESTORE_DELAY.
+static UA_StatusCode restoreSubscriptions (RFU6xx_Device* device, UA_Boolean newSession)
+{
+    // Set first, subscribeDeviceStatus checks the connection again
+    device->nextSubscriptionRestore = UA_DateTime_nowMonotonic() + (UA_DateTime) RFU6xx_SUBSCRIPTION_RESTORE_DELAY * UA_DATETIME_MSEC;
+
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    for (LastScanDataSubscription* sub = device->lastScanDataSubscriptions; sub != NULL; sub = sub->next)
+    {
+        if (newSession && sub->subscriptionId != 0)
+        {
+            UA_Client_Subscriptions_deleteSingle(device->client, sub->subscriptionId);
+            sub->subscriptionId = 0;
+        }
+        if (sub->subscriptionId != 0) continue;
+        UA_StatusCode subRetval = createLastScanDataSubscription(device, sub);
+        if (retval == UA_STATUSCODE_GOOD) retval = subRetval;
+    }
+    UA_StatusCode subRetval = RFU6xx_ScanEvents_restore(device, newSession);
+    if (retval == UA_STATUSCODE_GOOD) retval = subRetval;
+    if (device->deviceStatusSamplingInterval > 0)
+    {
+        if (newSession && device->deviceStatusSubscriptionId != 0)
+        {
+            UA_Client_Subscriptions_deleteSingle(device->client, device->deviceStatusSubscriptionId);
+            device->deviceStatusSubscriptionId = 0;
+        }
+        subRetval = subscribeDeviceStatus(device, device->deviceStatusSamplingInterval);
+        if (retval == UA_STATUSCODE_GOOD) retval = subRetval;
+    }
+
+    if (retval != UA_STATUSCODE_GOOD)
+    {
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Not all subscriptions of %s could be re-created. ErrorCode: %x, next attempt in %u ms", 
+            device->endpointUrl, retval, RFU6xx_SUBSCRIPTION_RESTORE_DELAY);
+    }
+    device->subscriptionStatus = retval;
+    return retval;
+}
+
+// Brings node ids and subscriptions up to date after a new session was created
+static UA_StatusCode restoreSession (RFU6xx_Device* device)
+{
+    // The node ids are still valid if the server has the same namespaces and build
+    uint64_t fingerprint;
+    UA_StatusCode retval = readServerFingerprint(device, &fingerprint);
+    if (retval != UA_STATUSCODE_GOOD) return retval;
+    if (device->serverFingerprint == 0 || fingerprint != device->serverFingerprint)
+    {
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Server %s changed, node ids are resolved again", device->endpointUrl);
+        retval = init(device);
+        if (retval != UA_STATUSCODE_GOOD) return retval;
+        device->serverFingerprint = fingerprint;
+        device->rawBytesRejected = false;
+    }
+
+    // The reader may have restarted, its status and the chunk size it accepts are unknown
+    device->deviceStatusValid = false;
+    device->bankChunkLimit = 0;
+    device->bankChunkLimitSuccesses = 0;
+
+    // The session is usable now, subscriptions that can not be created do not make it fail
+    restoreSubscriptions(device, true);
+    return UA_STATUSCODE_GOOD;
+}
+
+// One reconnect attempt. UA_Client_connect reactivates the previous session if the server still has it.
+static UA_StatusCode reconnect (RFU6xx_Device* device)
+{
+    UA_SecureChannelState channelState;
+    UA_SessionState sessionState;
+    UA_StatusCode connectStatus;
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+
+    UA_Client_getState(device->client, &channelState, &sessionState, &connectStatus);
+    if (channelState != UA_SECURECHANNELSTATE_OPEN || sessionState != UA_SESSIONSTATE_ACTIVATED)
+    {
+        // A channel without session can not be reused
+        if (channelState == UA_SECURECHANNELSTATE_OPEN) UA_Client_disconnect(device->client);
+        retval = UA_Client_connect(device->client, device->endpointUrl);
+    }
+
+    UA_Boolean newSession = device->sessionCreated;
+    if (retval == UA_STATUSCODE_GOOD && newSession)
+    {
+        // Operations called by restoreSession must not start another reconnect
+        device->connectionLost = false;
+        device->sessionCreated = false;
+        retval = restoreSession(device);
+        if (retval != UA_STATUSCODE_GOOD) device->sessionCreated = true;
+    }
+
+    if (retval != UA_STATUSCODE_GOOD)
+    {
+        device->connectionLost = true;
+        device->nextReconnect = UA_DateTime_nowMonotonic() + (UA_DateTime) device->reconnectDelay * UA_DATETIME_MSEC;
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Reconnect to %s failed. ErrorCode: %x, next attempt in %u ms", 
+            device->endpointUrl, retval, device->reconnectDelay);
+        device->reconnectDelay = 2 * device->reconnectDelay < RFU6xx_RECONNECT_MAX_DELAY ? 2 * device->reconnectDelay : RFU6xx_RECONNECT_MAX_DELAY;
+        return retval;
+    }
+
+    device->connectionLost = false;
+    device->reconnectDelay = RFU6xx_RECONNECT_MIN_DELAY;
+    device->reconnects++;
+    if (!newSession) device->sessionsRecovered++;
+    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Reconnected to %s (%s)", device->endpointUrl, 
+        !newSession ? "session reactivated" 
+            : (device->subscriptionStatus == UA_STATUSCODE_GOOD ? "new session, subscriptions re-created" : "new session, subscriptions pending"));
+    return UA_STATUSCODE_GOOD;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+UA_StatusCode RFU6xx_Device_supervise (RFU6xx_Device* device, RFU6xx_ReconnectPolicy policy, UA_UInt32 waitTimeout)
+{
+    UA_ClientConfig* config = UA_Client_getConfig(device->client);
+    if (!device->supervised)
+    {
+        device->userStateCallback = config->stateCallback;
+        config->stateCallback = supervisedStateChanged;
+    }
+    device->supervised = true;
+    device->reconnectPolicy = policy;
+    device->reconnectWaitTimeout = waitTimeout;
+    device->reconnectDelay = RFU6xx_RECONNECT_MIN_DELAY;
+    device->sessionCreated = false;
+
+    // initCached has already read the fingerprint
+    if (device->serverFingerprint != 0) return UA_STATUSCODE_GOOD;
+    return readServerFingerprint(device, &device->serverFingerprint);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+UA_StatusCode RFU6xx_Device_checkConnection (RFU6xx_Device* device)
+{
+    if (!device->supervised) return UA_STATUSCODE_GOOD;
+
+    UA_SecureChannelState channelState;
+    UA_SessionState sessionState;
+    UA_StatusCode connectStatus;
+    UA_Client_getState(device->client, &channelState, &sessionState, &connectStatus);
+    if (!device->connectionLost && !device->sessionCreated
+        && channelState == UA_SECURECHANNELSTATE_OPEN && sessionState == UA_SESSIONSTATE_ACTIVATED)
+    {
+        // Missing subscriptions are retried in the background of the operations, their errors are not passed on
+        if (device->subscriptionStatus != UA_STATUSCODE_GOOD && UA_DateTime_nowMonotonic() >= device->nextSubscriptionRestore)
+        {
+            restoreSubscriptions(device, false);
+        }
+        return UA_STATUSCODE_GOOD;
+    }
+
+    // The first attempt is made immediately
+    UA_DateTime now = UA_DateTime_nowMonotonic();
+    if (!device->connectionLost)
+    {
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Connection to %s lost", device->endpointUrl);
+        device->connectionLost = true;
+        device->reconnectDelay = RFU6xx_RECONNECT_MIN_DELAY;
+        device->nextReconnect = now;
+    }
+
+    UA_DateTime deadline = now;
+    if (device->reconnectPolicy == RFU6xx_RECONNECT_WAIT) deadline += (UA_DateTime) device->reconnectWaitTimeout * UA_DATETIME_MSEC;
+    while (true)
+    {
+        if (UA_DateTime_nowMonotonic() >= device->nextReconnect && reconnect(device) == UA_STATUSCODE_GOOD) return UA_STATUSCODE_GOOD;
+
+        now = UA_DateTime_nowMonotonic();
+        if (now >= deadline) return UA_STATUSCODE_BADCONNECTIONCLOSED;
+        UA_DateTime wakeup = device->nextReconnect < deadline ? device->nextReconnect : deadline;
+        if (wakeup > now) usleep((useconds_t) ((wakeup - now) / UA_DATETIME_USEC));
+    }
+}
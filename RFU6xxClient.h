@@ -15,6 +15,7 @@
     // Open62541 Library
     #include <open62541/client_config_default.h>
     #include <open62541/client_highlevel.h>
+    #include <open62541/client_subscriptions.h>
     #include <open62541/plugin/log_stdout.h>
 
     #include <stdio.h>
@@ -33,27 +34,303 @@
     #define RFU6xx_STATUSCODE_WRITE_ERROR 14
     #define RFU6xx_STATUSCODE_NOT_SUPPORTED_BY_DEVICE 15
 
+    // Number of input arguments of the ReadTag and WriteTag methods
+    #define RFU6xx_TAG_CALL_PARAMS_SIZE 6
+
+    // Maximum size of a tag id in bytes (496 bit EPC + reserve)
+    #define RFU6xx_MAX_TAG_ID_SIZE 64
+
+    // Default number of asynchronous method calls a device keeps in flight
+    #define RFU6xx_DEFAULT_MAX_IN_FLIGHT_CALLS 8
+
+    // Upper limit of ReadTag / WriteTag calls packed into one call request (callTagOperations)
+    #define RFU6xx_DEFAULT_MAX_METHODS_PER_CALL 64
+
+    // Timeout in ms of one UA_Client_run_iterate while waiting for asynchronous calls
+    #define RFU6xx_ASYNC_ITERATE_TIMEOUT 10
+
+    // Chunk sizes in bytes of readTagBank / writeTagBank, the size is tuned between min and max
+    #define RFU6xx_BANK_CHUNK_MIN_SIZE 2
+    #define RFU6xx_DEFAULT_BANK_CHUNK_SIZE 64
+    #define RFU6xx_BANK_CHUNK_MAX_SIZE 1024
+
+    // Chunks slower than this (ms) shrink the chunk size, so single calls stay far from the request timeout
+    #define RFU6xx_BANK_CHUNK_TARGET_LATENCY 250
+
+    // Attempts of a chunk that failed with an error other than READ_OUT_OF_RANGE
+    #define RFU6xx_BANK_CHUNK_RETRIES 3
+
+    // Successful chunks after which a chunk size limit learned from READ_OUT_OF_RANGE is dropped again
+    #define RFU6xx_BANK_CHUNK_LIMIT_RECOVERY 256
+
+    // Default retry policy of writeTagVerified: attempts and delay in ms between them
+    #define RFU6xx_DEFAULT_WRITE_ATTEMPTS 3
+    #define RFU6xx_DEFAULT_WRITE_RETRY_DELAY 10
+
+    // Delay in ms between reconnect attempts of a supervised device, doubled after every failed attempt
+    #define RFU6xx_RECONNECT_MIN_DELAY 50
+    #define RFU6xx_RECONNECT_MAX_DELAY 5000
+
+    // Delay in ms before subscriptions that could not be re-created after a reconnect are tried again
+    #define RFU6xx_SUBSCRIPTION_RESTORE_DELAY 5000
+
+    // Time in ms an operation waits for the reconnect with RFU6xx_RECONNECT_WAIT
+    #define RFU6xx_DEFAULT_RECONNECT_WAIT 10000
+
+    // Behaviour of operations on a supervised device while the connection is lost
+    typedef enum {
+        RFU6xx_RECONNECT_WAIT,                      // Wait until the device is reconnected (up to reconnectWaitTimeout)
+        RFU6xx_RECONNECT_FAIL_FAST                  // Fail with UA_STATUSCODE_BADCONNECTIONCLOSED unless a reconnect attempt is due and succeeds
+    } RFU6xx_ReconnectPolicy;
+
+    /*
+    * Struct:  RFU6xx_WriteRetryPolicy
+    * --------------------
+    * Retries of writeTagVerified. A write that fails with RFU6xx_STATUSCODE_WRITE_ERROR (the tag left the
+    * field for a moment, weak RF link) is repeated, optionally also a write whose read-back differs.
+    */
+    typedef struct {
+        UA_UInt32 maxAttempts;                      // Write-verify calls including the first one (0 == 1)
+        UA_UInt32 retryDelay;                       // ms between two attempts
+        UA_Boolean retryOnMismatch;                 // Also repeat a successful write whose read-back differs
+    } RFU6xx_WriteRetryPolicy;
+
     // Device status of the scanner
     typedef uint32_t RFU6xx_DeviceStatusCode;
     #define RFU6xx_DEVICESTATUSCODE_IDLE 0
     #define RFU6xx_DEVICESTATUSCODE_SCANNING 2
     #define RFU6xx_DEVICESTATUSCODE_BUSY 3
 
-    // Different namespace index
-    UA_Int16 nsAutoID;
-    UA_Int16 nsOpcDI;
-    UA_Int16 nsRfu;
+    /*
+    * Struct:  RFU6xx_Device 
+    * --------------------
+    * Context of one RFU6xx reader. It owns the OPC UA client of the connection and 
+    * the namespace indices and node ids resolved by init. All functions of this library
+    * take the device context, so one process can talk to any number of readers.
+    * A device (and its UA_Client) must only be used by one thread at a time.
+    */
+    typedef struct {
+        UA_Client* client;
+        char* endpointUrl;
+
+        // Different namespace index
+        UA_UInt16 nsAutoID;
+        UA_UInt16 nsOpcDI;
+        UA_UInt16 nsRfu;
+
+        // Different node ids
+        UA_UInt32 ndDeviceSetID;
+        UA_UInt32 ndRfu6xxNodeID;
+
+        UA_UInt32 ndLastScanDataID;
+        UA_UInt32 ndWriteTagID;
+        UA_UInt32 ndReadTagID;
+        UA_UInt32 ndScanStartID;
+        UA_UInt32 ndScanStopID;
+        UA_UInt32 ndDeviceStatusID;
+        UA_UInt32 ndRfidScanEventTypeID;            // AutoID namespace, 0 until resolved by subscribeScanEvents
+
+        // Number of service round trips used by the last node discovery (get_node_ids)
+        UA_UInt32 discoveryRoundTrips;
+
+        // Asynchronous method calls (readTagAsync, writeTagAsync)
+        UA_UInt32 maxInFlightCalls;                 // Limit of calls sent but not yet answered
+        UA_UInt32 inFlightCalls;
+        struct RFU6xx_TagCallRequest* freeTagCallRequests;  // Contexts of answered calls, reused by the next calls
+
+        // Method calls per call request (callTagOperations), 0 until read from the server
+        UA_UInt32 maxMethodsPerCall;
+        struct RFU6xx_TagCallParams* tagCallParams;         // Parameter storage of the largest batch so far, reused
+        size_t tagCallParamsCapacity;
+
+        // Locally tracked device status, checked by startScan / stopScan instead of reading it from the server.
+        // It is fed by readDeviceStatus, subscribeDeviceStatus and the results of ScanStart / ScanStop.
+        // A scan with duration leaves it invalid unless the DeviceStatus subscription is active.
+        RFU6xx_DeviceStatusCode deviceStatus;
+        UA_Boolean deviceStatusValid;
+        UA_Boolean strictStatusCheck;               // Always read the status from the server before start / stop
+        UA_UInt32 deviceStatusSubscriptionId;       // 0 if there is no DeviceStatus subscription
+
+        // Retries of writeTagVerified, RFU6xx_DEFAULT_WRITE_ATTEMPTS / RFU6xx_DEFAULT_WRITE_RETRY_DELAY after RFU6xx_Device_new
+        RFU6xx_WriteRetryPolicy writeRetryPolicy;
+        UA_Boolean rawBytesRejected;                // The server rejected RAW:BYTES, writeTagVerified sends RAW:STRING
+
+        // Chunk size of readTagBank / writeTagBank learned from previous transfers (0 == default)
+        UA_UInt32 bankChunkSize;
+        UA_UInt32 bankChunkLimit;                   // Largest size that did not fail with READ_OUT_OF_RANGE (0 == none)
+        UA_UInt32 bankChunkLimitSuccesses;          // Successful chunks since the limit was set
+
+        // Latency histograms and counters (RFU6xxMetrics.h), NULL if compiled with RFU6xx_METRICS_DISABLED
+        struct RFU6xx_Metrics* metrics;
+
+        // Cache of immutable tag memory (RFU6xxTagCache.h), NULL until RFU6xx_TagCache_enable
+        struct RFU6xx_TagCache* tagCache;
+
+        // Supervised connection (RFU6xx_Device_supervise)
+        UA_Boolean supervised;
+        RFU6xx_ReconnectPolicy reconnectPolicy;
+        UA_UInt32 reconnectWaitTimeout;             // ms, RFU6xx_RECONNECT_WAIT only
+        UA_Boolean connectionLost;
+        UA_Boolean sessionCreated;                  // A new session was created during the last reconnect
+        UA_UInt32 reconnectDelay;                   // Current backoff in ms
+        UA_DateTime nextReconnect;                  // Monotonic time of the next attempt
+        UA_UInt32 reconnects;                       // Successful reconnects
+        UA_UInt32 sessionsRecovered;                // Reconnects that reactivated the previous session
+        uint64_t serverFingerprint;                 // Namespaces and build info at init, validates the node ids after a new session
+        void (*userStateCallback)(UA_Client* client, UA_SecureChannelState channelState, 
+            UA_SessionState sessionState, UA_StatusCode connectStatus);
+
+        // Subscriptions that are re-created when the session is lost
+        struct RFU6xx_LastScanDataSubscription* lastScanDataSubscriptions;
+        struct RFU6xx_ScanEventSubscription* scanEventSubscriptions;   // RFU6xxScanEvents.h
+        UA_UInt32 nextSubscriptionHandle;           // Handles of the subscriptions above, server ids change on re-creation
+        UA_StatusCode subscriptionStatus;           // First error of re-creating them, GOOD if all exist on the server
+        UA_DateTime nextSubscriptionRestore;        // Monotonic time of the next attempt for the missing ones
+        UA_Double deviceStatusSamplingInterval;     // 0 if subscribeDeviceStatus was not called
+    } RFU6xx_Device;
+
+    /*
+    * Struct:  RFU6xx_TagOperation 
+    * --------------------
+    * One ReadTag or WriteTag operation of callTagOperations with its result.
+    */
+    typedef struct {
+        // Request
+        UA_Boolean write;                           // false: ReadTag, true: WriteTag
+        UA_String id;                               // Id string from the tag (coded in hex numbers)
+        UA_Int32 bank;
+        UA_Int32 offset;
+        UA_Int32 length;                            // Number of bytes to be read (ReadTag)
+        UA_String writeData;                        // Data to be written (WriteTag)
+
+        // Result
+        UA_StatusCode status;                       // Result of the method call
+        RFU6xx_StatusCode serverResponseCode;       // Status code returned from the rfu6xx server
+        UA_String readData;                         // Data of the tag (ReadTag), free with UA_String_clear
+    } RFU6xx_TagOperation;
+
+    /*
+    * Struct:  RFU6xx_WriteVerifyResult
+    * --------------------
+    * Combined result of the WriteTag and the verifying ReadTag of writeTagVerified (of the last attempt).
+    */
+    typedef struct {
+        RFU6xx_StatusCode writeResponseCode;        // Status code of WriteTag returned from the rfu6xx server
+        RFU6xx_StatusCode readResponseCode;         // Status code of the read-back returned from the rfu6xx server
+        UA_Boolean verified;                        // Write and read-back succeeded and the data matches
+        UA_Int32 mismatchOffset;                    // First byte of the read-back (relative to offset) that differs
+                                                    // from the data, -1 if it matches or was not read
+        UA_UInt32 attempts;                         // Number of write-verify calls
+    } RFU6xx_WriteVerifyResult;
+
+    /*
+    * Callback type for subscribeLastScanData
+    * --------------------
+    * Called from UA_Client_run_iterate each time the server publishes a new value of LastScanData.
+    * The string is only valid for the duration of the callback, copy it if it is needed later.
+    *
+    *  parameters: 
+    *               -> RFU6xx_Device* device
+    *               -> const UA_String* lastScanData            /-> ID of the last scanned tag
+    *               -> void* context                            /-> User context passed to subscribeLastScanData
+    */
+    typedef void (*RFU6xx_LastScanDataCallback)(RFU6xx_Device* device, const UA_String* lastScanData, void* context);
+
+    /*
+    * Callback types for readTagAsync and writeTagAsync
+    * --------------------
+    * Called from UA_Client_run_iterate when the answer of an asynchronous ReadTag / WriteTag call arrives.
+    * The read data is only valid for the duration of the callback, copy it if it is needed later.
+    *
+    *  parameters: 
+    *               -> RFU6xx_Device* device
+    *               -> UA_UInt32 requestId                      /-> Request handle returned by the async function
+    *               -> UA_StatusCode status                     /-> Result of the service call
+    *               -> const UA_String* readData                /-> Data of the tag (ReadTag only)
+    *               -> RFU6xx_StatusCode serverResponseCode     /-> Status code returned from the rfu6xx server
+    *               -> void* context                            /-> User context passed to the async function
+    */
+    typedef void (*RFU6xx_ReadTagCallback)(RFU6xx_Device* device, UA_UInt32 requestId, UA_StatusCode status, 
+        const UA_String* readData, RFU6xx_StatusCode serverResponseCode, void* context);
+    typedef void (*RFU6xx_WriteTagCallback)(RFU6xx_Device* device, UA_UInt32 requestId, UA_StatusCode status, 
+        RFU6xx_StatusCode serverResponseCode, void* context);
+
+    /*
+    * Function:  RFU6xx_Device_new 
+    * --------------------
+    * Creates a device context with a new OPC UA client using the default configuration.
+    * The device is stored as client context, see UA_Client_getContext.
+    * 
+    *  parameters: 
+    *               -> const char* endpointUrl                  /-> Url of the RFU6xx OPC UA server (opc.tcp://ip:port)
+    * 
+    *  returns: 
+    *               -> RFU6xx_Device*                           /-> NULL if out of memory
+    */
+    RFU6xx_Device* RFU6xx_Device_new (const char* endpointUrl);
 
-    // Different node ids
-    UA_Int16 ndDeviceSetID;
-    UA_Int16 ndRfu6xxNodeID;
+    /*
+    * Function:  RFU6xx_Device_delete 
+    * --------------------
+    * Disconnects and deletes the client and frees the device context.
+    * 
+    *  parameters: 
+    *               -> RFU6xx_Device* device
+    * 
+    *  returns: 
+    */
+    void RFU6xx_Device_delete (RFU6xx_Device* device);
+
+    /*
+    * Function:  RFU6xx_Device_connect 
+    * --------------------
+    * Connects the client of the device to its endpoint.
+    * 
+    *  parameters: 
+    *               -> RFU6xx_Device* device
+    * 
+    *  returns: 
+    *               -> UA_StatusCode
+    */
+    UA_StatusCode RFU6xx_Device_connect (RFU6xx_Device* device);
+
+    /*
+    * Function:  RFU6xx_Device_supervise 
+    * --------------------
+    * Enables the supervised connection mode, call it after init / initCached.
+    * Before every operation the channel and session state are checked. A lost connection is 
+    * reconnected with exponential backoff (RFU6xx_RECONNECT_MIN_DELAY .. RFU6xx_RECONNECT_MAX_DELAY).
+    * The client first tries to reactivate the previous session, then the node ids and subscriptions
+    * are still valid and nothing else has to be done. If a new session was created, the node ids are 
+    * validated with the server fingerprint (one read, a full init only if it changed) and the
+    * LastScanData, scan event and DeviceStatus subscriptions are re-created. The ids returned by subscribeLastScanData
+    * stay valid. Calls that were in flight when the connection broke fail and are not repeated.
+    * A subscription that can not be re-created does not fail the reconnect: device->subscriptionStatus
+    * reports the error and the missing subscriptions are tried again every RFU6xx_SUBSCRIPTION_RESTORE_DELAY ms.
+    * 
+    *  parameters: 
+    *               -> RFU6xx_Device* device
+    *               -> RFU6xx_ReconnectPolicy policy            /-> Behaviour of operations while the connection is lost
+    *               -> UA_UInt32 waitTimeout                    /-> Maximum wait in ms with RFU6xx_RECONNECT_WAIT
+    * 
+    *  returns: 
+    *               -> UA_StatusCode                            /-> Result of reading the server fingerprint
+    */
+    UA_StatusCode RFU6xx_Device_supervise (RFU6xx_Device* device, RFU6xx_ReconnectPolicy policy, UA_UInt32 waitTimeout);
 
-    UA_Int16 ndLastScanDataID;
-    UA_Int16 ndWriteTagID;
-    UA_Int16 ndReadTagID;
-    UA_Int16 ndScanStartID;
-    UA_Int16 ndScanStopID;
-    UA_Int16 ndDeviceStatusID;
+    /*
+    * Function:  RFU6xx_Device_checkConnection 
+    * --------------------
+    * Checks the connection of a supervised device and reconnects it according to the policy.
+    * The operations call it themselves, an application calls it to recover while it is idle.
+    * 
+    *  parameters: 
+    *               -> RFU6xx_Device* device
+    * 
+    *  returns: 
+    *               -> UA_StatusCode                            /-> UA_STATUSCODE_BADCONNECTIONCLOSED if the device is not connected
+    */
+    UA_StatusCode RFU6xx_Device_checkConnection (RFU6xx_Device* device);
 
     /*
     * Function:  serialize32Bit 
@@ -83,6 +360,30 @@
     */
     uint64_t encodeDouble(double value);
 
+    /*
+    * Function:  getChildNodeIdsByStrings 
+    * --------------------
+    * The function browses the children of a starting node once and 
+    * tries to get the node IDs of several children by their browse names.
+    * All searched names are matched in a single pass over the browse result,
+    * so only one round trip is needed regardless of the number of names.
+    * The node id of searchNodeNames[i] is stored in ndIDs[i].
+    * 
+    *  parameters: 
+    *               -> RFU6xx_Device* device
+    *               -> UA_UInt16 nsStartNode                    /-> Namespace of the starting node (mother node)
+    *               -> UA_UInt32 idStartNode                    /-> Node id of the starting node (mother node)
+    *               -> char* searchNodeNames[]                  /-> Browse names of the searched nodes
+    *               -> UA_UInt32* ndIDs[]                       /-> Node ids of the searched nodes
+    *               -> size_t searchNodeCount                   /-> Number of searched nodes
+    * 
+    *  returns: 
+    *               -> UA_StatusCode                            /-> UA_STATUSCODE_BADNOTFOUND if at least one name was not found,
+    *                                                               the status code of the browse service if it failed
+    */
+    UA_StatusCode getChildNodeIdsByStrings (RFU6xx_Device* device, UA_UInt16 nsStartNode, UA_UInt32 idStartNode, 
+        char* searchNodeNames[], UA_UInt32* ndIDs[], size_t searchNodeCount);
+
     /*
     * Function:  getChildNodeIdByString 
     * --------------------
@@ -93,70 +394,95 @@
     * If so, the child's node id is returned. (stored in ndID)
     * 
     *  parameters: 
-    *               -> UA_Client* client
-    *               -> UA_Int16 nsStartNode                     /-> Namespace of the starting node (mother node)
-    *               -> UA_Int16 idStartNode                     /-> Node id of the starting node (mother node)
+    *               -> RFU6xx_Device* device
+    *               -> UA_UInt16 nsStartNode                    /-> Namespace of the starting node (mother node)
+    *               -> UA_UInt32 idStartNode                    /-> Node id of the starting node (mother node)
     *               -> char* searchNodeName                     /-> Browse name of the searched node
-    *               -> UA_Int16* ndID                           /-> Node id of the searched node
+    *               -> UA_UInt32* ndID                          /-> Node id of the searched node
     * 
     *  returns: 
     *               -> UA_StatusCode
     */
-    UA_StatusCode getChildNodeIdByString (UA_Client* client, UA_Int16 nsStartNode, UA_Int16 idStartNode,  char* searchNodeName, UA_Int16* ndID);
+    UA_StatusCode getChildNodeIdByString (RFU6xx_Device* device, UA_UInt16 nsStartNode, UA_UInt32 idStartNode,  char* searchNodeName, UA_UInt32* ndID);
 
     /*
     * Function:  tagIdToExtentionObject
     * --------------------
     * Converts the id of a tag into a byte array and stores it in an extension object.
+    * The id must consist of an even number of hex digits.
     *  parameters: 
+    *               -> RFU6xx_Device* device
     *               -> UA_String id                             /-> ID of the tag in the form of a string 
     *               -> UA_ExtensionObject* eo                   /-> Extension object in which the id is stored as a byte string 
     *               -> unsigned char sendBuffer[]               /-> Buffer pointer in which the id of the tag is stored as a byte array
     *               -> int sendBuffSize                         /-> Size of the sendBuffer
     * 
     *  returns: 
-    *               -> int                                      /-> Errorcode -1 == Failed to translate hex numbers from id string; 0 == everything's OK
+    *               -> int                                      /-> Errorcode -1 == Invalid hex id string (odd length or no hex digit) or sendBuffer too small; 0 == everything's OK
     */
-    int tagIdToExtentionObject (UA_String id, UA_ExtensionObject* eo, unsigned char sendBuffer[], int sendBuffSize);
+    int tagIdToExtentionObject (RFU6xx_Device* device, UA_String id, UA_ExtensionObject* eo, unsigned char sendBuffer[], int sendBuffSize);
 
     /*
     * Function:  get_node_ids
     * --------------------
     * Searches the server for important node ids that will be used later.
+    * The fixed paths DeviceSet/RFU6xx/<child> are resolved with one TranslateBrowsePathsToNodeIds
+    * request, so the whole discovery takes one round trip. The count is stored in discoveryRoundTrips.
+    * If a path is not found (browse names in other namespaces than on the RFU6xx), the nodes are
+    * browsed level by level and matched by name regardless of namespace (3 more round trips).
+    * Needs the namespace indices of get_namespace_index. Service errors are passed through.
     *  parameters: 
-    *               -> UA_Client* client
+    *               -> RFU6xx_Device* device
     * 
     *  returns: 
     *               -> UA_StatusCode
     */
-    UA_StatusCode get_node_ids(UA_Client* client);
+    UA_StatusCode get_node_ids(RFU6xx_Device* device);
 
     /*
     * Function:  get_namespace_index
     * --------------------
     * Searches the server for the namespaces index that will be used later.
     *  parameters: 
-    *               -> UA_Client* client
+    *               -> RFU6xx_Device* device
     * 
     *  returns: 
     *               -> UA_StatusCode
     */
-    UA_StatusCode get_namespace_index(UA_Client* client);
+    UA_StatusCode get_namespace_index(RFU6xx_Device* device);
 
     /*
     * Function:  init 
     * --------------------
-    * Initializes the program for communication with the Rfu6xx.
+    * Initializes the device for communication with the Rfu6xx.
     * First, the indices of the namespaces are retrieved. 
     * After that, different node ids of important nodes are retrieved and saved.
     * 
     *  parameters: 
-    *               -> UA_Client* client
+    *               -> RFU6xx_Device* device
     * 
     *  returns: 
     *               -> UA_StatusCode
     */
-    UA_StatusCode init (UA_Client* client);
+    UA_StatusCode init (RFU6xx_Device* device);
+
+    /*
+    * Function:  initCached 
+    * --------------------
+    * Initializes the device like init, but keeps the namespace indices and node ids in a cache file.
+    * The cache entries are keyed by the endpoint url of the device and a fingerprint of the server namespace array 
+    * and build info, so a firmware update invalidates them. With a valid entry only one read request 
+    * (namespace array and build info) is sent instead of the full discovery.
+    * If there is no valid entry, init is called and the cache file is updated.
+    * 
+    *  parameters: 
+    *               -> RFU6xx_Device* device
+    *               -> const char* cacheFile                    /-> Path of the cache file
+    * 
+    *  returns: 
+    *               -> UA_StatusCode
+    */
+    UA_StatusCode initCached (RFU6xx_Device* device, const char* cacheFile);
 
     /*
     * Function:  readLastScanData 
@@ -164,48 +490,103 @@
     * Asks the RFU6xx server for the ID of the last code scanned and stores it in char* lastScanData
     *
     *  parameters: 
-    *               -> UA_Client* client
-    *               -> UA_String* lastScanData                  /-> Returns the ID of the last scanned tag
+    *               -> RFU6xx_Device* device
+    *               -> UA_String* lastScanData                  /-> Returns the ID of the last scanned tag (free with UA_String_clear)
+    * 
+    *  returns: 
+    *               -> UA_StatusCode
+    */
+    UA_StatusCode readLastScanData (RFU6xx_Device* device, UA_String* lastScanData);
+
+    /*
+    * Function:  subscribeLastScanData 
+    * --------------------
+    * Creates a subscription with a monitored item on the LastScanData node.
+    * Instead of polling readLastScanData, the callback is called with every new value
+    * the server publishes. Notifications are delivered while UA_Client_run_iterate is called.
+    *
+    *  parameters: 
+    *               -> RFU6xx_Device* device
+    *               -> UA_Double samplingInterval               /-> Sampling and publishing interval in ms
+    *               -> UA_UInt32 queueSize                      /-> Number of values the server queues between two publish cycles
+    *               -> RFU6xx_LastScanDataCallback callback     /-> Called with each new value
+    *               -> void* context                            /-> User context passed to the callback
+    *               -> UA_UInt32* subscriptionId                /-> Returns a device-local handle of the subscription (kept after re-creation)
+    * 
+    *  returns: 
+    *               -> UA_StatusCode
+    */
+    UA_StatusCode subscribeLastScanData (RFU6xx_Device* device, UA_Double samplingInterval, UA_UInt32 queueSize, 
+        RFU6xx_LastScanDataCallback callback, void* context, UA_UInt32* subscriptionId);
+
+    /*
+    * Function:  unsubscribeLastScanData 
+    * --------------------
+    * Deletes a subscription created by subscribeLastScanData
+    *
+    *  parameters: 
+    *               -> RFU6xx_Device* device
+    *               -> UA_UInt32 subscriptionId                 /-> Id returned by subscribeLastScanData
+    * 
+    *  returns: 
+    *               -> UA_StatusCode
+    */
+    UA_StatusCode unsubscribeLastScanData (RFU6xx_Device* device, UA_UInt32 subscriptionId);
+
+    /*
+    * Function:  subscribeDeviceStatus 
+    * --------------------
+    * Creates a subscription on the DeviceStatus node that keeps the tracked device status 
+    * (device->deviceStatus) up to date. Notifications are delivered while UA_Client_run_iterate is called.
+    *
+    *  parameters: 
+    *               -> RFU6xx_Device* device
+    *               -> UA_Double samplingInterval               /-> Sampling and publishing interval in ms
     * 
     *  returns: 
     *               -> UA_StatusCode
     */
-    UA_StatusCode readLastScanData (UA_Client* client, UA_String* lastScanData);
+    UA_StatusCode subscribeDeviceStatus (RFU6xx_Device* device, UA_Double samplingInterval);
 
     /*
     * Function:  readDeviceStatus 
     * --------------------
-    * Asks the RFU6xx server current device status and stores it in char* lastScanData
+    * Asks the RFU6xx server current device status and stores it in deviceStatus.
+    * The tracked device status is updated as well.
     *
     *  parameters: 
-    *               -> UA_Client* client
+    *               -> RFU6xx_Device* device
     *               -> UA_Int32* deviceStatus                   /-> Returns the device status
     * 
     *  returns: 
     *               -> UA_StatusCode
     */
-    UA_StatusCode readDeviceStatus (UA_Client* client, UA_Int32* deviceStatus);
+    UA_StatusCode readDeviceStatus (RFU6xx_Device* device, UA_Int32* deviceStatus);
 
     /*
     * Function:  stopScan 
     * --------------------
-    * Stops the Rfu6xx sensor for scanning
+    * Stops the Rfu6xx sensor for scanning.
+    * The device must be scanning. This is checked against the tracked device status, 
+    * the server is only asked if the tracked status is unknown, does not match or strictStatusCheck is set.
     *
     *  parameters: 
-    *               -> UA_Client* client
+    *               -> RFU6xx_Device* device
     * 
     *  returns: 
     *               -> UA_StatusCode
     */
-    UA_StatusCode stopScan (UA_Client* client);
+    UA_StatusCode stopScan (RFU6xx_Device* device);
 
     /*
     * Function:  startScan 
     * --------------------
-    * Starts the Rfu6xx sensor for scanning
+    * Starts the Rfu6xx sensor for scanning.
+    * The device must be idle. This is checked against the tracked device status, 
+    * the server is only asked if the tracked status is unknown, does not match or strictStatusCheck is set.
     *
     *  parameters: 
-    *               -> UA_Client* client
+    *               -> RFU6xx_Device* device
     *               -> UA_Double duration                       /->
     *               -> UA_Int32 cycle                           /->
     *               -> UA_Bool dataAvailable                    /->
@@ -213,43 +594,219 @@
     *  returns: 
     *              -> UA_StatusCode
     */
-    UA_StatusCode startScan (UA_Client* client, UA_Double duration, UA_Int32 cycle, UA_Boolean dataAvailable);
+    UA_StatusCode startScan (RFU6xx_Device* device, UA_Double duration, UA_Int32 cycle, UA_Boolean dataAvailable);
 
     /*
     * Function:  readTag 
     * --------------------
-    * Reads data of a tag
+    * Reads data of a tag. The data is returned as hex digits, hexDecode converts it into bytes.
     *
     *  parameters: 
-    *               -> UA_Client* client
+    *               -> RFU6xx_Device* device
     *               -> UA_String id                             /-> Id string from the tag (coded in hex numbers)
     *               -> UA_Int32 bank                            /-> Bank from which the data is to be read
     *               -> UA_Int32 offset                          /-> Reading start offset
     *               -> UA_Int32 length                          /-> Number of bytes to be read
-    *               -> UA_String* readData                      /-> Returns the data of the tag
+    *               -> UA_String* readData                      /-> Returns the data of the tag (free with UA_String_clear)
     *               -> RFU6xx_StatusCode* serverResponseCode    /-> Status code returned from the rfu6xx server
     * 
     *  returns: 
     *               -> UA_StatusCode
     */
-    UA_StatusCode readTag (UA_Client* client, UA_String id, UA_Int32 bank, UA_Int32 offset, UA_Int32 length, UA_String* readData, RFU6xx_StatusCode* serverResponseCode);
+    UA_StatusCode readTag (RFU6xx_Device* device, UA_String id, UA_Int32 bank, UA_Int32 offset, UA_Int32 length, UA_String* readData, RFU6xx_StatusCode* serverResponseCode);
 
     /*
     * Function:  writeTag 
     * --------------------
-    * Writes data to a tag
+    * Writes data to a tag. The data must consist of an even number of hex digits, 
+    * otherwise UA_STATUSCODE_BADINVALIDARGUMENT is returned without calling the server.
     *
     *  parameters: 
-    *               -> UA_Client* client
+    *               -> RFU6xx_Device* device
     *               -> UA_String id                             /-> Id string from the tag (coded in hex numbers)
     *               -> UA_Int32 bank                            /-> Bank from which the data is to be read
     *               -> UA_Int32 offset                          /-> Reading start offset
-    *               -> UA_String writeData                      /-> Data to be written
+    *               -> UA_String writeData                      /-> Data to be written (coded in hex numbers)
+    *               -> RFU6xx_StatusCode* serverResponseCode    /-> Status code returned from the rfu6xx server
+    * 
+    *  returns: 
+    *               -> UA_StatusCode
+    */
+    UA_StatusCode writeTag (RFU6xx_Device* device, UA_String id, UA_Int32 bank, UA_Int32 offset, UA_String writeData, RFU6xx_StatusCode* serverResponseCode);
+
+    /*
+    * Function:  readTagBytes 
+    * --------------------
+    * Binary variant of readTag: the data is requested with the code type RAW:BYTES, so the reader
+    * sends the bytes instead of twice as many hex digits, and they are copied into the caller buffer 
+    * without a hex conversion.
+    *
+    *  parameters: 
+    *               -> RFU6xx_Device* device
+    *               -> UA_String id                             /-> Id string from the tag (coded in hex numbers)
+    *               -> UA_Int32 bank                            /-> Bank from which the data is to be read
+    *               -> UA_Int32 offset                          /-> Reading start offset
+    *               -> UA_Int32 length                          /-> Number of bytes to be read
+    *               -> UA_Byte* buffer                          /-> Buffer of at least length bytes for the data
+    *               -> size_t* readLength                       /-> Returns the number of bytes received
+    *               -> RFU6xx_StatusCode* serverResponseCode    /-> Status code returned from the rfu6xx server
+    * 
+    *  returns: 
+    *               -> UA_StatusCode                            /-> UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED if the reader sent more than length bytes
+    */
+    UA_StatusCode readTagBytes (RFU6xx_Device* device, UA_String id, UA_Int32 bank, UA_Int32 offset, UA_Int32 length, 
+        UA_Byte* buffer, size_t* readLength, RFU6xx_StatusCode* serverResponseCode);
+
+    /*
+    * Function:  writeTagBytes 
+    * --------------------
+    * Binary variant of writeTag: the data is sent as ByteString with the code type RAW:BYTES.
+    * The request references the caller's bytes, they are not copied or hex encoded.
+    *
+    *  parameters: 
+    *               -> RFU6xx_Device* device
+    *               -> UA_String id                             /-> Id string from the tag (coded in hex numbers)
+    *               -> UA_Int32 bank                            /-> Bank to which the data is to be written
+    *               -> UA_Int32 offset                          /-> Writing start offset
+    *               -> const UA_Byte* data                      /-> Data to be written
+    *               -> size_t length                            /-> Number of bytes to be written
     *               -> RFU6xx_StatusCode* serverResponseCode    /-> Status code returned from the rfu6xx server
     * 
     *  returns: 
     *               -> UA_StatusCode
     */
-    UA_StatusCode writeTag (UA_Client* client, UA_String id, UA_Int32 bank, UA_Int32 offset, UA_String writeData, RFU6xx_StatusCode* serverResponseCode);
+    UA_StatusCode writeTagBytes (RFU6xx_Device* device, UA_String id, UA_Int32 bank, UA_Int32 offset, 
+        const UA_Byte* data, size_t length, RFU6xx_StatusCode* serverResponseCode);
+
+    /*
+    * Function:  callTagOperations 
+    * --------------------
+    * Executes many ReadTag / WriteTag operations with as few call requests as possible.
+    * The operations are packed into one call request; if there are more than the server accepts
+    * (MaxNodesPerMethodCall operation limit), they are split into several requests.
+    * The result of each operation is stored in the operation itself.
+    *
+    *  parameters: 
+    *               -> RFU6xx_Device* device
+    *               -> RFU6xx_TagOperation operations[]         /-> Operations, returns the per item results
+    *               -> size_t operationsSize                    /-> Number of operations
+    * 
+    *  returns: 
+    *               -> UA_StatusCode                            /-> Service result, the per item results are in the operations
+    */
+    UA_StatusCode callTagOperations (RFU6xx_Device* device, RFU6xx_TagOperation operations[], size_t operationsSize);
+
+    /*
+    * Function:  writeTagVerified 
+    * --------------------
+    * Writes data to a tag and reads the region back to confirm the encode. WriteTag and ReadTag (both
+    * RAW:BYTES) are sent back to back in one call request, the server executes them in order, so the
+    * verify costs no extra round trip and no hex conversion. The read-back is compared in place with
+    * the data. A RFU6xx_STATUSCODE_WRITE_ERROR (and a mismatch if configured) is retried according to
+    * device->writeRetryPolicy. If the server rejects the code type argument RAW:BYTES (bad input argument
+    * result, the write was not executed), the attempt is repeated with RAW:STRING and the device keeps
+    * using hex digits (device->rawBytesRejected, reset when the server changes). Other errors are returned.
+    *
+    *  parameters: 
+    *               -> RFU6xx_Device* device
+    *               -> UA_String id                             /-> Id string from the tag (coded in hex numbers)
+    *               -> UA_Int32 bank                            /-> Bank to which the data is to be written
+    *               -> UA_Int32 offset                          /-> Writing start offset
+    *               -> const UA_Byte* data                      /-> Data to be written
+    *               -> size_t length                            /-> Number of bytes to be written
+    *               -> RFU6xx_WriteVerifyResult* result         /-> Returns the status codes and the comparison (always set)
+    * 
+    *  returns: 
+    *               -> UA_StatusCode                            /-> Service result, the tag is only written correctly if result->verified
+    */
+    UA_StatusCode writeTagVerified (RFU6xx_Device* device, UA_String id, UA_Int32 bank, UA_Int32 offset, 
+        const UA_Byte* data, size_t length, RFU6xx_WriteVerifyResult* result);
+
+    /*
+    * Function:  readTagAsync 
+    * Function:  writeTagAsync 
+    * --------------------
+    * Asynchronous variants of readTag and writeTag. The method call is sent immediately and the 
+    * callback is called from UA_Client_run_iterate (see runIterate) when the answer arrives.
+    * Up to device->maxInFlightCalls calls are kept in flight; if the limit is reached, the function
+    * drives the client until an answer frees a slot.
+    *
+    *  parameters: 
+    *               -> RFU6xx_Device* device
+    *               -> UA_String id                             /-> Id string from the tag (coded in hex numbers)
+    *               -> UA_Int32 bank                            /-> Bank from which the data is to be read / written
+    *               -> UA_Int32 offset                          /-> Reading / writing start offset
+    *               -> UA_Int32 length                          /-> Number of bytes to be read (readTagAsync)
+    *               -> UA_String writeData                      /-> Data to be written (writeTagAsync)
+    *               -> RFU6xx_ReadTagCallback callback          /-> Called with the result (RFU6xx_WriteTagCallback for writeTagAsync)
+    *               -> void* context                            /-> User context passed to the callback
+    *               -> UA_UInt32* requestId                     /-> Returns the request handle (may be NULL)
+    * 
+    *  returns: 
+    *               -> UA_StatusCode                            /-> Result of sending, the callback is only called if good
+    */
+    UA_StatusCode readTagAsync (RFU6xx_Device* device, UA_String id, UA_Int32 bank, UA_Int32 offset, UA_Int32 length, 
+        RFU6xx_ReadTagCallback callback, void* context, UA_UInt32* requestId);
+    UA_StatusCode writeTagAsync (RFU6xx_Device* device, UA_String id, UA_Int32 bank, UA_Int32 offset, UA_String writeData, 
+        RFU6xx_WriteTagCallback callback, void* context, UA_UInt32* requestId);
+
+    /*
+    * Function:  runIterate 
+    * --------------------
+    * Processes network messages of the device: answers of asynchronous calls and subscription notifications.
+    *
+    *  parameters: 
+    *               -> RFU6xx_Device* device
+    *               -> UA_UInt32 timeout                        /-> Maximum time in ms to wait for messages
+    * 
+    *  returns: 
+    *               -> UA_StatusCode
+    */
+    UA_StatusCode runIterate (RFU6xx_Device* device, UA_UInt32 timeout);
+
+    /*
+    * Function:  waitForAsyncCalls 
+    * --------------------
+    * Drives the client until all asynchronous calls of the device are answered.
+    *
+    *  parameters: 
+    *               -> RFU6xx_Device* device
+    * 
+    *  returns: 
+    *               -> UA_StatusCode
+    */
+    UA_StatusCode waitForAsyncCalls (RFU6xx_Device* device);
+
+    /*
+    * Function:  readTagBank 
+    * Function:  writeTagBank 
+    * --------------------
+    * Reads (writes) a large region of a memory bank with pipelined ReadTag (WriteTag) calls.
+    * The region is split into chunks, up to device->maxInFlightCalls chunks are in flight and
+    * the read chunks are reassembled in the caller buffer. The chunk size adapts to the reader:
+    * it grows while chunks succeed fast and halves on errors and on chunks slower than
+    * RFU6xx_BANK_CHUNK_TARGET_LATENCY. A chunk answered with READ_OUT_OF_RANGE is repeated at the
+    * same offset with RFU6xx_BANK_CHUNK_MIN_SIZE bytes: if that succeeds the chunk was too large for
+    * the reader and its size becomes an upper limit, otherwise the region reaches past the end of
+    * the bank and the transfer fails without touching the limit. The limit is dropped again after
+    * RFU6xx_BANK_CHUNK_LIMIT_RECOVERY successful chunks and when a new session is created.
+    * The learned size is kept in the device for the next transfer.
+    *
+    *  parameters: 
+    *               -> RFU6xx_Device* device
+    *               -> UA_String id                             /-> Id string from the tag (coded in hex numbers)
+    *               -> UA_Int32 bank
+    *               -> UA_Int32 offset                          /-> Start of the region in bytes
+    *               -> UA_Int32 length                          /-> Size of the region in bytes
+    *               -> UA_Byte* buffer  /  const UA_Byte* data  /-> length bytes to be filled (written)
+    *               -> RFU6xx_StatusCode* serverResponseCode    /-> Status code of the first chunk that finally failed
+    * 
+    *  returns: 
+    *               -> UA_StatusCode                            /-> Good if all chunks succeeded
+    */
+    UA_StatusCode readTagBank (RFU6xx_Device* device, UA_String id, UA_Int32 bank, UA_Int32 offset, UA_Int32 length, 
+        UA_Byte* buffer, RFU6xx_StatusCode* serverResponseCode);
+    UA_StatusCode writeTagBank (RFU6xx_Device* device, UA_String id, UA_Int32 bank, UA_Int32 offset, UA_Int32 length, 
+        const UA_Byte* data, RFU6xx_StatusCode* serverResponseCode);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,128 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+*
+* @contact: sebastian.heidepriem@sick.de
+*
+*
+* Benchmark of the tag deduplication (RFU6xxTagDedup) with a simulated shift:
+*   1.) <field> tags are in the field at once, each one is scanned <repeats> times in random order.
+*   2.) A tag that got all of its scans leaves the field and a new unique tag arrives.
+*   3.) Time advances by <scan interval> per scan, departed tags expire after the TTL.
+* The cost per scan is measured against the same loop without deduplication.
+*
+* Usage: ./dedupbench [unique tags] [field] [repeats]
+*/
+
+#include "RFU6xxTagDedup.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define EPC_SIZE 12
+#define SCAN_INTERVAL (10 * UA_DATETIME_USEC)
+#define TTL_MS 2000
+#define PRESENT_INTERVAL_MS 1000
+
+typedef struct {
+    UA_Byte epc[EPC_SIZE];
+    UA_UInt32 scansLeft;
+} FieldTag;
+
+static uint64_t randomState = 1;
+
+static uint64_t nextRandom (void)
+{
+    uint64_t z = (randomState += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static void newTag (FieldTag* tag, UA_UInt32 repeats)
+{
+    uint64_t a = nextRandom(), b = nextRandom();
+    memcpy(tag->epc, &a, 8);
+    memcpy(&tag->epc[8], &b, 4);
+    tag->scansLeft = repeats;
+}
+
+static double nowNs (void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Runs the simulated shift, with dedup == NULL only the scan stream is generated
+static UA_UInt64 runShift (RFU6xx_TagDedup* dedup, size_t uniqueTags, size_t fieldSize, UA_UInt32 repeats, volatile UA_UInt64* sink)
+{
+    FieldTag* field = (FieldTag*) malloc(fieldSize * sizeof(FieldTag));
+    UA_UInt64 scans = 0;
+    UA_DateTime now = 0;
+
+    randomState = 1;
+    for (size_t i = 0; i < fieldSize; i++) newTag(&field[i], repeats);
+    size_t created = fieldSize;
+
+    while (created < uniqueTags)
+    {
+        FieldTag* tag = &field[nextRandom() % fieldSize];
+        now += SCAN_INTERVAL;
+        scans++;
+        if (dedup != NULL) *sink += RFU6xx_TagDedup_observe(dedup, tag->epc, EPC_SIZE, now);
+        else *sink += tag->epc[0];
+
+        if (--tag->scansLeft == 0)
+        {
+            newTag(tag, repeats);
+            created++;
+        }
+    }
+    if (dedup != NULL) RFU6xx_TagDedup_expire(dedup, now + (UA_DateTime) TTL_MS * UA_DATETIME_MSEC + 1);
+    free(field);
+    return scans;
+}
+
+int main (int argc, char *argv[])
+{
+    size_t uniqueTags = argc > 1 ? (size_t) atol(argv[1]) : 2000000;
+    size_t fieldSize = argc > 2 ? (size_t) atol(argv[2]) : 10000;
+    UA_UInt32 repeats = argc > 3 ? (UA_UInt32) atol(argv[3]) : 50;
+    volatile UA_UInt64 sink = 0;
+
+    if (fieldSize == 0 || repeats == 0 || uniqueTags < fieldSize)
+    {
+        fprintf(stderr, "Usage: %s [unique tags] [field] [repeats]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Tags stay in the index for the TTL after they left the field
+    size_t maxEntries = 4 * fieldSize;
+    RFU6xx_TagDedup* dedup = RFU6xx_TagDedup_new(maxEntries, TTL_MS, PRESENT_INTERVAL_MS, NULL, NULL);
+    if (dedup == NULL) return EXIT_FAILURE;
+
+    double start = nowNs();
+    UA_UInt64 scans = runShift(NULL, uniqueTags, fieldSize, repeats, &sink);
+    double baselineNs = nowNs() - start;
+
+    start = nowNs();
+    runShift(dedup, uniqueTags, fieldSize, repeats, &sink);
+    double dedupNs = nowNs() - start;
+
+    RFU6xx_TagDedupStats stats;
+    RFU6xx_TagDedup_getStats(dedup, &stats);
+    printf("scans %llu, unique tags %zu, field %zu, repeats %u\n", (unsigned long long) scans, uniqueTags, fieldSize, repeats);
+    printf("dedup %.1f ns/scan (%.1f M scans/s), stream generation %.1f ns/scan\n",
+        (dedupNs - baselineNs) / scans, scans / (dedupNs - baselineNs) * 1e3, baselineNs / scans);
+    printf("first seen %llu, present %llu, departed %llu, overflows %llu\n", (unsigned long long) stats.firstSeen,
+        (unsigned long long) stats.present, (unsigned long long) stats.departed, (unsigned long long) stats.overflows);
+    printf("reported %.2f %% of the scans, index memory %.1f MiB for %zu tags\n",
+        100.0 * (stats.firstSeen + stats.present + stats.departed) / scans, stats.memoryBytes / 1048576.0, stats.maxEntries);
+
+    RFU6xx_TagDedup_delete(dedup);
+    return EXIT_SUCCESS;
+}
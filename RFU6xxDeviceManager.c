@@ -0,0 +1,323 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+*
+* @contact: sebastian.heidepriem@sick.de
+*/
+
+#include "RFU6xxDeviceManager.h"
+
+#include <pthread.h>
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+typedef struct QueuedJob {
+    RFU6xx_DeviceJob job;
+    void* context;
+    struct QueuedJob* next;
+} QueuedJob;
+
+// One device with its own job queue. A slot is in the ready queue when it has
+// jobs and no worker is running one of them, so jobs of a device never overlap.
+typedef struct DeviceSlot {
+    RFU6xx_Device* device;
+    QueuedJob* jobHead;
+    QueuedJob* jobTail;
+    UA_Boolean ready;
+    UA_Boolean active;
+    struct DeviceSlot* nextReady;
+} DeviceSlot;
+
+struct RFU6xx_DeviceManager {
+    pthread_mutex_t mutex;
+    pthread_cond_t workAvailable;
+    pthread_cond_t idle;
+    UA_Boolean stop;
+
+    pthread_t* threads;
+    size_t threadCount;
+
+    DeviceSlot** slots;
+    size_t slotCount;
+
+    DeviceSlot* readyHead;
+    DeviceSlot* readyTail;
+    size_t pendingJobs;
+};
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+// Must be called with the mutex held
+static void enqueueReady (RFU6xx_DeviceManager* manager, DeviceSlot* slot)
+{
+    slot->ready = true;
+    slot->nextReady = NULL;
+    if (manager->readyTail == NULL) manager->readyHead = slot;
+    else manager->readyTail->nextReady = slot;
+    manager->readyTail = slot;
+    pthread_cond_signal(&manager->workAvailable);
+}
+
+static void* workerThread (void* arg)
+{
+    RFU6xx_DeviceManager* manager = (RFU6xx_DeviceManager*) arg;
+
+    pthread_mutex_lock(&manager->mutex);
+    while (true)
+    {
+        while (!manager->stop && manager->readyHead == NULL)
+        {
+            pthread_cond_wait(&manager->workAvailable, &manager->mutex);
+        }
+        if (manager->readyHead == NULL) break;
+
+        // Take the next device and its oldest job
+        DeviceSlot* slot = manager->readyHead;
+        manager->readyHead = slot->nextReady;
+        if (manager->readyHead == NULL) manager->readyTail = NULL;
+        slot->ready = false;
+        slot->active = true;
+
+        QueuedJob* job = slot->jobHead;
+        slot->jobHead = job->next;
+        if (slot->jobHead == NULL) slot->jobTail = NULL;
+        pthread_mutex_unlock(&manager->mutex);
+
+        job->job(slot->device, job->context);
+        UA_free(job);
+
+        // Requeue the device behind the others if it has more jobs (round robin)
+        pthread_mutex_lock(&manager->mutex);
+        slot->active = false;
+        if (slot->jobHead != NULL) enqueueReady(manager, slot);
+        if (--manager->pendingJobs == 0) pthread_cond_broadcast(&manager->idle);
+    }
+    pthread_mutex_unlock(&manager->mutex);
+    return NULL;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+RFU6xx_DeviceManager* RFU6xx_DeviceManager_new (size_t threadCount)
+{
+    if (threadCount == 0) return NULL;
+
+    RFU6xx_DeviceManager* manager = (RFU6xx_DeviceManager*) UA_calloc(1, sizeof(RFU6xx_DeviceManager));
+    if (manager == NULL) return NULL;
+
+    manager->threads = (pthread_t*) UA_calloc(threadCount, sizeof(pthread_t));
+    if (manager->threads == NULL)
+    {
+        UA_free(manager);
+        return NULL;
+    }
+    pthread_mutex_init(&manager->mutex, NULL);
+    pthread_cond_init(&manager->workAvailable, NULL);
+    pthread_cond_init(&manager->idle, NULL);
+
+    for (size_t i = 0; i < threadCount; i++)
+    {
+        if (pthread_create(&manager->threads[i], NULL, workerThread, manager) != 0)
+        {
+            UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Could not start worker thread %zu", i);
+            RFU6xx_DeviceManager_delete(manager);
+            return NULL;
+        }
+        manager->threadCount++;
+    }
+    return manager;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+void RFU6xx_DeviceManager_delete (RFU6xx_DeviceManager* manager)
+{
+    if (manager == NULL) return;
+
+    // Workers finish the queued jobs before they leave
+    pthread_mutex_lock(&manager->mutex);
+    manager->stop = true;
+    pthread_cond_broadcast(&manager->workAvailable);
+    pthread_mutex_unlock(&manager->mutex);
+    for (size_t i = 0; i < manager->threadCount; i++)
+    {
+        pthread_join(manager->threads[i], NULL);
+    }
+
+    for (size_t i = 0; i < manager->slotCount; i++)
+    {
+        RFU6xx_Device_delete(manager->slots[i]->device);
+        UA_free(manager->slots[i]);
+    }
+    UA_free(manager->slots);
+    UA_free(manager->threads);
+    pthread_cond_destroy(&manager->idle);
+    pthread_cond_destroy(&manager->workAvailable);
+    pthread_mutex_destroy(&manager->mutex);
+    UA_free(manager);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+RFU6xx_Device* RFU6xx_DeviceManager_addDevice (RFU6xx_DeviceManager* manager, const char* endpointUrl)
+{
+    DeviceSlot* slot = (DeviceSlot*) UA_calloc(1, sizeof(DeviceSlot));
+    if (slot == NULL) return NULL;
+
+    slot->device = RFU6xx_Device_new(endpointUrl);
+    if (slot->device == NULL)
+    {
+        UA_free(slot);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&manager->mutex);
+    DeviceSlot** slots = (DeviceSlot**) UA_realloc(manager->slots, (manager->slotCount + 1) * sizeof(DeviceSlot*));
+    if (slots == NULL)
+    {
+        pthread_mutex_unlock(&manager->mutex);
+        RFU6xx_Device_delete(slot->device);
+        UA_free(slot);
+        return NULL;
+    }
+    slots[manager->slotCount++] = slot;
+    manager->slots = slots;
+    pthread_mutex_unlock(&manager->mutex);
+
+    return slot->device;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+size_t RFU6xx_DeviceManager_getDeviceCount (RFU6xx_DeviceManager* manager)
+{
+    pthread_mutex_lock(&manager->mutex);
+    size_t count = manager->slotCount;
+    pthread_mutex_unlock(&manager->mutex);
+    return count;
+}
+
+RFU6xx_Device* RFU6xx_DeviceManager_getDevice (RFU6xx_DeviceManager* manager, size_t index)
+{
+    RFU6xx_Device* device = NULL;
+    pthread_mutex_lock(&manager->mutex);
+    if (index < manager->slotCount) device = manager->slots[index]->device;
+    pthread_mutex_unlock(&manager->mutex);
+    return device;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+// Must be called with the mutex held
+static UA_StatusCode submitToSlot (RFU6xx_DeviceManager* manager, DeviceSlot* slot, RFU6xx_DeviceJob job, void* context)
+{
+    QueuedJob* queued = (QueuedJob*) UA_malloc(sizeof(QueuedJob));
+    if (queued == NULL) return UA_STATUSCODE_BADOUTOFMEMORY;
+    queued->job = job;
+    queued->context = context;
+    queued->next = NULL;
+
+    if (slot->jobTail == NULL) slot->jobHead = queued;
+    else slot->jobTail->next = queued;
+    slot->jobTail = queued;
+    manager->pendingJobs++;
+
+    if (!slot->ready && !slot->active) enqueueReady(manager, slot);
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode RFU6xx_DeviceManager_submit (RFU6xx_DeviceManager* manager, RFU6xx_Device* device, RFU6xx_DeviceJob job, void* context)
+{
+    UA_StatusCode retval = UA_STATUSCODE_BADNOTFOUND;
+
+    pthread_mutex_lock(&manager->mutex);
+    for (size_t i = 0; i < manager->slotCount; i++)
+    {
+        if (manager->slots[i]->device == device)
+        {
+            retval = submitToSlot(manager, manager->slots[i], job, context);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&manager->mutex);
+    return retval;
+}
+
+UA_StatusCode RFU6xx_DeviceManager_submitAll (RFU6xx_DeviceManager* manager, RFU6xx_DeviceJob job, void* context)
+{
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+
+    pthread_mutex_lock(&manager->mutex);
+    for (size_t i = 0; i < manager->slotCount && retval == UA_STATUSCODE_GOOD; i++)
+    {
+        retval = submitToSlot(manager, manager->slots[i], job, context);
+    }
+    pthread_mutex_unlock(&manager->mutex);
+    return retval;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+void RFU6xx_DeviceManager_wait (RFU6xx_DeviceManager* manager)
+{
+    pthread_mutex_lock(&manager->mutex);
+    while (manager->pendingJobs > 0)
+    {
+        pthread_cond_wait(&manager->idle, &manager->mutex);
+    }
+    pthread_mutex_unlock(&manager->mutex);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+typedef struct {
+    const char* cacheFile;
+    UA_StatusCode result;
+} ConnectJobContext;
+
+static void connectJob (RFU6xx_Device* device, void* context)
+{
+    ConnectJobContext* connectContext = (ConnectJobContext*) context;
+
+    connectContext->result = RFU6xx_Device_connect(device);
+    if (connectContext->result != UA_STATUSCODE_GOOD) return;
+
+    if (connectContext->cacheFile != NULL) connectContext->result = initCached(device, connectContext->cacheFile);
+    else connectContext->result = init(device);
+}
+
+UA_StatusCode RFU6xx_DeviceManager_connectAll (RFU6xx_DeviceManager* manager, const char* cacheFile, UA_StatusCode results[])
+{
+    size_t deviceCount = RFU6xx_DeviceManager_getDeviceCount(manager);
+    if (deviceCount == 0) return UA_STATUSCODE_GOOD;
+
+    ConnectJobContext* contexts = (ConnectJobContext*) UA_calloc(deviceCount, sizeof(ConnectJobContext));
+    if (contexts == NULL) return UA_STATUSCODE_BADOUTOFMEMORY;
+
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    for (size_t i = 0; i < deviceCount; i++)
+    {
+        contexts[i].cacheFile = cacheFile;
+        contexts[i].result = UA_STATUSCODE_BADINTERNALERROR;
+        if (retval == UA_STATUSCODE_GOOD)
+        {
+            retval = RFU6xx_DeviceManager_submit(manager, RFU6xx_DeviceManager_getDevice(manager, i), connectJob, &contexts[i]);
+        }
+    }
+    RFU6xx_DeviceManager_wait(manager);
+
+    for (size_t i = 0; i < deviceCount; i++)
+    {
+        if (results != NULL) results[i] = contexts[i].result;
+        if (contexts[i].result != UA_STATUSCODE_GOOD)
+        {
+            UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Device %s could not be connected. ErrorCode: %x",
+                RFU6xx_DeviceManager_getDevice(manager, i)->endpointUrl, contexts[i].result);
+            if (retval == UA_STATUSCODE_GOOD) retval = contexts[i].result;
+        }
+    }
+    UA_free(contexts);
+    return retval;
+}
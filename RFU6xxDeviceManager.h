@@ -0,0 +1,145 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+* @contact: sebastian.heidepriem@sick.de
+*
+* Services many RFU6xx devices from one process with a fixed-size thread pool.
+* Jobs of the same device are executed one after another (a UA_Client is not thread-safe),
+* jobs of different devices run concurrently on the worker threads.
+*/
+
+#ifndef RFU6xxDEVICEMANAGER_H
+#define RFU6xxDEVICEMANAGER_H
+
+    #include "RFU6xxClient.h"
+
+    /*
+    * Callback type for RFU6xx_DeviceManager_submit
+    * --------------------
+    * Job executed on a worker thread with exclusive access to the device.
+    *
+    *  parameters:
+    *               -> RFU6xx_Device* device
+    *               -> void* context                            /-> User context passed to RFU6xx_DeviceManager_submit
+    */
+    typedef void (*RFU6xx_DeviceJob)(RFU6xx_Device* device, void* context);
+
+    typedef struct RFU6xx_DeviceManager RFU6xx_DeviceManager;
+
+    /*
+    * Function:  RFU6xx_DeviceManager_new
+    * --------------------
+    * Creates a manager and starts its worker threads.
+    *
+    *  parameters:
+    *               -> size_t threadCount                       /-> Number of worker threads
+    *
+    *  returns:
+    *               -> RFU6xx_DeviceManager*                    /-> NULL if the threads could not be started
+    */
+    RFU6xx_DeviceManager* RFU6xx_DeviceManager_new (size_t threadCount);
+
+    /*
+    * Function:  RFU6xx_DeviceManager_delete
+    * --------------------
+    * Waits for all queued jobs, stops the worker threads and deletes all devices of the manager.
+    *
+    *  parameters:
+    *               -> RFU6xx_DeviceManager* manager
+    *
+    *  returns:
+    */
+    void RFU6xx_DeviceManager_delete (RFU6xx_DeviceManager* manager);
+
+    /*
+    * Function:  RFU6xx_DeviceManager_addDevice
+    * --------------------
+    * Creates a device for an endpoint. The device is owned by the manager.
+    *
+    *  parameters:
+    *               -> RFU6xx_DeviceManager* manager
+    *               -> const char* endpointUrl                  /-> Url of the RFU6xx OPC UA server (opc.tcp://ip:port)
+    *
+    *  returns:
+    *               -> RFU6xx_Device*                           /-> NULL if out of memory
+    */
+    RFU6xx_Device* RFU6xx_DeviceManager_addDevice (RFU6xx_DeviceManager* manager, const char* endpointUrl);
+
+    /*
+    * Function:  RFU6xx_DeviceManager_getDeviceCount
+    * Function:  RFU6xx_DeviceManager_getDevice
+    * --------------------
+    * Number of devices and access to a device by index (order of RFU6xx_DeviceManager_addDevice)
+    *
+    *  parameters:
+    *               -> RFU6xx_DeviceManager* manager
+    *               -> size_t index
+    *
+    *  returns:
+    *               -> size_t  or  RFU6xx_Device*               /-> NULL if index is out of range
+    */
+    size_t RFU6xx_DeviceManager_getDeviceCount (RFU6xx_DeviceManager* manager);
+    RFU6xx_Device* RFU6xx_DeviceManager_getDevice (RFU6xx_DeviceManager* manager, size_t index);
+
+    /*
+    * Function:  RFU6xx_DeviceManager_submit
+    * --------------------
+    * Queues a job for a device. The job runs on the next free worker thread
+    * once all previously queued jobs of the same device have finished.
+    *
+    *  parameters:
+    *               -> RFU6xx_DeviceManager* manager
+    *               -> RFU6xx_Device* device                    /-> Device of the manager
+    *               -> RFU6xx_DeviceJob job
+    *               -> void* context                            /-> User context passed to the job
+    *
+    *  returns:
+    *               -> UA_StatusCode                            /-> UA_STATUSCODE_BADNOTFOUND if the device is not managed
+    */
+    UA_StatusCode RFU6xx_DeviceManager_submit (RFU6xx_DeviceManager* manager, RFU6xx_Device* device, RFU6xx_DeviceJob job, void* context);
+
+    /*
+    * Function:  RFU6xx_DeviceManager_submitAll
+    * --------------------
+    * Queues the same job for every device of the manager.
+    *
+    *  parameters:
+    *               -> RFU6xx_DeviceManager* manager
+    *               -> RFU6xx_DeviceJob job
+    *               -> void* context                            /-> User context passed to every job
+    *
+    *  returns:
+    *               -> UA_StatusCode
+    */
+    UA_StatusCode RFU6xx_DeviceManager_submitAll (RFU6xx_DeviceManager* manager, RFU6xx_DeviceJob job, void* context);
+
+    /*
+    * Function:  RFU6xx_DeviceManager_wait
+    * --------------------
+    * Blocks until all queued jobs have finished.
+    *
+    *  parameters:
+    *               -> RFU6xx_DeviceManager* manager
+    *
+    *  returns:
+    */
+    void RFU6xx_DeviceManager_wait (RFU6xx_DeviceManager* manager);
+
+    /*
+    * Function:  RFU6xx_DeviceManager_connectAll
+    * --------------------
+    * Connects and initializes all devices concurrently and waits until all are done.
+    *
+    *  parameters:
+    *               -> RFU6xx_DeviceManager* manager
+    *               -> const char* cacheFile                    /-> Node id cache file used by initCached, NULL to use init
+    *               -> UA_StatusCode results[]                  /-> Optional (NULL), returns the result of each device
+    *
+    *  returns:
+    *               -> UA_StatusCode                            /-> First error of all devices, UA_STATUSCODE_GOOD if all succeeded
+    */
+    UA_StatusCode RFU6xx_DeviceManager_connectAll (RFU6xx_DeviceManager* manager, const char* cacheFile, UA_StatusCode results[]);
+
+#endif
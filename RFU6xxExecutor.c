@@ -0,0 +1,441 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+*
+* @contact: sebastian.heidepriem@sick.de
+*/
+
+#include "RFU6xxExecutor.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+typedef enum {
+    COMMAND_START_SCAN,
+    COMMAND_STOP_SCAN,
+    COMMAND_READ_DEVICE_STATUS,
+    COMMAND_READ_TAG,
+    COMMAND_WRITE_TAG
+} CommandType;
+
+// A command is its own future and its own node of the queue
+struct RFU6xx_Future {
+    struct RFU6xx_Future* next;                 // Queue link
+    CommandType type;
+    UA_UInt32 references;                       // Submitter and executor
+
+    // Request
+    UA_Double duration;
+    UA_Int32 cycle;
+    UA_Boolean dataAvailable;
+    UA_String id;
+    UA_Int32 bank;
+    UA_Int32 offset;
+    UA_Int32 length;
+    UA_String writeData;
+    RFU6xx_FutureCallback callback;
+    void* context;
+
+    // Result
+    UA_StatusCode status;
+    RFU6xx_StatusCode serverResponseCode;
+    UA_String readData;
+    UA_Int32 deviceStatus;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t completed;
+    UA_Boolean done;
+};
+
+#define COUNTER_ADD(counter, value) __atomic_fetch_add(&(counter), (value), __ATOMIC_RELAXED)
+#define CACHE_LINE_SIZE 64
+
+struct RFU6xx_Executor {
+    RFU6xx_Device* device;
+    pthread_t thread;
+
+    // Intrusive MPSC queue (Vyukov): producers exchange the head, the I/O thread pops at the tail
+    RFU6xx_Future* head;
+    char padding0[CACHE_LINE_SIZE];
+    RFU6xx_Future* tail;
+    RFU6xx_Future stub;
+    char padding1[CACHE_LINE_SIZE];
+
+    // Sleep of the I/O thread, producers only take the mutex if it is sleeping
+    UA_UInt64 queued;
+    UA_Boolean sleeping;
+    UA_Boolean stop;
+    pthread_mutex_t mutex;
+    pthread_cond_t wakeup;
+
+    RFU6xx_ExecutorStats stats;
+};
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+static void push (RFU6xx_Executor* executor, RFU6xx_Future* command)
+{
+    __atomic_store_n(&command->next, NULL, __ATOMIC_RELAXED);
+    RFU6xx_Future* previous = __atomic_exchange_n(&executor->head, command, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&previous->next, command, __ATOMIC_RELEASE);
+}
+
+// I/O thread only. Returns NULL if the queue is empty or a producer is between exchange and link.
+static RFU6xx_Future* pop (RFU6xx_Executor* executor)
+{
+    RFU6xx_Future* tail = executor->tail;
+    RFU6xx_Future* next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (tail == &executor->stub)
+    {
+        if (next == NULL) return NULL;
+        executor->tail = next;
+        tail = next;
+        next = __atomic_load_n(&next->next, __ATOMIC_ACQUIRE);
+    }
+    if (next != NULL)
+    {
+        executor->tail = next;
+        return tail;
+    }
+    if (tail != __atomic_load_n(&executor->head, __ATOMIC_ACQUIRE)) return NULL;
+
+    // tail is the last command, the stub is queued behind it so that it can be taken
+    push(executor, &executor->stub);
+    next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (next == NULL) return NULL;
+    executor->tail = next;
+    return tail;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+static void releaseCommand (RFU6xx_Future* command)
+{
+    if (__atomic_sub_fetch(&command->references, 1, __ATOMIC_ACQ_REL) != 0) return;
+    UA_String_clear(&command->id);
+    UA_String_clear(&command->writeData);
+    UA_String_clear(&command->readData);
+    pthread_mutex_destroy(&command->mutex);
+    pthread_cond_destroy(&command->completed);
+    UA_free(command);
+}
+
+static void complete (RFU6xx_Executor* executor, RFU6xx_Future* command)
+{
+    if (command->callback != NULL) command->callback(command, command->context);
+
+    pthread_mutex_lock(&command->mutex);
+    command->done = true;
+    pthread_cond_broadcast(&command->completed);
+    pthread_mutex_unlock(&command->mutex);
+
+    COUNTER_ADD(executor->stats.completed, 1);
+    releaseCommand(command);
+}
+
+static UA_Boolean isTagCommand (const RFU6xx_Future* command)
+{
+    return command->type == COMMAND_READ_TAG || command->type == COMMAND_WRITE_TAG;
+}
+
+// Executes commands[0..count) in order, runs of tag commands and of readDeviceStatus share one call
+static void execute (RFU6xx_Executor* executor, RFU6xx_Future** commands, size_t count)
+{
+    RFU6xx_Device* device = executor->device;
+    RFU6xx_TagOperation operations[RFU6xx_EXECUTOR_MAX_BATCH];
+
+    size_t i = 0;
+    while (i < count)
+    {
+        RFU6xx_Future* command = commands[i];
+        size_t run = 1;
+        while (i + run < count && (isTagCommand(command) ? isTagCommand(commands[i + run])
+            : command->type == COMMAND_READ_DEVICE_STATUS && commands[i + run]->type == COMMAND_READ_DEVICE_STATUS))
+        {
+            run++;
+        }
+        COUNTER_ADD(executor->stats.serviceCalls, 1);
+        COUNTER_ADD(executor->stats.coalesced, run - 1);
+
+        if (isTagCommand(command) && run > 1)
+        {
+            memset(operations, 0, run * sizeof(RFU6xx_TagOperation));
+            for (size_t k = 0; k < run; k++)
+            {
+                RFU6xx_Future* c = commands[i + k];
+                operations[k].write = c->type == COMMAND_WRITE_TAG;
+                operations[k].id = c->id;
+                operations[k].bank = c->bank;
+                operations[k].offset = c->offset;
+                operations[k].length = c->length;
+                operations[k].writeData = c->writeData;
+            }
+            callTagOperations(device, operations, run);
+            for (size_t k = 0; k < run; k++)
+            {
+                RFU6xx_Future* c = commands[i + k];
+                c->status = operations[k].status;
+                c->serverResponseCode = operations[k].serverResponseCode;
+                c->readData = operations[k].readData;
+            }
+        }
+        else
+        {
+            switch (command->type)
+            {
+                case COMMAND_START_SCAN:
+                    command->status = startScan(device, command->duration, command->cycle, command->dataAvailable);
+                    break;
+                case COMMAND_STOP_SCAN:
+                    command->status = stopScan(device);
+                    break;
+                case COMMAND_READ_DEVICE_STATUS:
+                    command->status = readDeviceStatus(device, &command->deviceStatus);
+                    for (size_t k = 1; k < run; k++)
+                    {
+                        commands[i + k]->status = command->status;
+                        commands[i + k]->deviceStatus = command->deviceStatus;
+                    }
+                    break;
+                case COMMAND_READ_TAG:
+                    command->status = readTag(device, command->id, command->bank, command->offset, command->length,
+                        &command->readData, &command->serverResponseCode);
+                    break;
+                case COMMAND_WRITE_TAG:
+                    command->status = writeTag(device, command->id, command->bank, command->offset, command->writeData,
+                        &command->serverResponseCode);
+                    break;
+            }
+        }
+
+        for (size_t k = 0; k < run; k++) complete(executor, commands[i + k]);
+        i += run;
+    }
+}
+
+static void* ioThread (void* arg)
+{
+    RFU6xx_Executor* executor = (RFU6xx_Executor*) arg;
+    RFU6xx_Future* commands[RFU6xx_EXECUTOR_MAX_BATCH];
+
+    while (true)
+    {
+        size_t count = 0;
+        RFU6xx_Future* command;
+        while (count < RFU6xx_EXECUTOR_MAX_BATCH && (command = pop(executor)) != NULL) commands[count++] = command;
+
+        if (count > 0)
+        {
+            __atomic_fetch_sub(&executor->queued, count, __ATOMIC_SEQ_CST);
+            if (count > executor->stats.maxBatch) __atomic_store_n(&executor->stats.maxBatch, count, __ATOMIC_RELAXED);
+            execute(executor, commands, count);
+            continue;
+        }
+
+        // Idle: service the subscriptions of the client, then sleep until a command arrives
+        if (__atomic_load_n(&executor->stop, __ATOMIC_ACQUIRE) && __atomic_load_n(&executor->queued, __ATOMIC_SEQ_CST) == 0) break;
+        runIterate(executor->device, 0);
+
+        pthread_mutex_lock(&executor->mutex);
+        __atomic_store_n(&executor->sleeping, true, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&executor->queued, __ATOMIC_SEQ_CST) == 0 && !executor->stop)
+        {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += RFU6xx_EXECUTOR_IDLE_INTERVAL * 1000000L;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            pthread_cond_timedwait(&executor->wakeup, &executor->mutex, &deadline);
+        }
+        __atomic_store_n(&executor->sleeping, false, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&executor->mutex);
+    }
+    return NULL;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+RFU6xx_Executor* RFU6xx_Executor_new (RFU6xx_Device* device)
+{
+    RFU6xx_Executor* executor = (RFU6xx_Executor*) UA_calloc(1, sizeof(RFU6xx_Executor));
+    if (executor == NULL) return NULL;
+
+    executor->device = device;
+    executor->head = &executor->stub;
+    executor->tail = &executor->stub;
+    pthread_mutex_init(&executor->mutex, NULL);
+    pthread_cond_init(&executor->wakeup, NULL);
+    if (pthread_create(&executor->thread, NULL, ioThread, executor) != 0)
+    {
+        pthread_mutex_destroy(&executor->mutex);
+        pthread_cond_destroy(&executor->wakeup);
+        UA_free(executor);
+        return NULL;
+    }
+    return executor;
+}
+
+void RFU6xx_Executor_delete (RFU6xx_Executor* executor)
+{
+    if (executor == NULL) return;
+
+    pthread_mutex_lock(&executor->mutex);
+    __atomic_store_n(&executor->stop, true, __ATOMIC_RELEASE);
+    pthread_cond_signal(&executor->wakeup);
+    pthread_mutex_unlock(&executor->mutex);
+    pthread_join(executor->thread, NULL);
+
+    pthread_mutex_destroy(&executor->mutex);
+    pthread_cond_destroy(&executor->wakeup);
+    UA_free(executor);
+}
+
+static RFU6xx_Future* newCommand (CommandType type, RFU6xx_FutureCallback callback, void* context)
+{
+    RFU6xx_Future* command = (RFU6xx_Future*) UA_calloc(1, sizeof(RFU6xx_Future));
+    if (command == NULL) return NULL;
+    command->type = type;
+    command->references = 2;
+    command->callback = callback;
+    command->context = context;
+    pthread_mutex_init(&command->mutex, NULL);
+    pthread_cond_init(&command->completed, NULL);
+    return command;
+}
+
+static RFU6xx_Future* submit (RFU6xx_Executor* executor, RFU6xx_Future* command)
+{
+    if (command == NULL) return NULL;
+    push(executor, command);
+    COUNTER_ADD(executor->stats.submitted, 1);
+
+    // The I/O thread sets sleeping before it checks queued, one of both sees the other
+    __atomic_fetch_add(&executor->queued, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&executor->sleeping, __ATOMIC_SEQ_CST))
+    {
+        pthread_mutex_lock(&executor->mutex);
+        pthread_cond_signal(&executor->wakeup);
+        pthread_mutex_unlock(&executor->mutex);
+    }
+    return command;
+}
+
+RFU6xx_Future* RFU6xx_Executor_startScan (RFU6xx_Executor* executor, UA_Double duration, UA_Int32 cycle, UA_Boolean dataAvailable,
+    RFU6xx_FutureCallback callback, void* context)
+{
+    RFU6xx_Future* command = newCommand(COMMAND_START_SCAN, callback, context);
+    if (command == NULL) return NULL;
+    command->duration = duration;
+    command->cycle = cycle;
+    command->dataAvailable = dataAvailable;
+    return submit(executor, command);
+}
+
+RFU6xx_Future* RFU6xx_Executor_stopScan (RFU6xx_Executor* executor, RFU6xx_FutureCallback callback, void* context)
+{
+    return submit(executor, newCommand(COMMAND_STOP_SCAN, callback, context));
+}
+
+RFU6xx_Future* RFU6xx_Executor_readDeviceStatus (RFU6xx_Executor* executor, RFU6xx_FutureCallback callback, void* context)
+{
+    return submit(executor, newCommand(COMMAND_READ_DEVICE_STATUS, callback, context));
+}
+
+RFU6xx_Future* RFU6xx_Executor_readTag (RFU6xx_Executor* executor, UA_String id, UA_Int32 bank, UA_Int32 offset, UA_Int32 length,
+    RFU6xx_FutureCallback callback, void* context)
+{
+    RFU6xx_Future* command = newCommand(COMMAND_READ_TAG, callback, context);
+    if (command == NULL) return NULL;
+    command->bank = bank;
+    command->offset = offset;
+    command->length = length;
+    if (UA_String_copy(&id, &command->id) != UA_STATUSCODE_GOOD)
+    {
+        command->references = 1;
+        releaseCommand(command);
+        return NULL;
+    }
+    return submit(executor, command);
+}
+
+RFU6xx_Future* RFU6xx_Executor_writeTag (RFU6xx_Executor* executor, UA_String id, UA_Int32 bank, UA_Int32 offset, UA_String writeData,
+    RFU6xx_FutureCallback callback, void* context)
+{
+    RFU6xx_Future* command = newCommand(COMMAND_WRITE_TAG, callback, context);
+    if (command == NULL) return NULL;
+    command->bank = bank;
+    command->offset = offset;
+    if (UA_String_copy(&id, &command->id) != UA_STATUSCODE_GOOD || UA_String_copy(&writeData, &command->writeData) != UA_STATUSCODE_GOOD)
+    {
+        command->references = 1;
+        releaseCommand(command);
+        return NULL;
+    }
+    return submit(executor, command);
+}
+
+void RFU6xx_Executor_getStats (RFU6xx_Executor* executor, RFU6xx_ExecutorStats* stats)
+{
+    stats->submitted = __atomic_load_n(&executor->stats.submitted, __ATOMIC_RELAXED);
+    stats->completed = __atomic_load_n(&executor->stats.completed, __ATOMIC_RELAXED);
+    stats->serviceCalls = __atomic_load_n(&executor->stats.serviceCalls, __ATOMIC_RELAXED);
+    stats->coalesced = __atomic_load_n(&executor->stats.coalesced, __ATOMIC_RELAXED);
+    stats->maxBatch = __atomic_load_n(&executor->stats.maxBatch, __ATOMIC_RELAXED);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+UA_StatusCode RFU6xx_Future_wait (RFU6xx_Future* future, UA_UInt32 timeoutMs)
+{
+    struct timespec deadline;
+    if (timeoutMs > 0)
+    {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeoutMs / 1000;
+        deadline.tv_nsec += (long) (timeoutMs % 1000) * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+    }
+
+    pthread_mutex_lock(&future->mutex);
+    while (!future->done)
+    {
+        if (timeoutMs == 0) pthread_cond_wait(&future->completed, &future->mutex);
+        else if (pthread_cond_timedwait(&future->completed, &future->mutex, &deadline) == ETIMEDOUT) break;
+    }
+    UA_StatusCode retval = future->done ? future->status : UA_STATUSCODE_BADTIMEOUT;
+    pthread_mutex_unlock(&future->mutex);
+    return retval;
+}
+
+UA_Boolean RFU6xx_Future_isDone (RFU6xx_Future* future)
+{
+    pthread_mutex_lock(&future->mutex);
+    UA_Boolean done = future->done;
+    pthread_mutex_unlock(&future->mutex);
+    return done;
+}
+
+RFU6xx_StatusCode RFU6xx_Future_getServerResponseCode (RFU6xx_Future* future)
+{
+    return future->serverResponseCode;
+}
+
+const UA_String* RFU6xx_Future_getReadData (RFU6xx_Future* future)
+{
+    return &future->readData;
+}
+
+UA_Int32 RFU6xx_Future_getDeviceStatus (RFU6xx_Future* future)
+{
+    return future->deviceStatus;
+}
+
+void RFU6xx_Future_release (RFU6xx_Future* future)
+{
+    if (future != NULL) releaseCommand(future);
+}
@@ -0,0 +1,171 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+* @contact: sebastian.heidepriem@sick.de
+*
+* Thread-safe front end of one RFU6xx device. The executor owns the device on its own I/O thread,
+* any thread submits commands through a lock-free MPSC queue and gets a future (and optionally a
+* completion callback) back. The I/O thread takes all queued commands at once and coalesces them:
+* consecutive ReadTag / WriteTag commands are sent as one call request (callTagOperations) and
+* consecutive readDeviceStatus commands share one read. Commands are executed in submission order.
+*/
+
+#ifndef RFU6xxEXECUTOR_H
+#define RFU6xxEXECUTOR_H
+
+    #include "RFU6xxClient.h"
+
+    // Commands taken from the queue at once
+    #define RFU6xx_EXECUTOR_MAX_BATCH 256
+    // Time in ms the idle I/O thread waits for commands before it services the subscriptions of the client
+    #define RFU6xx_EXECUTOR_IDLE_INTERVAL 20
+
+    typedef struct RFU6xx_Executor RFU6xx_Executor;
+    typedef struct RFU6xx_Future RFU6xx_Future;
+
+    /*
+    * Callback type for the commands of the executor
+    * --------------------
+    * Called on the I/O thread when the command is completed, before waiting threads are woken up.
+    * The future is valid during the callback, it must not block.
+    *
+    *  parameters:
+    *               -> RFU6xx_Future* future
+    *               -> void* context                            /-> User context passed with the command
+    */
+    typedef void (*RFU6xx_FutureCallback)(RFU6xx_Future* future, void* context);
+
+    typedef struct {
+        UA_UInt64 submitted;                        // Commands queued
+        UA_UInt64 completed;                        // Commands completed
+        UA_UInt64 serviceCalls;                     // Calls of the client functions for the commands
+        UA_UInt64 coalesced;                        // Commands executed by the call of another command
+        UA_UInt64 maxBatch;                         // Most commands taken from the queue at once
+    } RFU6xx_ExecutorStats;
+
+    /*
+    * Function:  RFU6xx_Executor_new
+    * --------------------
+    * Starts the I/O thread of a connected device. The device must only be used through the executor
+    * until it is deleted (the subscription callbacks of the device are called on the I/O thread).
+    *
+    *  parameters:
+    *               -> RFU6xx_Device* device
+    *
+    *  returns:
+    *               -> RFU6xx_Executor*                         /-> NULL if the thread could not be started
+    */
+    RFU6xx_Executor* RFU6xx_Executor_new (RFU6xx_Device* device);
+
+    /*
+    * Function:  RFU6xx_Executor_delete
+    * --------------------
+    * Completes all queued commands and stops the I/O thread. The device is not deleted.
+    * No command may be submitted while or after the executor is deleted.
+    *
+    *  parameters:
+    *               -> RFU6xx_Executor* executor
+    *
+    *  returns:
+    */
+    void RFU6xx_Executor_delete (RFU6xx_Executor* executor);
+
+    /*
+    * Function:  RFU6xx_Executor_startScan
+    * Function:  RFU6xx_Executor_stopScan
+    * Function:  RFU6xx_Executor_readDeviceStatus
+    * Function:  RFU6xx_Executor_readTag
+    * Function:  RFU6xx_Executor_writeTag
+    * --------------------
+    * Queue a command, can be called from any thread. The parameters are those of the client functions,
+    * id and write data are copied. The result is read from the future after RFU6xx_Future_wait
+    * or in the callback. Every returned future must be released with RFU6xx_Future_release
+    * (right away if only the callback is of interest).
+    *
+    *  parameters:
+    *               -> RFU6xx_Executor* executor
+    *               -> ...                                      /-> Parameters of the client function
+    *               -> RFU6xx_FutureCallback callback           /-> May be NULL
+    *               -> void* context                            /-> User context passed to the callback
+    *
+    *  returns:
+    *               -> RFU6xx_Future*                           /-> NULL if out of memory
+    */
+    RFU6xx_Future* RFU6xx_Executor_startScan (RFU6xx_Executor* executor, UA_Double duration, UA_Int32 cycle, UA_Boolean dataAvailable,
+        RFU6xx_FutureCallback callback, void* context);
+    RFU6xx_Future* RFU6xx_Executor_stopScan (RFU6xx_Executor* executor, RFU6xx_FutureCallback callback, void* context);
+    RFU6xx_Future* RFU6xx_Executor_readDeviceStatus (RFU6xx_Executor* executor, RFU6xx_FutureCallback callback, void* context);
+    RFU6xx_Future* RFU6xx_Executor_readTag (RFU6xx_Executor* executor, UA_String id, UA_Int32 bank, UA_Int32 offset, UA_Int32 length,
+        RFU6xx_FutureCallback callback, void* context);
+    RFU6xx_Future* RFU6xx_Executor_writeTag (RFU6xx_Executor* executor, UA_String id, UA_Int32 bank, UA_Int32 offset, UA_String writeData,
+        RFU6xx_FutureCallback callback, void* context);
+
+    /*
+    * Function:  RFU6xx_Executor_getStats
+    * --------------------
+    * Reads the counters of the executor. Can be called from any thread.
+    *
+    *  parameters:
+    *               -> RFU6xx_Executor* executor
+    *               -> RFU6xx_ExecutorStats* stats
+    *
+    *  returns:
+    */
+    void RFU6xx_Executor_getStats (RFU6xx_Executor* executor, RFU6xx_ExecutorStats* stats);
+
+    // ------------------------------------------------------------------------------------------------------------------------
+
+    /*
+    * Function:  RFU6xx_Future_wait
+    * --------------------
+    * Waits until the command is completed.
+    *
+    *  parameters:
+    *               -> RFU6xx_Future* future
+    *               -> UA_UInt32 timeoutMs                      /-> 0 == no timeout
+    *
+    *  returns:
+    *               -> UA_StatusCode                            /-> Result of the command, UA_STATUSCODE_BADTIMEOUT if it is not completed yet
+    */
+    UA_StatusCode RFU6xx_Future_wait (RFU6xx_Future* future, UA_UInt32 timeoutMs);
+
+    /*
+    * Function:  RFU6xx_Future_isDone
+    * --------------------
+    *
+    *  parameters:
+    *               -> RFU6xx_Future* future
+    *
+    *  returns:
+    *               -> UA_Boolean
+    */
+    UA_Boolean RFU6xx_Future_isDone (RFU6xx_Future* future);
+
+    /*
+    * Function:  RFU6xx_Future_getServerResponseCode
+    * Function:  RFU6xx_Future_getReadData
+    * Function:  RFU6xx_Future_getDeviceStatus
+    * --------------------
+    * Results of a completed command: the RFU6xx_StatusCode of ReadTag / WriteTag, the data of ReadTag
+    * (owned by the future, copy it before the future is released) and the status of readDeviceStatus.
+    */
+    RFU6xx_StatusCode RFU6xx_Future_getServerResponseCode (RFU6xx_Future* future);
+    const UA_String* RFU6xx_Future_getReadData (RFU6xx_Future* future);
+    UA_Int32 RFU6xx_Future_getDeviceStatus (RFU6xx_Future* future);
+
+    /*
+    * Function:  RFU6xx_Future_release
+    * --------------------
+    * Gives up the reference of the submitter. The future is freed when the command is completed
+    * and released, a pending command is still executed.
+    *
+    *  parameters:
+    *               -> RFU6xx_Future* future
+    *
+    *  returns:
+    */
+    void RFU6xx_Future_release (RFU6xx_Future* future);
+
+#endif
@@ -0,0 +1,134 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+*
+* @contact: sebastian.heidepriem@sick.de
+*/
+
+#include "RFU6xxHex.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+// Value of each character as hex digit, 0xFF for characters that are no hex digit
+#define HEX_INVALID 0xFF
+#define R16(v) v, v, v, v, v, v, v, v, v, v, v, v, v, v, v, v
+static const uint8_t hexDigitTable[256] = {
+    R16(HEX_INVALID), R16(HEX_INVALID), R16(HEX_INVALID),
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, HEX_INVALID, HEX_INVALID, HEX_INVALID, HEX_INVALID, HEX_INVALID, HEX_INVALID,
+    HEX_INVALID, 10, 11, 12, 13, 14, 15, HEX_INVALID, HEX_INVALID, HEX_INVALID, HEX_INVALID, HEX_INVALID, HEX_INVALID, HEX_INVALID, HEX_INVALID, HEX_INVALID,
+    R16(HEX_INVALID),
+    HEX_INVALID, 10, 11, 12, 13, 14, 15, HEX_INVALID, HEX_INVALID, HEX_INVALID, HEX_INVALID, HEX_INVALID, HEX_INVALID, HEX_INVALID, HEX_INVALID, HEX_INVALID,
+    R16(HEX_INVALID),
+    R16(HEX_INVALID), R16(HEX_INVALID), R16(HEX_INVALID), R16(HEX_INVALID),
+    R16(HEX_INVALID), R16(HEX_INVALID), R16(HEX_INVALID), R16(HEX_INVALID)
+};
+#undef R16
+
+static const char hexDigitsLower[16] = "0123456789abcdef";
+static const char hexDigitsUpper[16] = "0123456789ABCDEF";
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+#if defined(__SSE2__)
+
+// Converts 16 hex digits into 8 bytes, returns -1 if one of the digits is invalid
+static int hexDecode16 (const uint8_t* hex, uint8_t* bytes)
+{
+    __m128i v = _mm_loadu_si128((const __m128i*) hex);
+
+    // Characters >= 0x80 are negative as signed bytes and fail both range checks
+    __m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i isLetter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+    if (_mm_movemask_epi8(_mm_or_si128(isDigit, isLetter)) != 0xFFFF) return -1;
+
+    __m128i digitValue = _mm_and_si128(isDigit, _mm_sub_epi8(v, _mm_set1_epi8('0')));
+    __m128i letterValue = _mm_and_si128(isLetter, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10)));
+    __m128i nibbles = _mm_or_si128(digitValue, letterValue);
+
+    // Each 16 bit lane holds (high nibble, low nibble) in memory order
+    __m128i high = _mm_and_si128(nibbles, _mm_set1_epi16(0x00FF));
+    __m128i low = _mm_srli_epi16(nibbles, 8);
+    __m128i words = _mm_or_si128(_mm_slli_epi16(high, 4), low);
+    _mm_storel_epi64((__m128i*) bytes, _mm_packus_epi16(words, words));
+    return 0;
+}
+
+// Converts 8 bytes into 16 hex digits
+static void hexEncode8 (const uint8_t* bytes, uint8_t* hex, int upperCase)
+{
+    __m128i v = _mm_loadl_epi64((const __m128i*) bytes);
+    __m128i high = _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0F));
+    __m128i low = _mm_and_si128(v, _mm_set1_epi8(0x0F));
+    __m128i nibbles = _mm_unpacklo_epi8(high, low);
+
+    // '0' + n for n < 10, 'a' + n - 10 (or 'A' + n - 10) otherwise
+    __m128i isLetter = _mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9));
+    __m128i letterOffset = _mm_and_si128(isLetter, _mm_set1_epi8((upperCase ? 'A' : 'a') - '0' - 10));
+    __m128i chars = _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), letterOffset);
+    _mm_storeu_si128((__m128i*) hex, chars);
+}
+
+#endif
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+int hexDecode (const uint8_t* hex, size_t hexLength, uint8_t* bytes)
+{
+    if (hexLength % 2 != 0) return -1;
+
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= hexLength; i += 16)
+    {
+        if (hexDecode16(&hex[i], &bytes[i/2]) != 0) return -1;
+    }
+#endif
+    for (; i < hexLength; i += 2)
+    {
+        uint8_t high = hexDigitTable[hex[i]];
+        uint8_t low = hexDigitTable[hex[i + 1]];
+        if ((high | low) == HEX_INVALID) return -1;
+        bytes[i/2] = (uint8_t) ((high << 4) | low);
+    }
+    return 0;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+void hexEncode (const uint8_t* bytes, size_t length, uint8_t* hex, int upperCase)
+{
+    const char* digits = upperCase ? hexDigitsUpper : hexDigitsLower;
+
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 8 <= length; i += 8)
+    {
+        hexEncode8(&bytes[i], &hex[2*i], upperCase);
+    }
+#endif
+    for (; i < length; i++)
+    {
+        hex[2*i] = digits[bytes[i] >> 4];
+        hex[2*i + 1] = digits[bytes[i] & 0x0F];
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+int hexValidate (const uint8_t* hex, size_t hexLength)
+{
+    if (hexLength % 2 != 0) return -1;
+
+    for (size_t i = 0; i < hexLength; i++)
+    {
+        if (hexDigitTable[hex[i]] == HEX_INVALID) return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+* @contact: sebastian.heidepriem@sick.de
+*
+* Validated hex encoding and decoding of tag ids, write data and read data.
+* Decoding uses a lookup table, on x86 with SSE2 16 hex digits are converted at once.
+* The module does not depend on open62541.
+*/
+
+#ifndef RFU6xxHEX_H
+#define RFU6xxHEX_H
+
+    #include <stddef.h>
+    #include <stdint.h>
+
+    /*
+    * Function:  hexDecode
+    * --------------------
+    * Converts a hex string (upper or lower case digits) into bytes.
+    * The string must have an even length and only contain hex digits.
+    *
+    *  parameters:
+    *               -> const uint8_t* hex                       /-> Hex string (not null terminated)
+    *               -> size_t hexLength                         /-> Number of hex digits
+    *               -> uint8_t* bytes                           /-> Buffer for hexLength/2 bytes
+    *
+    *  returns:
+    *               -> int                                      /-> Errorcode -1 == odd length or invalid digit; 0 == everything's OK
+    */
+    int hexDecode (const uint8_t* hex, size_t hexLength, uint8_t* bytes);
+
+    /*
+    * Function:  hexEncode
+    * --------------------
+    * Converts bytes into a hex string with two digits per byte.
+    *
+    *  parameters:
+    *               -> const uint8_t* bytes
+    *               -> size_t length                            /-> Number of bytes
+    *               -> uint8_t* hex                             /-> Buffer for 2*length digits (not null terminated)
+    *               -> int upperCase                            /-> 0 == lower case digits, otherwise upper case
+    *
+    *  returns:
+    */
+    void hexEncode (const uint8_t* bytes, size_t length, uint8_t* hex, int upperCase);
+
+    /*
+    * Function:  hexValidate
+    * --------------------
+    * Checks that a string has an even length and only contains hex digits.
+    *
+    *  parameters:
+    *               -> const uint8_t* hex
+    *               -> size_t hexLength                         /-> Number of hex digits
+    *
+    *  returns:
+    *               -> int                                      /-> Errorcode -1 == odd length or invalid digit; 0 == everything's OK
+    */
+    int hexValidate (const uint8_t* hex, size_t hexLength);
+
+#endif
@@ -0,0 +1,94 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+*
+* @contact: sebastian.heidepriem@sick.de
+*
+*
+* Microbenchmark of the tag id conversion:
+*   1.) The previous conversion (malloc'd C string + one sscanf("%2hhx") per byte)
+*   2.) hexDecode (lookup table / SSE2)
+*   3.) hexEncode
+* for EPC lengths from 96 to 496 bit. Results are printed in ns per id.
+*/
+
+#include "RFU6xxHex.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ITERATIONS 1000000
+
+static double nowNs (void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Conversion used by tagIdToExtentionObject before the hex module
+static int sscanfDecode (const uint8_t* hex, size_t hexLength, uint8_t* bytes)
+{
+    char* idString = (char*) malloc(hexLength + 1);
+    memcpy(idString, hex, hexLength);
+    idString[hexLength] = '\0';
+
+    const char* pos = idString;
+    for (size_t count = 0; count < hexLength/2; count++) {
+        if (sscanf(pos, "%2hhx", &bytes[count]) != 1) {
+            free(idString);
+            return -1;
+        }
+        pos += 2;
+    }
+    free(idString);
+    return 0;
+}
+
+int main (void)
+{
+    const int epcBits[] = { 96, 128, 192, 256, 320, 384, 448, 496 };
+    uint8_t bytes[64];
+    uint8_t hex[128];
+    volatile uint8_t sink = 0;
+
+    printf("%8s %14s %14s %14s %10s\n", "EPC bit", "sscanf ns/id", "decode ns/id", "encode ns/id", "speedup");
+    for (size_t e = 0; e < sizeof(epcBits) / sizeof(epcBits[0]); e++)
+    {
+        size_t length = epcBits[e] / 8;
+        for (size_t i = 0; i < length; i++) bytes[i] = (uint8_t) rand();
+        hexEncode(bytes, length, hex, 1);
+
+        // The previous path is much slower, a tenth of the iterations is enough
+        double start = nowNs();
+        for (int i = 0; i < ITERATIONS / 10; i++)
+        {
+            if (sscanfDecode(hex, 2*length, bytes) != 0) return EXIT_FAILURE;
+            sink ^= bytes[i % length];
+        }
+        double sscanfNs = (nowNs() - start) / (ITERATIONS / 10);
+
+        start = nowNs();
+        for (int i = 0; i < ITERATIONS; i++)
+        {
+            if (hexDecode(hex, 2*length, bytes) != 0) return EXIT_FAILURE;
+            sink ^= bytes[i % length];
+        }
+        double decodeNs = (nowNs() - start) / ITERATIONS;
+
+        start = nowNs();
+        for (int i = 0; i < ITERATIONS; i++)
+        {
+            hexEncode(bytes, length, hex, 1);
+            sink ^= hex[i % (2*length)];
+        }
+        double encodeNs = (nowNs() - start) / ITERATIONS;
+
+        printf("%8d %14.1f %14.1f %14.1f %9.1fx\n", epcBits[e], sscanfNs, decodeNs, encodeNs, sscanfNs / decodeNs);
+    }
+    return EXIT_SUCCESS;
+}
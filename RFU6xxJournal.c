@@ -0,0 +1,811 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+*
+* @contact: sebastian.heidepriem@sick.de
+*/
+
+#define _GNU_SOURCE
+
+#include "RFU6xxJournal.h"
+#include "RFU6xxHex.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SEGMENT_MAGIC "RFU6xxJ1"
+#define INDEX_MAGIC "RFU6xxI1"
+#define JOURNAL_VERSION 1
+#define JOURNAL_PATH_SIZE 1024
+#define JOURNAL_DIRECTORY_SIZE (JOURNAL_PATH_SIZE - 32)     // Leaves room for the file names
+#define NO_SEGMENT UINT64_MAX
+
+_Static_assert(sizeof(RFU6xx_JournalRecord) == 64, "journal records must be 64 bytes");
+
+// First 64 bytes of a segment file, the records follow
+typedef struct {
+    char magic[8];
+    UA_UInt32 version;
+    UA_UInt32 recordSize;
+    UA_UInt64 capacity;
+    UA_UInt64 firstSequence;
+    UA_UInt64 committed;                        // Records flushed to disk, the rest of the file is not valid
+    UA_DateTime created;
+    UA_Byte reserved[16];
+} SegmentHeader;
+
+// First 64 bytes of an index file, followed by the time ranges of the blocks and the EPC entries
+typedef struct {
+    char magic[8];
+    UA_UInt64 records;
+    UA_UInt32 blockSize;
+    UA_UInt32 blocks;
+    UA_DateTime minTimestamp;
+    UA_DateTime maxTimestamp;
+    UA_Byte reserved[24];
+} IndexHeader;
+
+typedef struct {
+    UA_DateTime min;
+    UA_DateTime max;
+} TimeRange;
+
+// Sorted by hash and record, so the records of a tag are found in journal order
+typedef struct {
+    UA_UInt32 hash;
+    UA_UInt32 record;
+} EpcIndexEntry;
+
+// Mapped segment of the writer
+typedef struct {
+    UA_UInt64 number;                           // Segment number of this run, NO_SEGMENT if not mapped
+    int fd;
+    SegmentHeader* header;
+    RFU6xx_JournalRecord* records;
+    size_t mapSize;
+    char path[JOURNAL_PATH_SIZE];
+} Segment;
+
+#define CACHE_LINE_SIZE 64
+
+struct RFU6xx_Journal {
+    char directory[JOURNAL_DIRECTORY_SIZE];
+    size_t capacity;                            // Records per segment
+    UA_UInt64 baseSequence;                     // Sequence of the first record of this run
+    UA_UInt32 commitIntervalMs;
+
+    // Segment number n is mapped in segments[n & 1], the commit thread maps segment n + 1 while n is written
+    Segment segments[2];
+    char padding0[CACHE_LINE_SIZE];
+
+    // Producers
+    UA_UInt64 nextSequence;                     // Relative to baseSequence
+    char padding1[CACHE_LINE_SIZE];
+    UA_UInt64 appended;
+    UA_UInt64 dropped;
+    char padding2[CACHE_LINE_SIZE];
+
+    // Commit thread
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wakeup;
+    pthread_cond_t committedChanged;
+    UA_Boolean stop;
+    UA_UInt64 committed;                        // All records before this sequence are flushed
+    UA_UInt64 commits;
+    UA_UInt64 segmentsCreated;
+    UA_UInt64 errors;
+};
+
+#define COUNTER_LOAD(counter) __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+#define COUNTER_ADD(counter, value) __atomic_fetch_add(&(counter), (value), __ATOMIC_RELAXED)
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+// FNV-1a over 32 bit words of the record with checksum 0. Never 0, that marks an unwritten record.
+static UA_UInt32 recordChecksum (const RFU6xx_JournalRecord* record)
+{
+    UA_UInt32 words[sizeof(RFU6xx_JournalRecord) / 4];
+    memcpy(words, record, sizeof(words));
+    words[offsetof(RFU6xx_JournalRecord, checksum) / 4] = 0;
+
+    UA_UInt32 hash = 0x811c9dc5u;
+    for (size_t i = 0; i < sizeof(words) / 4; i++)
+    {
+        hash = (hash ^ words[i]) * 0x01000193u;
+    }
+    hash ^= hash >> 15;
+    return hash ? hash : 1;
+}
+
+static UA_UInt32 epcHash (const UA_Byte* epc, UA_Byte epcLength)
+{
+    size_t length = epcLength < RFU6xx_JOURNAL_EPC_SIZE ? epcLength : RFU6xx_JOURNAL_EPC_SIZE;
+    UA_UInt32 hash = 0x811c9dc5u ^ epcLength;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ epc[i]) * 0x01000193u;
+    }
+    return hash;
+}
+
+static void segmentPath (char* path, const char* directory, UA_UInt64 firstSequence, const char* extension)
+{
+    snprintf(path, JOURNAL_PATH_SIZE, "%s/journal-%016llx.%s", directory, (unsigned long long) firstSequence, extension);
+}
+
+static size_t segmentFileSize (size_t records)
+{
+    return sizeof(SegmentHeader) + records * sizeof(RFU6xx_JournalRecord);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+// Writes the index of the first count records of a segment (temporary file, then rename)
+static int writeIndex (const char* segmentFile, const RFU6xx_JournalRecord* records, UA_UInt64 count)
+{
+    IndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.records = count;
+    header.blockSize = RFU6xx_JOURNAL_INDEX_BLOCK_SIZE;
+    header.blocks = (UA_UInt32) ((count + RFU6xx_JOURNAL_INDEX_BLOCK_SIZE - 1) / RFU6xx_JOURNAL_INDEX_BLOCK_SIZE);
+    header.minTimestamp = INT64_MAX;
+    header.maxTimestamp = INT64_MIN;
+
+    TimeRange* blocks = (TimeRange*) UA_malloc((header.blocks ? header.blocks : 1) * sizeof(TimeRange));
+    EpcIndexEntry* entries = (EpcIndexEntry*) UA_malloc((count ? count : 1) * sizeof(EpcIndexEntry));
+    if (blocks == NULL || entries == NULL)
+    {
+        UA_free(blocks);
+        UA_free(entries);
+        return -1;
+    }
+
+    for (UA_UInt64 i = 0; i < count; i++)
+    {
+        const RFU6xx_JournalRecord* record = &records[i];
+        TimeRange* block = &blocks[i / RFU6xx_JOURNAL_INDEX_BLOCK_SIZE];
+        if (i % RFU6xx_JOURNAL_INDEX_BLOCK_SIZE == 0) block->min = block->max = record->timestamp;
+        if (record->timestamp < block->min) block->min = record->timestamp;
+        if (record->timestamp > block->max) block->max = record->timestamp;
+        if (record->timestamp < header.minTimestamp) header.minTimestamp = record->timestamp;
+        if (record->timestamp > header.maxTimestamp) header.maxTimestamp = record->timestamp;
+
+        entries[i].hash = epcHash(record->epc, record->epcLength);
+        entries[i].record = (UA_UInt32) i;
+    }
+
+    // LSD radix sort on the hash (stable, so the records of a hash stay in journal order)
+    EpcIndexEntry* sorted = (EpcIndexEntry*) UA_malloc((count ? count : 1) * sizeof(EpcIndexEntry));
+    if (sorted == NULL)
+    {
+        UA_free(blocks);
+        UA_free(entries);
+        return -1;
+    }
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        size_t offsets[257] = { 0 };
+        for (UA_UInt64 i = 0; i < count; i++) offsets[((entries[i].hash >> shift) & 0xFF) + 1]++;
+        for (int b = 0; b < 256; b++) offsets[b + 1] += offsets[b];
+        for (UA_UInt64 i = 0; i < count; i++) sorted[offsets[(entries[i].hash >> shift) & 0xFF]++] = entries[i];
+        EpcIndexEntry* swap = entries;
+        entries = sorted;
+        sorted = swap;
+    }
+    UA_free(sorted);
+
+    char indexFile[JOURNAL_PATH_SIZE];
+    char tmpFile[JOURNAL_PATH_SIZE + 4];
+    snprintf(indexFile, sizeof(indexFile), "%.*s.idx", (int) (strlen(segmentFile) - 4), segmentFile);
+    snprintf(tmpFile, sizeof(tmpFile), "%s.tmp", indexFile);
+
+    int retval = -1;
+    FILE* out = fopen(tmpFile, "wb");
+    if (out != NULL)
+    {
+        size_t written = fwrite(&header, sizeof(header), 1, out);
+        written += fwrite(blocks, sizeof(TimeRange), header.blocks, out);
+        written += fwrite(entries, sizeof(EpcIndexEntry), count, out);
+        if (fflush(out) == 0 && fsync(fileno(out)) == 0 && written == 1 + header.blocks + count) retval = 0;
+        if (fclose(out) != 0) retval = -1;
+        if (retval == 0 && rename(tmpFile, indexFile) != 0) retval = -1;
+        if (retval != 0) remove(tmpFile);
+    }
+    UA_free(blocks);
+    UA_free(entries);
+    return retval;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+// Creates and maps segment number of this run. The pages are populated, so producers do not fault.
+static int createSegment (RFU6xx_Journal* journal, Segment* segment, UA_UInt64 number)
+{
+    UA_UInt64 firstSequence = journal->baseSequence + number * journal->capacity;
+    segmentPath(segment->path, journal->directory, firstSequence, "seg");
+
+    segment->mapSize = segmentFileSize(journal->capacity);
+    segment->fd = open(segment->path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (segment->fd < 0) return -1;
+    if (ftruncate(segment->fd, (off_t) segment->mapSize) != 0)
+    {
+        close(segment->fd);
+        unlink(segment->path);
+        return -1;
+    }
+
+    void* map = mmap(NULL, segment->mapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, segment->fd, 0);
+    if (map == MAP_FAILED)
+    {
+        close(segment->fd);
+        unlink(segment->path);
+        return -1;
+    }
+    segment->header = (SegmentHeader*) map;
+    segment->records = (RFU6xx_JournalRecord*) ((char*) map + sizeof(SegmentHeader));
+
+    memcpy(segment->header->magic, SEGMENT_MAGIC, sizeof(segment->header->magic));
+    segment->header->version = JOURNAL_VERSION;
+    segment->header->recordSize = sizeof(RFU6xx_JournalRecord);
+    segment->header->capacity = journal->capacity;
+    segment->header->firstSequence = firstSequence;
+    segment->header->committed = 0;
+    segment->header->created = UA_DateTime_now();
+
+    // Producers may use the segment from now on
+    __atomic_store_n(&segment->number, number, __ATOMIC_RELEASE);
+    COUNTER_ADD(journal->segmentsCreated, 1);
+    return 0;
+}
+
+// Flushes records [start, end) and then the committed count in the header
+static int flushSegment (Segment* segment, size_t start, size_t end)
+{
+    long pageSize = sysconf(_SC_PAGESIZE);
+    size_t from = (sizeof(SegmentHeader) + start * sizeof(RFU6xx_JournalRecord)) & ~((size_t) pageSize - 1);
+    size_t to = sizeof(SegmentHeader) + end * sizeof(RFU6xx_JournalRecord);
+
+    int retval = msync((char*) segment->header + from, to - from, MS_SYNC);
+    segment->header->committed = end;
+    if (msync(segment->header, sizeof(SegmentHeader), MS_SYNC) != 0) retval = -1;
+    return retval;
+}
+
+// Unmaps a segment, a segment with records is truncated to them and indexed, an empty one is removed
+static int closeSegment (Segment* segment, UA_UInt64 count)
+{
+    int retval = 0;
+    __atomic_store_n(&segment->number, NO_SEGMENT, __ATOMIC_RELEASE);
+
+    size_t capacity = (size_t) segment->header->capacity;
+    if (count > 0 && writeIndex(segment->path, segment->records, count) != 0) retval = -1;
+    munmap(segment->header, segment->mapSize);
+    if (count == 0) unlink(segment->path);
+    else if (count < capacity && ftruncate(segment->fd, (off_t) segmentFileSize(count)) != 0) retval = -1;
+    close(segment->fd);
+    return retval;
+}
+
+// Flushes the completed records. A full segment is closed and indexed, the next one is prepared in advance.
+static void commit (RFU6xx_Journal* journal)
+{
+    while (true)
+    {
+        UA_UInt64 number = journal->committed / journal->capacity;
+        Segment* segment = &journal->segments[number & 1];
+        Segment* next = &journal->segments[(number + 1) & 1];
+
+        if (__atomic_load_n(&next->number, __ATOMIC_ACQUIRE) == NO_SEGMENT && createSegment(journal, next, number + 1) != 0)
+        {
+            COUNTER_ADD(journal->errors, 1);
+        }
+        if (__atomic_load_n(&segment->number, __ATOMIC_ACQUIRE) != number) return;
+
+        // Complete records form a prefix, a producer that is still copying ends it
+        size_t start = journal->committed % journal->capacity;
+        size_t end = start;
+        while (end < journal->capacity && __atomic_load_n(&segment->records[end].checksum, __ATOMIC_ACQUIRE) != 0) end++;
+        if (end == start) return;
+
+        if (flushSegment(segment, start, end) != 0) COUNTER_ADD(journal->errors, 1);
+        COUNTER_ADD(journal->commits, 1);
+
+        pthread_mutex_lock(&journal->mutex);
+        journal->committed += end - start;
+        pthread_cond_broadcast(&journal->committedChanged);
+        pthread_mutex_unlock(&journal->mutex);
+
+        if (end < journal->capacity) return;
+
+        // The slot is mapped for segment number + 2 before the full segment is indexed
+        Segment full = *segment;
+        __atomic_store_n(&segment->number, NO_SEGMENT, __ATOMIC_RELEASE);
+        if (createSegment(journal, segment, number + 2) != 0) COUNTER_ADD(journal->errors, 1);
+        if (closeSegment(&full, journal->capacity) != 0) COUNTER_ADD(journal->errors, 1);
+    }
+}
+
+static void* commitThread (void* arg)
+{
+    RFU6xx_Journal* journal = (RFU6xx_Journal*) arg;
+
+    pthread_mutex_lock(&journal->mutex);
+    while (!journal->stop)
+    {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += (long) journal->commitIntervalMs * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&journal->wakeup, &journal->mutex, &deadline);
+
+        pthread_mutex_unlock(&journal->mutex);
+        commit(journal);
+        pthread_mutex_lock(&journal->mutex);
+    }
+    pthread_mutex_unlock(&journal->mutex);
+    return NULL;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+// Maps a segment that was not closed, counts its complete records and indexes it.
+// Returns the number of records or -1 if the file is no segment.
+static long long recoverSegment (const char* path)
+{
+    int fd = open(path, O_RDWR);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(SegmentHeader))
+    {
+        close(fd);
+        return -1;
+    }
+    void* map = mmap(NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+    {
+        close(fd);
+        return -1;
+    }
+
+    SegmentHeader* header = (SegmentHeader*) map;
+    const RFU6xx_JournalRecord* records = (const RFU6xx_JournalRecord*) ((char*) map + sizeof(SegmentHeader));
+    size_t slots = ((size_t) st.st_size - sizeof(SegmentHeader)) / sizeof(RFU6xx_JournalRecord);
+    long long count = -1;
+
+    if (memcmp(header->magic, SEGMENT_MAGIC, sizeof(header->magic)) == 0 && header->recordSize == sizeof(RFU6xx_JournalRecord))
+    {
+        // The journal ends at the first record that was not completely written
+        size_t valid = 0;
+        while (valid < slots && records[valid].checksum != 0 && records[valid].checksum == recordChecksum(&records[valid])) valid++;
+        header->committed = valid;
+        msync(map, sizeof(SegmentHeader), MS_SYNC);
+        if (valid > 0) writeIndex(path, records, valid);
+        count = (long long) valid;
+    }
+    munmap(map, (size_t) st.st_size);
+    if (count > 0 && (size_t) count < slots && ftruncate(fd, (off_t) segmentFileSize((size_t) count)) != 0) count = -1;
+    close(fd);
+    if (count == 0) unlink(path);
+    return count;
+}
+
+// Parses journal-<first sequence>.<extension>
+static int parseSegmentName (const char* name, const char* extension, UA_UInt64* firstSequence)
+{
+    unsigned long long sequence;
+    char ext[8];
+    if (sscanf(name, "journal-%16llx.%7s", &sequence, ext) != 2 || strcmp(ext, extension) != 0) return -1;
+    *firstSequence = sequence;
+    return 0;
+}
+
+// Recovers unindexed segments and returns the sequence that follows the last record in the directory
+static UA_UInt64 recoverDirectory (const char* directory)
+{
+    UA_UInt64 nextSequence = 0;
+    DIR* dir = opendir(directory);
+    if (dir == NULL) return 0;
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        UA_UInt64 firstSequence;
+        if (parseSegmentName(entry->d_name, "seg", &firstSequence) != 0) continue;
+
+        char path[JOURNAL_PATH_SIZE];
+        char indexPath[JOURNAL_PATH_SIZE];
+        segmentPath(path, directory, firstSequence, "seg");
+        segmentPath(indexPath, directory, firstSequence, "idx");
+
+        long long count;
+        struct stat st;
+        if (stat(indexPath, &st) == 0 && stat(path, &st) == 0)
+        {
+            count = (long long) (((size_t) st.st_size - sizeof(SegmentHeader)) / sizeof(RFU6xx_JournalRecord));
+        }
+        else
+        {
+            UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Recovering journal segment %s", path);
+            count = recoverSegment(path);
+        }
+        if (count > 0 && firstSequence + (UA_UInt64) count > nextSequence) nextSequence = firstSequence + (UA_UInt64) count;
+    }
+    closedir(dir);
+    return nextSequence;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+RFU6xx_Journal* RFU6xx_Journal_open (const char* directory, size_t segmentRecords, UA_UInt32 commitIntervalMs)
+{
+    if (strlen(directory) >= JOURNAL_DIRECTORY_SIZE) return NULL;
+    if (mkdir(directory, 0755) != 0 && errno != EEXIST) return NULL;
+
+    RFU6xx_Journal* journal = (RFU6xx_Journal*) UA_calloc(1, sizeof(RFU6xx_Journal));
+    if (journal == NULL) return NULL;
+    strcpy(journal->directory, directory);
+    journal->capacity = segmentRecords ? segmentRecords : RFU6xx_JOURNAL_DEFAULT_SEGMENT_RECORDS;
+    journal->commitIntervalMs = commitIntervalMs ? commitIntervalMs : RFU6xx_JOURNAL_DEFAULT_COMMIT_INTERVAL;
+    journal->segments[0].number = NO_SEGMENT;
+    journal->segments[1].number = NO_SEGMENT;
+    journal->baseSequence = recoverDirectory(directory);
+
+    // The first segment is created here, the commit thread prepares the following ones
+    if (createSegment(journal, &journal->segments[0], 0) != 0)
+    {
+        UA_free(journal);
+        return NULL;
+    }
+    pthread_mutex_init(&journal->mutex, NULL);
+    pthread_cond_init(&journal->wakeup, NULL);
+    pthread_cond_init(&journal->committedChanged, NULL);
+    if (pthread_create(&journal->thread, NULL, commitThread, journal) != 0)
+    {
+        closeSegment(&journal->segments[0], 0);
+        pthread_mutex_destroy(&journal->mutex);
+        pthread_cond_destroy(&journal->wakeup);
+        pthread_cond_destroy(&journal->committedChanged);
+        UA_free(journal);
+        return NULL;
+    }
+    return journal;
+}
+
+void RFU6xx_Journal_close (RFU6xx_Journal* journal)
+{
+    if (journal == NULL) return;
+
+    pthread_mutex_lock(&journal->mutex);
+    journal->stop = true;
+    pthread_cond_signal(&journal->wakeup);
+    pthread_mutex_unlock(&journal->mutex);
+    pthread_join(journal->thread, NULL);
+
+    // Final commit, then the partly filled segment is indexed and the prepared one removed
+    commit(journal);
+    for (int i = 0; i < 2; i++)
+    {
+        Segment* segment = &journal->segments[i];
+        if (segment->number == NO_SEGMENT) continue;
+        UA_UInt64 count = segment->number == journal->committed / journal->capacity ? journal->committed % journal->capacity : 0;
+        closeSegment(segment, count);
+    }
+
+    pthread_mutex_destroy(&journal->mutex);
+    pthread_cond_destroy(&journal->wakeup);
+    pthread_cond_destroy(&journal->committedChanged);
+    UA_free(journal);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+UA_Boolean RFU6xx_Journal_append (RFU6xx_Journal* journal, const RFU6xx_JournalRecord* record)
+{
+    if (journal == NULL) return false;
+
+    // Reserve a sequence only if its segment is mapped, so a mapped segment never has gaps
+    UA_UInt64 sequence = __atomic_load_n(&journal->nextSequence, __ATOMIC_RELAXED);
+    Segment* segment;
+    do
+    {
+        UA_UInt64 number = sequence / journal->capacity;
+        segment = &journal->segments[number & 1];
+        if (__atomic_load_n(&segment->number, __ATOMIC_ACQUIRE) != number)
+        {
+            COUNTER_ADD(journal->dropped, 1);
+            return false;
+        }
+    } while (!__atomic_compare_exchange_n(&journal->nextSequence, &sequence, sequence + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    // The checksum is written last, it marks the record as complete for the commit thread
+    RFU6xx_JournalRecord copy = *record;
+    copy.checksum = 0;
+    UA_UInt32 checksum = recordChecksum(&copy);
+    RFU6xx_JournalRecord* slot = &segment->records[sequence % journal->capacity];
+    memcpy(slot, &copy, sizeof(copy));
+    __atomic_store_n(&slot->checksum, checksum, __ATOMIC_RELEASE);
+    COUNTER_ADD(journal->appended, 1);
+    return true;
+}
+
+UA_Boolean RFU6xx_Journal_appendTagOperation (RFU6xx_Journal* journal, UA_UInt32 deviceId, RFU6xx_JournalOperation operation,
+    UA_String id, UA_Int32 bank, UA_Int32 offset, UA_Int32 length, UA_StatusCode status,
+    RFU6xx_StatusCode serverResponseCode, UA_UInt32 durationUs)
+{
+    RFU6xx_JournalRecord record;
+    UA_Byte epc[RFU6xx_MAX_TAG_ID_SIZE];
+
+    if (journal == NULL) return false;
+    if (id.length > 2*RFU6xx_MAX_TAG_ID_SIZE || hexDecode(id.data, id.length, epc) != 0) return false;
+
+    memset(&record, 0, sizeof(record));
+    record.timestamp = UA_DateTime_now();
+    record.deviceId = deviceId;
+    record.status = status;
+    record.serverResponseCode = serverResponseCode;
+    record.offset = offset;
+    record.length = length;
+    record.durationUs = durationUs;
+    record.operation = (UA_Byte) operation;
+    record.bank = (UA_Byte) bank;
+    record.epcLength = (UA_Byte) (id.length / 2);
+    memcpy(record.epc, epc, record.epcLength < RFU6xx_JOURNAL_EPC_SIZE ? record.epcLength : RFU6xx_JOURNAL_EPC_SIZE);
+    return RFU6xx_Journal_append(journal, &record);
+}
+
+void RFU6xx_Journal_onLastScanData (RFU6xx_Device* device, const UA_String* lastScanData, void* context)
+{
+    RFU6xx_JournalProducer* producer = (RFU6xx_JournalProducer*) context;
+    if (lastScanData->length == 0) return;
+    RFU6xx_Journal_appendTagOperation(producer->journal, producer->deviceId, RFU6xx_JOURNAL_SCAN, *lastScanData,
+        0, 0, 0, UA_STATUSCODE_GOOD, RFU6xx_STATUSCODE_SUCCESS, 0);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+UA_StatusCode RFU6xx_Journal_sync (RFU6xx_Journal* journal)
+{
+    UA_UInt64 target = __atomic_load_n(&journal->nextSequence, __ATOMIC_ACQUIRE);
+    UA_UInt64 errors = COUNTER_LOAD(journal->errors);
+
+    pthread_mutex_lock(&journal->mutex);
+    while (journal->committed < target && !journal->stop)
+    {
+        pthread_cond_signal(&journal->wakeup);
+        pthread_cond_wait(&journal->committedChanged, &journal->mutex);
+    }
+    pthread_mutex_unlock(&journal->mutex);
+    return COUNTER_LOAD(journal->errors) == errors ? UA_STATUSCODE_GOOD : UA_STATUSCODE_BADINTERNALERROR;
+}
+
+void RFU6xx_Journal_getStats (RFU6xx_Journal* journal, RFU6xx_JournalStats* stats)
+{
+    stats->appended = COUNTER_LOAD(journal->appended);
+    stats->dropped = COUNTER_LOAD(journal->dropped);
+    stats->committed = __atomic_load_n(&journal->committed, __ATOMIC_RELAXED);
+    stats->commits = COUNTER_LOAD(journal->commits);
+    stats->segments = COUNTER_LOAD(journal->segmentsCreated);
+    stats->errors = COUNTER_LOAD(journal->errors);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+// Read-only mapping of a segment and its index (NULL if there is no valid index)
+typedef struct {
+    UA_UInt64 firstSequence;
+    void* map;
+    size_t mapSize;
+    const RFU6xx_JournalRecord* records;
+    UA_UInt64 count;
+
+    void* indexMap;
+    size_t indexMapSize;
+    const IndexHeader* index;
+    const TimeRange* blocks;
+    const EpcIndexEntry* entries;
+} ReaderSegment;
+
+struct RFU6xx_JournalReader {
+    ReaderSegment* segments;
+    size_t segmentsSize;
+};
+
+UA_DateTime RFU6xx_Journal_parseTime (const char* text)
+{
+    struct tm tm;
+    time_t seconds;
+    char* end;
+
+    memset(&tm, 0, sizeof(tm));
+    end = strptime(text, "%Y-%m-%dT%H:%M:%S", &tm);
+    if (end != NULL && *end == '\0') seconds = timegm(&tm);
+    else
+    {
+        seconds = (time_t) strtoll(text, &end, 10);
+        if (*end != '\0' || end == text) return 0;
+    }
+    return (UA_DateTime) seconds * UA_DATETIME_SEC + UA_DATETIME_UNIX_EPOCH;
+}
+
+static void* mapReadOnly (const char* path, size_t* size)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    void* map = NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) map = NULL;
+        *size = (size_t) st.st_size;
+    }
+    close(fd);
+    return map;
+}
+
+static int mapReaderSegment (ReaderSegment* segment, const char* directory)
+{
+    char path[JOURNAL_PATH_SIZE];
+    segmentPath(path, directory, segment->firstSequence, "seg");
+    segment->map = mapReadOnly(path, &segment->mapSize);
+    if (segment->map == NULL || segment->mapSize < sizeof(SegmentHeader)) return -1;
+
+    const SegmentHeader* header = (const SegmentHeader*) segment->map;
+    if (memcmp(header->magic, SEGMENT_MAGIC, sizeof(header->magic)) != 0 || header->recordSize != sizeof(RFU6xx_JournalRecord)) return -1;
+    segment->records = (const RFU6xx_JournalRecord*) ((const char*) segment->map + sizeof(SegmentHeader));
+    segment->count = __atomic_load_n(&header->committed, __ATOMIC_ACQUIRE);
+    size_t slots = (segment->mapSize - sizeof(SegmentHeader)) / sizeof(RFU6xx_JournalRecord);
+    if (segment->count > slots) segment->count = slots;
+
+    // The index is only used if it covers exactly the records of the segment
+    segmentPath(path, directory, segment->firstSequence, "idx");
+    segment->indexMap = mapReadOnly(path, &segment->indexMapSize);
+    if (segment->indexMap == NULL) return 0;
+    const IndexHeader* index = (const IndexHeader*) segment->indexMap;
+    if (segment->indexMapSize >= sizeof(IndexHeader) && memcmp(index->magic, INDEX_MAGIC, sizeof(index->magic)) == 0
+        && index->records == segment->count && index->blockSize == RFU6xx_JOURNAL_INDEX_BLOCK_SIZE
+        && segment->indexMapSize == sizeof(IndexHeader) + index->blocks * sizeof(TimeRange) + index->records * sizeof(EpcIndexEntry))
+    {
+        segment->index = index;
+        segment->blocks = (const TimeRange*) ((const char*) segment->indexMap + sizeof(IndexHeader));
+        segment->entries = (const EpcIndexEntry*) &segment->blocks[index->blocks];
+    }
+    return 0;
+}
+
+static int compareSegments (const void* a, const void* b)
+{
+    UA_UInt64 x = ((const ReaderSegment*) a)->firstSequence, y = ((const ReaderSegment*) b)->firstSequence;
+    return (x > y) - (x < y);
+}
+
+RFU6xx_JournalReader* RFU6xx_JournalReader_open (const char* directory)
+{
+    if (strlen(directory) >= JOURNAL_DIRECTORY_SIZE) return NULL;
+    DIR* dir = opendir(directory);
+    if (dir == NULL) return NULL;
+
+    RFU6xx_JournalReader* reader = (RFU6xx_JournalReader*) UA_calloc(1, sizeof(RFU6xx_JournalReader));
+    size_t capacity = 0;
+    struct dirent* entry;
+    while (reader != NULL && (entry = readdir(dir)) != NULL)
+    {
+        UA_UInt64 firstSequence;
+        if (parseSegmentName(entry->d_name, "seg", &firstSequence) != 0) continue;
+        if (reader->segmentsSize == capacity)
+        {
+            capacity = capacity ? 2*capacity : 16;
+            ReaderSegment* segments = (ReaderSegment*) UA_realloc(reader->segments, capacity * sizeof(ReaderSegment));
+            if (segments == NULL) break;
+            reader->segments = segments;
+        }
+        ReaderSegment* segment = &reader->segments[reader->segmentsSize];
+        memset(segment, 0, sizeof(ReaderSegment));
+        segment->firstSequence = firstSequence;
+        reader->segmentsSize++;
+        if (mapReaderSegment(segment, directory) != 0) segment->count = 0;
+    }
+    closedir(dir);
+
+    if (reader != NULL && reader->segmentsSize > 0) qsort(reader->segments, reader->segmentsSize, sizeof(ReaderSegment), compareSegments);
+    return reader;
+}
+
+void RFU6xx_JournalReader_close (RFU6xx_JournalReader* reader)
+{
+    if (reader == NULL) return;
+    for (size_t i = 0; i < reader->segmentsSize; i++)
+    {
+        if (reader->segments[i].map != NULL) munmap(reader->segments[i].map, reader->segments[i].mapSize);
+        if (reader->segments[i].indexMap != NULL) munmap(reader->segments[i].indexMap, reader->segments[i].indexMapSize);
+    }
+    UA_free(reader->segments);
+    UA_free(reader);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+static UA_Boolean overlaps (const RFU6xx_JournalQuery* query, UA_DateTime min, UA_DateTime max)
+{
+    return (query->from == 0 || max >= query->from) && (query->to == 0 || min < query->to);
+}
+
+static UA_Boolean matches (const RFU6xx_JournalQuery* query, const RFU6xx_JournalRecord* record)
+{
+    if (query->from != 0 && record->timestamp < query->from) return false;
+    if (query->to != 0 && record->timestamp >= query->to) return false;
+    if (query->filterDevice && record->deviceId != query->deviceId) return false;
+    if (query->operation != 0 && record->operation != query->operation) return false;
+    if (query->epc != NULL)
+    {
+        size_t length = query->epcLength < RFU6xx_JOURNAL_EPC_SIZE ? query->epcLength : RFU6xx_JOURNAL_EPC_SIZE;
+        if (record->epcLength != query->epcLength || memcmp(record->epc, query->epc, length) != 0) return false;
+    }
+    // Only matching records are verified
+    return record->checksum == recordChecksum(record);
+}
+
+UA_UInt64 RFU6xx_JournalReader_query (RFU6xx_JournalReader* reader, const RFU6xx_JournalQuery* query,
+    RFU6xx_JournalVisitor visitor, void* context)
+{
+    UA_UInt64 found = 0;
+
+    for (size_t s = 0; s < reader->segmentsSize; s++)
+    {
+        const ReaderSegment* segment = &reader->segments[s];
+        if (segment->count == 0) continue;
+        if (segment->index != NULL && !overlaps(query, segment->index->minTimestamp, segment->index->maxTimestamp)) continue;
+
+        if (query->epc != NULL && segment->index != NULL)
+        {
+            // Binary search of the first entry with the hash of the EPC
+            UA_UInt32 hash = epcHash(query->epc, (UA_Byte) query->epcLength);
+            size_t low = 0, high = segment->index->records;
+            while (low < high)
+            {
+                size_t mid = low + (high - low) / 2;
+                if (segment->entries[mid].hash < hash) low = mid + 1;
+                else high = mid;
+            }
+            for (size_t i = low; i < segment->index->records && segment->entries[i].hash == hash; i++)
+            {
+                UA_UInt32 r = segment->entries[i].record;
+                if (!matches(query, &segment->records[r])) continue;
+                found++;
+                if (visitor != NULL && !visitor(&segment->records[r], segment->firstSequence + r, context)) return found;
+            }
+            continue;
+        }
+
+        for (UA_UInt64 r = 0; r < segment->count; r++)
+        {
+            // Blocks outside of the time range are skipped as a whole
+            if (segment->index != NULL && r % RFU6xx_JOURNAL_INDEX_BLOCK_SIZE == 0)
+            {
+                const TimeRange* block = &segment->blocks[r / RFU6xx_JOURNAL_INDEX_BLOCK_SIZE];
+                if (!overlaps(query, block->min, block->max))
+                {
+                    r += RFU6xx_JOURNAL_INDEX_BLOCK_SIZE - 1;
+                    continue;
+                }
+            }
+            if (!matches(query, &segment->records[r])) continue;
+            found++;
+            if (visitor != NULL && !visitor(&segment->records[r], segment->firstSequence + r, context)) return found;
+        }
+    }
+    return found;
+}
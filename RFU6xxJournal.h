@@ -0,0 +1,273 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+* @contact: sebastian.heidepriem@sick.de
+*
+* Append-only journal of scanned tags and tag operations for traceability.
+* Records have a fixed binary layout (64 bytes) and are appended to memory-mapped segment files
+* (journal-<first sequence>.seg). Appending copies the record into the mapping without a system call
+* or lock, so it can be called from the thread that drives the OPC UA client. A commit thread
+* flushes the written records with one msync per commit interval (group commit), prepares the next
+* segment in advance and writes the index of a full segment (journal-<first sequence>.idx):
+* minimum / maximum timestamp per block of records and the records sorted by EPC hash.
+* Segments and indices are read in place through RFU6xx_JournalReader.
+*/
+
+#ifndef RFU6xxJOURNAL_H
+#define RFU6xxJOURNAL_H
+
+    #include "RFU6xxClient.h"
+
+    // EPC bytes stored in a record, longer EPCs are stored truncated (epcLength keeps the full length)
+    #define RFU6xx_JOURNAL_EPC_SIZE 24
+
+    // Defaults of RFU6xx_Journal_open
+    #define RFU6xx_JOURNAL_DEFAULT_SEGMENT_RECORDS (1024 * 1024)
+    #define RFU6xx_JOURNAL_DEFAULT_COMMIT_INTERVAL 10
+
+    // Records per block of the time index
+    #define RFU6xx_JOURNAL_INDEX_BLOCK_SIZE 1024
+
+    typedef enum {
+        RFU6xx_JOURNAL_SCAN = 1,                    // Tag seen in LastScanData
+        RFU6xx_JOURNAL_READ_TAG,
+        RFU6xx_JOURNAL_WRITE_TAG,
+        RFU6xx_JOURNAL_START_SCAN,
+        RFU6xx_JOURNAL_STOP_SCAN
+    } RFU6xx_JournalOperation;
+
+    /*
+    * Struct:  RFU6xx_JournalRecord
+    * --------------------
+    * Layout of a record in the segment files (little endian, 64 bytes).
+    */
+    typedef struct {
+        UA_DateTime timestamp;
+        UA_UInt32 checksum;                         // Of the other bytes, 0 == not written (set by RFU6xx_Journal_append)
+        UA_UInt32 deviceId;
+        UA_UInt32 status;                           // UA_StatusCode of the operation
+        UA_UInt32 serverResponseCode;               // RFU6xx_StatusCode (ReadTag / WriteTag)
+        UA_Int32 offset;                            // ReadTag / WriteTag parameters
+        UA_Int32 length;
+        UA_UInt32 durationUs;                       // Duration of the operation, 0 if unknown
+        UA_Byte operation;                          // RFU6xx_JournalOperation
+        UA_Byte bank;
+        UA_Byte epcLength;
+        UA_Byte reserved;
+        UA_Byte epc[RFU6xx_JOURNAL_EPC_SIZE];       // Binary EPC
+    } RFU6xx_JournalRecord;
+
+    typedef struct {
+        UA_UInt64 appended;                         // Records written into a segment
+        UA_UInt64 dropped;                          // Records dropped because the next segment was not ready
+        UA_UInt64 committed;                        // Records flushed to disk
+        UA_UInt64 commits;                          // msync calls of the commit thread
+        UA_UInt64 segments;                         // Segments created
+        UA_UInt64 errors;                           // Failed segment creations, flushes or index writes
+    } RFU6xx_JournalStats;
+
+    typedef struct RFU6xx_Journal RFU6xx_Journal;
+
+    /*
+    * Struct:  RFU6xx_JournalProducer
+    * --------------------
+    * Context of RFU6xx_Journal_onLastScanData: the journal and the id written into the records of a device.
+    */
+    typedef struct {
+        RFU6xx_Journal* journal;
+        UA_UInt32 deviceId;
+    } RFU6xx_JournalProducer;
+
+    /*
+    * Function:  RFU6xx_Journal_open
+    * --------------------
+    * Opens the journal in a directory (created if missing) and starts its commit thread.
+    * A segment that was not closed (e.g. after a crash) is recovered up to its last complete record
+    * and indexed, new records are appended to a new segment.
+    *
+    *  parameters:
+    *               -> const char* directory
+    *               -> size_t segmentRecords                    /-> Records per segment file, 0 == RFU6xx_JOURNAL_DEFAULT_SEGMENT_RECORDS
+    *               -> UA_UInt32 commitIntervalMs               /-> Time between two group commits, 0 == RFU6xx_JOURNAL_DEFAULT_COMMIT_INTERVAL
+    *
+    *  returns:
+    *               -> RFU6xx_Journal*                          /-> NULL if the directory or the first segment could not be created
+    */
+    RFU6xx_Journal* RFU6xx_Journal_open (const char* directory, size_t segmentRecords, UA_UInt32 commitIntervalMs);
+
+    /*
+    * Function:  RFU6xx_Journal_close
+    * --------------------
+    * Commits all appended records, writes the index of the last segment and frees the journal.
+    * No thread may append while the journal is closed.
+    *
+    *  parameters:
+    *               -> RFU6xx_Journal* journal
+    *
+    *  returns:
+    */
+    void RFU6xx_Journal_close (RFU6xx_Journal* journal);
+
+    /*
+    * Function:  RFU6xx_Journal_append
+    * --------------------
+    * Copies a record into the journal and sets its checksum. Lock-free, can be called from any thread.
+    * The record is durable after the next group commit (see RFU6xx_Journal_sync).
+    *
+    *  parameters:
+    *               -> RFU6xx_Journal* journal                  /-> NULL == journal disabled, the record is ignored
+    *               -> const RFU6xx_JournalRecord* record
+    *
+    *  returns:
+    *               -> UA_Boolean                               /-> false if the record was dropped or the journal is NULL
+    */
+    UA_Boolean RFU6xx_Journal_append (RFU6xx_Journal* journal, const RFU6xx_JournalRecord* record);
+
+    /*
+    * Function:  RFU6xx_Journal_appendTagOperation
+    * --------------------
+    * Appends a record of a tag operation with the current time.
+    *
+    *  parameters:
+    *               -> RFU6xx_Journal* journal                  /-> NULL == journal disabled, the record is ignored
+    *               -> UA_UInt32 deviceId
+    *               -> RFU6xx_JournalOperation operation
+    *               -> UA_String id                             /-> Id string from the tag (coded in hex numbers), may be empty
+    *               -> UA_Int32 bank
+    *               -> UA_Int32 offset
+    *               -> UA_Int32 length                          /-> Number of bytes read / written
+    *               -> UA_StatusCode status
+    *               -> RFU6xx_StatusCode serverResponseCode
+    *               -> UA_UInt32 durationUs
+    *
+    *  returns:
+    *               -> UA_Boolean                               /-> false if the id was invalid or the record was dropped
+    */
+    UA_Boolean RFU6xx_Journal_appendTagOperation (RFU6xx_Journal* journal, UA_UInt32 deviceId, RFU6xx_JournalOperation operation,
+        UA_String id, UA_Int32 bank, UA_Int32 offset, UA_Int32 length, UA_StatusCode status,
+        RFU6xx_StatusCode serverResponseCode, UA_UInt32 durationUs);
+
+    /*
+    * Function:  RFU6xx_Journal_onLastScanData
+    * --------------------
+    * RFU6xx_LastScanDataCallback that appends a RFU6xx_JOURNAL_SCAN record for every notification.
+    * The context is a RFU6xx_JournalProducer, e.g.:
+    *       subscribeLastScanData(device, 100, 10, RFU6xx_Journal_onLastScanData, &producer, &subscriptionId);
+    */
+    void RFU6xx_Journal_onLastScanData (RFU6xx_Device* device, const UA_String* lastScanData, void* context);
+
+    /*
+    * Function:  RFU6xx_Journal_sync
+    * --------------------
+    * Waits until all records appended before the call are committed.
+    *
+    *  parameters:
+    *               -> RFU6xx_Journal* journal
+    *
+    *  returns:
+    *               -> UA_StatusCode                            /-> UA_STATUSCODE_BADINTERNALERROR if a flush failed
+    */
+    UA_StatusCode RFU6xx_Journal_sync (RFU6xx_Journal* journal);
+
+    /*
+    * Function:  RFU6xx_Journal_getStats
+    * --------------------
+    * Reads the counters of the journal. Can be called from any thread.
+    *
+    *  parameters:
+    *               -> RFU6xx_Journal* journal
+    *               -> RFU6xx_JournalStats* stats
+    *
+    *  returns:
+    */
+    void RFU6xx_Journal_getStats (RFU6xx_Journal* journal, RFU6xx_JournalStats* stats);
+
+    // ------------------------------------------------------------------------------------------------------------------------
+
+    /*
+    * Struct:  RFU6xx_JournalQuery
+    * --------------------
+    * Filter of RFU6xx_JournalReader_query, all conditions must match.
+    */
+    typedef struct {
+        UA_DateTime from;                           // First timestamp (inclusive), 0 == no limit
+        UA_DateTime to;                             // Last timestamp (exclusive), 0 == no limit
+        const UA_Byte* epc;                         // NULL == all tags
+        UA_UInt16 epcLength;
+        UA_Boolean filterDevice;
+        UA_UInt32 deviceId;
+        UA_Byte operation;                          // 0 == all operations
+    } RFU6xx_JournalQuery;
+
+    /*
+    * Callback type for RFU6xx_JournalReader_query
+    * --------------------
+    * Called with every matching record. The record points into the mapped segment.
+    *
+    *  returns:
+    *               -> UA_Boolean                               /-> false stops the query
+    */
+    typedef UA_Boolean (*RFU6xx_JournalVisitor)(const RFU6xx_JournalRecord* record, UA_UInt64 sequence, void* context);
+
+    typedef struct RFU6xx_JournalReader RFU6xx_JournalReader;
+
+    /*
+    * Function:  RFU6xx_Journal_parseTime
+    * --------------------
+    * Parses a time of a query: YYYY-MM-DDTHH:MM:SS (UTC) or seconds since 1970.
+    *
+    *  parameters:
+    *               -> const char* text
+    *
+    *  returns:
+    *               -> UA_DateTime                              /-> 0 if the text is no valid time
+    */
+    UA_DateTime RFU6xx_Journal_parseTime (const char* text);
+
+    /*
+    * Function:  RFU6xx_JournalReader_open
+    * --------------------
+    * Maps all segments and indices of a journal directory read-only. Records appended
+    * afterwards are not visible, the segment being written is read up to its last commit.
+    *
+    *  parameters:
+    *               -> const char* directory
+    *
+    *  returns:
+    *               -> RFU6xx_JournalReader*                    /-> NULL if the directory can not be read
+    */
+    RFU6xx_JournalReader* RFU6xx_JournalReader_open (const char* directory);
+
+    /*
+    * Function:  RFU6xx_JournalReader_close
+    * --------------------
+    *
+    *  parameters:
+    *               -> RFU6xx_JournalReader* reader
+    *
+    *  returns:
+    */
+    void RFU6xx_JournalReader_close (RFU6xx_JournalReader* reader);
+
+    /*
+    * Function:  RFU6xx_JournalReader_query
+    * --------------------
+    * Calls the visitor for every matching record in the order of the journal. Segments outside
+    * of the time range are skipped, the index restricts the scan to the blocks of the time range
+    * or to the records with the hash of the EPC. Records with an invalid checksum are skipped.
+    *
+    *  parameters:
+    *               -> RFU6xx_JournalReader* reader
+    *               -> const RFU6xx_JournalQuery* query
+    *               -> RFU6xx_JournalVisitor visitor
+    *               -> void* context                            /-> User context passed to the visitor
+    *
+    *  returns:
+    *               -> UA_UInt64                                /-> Number of matching records
+    */
+    UA_UInt64 RFU6xx_JournalReader_query (RFU6xx_JournalReader* reader, const RFU6xx_JournalQuery* query,
+        RFU6xx_JournalVisitor visitor, void* context);
+
+#endif
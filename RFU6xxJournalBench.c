@@ -0,0 +1,220 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+*
+* @contact: sebastian.heidepriem@sick.de
+*
+*
+* Benchmark of the scan journal (RFU6xxJournal):
+*   1.) <records> scan records of <field> different tags are appended by <producers> threads at
+*       <rate> records/s in total (0 == as fast as possible), the timestamps advance by 10 us per record.
+*       Unpaced the producers outrun the disk and records are dropped once the prepared segment is full.
+*   2.) The journal is closed (last commit, index of the last segment) and opened by a reader.
+*   3.) Lookups of single EPCs, of a one second time window and a full scan are timed.
+* Existing journal files in the directory are removed first.
+*
+* Usage: ./journalbench [directory] [records] [rate] [producers] [field]
+*/
+
+#include "RFU6xxJournal.h"
+
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define EPC_SIZE 12
+#define RECORD_INTERVAL (10 * UA_DATETIME_USEC)
+#define SEGMENT_RECORDS (256 * 1024)
+#define LOOKUPS 100
+
+typedef struct {
+    RFU6xx_Journal* journal;
+    UA_UInt32 deviceId;
+    size_t records;
+    size_t field;
+    double rate;                                // Records/s of this producer, 0 == unpaced
+    double cpuNs;
+    UA_DateTime start;
+    pthread_t thread;
+} Producer;
+
+static double clockNs (clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double nowNs (void)
+{
+    return clockNs(CLOCK_MONOTONIC);
+}
+
+// EPC of tag number n of the field
+static void fieldEpc (UA_Byte* epc, size_t n)
+{
+    uint64_t z = (uint64_t) n * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 31)) * 0xBF58476D1CE4E5B9ULL;
+    memcpy(epc, &z, 8);
+    memcpy(&epc[8], &n, 4);
+}
+
+static void* produce (void* arg)
+{
+    Producer* producer = (Producer*) arg;
+    RFU6xx_JournalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.deviceId = producer->deviceId;
+    record.operation = RFU6xx_JOURNAL_SCAN;
+    record.epcLength = EPC_SIZE;
+
+    uint64_t state = producer->deviceId + 1;
+    double start = nowNs();
+    double cpuStart = clockNs(CLOCK_THREAD_CPUTIME_ID);
+    for (size_t i = 0; i < producer->records; i++)
+    {
+        // Paced in batches of 64 records
+        if (producer->rate > 0 && i % 64 == 0)
+        {
+            double due = start + i * 1e9 / producer->rate;
+            double now = nowNs();
+            if (due > now)
+            {
+                struct timespec wait = { (time_t) ((due - now) / 1e9), (long) ((UA_UInt64) (due - now) % 1000000000ULL) };
+                nanosleep(&wait, NULL);
+            }
+        }
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        fieldEpc(record.epc, (size_t) (state >> 33) % producer->field);
+        record.timestamp = producer->start + (UA_DateTime) i * RECORD_INTERVAL;
+        RFU6xx_Journal_append(producer->journal, &record);
+    }
+    producer->cpuNs = clockNs(CLOCK_THREAD_CPUTIME_ID) - cpuStart;
+    return NULL;
+}
+
+static UA_Boolean countRecord (const RFU6xx_JournalRecord* record, UA_UInt64 sequence, void* context)
+{
+    (void) record;
+    (void) sequence;
+    (*(UA_UInt64*) context)++;
+    return true;
+}
+
+// Removes journal-*.seg / journal-*.idx files of an earlier run
+static void removeJournal (const char* directory)
+{
+    DIR* dir = opendir(directory);
+    if (dir == NULL) return;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (strncmp(entry->d_name, "journal-", 8) != 0) continue;
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+        remove(path);
+    }
+    closedir(dir);
+}
+
+int main (int argc, char *argv[])
+{
+    const char* directory = argc > 1 ? argv[1] : "journalbench.d";
+    size_t records = argc > 2 ? (size_t) atol(argv[2]) : 1000000;
+    double rate = argc > 3 ? atof(argv[3]) : 200000;
+    size_t producers = argc > 4 ? (size_t) atol(argv[4]) : 1;
+    size_t field = argc > 5 ? (size_t) atol(argv[5]) : 10000;
+
+    if (records == 0 || rate < 0 || producers == 0 || field == 0)
+    {
+        fprintf(stderr, "Usage: %s [directory] [records] [rate] [producers] [field]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    removeJournal(directory);
+    RFU6xx_Journal* journal = RFU6xx_Journal_open(directory, SEGMENT_RECORDS, 0);
+    if (journal == NULL)
+    {
+        fprintf(stderr, "Can not open the journal in %s\n", directory);
+        return EXIT_FAILURE;
+    }
+
+    // Append
+    UA_DateTime start = UA_DateTime_now();
+    Producer* threads = (Producer*) calloc(producers, sizeof(Producer));
+    double appendStart = nowNs();
+    for (size_t i = 0; i < producers; i++)
+    {
+        threads[i].journal = journal;
+        threads[i].deviceId = (UA_UInt32) i;
+        threads[i].records = records / producers;
+        threads[i].field = field;
+        threads[i].rate = rate / producers;
+        threads[i].start = start;
+        pthread_create(&threads[i].thread, NULL, produce, &threads[i]);
+    }
+    double cpuNs = 0;
+    for (size_t i = 0; i < producers; i++)
+    {
+        pthread_join(threads[i].thread, NULL);
+        cpuNs += threads[i].cpuNs;
+    }
+    double appendNs = nowNs() - appendStart;
+    UA_StatusCode retval = RFU6xx_Journal_sync(journal);
+    double syncNs = nowNs() - appendStart;
+
+    RFU6xx_JournalStats stats;
+    RFU6xx_Journal_getStats(journal, &stats);
+    double closeStart = nowNs();
+    RFU6xx_Journal_close(journal);
+    double closeNs = nowNs() - closeStart;
+    free(threads);
+
+    printf("appended %llu records with %zu producer(s): %.0f records/s (%.1f MiB/s), producer CPU %.1f ns/record\n",
+        (unsigned long long) stats.appended, producers, stats.appended / appendNs * 1e9,
+        stats.appended * sizeof(RFU6xx_JournalRecord) / appendNs * 1e9 / 1048576.0, cpuNs / (stats.appended + stats.dropped));
+    printf("durable after %.1f ms (%s), %llu commits, %llu segments, %llu dropped, %llu errors, close %.1f ms\n",
+        syncNs / 1e6, UA_StatusCode_name(retval), (unsigned long long) stats.commits, (unsigned long long) stats.segments,
+        (unsigned long long) stats.dropped, (unsigned long long) stats.errors, closeNs / 1e6);
+
+    // Query
+    RFU6xx_JournalReader* reader = RFU6xx_JournalReader_open(directory);
+    if (reader == NULL) return EXIT_FAILURE;
+
+    RFU6xx_JournalQuery query;
+    UA_Byte epc[EPC_SIZE];
+    UA_UInt64 found = 0;
+    memset(&query, 0, sizeof(query));
+    query.epc = epc;
+    query.epcLength = EPC_SIZE;
+    double queryStart = nowNs();
+    for (size_t i = 0; i < LOOKUPS; i++)
+    {
+        fieldEpc(epc, i * field / LOOKUPS);
+        RFU6xx_JournalReader_query(reader, &query, countRecord, &found);
+    }
+    double epcNs = (nowNs() - queryStart) / LOOKUPS;
+    printf("EPC lookup: %.1f us/query, %.1f records/query\n", epcNs / 1e3, (double) found / LOOKUPS);
+
+    memset(&query, 0, sizeof(query));
+    query.from = start + (UA_DateTime) (records / producers / 2) * RECORD_INTERVAL;
+    query.to = query.from + UA_DATETIME_SEC;
+    found = 0;
+    queryStart = nowNs();
+    RFU6xx_JournalReader_query(reader, &query, countRecord, &found);
+    printf("1 s time window: %.1f us, %llu records\n", (nowNs() - queryStart) / 1e3, (unsigned long long) found);
+
+    memset(&query, 0, sizeof(query));
+    query.operation = RFU6xx_JOURNAL_SCAN;
+    queryStart = nowNs();
+    found = RFU6xx_JournalReader_query(reader, &query, NULL, NULL);
+    double scanNs = nowNs() - queryStart;
+    printf("full scan: %.1f ms, %llu records (%.1f ns/record)\n", scanNs / 1e6, (unsigned long long) found, scanNs / found);
+
+    RFU6xx_JournalReader_close(reader);
+    return found == stats.appended ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,114 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+*
+* @contact: sebastian.heidepriem@sick.de
+*
+*
+* Query tool of the scan journal (RFU6xxJournal). The segments are read in place, one line is printed per record:
+*   <sequence> <timestamp UTC> <device> <operation> <EPC> bank=<bank> offset=<offset> length=<length>
+*   status=<UA_StatusCode> response=<RFU6xx_StatusCode> <duration>us
+*
+* Usage: ./journalquery [-D directory] [-f from] [-t to] [-e EPC] [-n device] [-o operation] [-l limit] [-c]
+*   from / to are UTC times (YYYY-MM-DDTHH:MM:SS) or seconds since 1970, to is exclusive.
+*   operation is one of scan, readTag, writeTag, startScan, stopScan. -c only prints the number of records.
+*/
+
+#include "RFU6xxJournal.h"
+#include "RFU6xxHex.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+static const char* operationNames[] = { "", "scan", "readTag", "writeTag", "startScan", "stopScan" };
+
+typedef struct {
+    UA_UInt64 limit;                            // 0 == no limit
+    UA_UInt64 printed;
+} Output;
+
+static UA_Byte parseOperation (const char* text)
+{
+    for (UA_Byte i = 1; i < sizeof(operationNames) / sizeof(operationNames[0]); i++)
+    {
+        if (strcmp(text, operationNames[i]) == 0) return i;
+    }
+    return 0;
+}
+
+static UA_Boolean printRecord (const RFU6xx_JournalRecord* record, UA_UInt64 sequence, void* context)
+{
+    Output* output = (Output*) context;
+    UA_Byte epc[2*RFU6xx_JOURNAL_EPC_SIZE + 1];
+    char timestamp[32];
+    struct tm tm;
+
+    size_t epcLength = record->epcLength < RFU6xx_JOURNAL_EPC_SIZE ? record->epcLength : RFU6xx_JOURNAL_EPC_SIZE;
+    hexEncode(record->epc, epcLength, epc, 1);
+    epc[2*epcLength] = '\0';
+
+    UA_DateTime unixTime = record->timestamp - UA_DATETIME_UNIX_EPOCH;
+    time_t seconds = (time_t) (unixTime / UA_DATETIME_SEC);
+    gmtime_r(&seconds, &tm);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%S", &tm);
+
+    printf("%llu %s.%06lldZ %u %s %s%s bank=%u offset=%d length=%d status=0x%08x response=%u %uus\n",
+        (unsigned long long) sequence, timestamp, (long long) (unixTime % UA_DATETIME_SEC / UA_DATETIME_USEC),
+        record->deviceId, record->operation < sizeof(operationNames) / sizeof(operationNames[0]) ? operationNames[record->operation] : "?",
+        epcLength ? (char*) epc : "-", record->epcLength > RFU6xx_JOURNAL_EPC_SIZE ? "..." : "",
+        record->bank, record->offset, record->length, record->status, record->serverResponseCode, record->durationUs);
+
+    return output->limit == 0 || ++output->printed < output->limit;
+}
+
+int main (int argc, char *argv[])
+{
+    const char* directory = "journal";
+    UA_Boolean countOnly = false;
+    UA_Byte epc[RFU6xx_MAX_TAG_ID_SIZE];
+    RFU6xx_JournalQuery query;
+    Output output = { 0, 0 };
+    int opt;
+
+    memset(&query, 0, sizeof(query));
+    while ((opt = getopt(argc, argv, "D:f:t:e:n:o:l:c")) != -1)
+    {
+        switch (opt)
+        {
+            case 'D': directory = optarg; break;
+            case 'f': query.from = RFU6xx_Journal_parseTime(optarg); if (query.from == 0) opt = '?'; break;
+            case 't': query.to = RFU6xx_Journal_parseTime(optarg); if (query.to == 0) opt = '?'; break;
+            case 'e':
+                query.epcLength = (UA_UInt16) (strlen(optarg) / 2);
+                if (strlen(optarg) > 2*RFU6xx_MAX_TAG_ID_SIZE || hexDecode((const UA_Byte*) optarg, strlen(optarg), epc) != 0) opt = '?';
+                query.epc = epc;
+                break;
+            case 'n': query.filterDevice = true; query.deviceId = (UA_UInt32) strtoul(optarg, NULL, 10); break;
+            case 'o': query.operation = parseOperation(optarg); if (query.operation == 0) opt = '?'; break;
+            case 'l': output.limit = (UA_UInt64) strtoull(optarg, NULL, 10); break;
+            case 'c': countOnly = true; break;
+            default: opt = '?'; break;
+        }
+        if (opt == '?')
+        {
+            fprintf(stderr, "Usage: %s [-D directory] [-f from] [-t to] [-e EPC] [-n device] "
+                "[-o scan|readTag|writeTag|startScan|stopScan] [-l limit] [-c]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    RFU6xx_JournalReader* reader = RFU6xx_JournalReader_open(directory);
+    if (reader == NULL)
+    {
+        fprintf(stderr, "Can not read the journal in %s\n", directory);
+        return EXIT_FAILURE;
+    }
+    UA_UInt64 found = RFU6xx_JournalReader_query(reader, &query, countOnly ? NULL : printRecord, &output);
+    if (countOnly) printf("%llu\n", (unsigned long long) found);
+    RFU6xx_JournalReader_close(reader);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,399 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+*
+* @contact: sebastian.heidepriem@sick.de
+*/
+
+#include "RFU6xxMetrics.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+const char* RFU6xx_operationNames[RFU6xx_OPERATION_COUNT] = {
+    "init", "readDeviceStatus", "readLastScanData", "startScan", "stopScan",
+    "readTag", "writeTag", "readTagAsync", "writeTagAsync", "callTagOperations",
+    "readTagBytes", "writeTagBytes", "writeTagVerified"
+};
+
+// A device is only used by one thread at a time, so every counter has a single writer.
+// Plain relaxed load / store (no locked instruction) is enough, readers on other threads see whole values.
+#define COUNTER_LOAD(counter) __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+#define COUNTER_ADD(counter, value) __atomic_store_n(&(counter), COUNTER_LOAD(counter) + (value), __ATOMIC_RELAXED)
+
+// Upper bounds (le) of the exported Prometheus histogram buckets in seconds
+static const double exportBucketBounds[] = {
+    0.00001, 0.00002, 0.00005, 0.0001, 0.0002, 0.0005, 0.001, 0.002, 0.005,
+    0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1, 2, 5, 10
+};
+#define EXPORT_BUCKETS (sizeof(exportBucketBounds) / sizeof(exportBucketBounds[0]))
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+static size_t bucketIndex (uint64_t latencyNs)
+{
+    if (latencyNs < RFU6xx_HISTOGRAM_SUB_BUCKETS) return (size_t) latencyNs;
+
+    int msb = 63 - __builtin_clzll(latencyNs);
+    if (msb >= RFU6xx_HISTOGRAM_MAX_BITS) return RFU6xx_HISTOGRAM_BUCKETS - 1;
+
+    int shift = msb - RFU6xx_HISTOGRAM_SUB_BUCKET_BITS;
+    return (size_t) (shift + 1) * RFU6xx_HISTOGRAM_SUB_BUCKETS + ((latencyNs >> shift) & (RFU6xx_HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+// Largest latency that falls into a bucket
+static uint64_t bucketUpperBound (size_t index)
+{
+    if (index < RFU6xx_HISTOGRAM_SUB_BUCKETS) return index;
+
+    int shift = (int) (index / RFU6xx_HISTOGRAM_SUB_BUCKETS) - 1;
+    uint64_t lower = (uint64_t) (RFU6xx_HISTOGRAM_SUB_BUCKETS + index % RFU6xx_HISTOGRAM_SUB_BUCKETS) << shift;
+    return lower + ((uint64_t) 1 << shift) - 1;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+void RFU6xx_Metrics_countResponse (RFU6xx_Metrics* metrics, UA_StatusCode status, RFU6xx_StatusCode serverResponseCode,
+    size_t bytesSent, size_t bytesReceived)
+{
+    if (metrics == NULL) return;
+
+    // Open addressing on the status code, a slot is taken once its count is set
+    size_t slot = (status ^ (status >> 16)) % RFU6xx_METRICS_UA_STATUS_CODES;
+    size_t probes;
+    for (probes = 0; probes < RFU6xx_METRICS_UA_STATUS_CODES; probes++)
+    {
+        RFU6xx_StatusCodeCounter* counter = &metrics->uaStatusCodes[slot];
+        if (COUNTER_LOAD(counter->count) == 0)
+        {
+            counter->code = status;
+            __atomic_store_n(&counter->count, 1, __ATOMIC_RELEASE);
+            break;
+        }
+        if (counter->code == status)
+        {
+            COUNTER_ADD(counter->count, 1);
+            break;
+        }
+        slot = (slot + 1) % RFU6xx_METRICS_UA_STATUS_CODES;
+    }
+    if (probes == RFU6xx_METRICS_UA_STATUS_CODES) COUNTER_ADD(metrics->uaStatusCodesOther, 1);
+
+    if (serverResponseCode >= RFU6xx_METRICS_SERVER_RESPONSE_CODES) serverResponseCode = RFU6xx_METRICS_SERVER_RESPONSE_CODES - 1;
+    COUNTER_ADD(metrics->serverResponseCodes[serverResponseCode], 1);
+    COUNTER_ADD(metrics->bytesSent, bytesSent);
+    COUNTER_ADD(metrics->bytesReceived, bytesReceived);
+}
+
+void RFU6xx_Metrics_record (RFU6xx_Metrics* metrics, RFU6xx_Operation operation, uint64_t latencyNs,
+    UA_StatusCode status, RFU6xx_StatusCode serverResponseCode, size_t bytesSent, size_t bytesReceived)
+{
+    if (metrics == NULL) return;
+
+    RFU6xx_OperationMetrics* op = &metrics->operations[operation];
+    COUNTER_ADD(op->calls, 1);
+    if (status != UA_STATUSCODE_GOOD || serverResponseCode != RFU6xx_STATUSCODE_SUCCESS) COUNTER_ADD(op->errors, 1);
+    COUNTER_ADD(op->latencySumNs, latencyNs);
+    COUNTER_ADD(op->buckets[bucketIndex(latencyNs)], 1);
+    RFU6xx_Metrics_countResponse(metrics, status, serverResponseCode, bytesSent, bytesReceived);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+void RFU6xx_Metrics_snapshot (RFU6xx_Device* device, RFU6xx_Metrics* snapshot)
+{
+    memset(snapshot, 0, sizeof(RFU6xx_Metrics));
+    RFU6xx_Metrics* metrics = device->metrics;
+    if (metrics == NULL) return;
+
+    for (size_t o = 0; o < RFU6xx_OPERATION_COUNT; o++)
+    {
+        snapshot->operations[o].calls = COUNTER_LOAD(metrics->operations[o].calls);
+        snapshot->operations[o].errors = COUNTER_LOAD(metrics->operations[o].errors);
+        snapshot->operations[o].latencySumNs = COUNTER_LOAD(metrics->operations[o].latencySumNs);
+        for (size_t b = 0; b < RFU6xx_HISTOGRAM_BUCKETS; b++)
+        {
+            snapshot->operations[o].buckets[b] = COUNTER_LOAD(metrics->operations[o].buckets[b]);
+        }
+    }
+    for (size_t i = 0; i < RFU6xx_METRICS_UA_STATUS_CODES; i++)
+    {
+        snapshot->uaStatusCodes[i].count = __atomic_load_n(&metrics->uaStatusCodes[i].count, __ATOMIC_ACQUIRE);
+        snapshot->uaStatusCodes[i].code = metrics->uaStatusCodes[i].code;
+    }
+    snapshot->uaStatusCodesOther = COUNTER_LOAD(metrics->uaStatusCodesOther);
+    for (size_t i = 0; i < RFU6xx_METRICS_SERVER_RESPONSE_CODES; i++)
+    {
+        snapshot->serverResponseCodes[i] = COUNTER_LOAD(metrics->serverResponseCodes[i]);
+    }
+    snapshot->bytesSent = COUNTER_LOAD(metrics->bytesSent);
+    snapshot->bytesReceived = COUNTER_LOAD(metrics->bytesReceived);
+}
+
+uint64_t RFU6xx_Metrics_percentile (const RFU6xx_OperationMetrics* operation, double percentile)
+{
+    uint64_t total = 0;
+    for (size_t b = 0; b < RFU6xx_HISTOGRAM_BUCKETS; b++) total += operation->buckets[b];
+    if (total == 0) return 0;
+
+    uint64_t rank = (uint64_t) (percentile * total + 0.5);
+    if (rank == 0) rank = 1;
+    uint64_t count = 0;
+    for (size_t b = 0; b < RFU6xx_HISTOGRAM_BUCKETS; b++)
+    {
+        count += operation->buckets[b];
+        if (count >= rank) return bucketUpperBound(b);
+    }
+    return bucketUpperBound(RFU6xx_HISTOGRAM_BUCKETS - 1);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+static void writeLabel (FILE* out, const char* value)
+{
+    for (; *value != '\0'; value++)
+    {
+        if (*value == '"' || *value == '\\') fputc('\\', out);
+        fputc(*value, out);
+    }
+}
+
+int RFU6xx_Metrics_writePrometheus (RFU6xx_Device* devices[], size_t devicesSize, FILE* out)
+{
+    RFU6xx_Metrics* snapshot = (RFU6xx_Metrics*) UA_malloc(sizeof(RFU6xx_Metrics));
+    if (snapshot == NULL) return -1;
+
+    fprintf(out, "# HELP rfu6xx_operation_duration_seconds Latency of the client operations.\n");
+    fprintf(out, "# TYPE rfu6xx_operation_duration_seconds histogram\n");
+    fprintf(out, "# HELP rfu6xx_operation_errors_total Calls that returned a bad UA_StatusCode or RFU6xx_StatusCode.\n");
+    fprintf(out, "# TYPE rfu6xx_operation_errors_total counter\n");
+    fprintf(out, "# HELP rfu6xx_ua_status_total Results of the client operations by UA_StatusCode.\n");
+    fprintf(out, "# TYPE rfu6xx_ua_status_total counter\n");
+    fprintf(out, "# HELP rfu6xx_server_response_total Status codes returned by the RFU6xx server.\n");
+    fprintf(out, "# TYPE rfu6xx_server_response_total counter\n");
+    fprintf(out, "# HELP rfu6xx_payload_bytes_total Tag ids, tag data and scan data sent and received.\n");
+    fprintf(out, "# TYPE rfu6xx_payload_bytes_total counter\n");
+
+    for (size_t d = 0; d < devicesSize; d++)
+    {
+        RFU6xx_Metrics_snapshot(devices[d], snapshot);
+
+        for (size_t o = 0; o < RFU6xx_OPERATION_COUNT; o++)
+        {
+            RFU6xx_OperationMetrics* op = &snapshot->operations[o];
+            if (op->calls == 0) continue;
+
+            // The fine buckets are folded into the coarse export buckets
+            uint64_t cumulative = 0;
+            size_t b = 0;
+            for (size_t e = 0; e < EXPORT_BUCKETS; e++)
+            {
+                uint64_t boundNs = (uint64_t) (exportBucketBounds[e] * 1e9);
+                for (; b < RFU6xx_HISTOGRAM_BUCKETS && bucketUpperBound(b) <= boundNs; b++) cumulative += op->buckets[b];
+
+                fprintf(out, "rfu6xx_operation_duration_seconds_bucket{endpoint=\"");
+                writeLabel(out, devices[d]->endpointUrl);
+                fprintf(out, "\",operation=\"%s\",le=\"%g\"} %llu\n", RFU6xx_operationNames[o], exportBucketBounds[e],
+                    (unsigned long long) cumulative);
+            }
+            fprintf(out, "rfu6xx_operation_duration_seconds_bucket{endpoint=\"");
+            writeLabel(out, devices[d]->endpointUrl);
+            fprintf(out, "\",operation=\"%s\",le=\"+Inf\"} %llu\n", RFU6xx_operationNames[o], (unsigned long long) op->calls);
+
+            fprintf(out, "rfu6xx_operation_duration_seconds_sum{endpoint=\"");
+            writeLabel(out, devices[d]->endpointUrl);
+            fprintf(out, "\",operation=\"%s\"} %.9f\n", RFU6xx_operationNames[o], op->latencySumNs / 1e9);
+
+            fprintf(out, "rfu6xx_operation_duration_seconds_count{endpoint=\"");
+            writeLabel(out, devices[d]->endpointUrl);
+            fprintf(out, "\",operation=\"%s\"} %llu\n", RFU6xx_operationNames[o], (unsigned long long) op->calls);
+
+            fprintf(out, "rfu6xx_operation_errors_total{endpoint=\"");
+            writeLabel(out, devices[d]->endpointUrl);
+            fprintf(out, "\",operation=\"%s\"} %llu\n", RFU6xx_operationNames[o], (unsigned long long) op->errors);
+        }
+
+        for (size_t i = 0; i < RFU6xx_METRICS_UA_STATUS_CODES; i++)
+        {
+            if (snapshot->uaStatusCodes[i].count == 0) continue;
+            fprintf(out, "rfu6xx_ua_status_total{endpoint=\"");
+            writeLabel(out, devices[d]->endpointUrl);
+            fprintf(out, "\",code=\"%s\"} %llu\n", UA_StatusCode_name(snapshot->uaStatusCodes[i].code),
+                (unsigned long long) snapshot->uaStatusCodes[i].count);
+        }
+        if (snapshot->uaStatusCodesOther > 0)
+        {
+            fprintf(out, "rfu6xx_ua_status_total{endpoint=\"");
+            writeLabel(out, devices[d]->endpointUrl);
+            fprintf(out, "\",code=\"other\"} %llu\n", (unsigned long long) snapshot->uaStatusCodesOther);
+        }
+
+        for (size_t i = 0; i < RFU6xx_METRICS_SERVER_RESPONSE_CODES; i++)
+        {
+            if (snapshot->serverResponseCodes[i] == 0) continue;
+            fprintf(out, "rfu6xx_server_response_total{endpoint=\"");
+            writeLabel(out, devices[d]->endpointUrl);
+            fprintf(out, "\",code=\"%zu\"} %llu\n", i, (unsigned long long) snapshot->serverResponseCodes[i]);
+        }
+
+        fprintf(out, "rfu6xx_payload_bytes_total{endpoint=\"");
+        writeLabel(out, devices[d]->endpointUrl);
+        fprintf(out, "\",direction=\"sent\"} %llu\n", (unsigned long long) snapshot->bytesSent);
+        fprintf(out, "rfu6xx_payload_bytes_total{endpoint=\"");
+        writeLabel(out, devices[d]->endpointUrl);
+        fprintf(out, "\",direction=\"received\"} %llu\n", (unsigned long long) snapshot->bytesReceived);
+    }
+    UA_free(snapshot);
+    return ferror(out) ? -1 : 0;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+struct RFU6xx_MetricsExporter {
+    RFU6xx_Device** devices;
+    size_t devicesSize;
+    char* target;
+    UA_UInt32 intervalMs;
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wakeUp;
+    UA_Boolean stop;
+};
+
+static int exportToSocket (RFU6xx_MetricsExporter* exporter, const char* path)
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) return -1;
+    strcpy(address.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr*) &address, sizeof(address)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    FILE* out = fdopen(fd, "w");
+    if (out == NULL)
+    {
+        close(fd);
+        return -1;
+    }
+    int result = RFU6xx_Metrics_writePrometheus(exporter->devices, exporter->devicesSize, out);
+    if (fclose(out) != 0) result = -1;
+    return result;
+}
+
+// The file is written next to the target and renamed, so readers never see a partial file
+static int exportToFile (RFU6xx_MetricsExporter* exporter)
+{
+    size_t pathLength = strlen(exporter->target);
+    char tmpPath[pathLength + sizeof(".tmp")];
+    memcpy(tmpPath, exporter->target, pathLength);
+    memcpy(&tmpPath[pathLength], ".tmp", sizeof(".tmp"));
+
+    FILE* out = fopen(tmpPath, "w");
+    if (out == NULL) return -1;
+    int result = RFU6xx_Metrics_writePrometheus(exporter->devices, exporter->devicesSize, out);
+    if (fclose(out) != 0) result = -1;
+    if (result == 0 && rename(tmpPath, exporter->target) != 0) result = -1;
+    if (result != 0) remove(tmpPath);
+    return result;
+}
+
+static void exportMetrics (RFU6xx_MetricsExporter* exporter)
+{
+    int result;
+    if (strncmp(exporter->target, "unix:", 5) == 0) result = exportToSocket(exporter, &exporter->target[5]);
+    else result = exportToFile(exporter);
+
+    if (result != 0)
+    {
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Could not export metrics to %s", exporter->target);
+    }
+}
+
+static void* exporterThread (void* arg)
+{
+    RFU6xx_MetricsExporter* exporter = (RFU6xx_MetricsExporter*) arg;
+
+    pthread_mutex_lock(&exporter->mutex);
+    while (!exporter->stop)
+    {
+        struct timespec wakeUpTime;
+        clock_gettime(CLOCK_REALTIME, &wakeUpTime);
+        wakeUpTime.tv_sec += exporter->intervalMs / 1000;
+        wakeUpTime.tv_nsec += (long) (exporter->intervalMs % 1000) * 1000000;
+        if (wakeUpTime.tv_nsec >= 1000000000)
+        {
+            wakeUpTime.tv_sec++;
+            wakeUpTime.tv_nsec -= 1000000000;
+        }
+        while (!exporter->stop && pthread_cond_timedwait(&exporter->wakeUp, &exporter->mutex, &wakeUpTime) == 0);
+
+        pthread_mutex_unlock(&exporter->mutex);
+        exportMetrics(exporter);
+        pthread_mutex_lock(&exporter->mutex);
+    }
+    pthread_mutex_unlock(&exporter->mutex);
+    return NULL;
+}
+
+RFU6xx_MetricsExporter* RFU6xx_MetricsExporter_start (RFU6xx_Device* devices[], size_t devicesSize,
+    const char* target, UA_UInt32 intervalMs)
+{
+    RFU6xx_MetricsExporter* exporter = (RFU6xx_MetricsExporter*) UA_calloc(1, sizeof(RFU6xx_MetricsExporter));
+    if (exporter == NULL) return NULL;
+
+    exporter->devices = (RFU6xx_Device**) UA_malloc((devicesSize ? devicesSize : 1) * sizeof(RFU6xx_Device*));
+    exporter->target = (char*) UA_malloc(strlen(target) + 1);
+    if (exporter->devices == NULL || exporter->target == NULL)
+    {
+        UA_free(exporter->devices);
+        UA_free(exporter->target);
+        UA_free(exporter);
+        return NULL;
+    }
+    if (devicesSize > 0) memcpy(exporter->devices, devices, devicesSize * sizeof(RFU6xx_Device*));
+    exporter->devicesSize = devicesSize;
+    strcpy(exporter->target, target);
+    exporter->intervalMs = intervalMs > 0 ? intervalMs : 1000;
+
+    pthread_mutex_init(&exporter->mutex, NULL);
+    pthread_cond_init(&exporter->wakeUp, NULL);
+    if (pthread_create(&exporter->thread, NULL, exporterThread, exporter) != 0)
+    {
+        pthread_cond_destroy(&exporter->wakeUp);
+        pthread_mutex_destroy(&exporter->mutex);
+        UA_free(exporter->devices);
+        UA_free(exporter->target);
+        UA_free(exporter);
+        return NULL;
+    }
+    return exporter;
+}
+
+void RFU6xx_MetricsExporter_stop (RFU6xx_MetricsExporter* exporter)
+{
+    if (exporter == NULL) return;
+
+    pthread_mutex_lock(&exporter->mutex);
+    exporter->stop = true;
+    pthread_cond_signal(&exporter->wakeUp);
+    pthread_mutex_unlock(&exporter->mutex);
+    pthread_join(exporter->thread, NULL);
+
+    pthread_cond_destroy(&exporter->wakeUp);
+    pthread_mutex_destroy(&exporter->mutex);
+    UA_free(exporter->devices);
+    UA_free(exporter->target);
+    UA_free(exporter);
+}
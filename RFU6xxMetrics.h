@@ -0,0 +1,214 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+* @contact: sebastian.heidepriem@sick.de
+*
+* Instrumentation of the client operations: latency histograms, call and error counters,
+* counters per UA_StatusCode and RFU6xx_StatusCode and the tag payload bytes of each device.
+* Recording costs two clock reads and a few relaxed atomic adds. Compiled with
+* -DRFU6xx_METRICS_DISABLED the recording macros expand to nothing.
+*/
+
+#ifndef RFU6xxMETRICS_H
+#define RFU6xxMETRICS_H
+
+    #include "RFU6xxClient.h"
+
+    #include <stdint.h>
+    #include <time.h>
+
+    // Log-linear histogram (HDR style): 16 sub buckets per power of two, relative error < 6.25 %, range up to 2^40 ns
+    #define RFU6xx_HISTOGRAM_SUB_BUCKET_BITS 4
+    #define RFU6xx_HISTOGRAM_SUB_BUCKETS (1 << RFU6xx_HISTOGRAM_SUB_BUCKET_BITS)
+    #define RFU6xx_HISTOGRAM_MAX_BITS 40
+    #define RFU6xx_HISTOGRAM_BUCKETS ((RFU6xx_HISTOGRAM_MAX_BITS - RFU6xx_HISTOGRAM_SUB_BUCKET_BITS + 1) * RFU6xx_HISTOGRAM_SUB_BUCKETS)
+
+    // Number of distinct UA_StatusCodes counted per device, further codes are counted as "other"
+    #define RFU6xx_METRICS_UA_STATUS_CODES 32
+
+    // RFU6xx_StatusCodes >= this value are counted in the last counter
+    #define RFU6xx_METRICS_SERVER_RESPONSE_CODES 32
+
+    typedef enum {
+        RFU6xx_OPERATION_INIT,
+        RFU6xx_OPERATION_READ_DEVICE_STATUS,
+        RFU6xx_OPERATION_READ_LAST_SCAN_DATA,
+        RFU6xx_OPERATION_START_SCAN,
+        RFU6xx_OPERATION_STOP_SCAN,
+        RFU6xx_OPERATION_READ_TAG,
+        RFU6xx_OPERATION_WRITE_TAG,
+        RFU6xx_OPERATION_READ_TAG_ASYNC,
+        RFU6xx_OPERATION_WRITE_TAG_ASYNC,
+        RFU6xx_OPERATION_CALL_TAG_OPERATIONS,
+        RFU6xx_OPERATION_READ_TAG_BYTES,
+        RFU6xx_OPERATION_WRITE_TAG_BYTES,
+        RFU6xx_OPERATION_WRITE_TAG_VERIFIED,
+        RFU6xx_OPERATION_COUNT
+    } RFU6xx_Operation;
+
+    typedef struct {
+        uint64_t calls;
+        uint64_t errors;                            // Calls with a bad UA_StatusCode or RFU6xx_StatusCode
+        uint64_t latencySumNs;
+        uint64_t buckets[RFU6xx_HISTOGRAM_BUCKETS];
+    } RFU6xx_OperationMetrics;
+
+    typedef struct {
+        UA_StatusCode code;
+        uint64_t count;                             // 0 == slot is free
+    } RFU6xx_StatusCodeCounter;
+
+    /*
+    * Struct:  RFU6xx_Metrics
+    * --------------------
+    * Metrics of one device. The live instance is updated with relaxed atomics,
+    * RFU6xx_Metrics_snapshot copies it into a caller owned instance.
+    */
+    typedef struct RFU6xx_Metrics {
+        RFU6xx_OperationMetrics operations[RFU6xx_OPERATION_COUNT];
+        RFU6xx_StatusCodeCounter uaStatusCodes[RFU6xx_METRICS_UA_STATUS_CODES];
+        uint64_t uaStatusCodesOther;
+        uint64_t serverResponseCodes[RFU6xx_METRICS_SERVER_RESPONSE_CODES];
+        uint64_t bytesSent;                         // Tag ids and write data
+        uint64_t bytesReceived;                     // Read data and scan data
+    } RFU6xx_Metrics;
+
+    typedef struct RFU6xx_MetricsExporter RFU6xx_MetricsExporter;
+
+    extern const char* RFU6xx_operationNames[RFU6xx_OPERATION_COUNT];
+
+    static inline uint64_t RFU6xx_Metrics_now (void)
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+    }
+
+    #ifndef RFU6xx_METRICS_DISABLED
+        #define RFU6xx_METRICS_NOW() RFU6xx_Metrics_now()
+        #define RFU6xx_METRICS_START(var) uint64_t var = RFU6xx_Metrics_now()
+        #define RFU6xx_METRICS_RECORD(device, operation, start, status, serverResponseCode, sent, received) \
+            RFU6xx_Metrics_record((device)->metrics, operation, RFU6xx_Metrics_now() - (start), status, serverResponseCode, sent, received)
+        #define RFU6xx_METRICS_COUNT_RESPONSE(device, status, serverResponseCode, sent, received) \
+            RFU6xx_Metrics_countResponse((device)->metrics, status, serverResponseCode, sent, received)
+    #else
+        #define RFU6xx_METRICS_NOW() 0
+        #define RFU6xx_METRICS_START(var)
+        #define RFU6xx_METRICS_RECORD(device, operation, start, status, serverResponseCode, sent, received)
+        #define RFU6xx_METRICS_COUNT_RESPONSE(device, status, serverResponseCode, sent, received)
+    #endif
+
+    /*
+    * Function:  RFU6xx_Metrics_record
+    * --------------------
+    * Records one call of an operation: latency, call / error counters, status codes and payload bytes.
+    * Used through RFU6xx_METRICS_RECORD by the client functions.
+    *
+    *  parameters:
+    *               -> RFU6xx_Metrics* metrics                  /-> Nothing is recorded if NULL
+    *               -> RFU6xx_Operation operation
+    *               -> uint64_t latencyNs
+    *               -> UA_StatusCode status
+    *               -> RFU6xx_StatusCode serverResponseCode     /-> RFU6xx_STATUSCODE_SUCCESS if the operation has none
+    *               -> size_t bytesSent
+    *               -> size_t bytesReceived
+    *
+    *  returns:
+    */
+    void RFU6xx_Metrics_record (RFU6xx_Metrics* metrics, RFU6xx_Operation operation, uint64_t latencyNs,
+        UA_StatusCode status, RFU6xx_StatusCode serverResponseCode, size_t bytesSent, size_t bytesReceived);
+
+    /*
+    * Function:  RFU6xx_Metrics_countResponse
+    * --------------------
+    * Counts the status codes and payload bytes of one item of a batched call without a latency sample.
+    *
+    *  parameters:
+    *               -> RFU6xx_Metrics* metrics                  /-> Nothing is counted if NULL
+    *               -> UA_StatusCode status
+    *               -> RFU6xx_StatusCode serverResponseCode
+    *               -> size_t bytesSent
+    *               -> size_t bytesReceived
+    *
+    *  returns:
+    */
+    void RFU6xx_Metrics_countResponse (RFU6xx_Metrics* metrics, UA_StatusCode status, RFU6xx_StatusCode serverResponseCode,
+        size_t bytesSent, size_t bytesReceived);
+
+    /*
+    * Function:  RFU6xx_Metrics_snapshot
+    * --------------------
+    * Copies the metrics of a device. Can be called from any thread while the device is used.
+    *
+    *  parameters:
+    *               -> RFU6xx_Device* device
+    *               -> RFU6xx_Metrics* snapshot                 /-> Zeroed if metrics are compiled out
+    *
+    *  returns:
+    */
+    void RFU6xx_Metrics_snapshot (RFU6xx_Device* device, RFU6xx_Metrics* snapshot);
+
+    /*
+    * Function:  RFU6xx_Metrics_percentile
+    * --------------------
+    * Latency percentile of an operation (upper bound of the histogram bucket).
+    *
+    *  parameters:
+    *               -> const RFU6xx_OperationMetrics* operation /-> Operation of a snapshot
+    *               -> double percentile                        /-> 0.0 .. 1.0, e.g. 0.99
+    *
+    *  returns:
+    *               -> uint64_t                                 /-> Latency in ns, 0 if there are no calls
+    */
+    uint64_t RFU6xx_Metrics_percentile (const RFU6xx_OperationMetrics* operation, double percentile);
+
+    /*
+    * Function:  RFU6xx_Metrics_writePrometheus
+    * --------------------
+    * Writes the metrics of the devices in Prometheus text format, labeled with the endpoint url.
+    *
+    *  parameters:
+    *               -> RFU6xx_Device* devices[]
+    *               -> size_t devicesSize
+    *               -> FILE* out
+    *
+    *  returns:
+    *               -> int                                      /-> Errorcode -1 == write failed; 0 == everything's OK
+    */
+    int RFU6xx_Metrics_writePrometheus (RFU6xx_Device* devices[], size_t devicesSize, FILE* out);
+
+    /*
+    * Function:  RFU6xx_MetricsExporter_start
+    * --------------------
+    * Starts a thread that periodically writes the metrics of the devices in Prometheus text format.
+    * A target "unix:<path>" is a Unix stream socket the text is sent to on every interval,
+    * any other target is a file that is replaced atomically (e.g. for the node exporter textfile collector).
+    * The devices must stay alive until the exporter is stopped.
+    *
+    *  parameters:
+    *               -> RFU6xx_Device* devices[]                 /-> The array is copied
+    *               -> size_t devicesSize
+    *               -> const char* target                       /-> File path or unix:<socket path>
+    *               -> UA_UInt32 intervalMs
+    *
+    *  returns:
+    *               -> RFU6xx_MetricsExporter*                  /-> NULL if out of memory or the thread could not be started
+    */
+    RFU6xx_MetricsExporter* RFU6xx_MetricsExporter_start (RFU6xx_Device* devices[], size_t devicesSize,
+        const char* target, UA_UInt32 intervalMs);
+
+    /*
+    * Function:  RFU6xx_MetricsExporter_stop
+    * --------------------
+    * Writes the metrics a last time, stops the thread and frees the exporter.
+    *
+    *  parameters:
+    *               -> RFU6xx_MetricsExporter* exporter
+    *
+    *  returns:
+    */
+    void RFU6xx_MetricsExporter_stop (RFU6xx_MetricsExporter* exporter);
+
+#endif
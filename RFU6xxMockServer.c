@@ -0,0 +1,757 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+*
+* @contact: sebastian.heidepriem@sick.de
+*
+*
+* Mock of the RFU6xx OPC UA server for offline testing and benchmarking:
+*   1.) The namespaces of DI, AutoID and RFU6xx are registered (DI gets index 2 like on the device).
+*   2.) Objects/DeviceSet/RFU6xx is created with LastScanData, DeviceStatus,
+*       ScanStart, ScanStop, ReadTag and WriteTag.
+*   3.) A population of tags with EPC, TID and USER memory banks is simulated.
+*       While scanning, scan cycles run with the configured rate. Each cycle sees <tags per cycle> tags,
+*       fires a RfidScanEvent with all of them on the RFU6xx object (if open62541 was built with
+*       UA_ENABLE_SUBSCRIPTIONS_EVENTS) and writes the last one to LastScanData.
+*   4.) Every method call is answered after the configured latency and jitter. With async operations
+*       (open62541 built with UA_MULTITHREADING >= 100) the calls wait in a queue and the server keeps
+*       serving other calls meanwhile, otherwise the delay blocks the server thread.
+*       A WriteTag call fails with WRITE_ERROR with the configured probability before any byte is written.
+*       With -x ReadTag and WriteTag reject the code type argument RAW:BYTES (RAW:STRING only).
+*
+* Usage: ./mockserver [-p port] [-n tags] [-r cycles/s] [-b tags per cycle] [-l latency ms] [-j jitter ms]
+*                     [-u user bank bytes] [-m max bytes per read/write] [-w write error probability] [-s seed] [-x]
+*/
+
+#include "RFU6xxClient.h"
+#include "RFU6xxHex.h"
+#include <open62541/server.h>
+#include <open62541/server_config_default.h>
+#include <open62541/plugin/log_stdout.h>
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+// Node ids of the simulated address space
+#define MOCK_DEVICESET_ID 5001
+#define MOCK_RFU6XX_ID 6001
+#define MOCK_LASTSCANDATA_ID 6002
+#define MOCK_DEVICESTATUS_ID 6003
+#define MOCK_SCANSTART_ID 6004
+#define MOCK_SCANSTOP_ID 6005
+#define MOCK_READTAG_ID 6006
+#define MOCK_WRITETAG_ID 6007
+#define MOCK_AUTOIDSCANEVENTTYPE_ID 7001
+#define MOCK_RFIDSCANEVENTTYPE_ID 7002
+#define MOCK_SCANRESULT_ID 7003
+#define MOCK_RFIDSCANRESULT_ENCODING_ID 7004
+
+// Memory banks of a tag
+#define MOCK_BANK_RESERVED 0
+#define MOCK_BANK_EPC 1
+#define MOCK_BANK_TID 2
+#define MOCK_BANK_USER 3
+#define MOCK_BANK_COUNT 4
+
+#define MOCK_EPC_SIZE 12
+#define MOCK_TID_SIZE 12
+#define MOCK_RESERVED_SIZE 8
+
+// Encoded RfidScanResult: mask, CodeType "EPC", ScanDataEpc, timestamp and up to MOCK_MAX_SIGHTINGS sightings
+#define MOCK_MAX_SIGHTINGS 2
+#define MOCK_SCAN_RESULT_SIZE (4 + 4+3 + 4+2+4+MOCK_EPC_SIZE+4 + 8 + 4+20*MOCK_MAX_SIGHTINGS)
+
+typedef struct {
+    UA_Byte epc[MOCK_EPC_SIZE];
+    UA_Byte* banks[MOCK_BANK_COUNT];
+    size_t bankSizes[MOCK_BANK_COUNT];
+} MockTag;
+
+#if UA_MULTITHREADING >= 100
+// Method call taken from the async operation queue of the server, answered when it is due
+typedef struct {
+    const UA_AsyncOperationRequest* request;
+    void* context;
+    UA_DateTime due;                            // Monotonic
+} MockPendingCall;
+#endif
+
+typedef struct {
+    // Configuration
+    UA_UInt16 port;
+    size_t tagCount;
+    double tagRate;                             // Scan cycles per second while scanning
+    size_t tagsPerCycle;                        // Tags seen in each scan cycle
+    double latencyMs;                           // Delay of each method call
+    double jitterMs;                            // Additional uniform random delay 0..jitterMs
+    size_t userBankSize;
+    size_t maxTransferSize;                     // Larger reads / writes fail with READ_OUT_OF_RANGE
+    double writeErrorRate;                      // Probability 0..1 of a WRITE_ERROR per WriteTag call
+    UA_Boolean rawStringOnly;                   // Reject RAW:BYTES like firmware without binary transfers
+    uint64_t seed;
+
+    // State
+    UA_UInt16 nsDI;
+    UA_UInt16 nsAutoID;
+    UA_UInt16 nsRfu;
+    MockTag* tags;
+    RFU6xx_DeviceStatusCode deviceStatus;
+    UA_DateTime scanEnd;                        // 0 if the scan has no duration
+    uint64_t random;
+    UA_Boolean delayAsync;                      // Method calls are delayed by deliverDelayedCalls, not by blocking
+#if UA_MULTITHREADING >= 100
+    MockPendingCall* pending;                   // Queue of taken method calls in arrival order
+    size_t pendingHead;
+    size_t pendingSize;
+    size_t pendingCapacity;
+#endif
+} MockReader;
+
+static MockReader mock;
+static volatile UA_Boolean running = true;
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+static void stopHandler (int sig)
+{
+    running = false;
+}
+
+// xorshift64, deterministic for a given seed
+static uint64_t nextRandom (void)
+{
+    mock.random ^= mock.random << 13;
+    mock.random ^= mock.random >> 7;
+    mock.random ^= mock.random << 17;
+    return mock.random;
+}
+
+static double nextUniform (void)
+{
+    return (nextRandom() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double nextDelayMs (void)
+{
+    return mock.latencyMs + mock.jitterMs * nextUniform();
+}
+
+// Blocking delay of a method call, only used if the calls cannot be answered asynchronously
+static void simulateLatency (void)
+{
+    if (mock.delayAsync) return;
+    double delayMs = nextDelayMs();
+    if (delayMs > 0) usleep((useconds_t) (delayMs * 1000));
+}
+
+// RAW:BYTES transfers the data as plain bytes, every other code type as hex digits (RAW:STRING)
+static UA_Boolean isBinaryCodeType (const UA_Variant* codeType)
+{
+    static const UA_String rawBytes = { sizeof("RAW:BYTES") - 1, (UA_Byte*) "RAW:BYTES" };
+    return UA_Variant_hasScalarType(codeType, &UA_TYPES[UA_TYPES_STRING]) && UA_String_equal((const UA_String*) codeType->data, &rawBytes);
+}
+
+#if UA_MULTITHREADING >= 100
+static void answerCall (UA_Server* server, const UA_AsyncOperationRequest* request, void* context)
+{
+    UA_AsyncOperationResponse response;
+    const UA_CallMethodRequest* method = &request->callMethodRequest;
+    if (mock.rawStringOnly && method->inputArgumentsSize > 1 && isBinaryCodeType(&method->inputArguments[1]))
+    {
+        // Like firmware without RAW:BYTES: the code type argument is rejected and the method is not executed
+        UA_CallMethodResult_init(&response.callMethodResult);
+        response.callMethodResult.statusCode = UA_STATUSCODE_BADINVALIDARGUMENT;
+        response.callMethodResult.inputArgumentResults = (UA_StatusCode*) UA_Array_new(method->inputArgumentsSize, &UA_TYPES[UA_TYPES_STATUSCODE]);
+        if (response.callMethodResult.inputArgumentResults != NULL)
+        {
+            response.callMethodResult.inputArgumentResultsSize = method->inputArgumentsSize;
+            response.callMethodResult.inputArgumentResults[1] = UA_STATUSCODE_BADINVALIDARGUMENT;
+        }
+    }
+    else
+    {
+        response.callMethodResult = UA_Server_call(server, method);
+    }
+    UA_Server_setAsyncOperationResult(server, &response, context);
+    UA_CallMethodResult_clear(&response.callMethodResult);
+}
+
+static UA_Boolean queuePendingCall (const UA_AsyncOperationRequest* request, void* context, UA_DateTime due)
+{
+    if (mock.pendingSize == mock.pendingCapacity && mock.pendingHead > 0)
+    {
+        memmove(mock.pending, &mock.pending[mock.pendingHead], (mock.pendingSize - mock.pendingHead) * sizeof(MockPendingCall));
+        mock.pendingSize -= mock.pendingHead;
+        mock.pendingHead = 0;
+    }
+    if (mock.pendingSize == mock.pendingCapacity)
+    {
+        size_t capacity = mock.pendingCapacity ? 2 * mock.pendingCapacity : 64;
+        MockPendingCall* pending = (MockPendingCall*) UA_realloc(mock.pending, capacity * sizeof(MockPendingCall));
+        if (pending == NULL) return false;
+        mock.pending = pending;
+        mock.pendingCapacity = capacity;
+    }
+    MockPendingCall* call = &mock.pending[mock.pendingSize++];
+    call->request = request;
+    call->context = context;
+    call->due = due;
+    return true;
+}
+
+// Repeated callback: takes the new method calls of the server and answers the due ones. The arrival order
+// is kept like on the reader (a WriteTag before a ReadTag of the same request), so a due call waits for the
+// calls before it. The server answers a call request once all its method calls are answered.
+static void deliverDelayedCalls (UA_Server* server, void* data)
+{
+    UA_AsyncOperationType type;
+    const UA_AsyncOperationRequest* request;
+    void* context;
+    UA_DateTime timeout;
+    UA_DateTime now = UA_DateTime_nowMonotonic();
+
+    while (UA_Server_getAsyncOperationNonBlocking(server, &type, &request, &context, &timeout))
+    {
+        UA_DateTime due = now + (UA_DateTime) (nextDelayMs() * UA_DATETIME_MSEC);
+        if (!queuePendingCall(request, context, due)) answerCall(server, request, context);
+    }
+    while (mock.pendingHead < mock.pendingSize && mock.pending[mock.pendingHead].due <= now)
+    {
+        MockPendingCall* call = &mock.pending[mock.pendingHead++];
+        answerCall(server, call->request, call->context);
+    }
+    if (mock.pendingHead == mock.pendingSize) mock.pendingHead = mock.pendingSize = 0;
+}
+#endif
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+static UA_StatusCode createTags (void)
+{
+    mock.tags = (MockTag*) UA_calloc(mock.tagCount, sizeof(MockTag));
+    if (mock.tags == NULL) return UA_STATUSCODE_BADOUTOFMEMORY;
+
+    for (size_t i = 0; i < mock.tagCount; i++)
+    {
+        MockTag* tag = &mock.tags[i];
+        tag->bankSizes[MOCK_BANK_RESERVED] = MOCK_RESERVED_SIZE;
+        tag->bankSizes[MOCK_BANK_EPC] = MOCK_EPC_SIZE;
+        tag->bankSizes[MOCK_BANK_TID] = MOCK_TID_SIZE;
+        tag->bankSizes[MOCK_BANK_USER] = mock.userBankSize;
+        for (int b = 0; b < MOCK_BANK_COUNT; b++)
+        {
+            tag->banks[b] = (UA_Byte*) UA_calloc(tag->bankSizes[b] > 0 ? tag->bankSizes[b] : 1, 1);
+            if (tag->banks[b] == NULL) return UA_STATUSCODE_BADOUTOFMEMORY;
+        }
+
+        // Unique EPC: random prefix and the tag index, the TID is random
+        for (int b = 0; b < MOCK_EPC_SIZE; b++) tag->epc[b] = (UA_Byte) nextRandom();
+        tag->epc[MOCK_EPC_SIZE - 4] = (UA_Byte) (i >> 24);
+        tag->epc[MOCK_EPC_SIZE - 3] = (UA_Byte) (i >> 16);
+        tag->epc[MOCK_EPC_SIZE - 2] = (UA_Byte) (i >> 8);
+        tag->epc[MOCK_EPC_SIZE - 1] = (UA_Byte) i;
+        memcpy(tag->banks[MOCK_BANK_EPC], tag->epc, MOCK_EPC_SIZE);
+        for (int b = 0; b < MOCK_TID_SIZE; b++) tag->banks[MOCK_BANK_TID][b] = (UA_Byte) nextRandom();
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+static void deleteTags (void)
+{
+    if (mock.tags == NULL) return;
+    for (size_t i = 0; i < mock.tagCount; i++)
+    {
+        for (int b = 0; b < MOCK_BANK_COUNT; b++) UA_free(mock.tags[i].banks[b]);
+    }
+    UA_free(mock.tags);
+}
+
+// Finds the tag of a TagId extension object (int32 type, int32 length, id bytes)
+static MockTag* findTag (const UA_Variant* idVariant)
+{
+    if (!UA_Variant_hasScalarType(idVariant, &UA_TYPES[UA_TYPES_EXTENSIONOBJECT])) return NULL;
+    const UA_ExtensionObject* eo = (const UA_ExtensionObject*) idVariant->data;
+    if (eo->encoding != UA_EXTENSIONOBJECT_ENCODED_BYTESTRING) return NULL;
+
+    const UA_ByteString* body = &eo->content.encoded.body;
+    if (body->length < 2*sizeof(UA_Int32)) return NULL;
+    UA_UInt32 idLength = body->data[4] | (body->data[5] << 8) | (body->data[6] << 16) | ((UA_UInt32) body->data[7] << 24);
+    if (idLength != MOCK_EPC_SIZE || body->length < 2*sizeof(UA_Int32) + idLength) return NULL;
+
+    for (size_t i = 0; i < mock.tagCount; i++)
+    {
+        if (memcmp(mock.tags[i].epc, &body->data[8], MOCK_EPC_SIZE) == 0) return &mock.tags[i];
+    }
+    return NULL;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+static void setDeviceStatus (UA_Server* server, RFU6xx_DeviceStatusCode status)
+{
+    UA_Int32 value = (UA_Int32) status;
+    UA_Variant variant;
+    UA_Variant_setScalar(&variant, &value, &UA_TYPES[UA_TYPES_INT32]);
+    mock.deviceStatus = status;
+    UA_Server_writeValue(server, UA_NODEID_NUMERIC(mock.nsRfu, MOCK_DEVICESTATUS_ID), variant);
+}
+
+#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
+// Little endian as in the OPC UA binary encoding
+static UA_Byte* put32 (UA_Byte* p, UA_UInt32 value)
+{
+    for (int i = 0; i < 4; i++) *p++ = (UA_Byte) (value >> (8*i));
+    return p;
+}
+
+static UA_Byte* put64 (UA_Byte* p, UA_Int64 value)
+{
+    for (int i = 0; i < 8; i++) *p++ = (UA_Byte) ((UA_UInt64) value >> (8*i));
+    return p;
+}
+
+// RfidScanResult of a tag as ScanDataEpc with one or two sightings, returns the encoded length
+static size_t encodeScanResult (const MockTag* tag, UA_DateTime timestamp, UA_Byte* buffer)
+{
+    UA_Byte* p = buffer;
+    p = put32(p, 0);                                            // Encoding mask: no location
+    p = put32(p, 3);                                            // CodeType
+    memcpy(p, "EPC", 3);
+    p += 3;
+    p = put32(p, 3);                                            // ScanData: ScanDataEpc
+    *p++ = 0x00;                                                // PC: EPC length in words
+    *p++ = (MOCK_EPC_SIZE / 2) << 3;
+    p = put32(p, MOCK_EPC_SIZE);
+    memcpy(p, tag->epc, MOCK_EPC_SIZE);
+    p += MOCK_EPC_SIZE;
+    p = put32(p, 0);                                            // XPC_W1, XPC_W2
+    p = put64(p, timestamp);
+
+    UA_UInt32 sightings = 1 + (UA_UInt32) (nextRandom() % MOCK_MAX_SIGHTINGS);
+    p = put32(p, sightings);
+    for (UA_UInt32 i = 0; i < sightings; i++)
+    {
+        p = put32(p, 1 + (UA_UInt32) (nextRandom() % 4));      // Antenna
+        p = put32(p, (UA_UInt32) -(30 + (UA_Int32) (nextRandom() % 50)));   // Strength
+        p = put64(p, timestamp);
+        p = put32(p, 0);                                        // CurrentPowerLevel
+    }
+    return (size_t) (p - buffer);
+}
+
+// Fires a RfidScanEvent with count tags starting at tag index first
+static void triggerScanEvent (UA_Server* server, size_t first, size_t count)
+{
+    UA_Byte* buffer = (UA_Byte*) UA_malloc(count * MOCK_SCAN_RESULT_SIZE);
+    UA_ExtensionObject* eos = (UA_ExtensionObject*) UA_calloc(count, sizeof(UA_ExtensionObject));
+    UA_NodeId eventId;
+    if (buffer == NULL || eos == NULL
+        || UA_Server_createEvent(server, UA_NODEID_NUMERIC(mock.nsAutoID, MOCK_RFIDSCANEVENTTYPE_ID), &eventId) != UA_STATUSCODE_GOOD)
+    {
+        UA_free(buffer);
+        UA_free(eos);
+        return;
+    }
+
+    UA_DateTime now = UA_DateTime_now();
+    for (size_t i = 0; i < count; i++)
+    {
+        eos[i].encoding = UA_EXTENSIONOBJECT_ENCODED_BYTESTRING;
+        eos[i].content.encoded.typeId = UA_NODEID_NUMERIC(mock.nsAutoID, MOCK_RFIDSCANRESULT_ENCODING_ID);
+        eos[i].content.encoded.body.data = &buffer[i * MOCK_SCAN_RESULT_SIZE];
+        eos[i].content.encoded.body.length = encodeScanResult(&mock.tags[(first + i) % mock.tagCount], now,
+            eos[i].content.encoded.body.data);
+    }
+
+    // The properties are copied into the event
+    UA_Variant scanResult;
+    UA_Variant_setArray(&scanResult, eos, count, &UA_TYPES[UA_TYPES_EXTENSIONOBJECT]);
+    UA_UInt16 severity = 100;
+    UA_Server_writeObjectProperty(server, eventId, UA_QUALIFIEDNAME(mock.nsAutoID, "ScanResult"), scanResult);
+    UA_Server_writeObjectProperty_scalar(server, eventId, UA_QUALIFIEDNAME(0, "Time"), &now, &UA_TYPES[UA_TYPES_DATETIME]);
+    UA_Server_writeObjectProperty_scalar(server, eventId, UA_QUALIFIEDNAME(0, "Severity"), &severity, &UA_TYPES[UA_TYPES_UINT16]);
+    UA_Server_triggerEvent(server, eventId, UA_NODEID_NUMERIC(mock.nsRfu, MOCK_RFU6XX_ID), NULL, true);
+    UA_free(buffer);
+    UA_free(eos);
+}
+#endif
+
+// Repeated callback: one scan cycle while scanning
+static void scanTick (UA_Server* server, void* data)
+{
+    if (mock.deviceStatus != RFU6xx_DEVICESTATUSCODE_SCANNING) return;
+
+    if (mock.scanEnd != 0 && UA_DateTime_nowMonotonic() >= mock.scanEnd)
+    {
+        setDeviceStatus(server, RFU6xx_DEVICESTATUSCODE_IDLE);
+        return;
+    }
+
+    // The cycle sees consecutive tags from a random start, LastScanData only keeps the last one
+    size_t first = nextRandom() % mock.tagCount;
+#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
+    triggerScanEvent(server, first, mock.tagsPerCycle);
+#endif
+    MockTag* tag = &mock.tags[(first + mock.tagsPerCycle - 1) % mock.tagCount];
+    UA_Byte hex[2*MOCK_EPC_SIZE];
+    hexEncode(tag->epc, MOCK_EPC_SIZE, hex, 1);
+
+    UA_String lastScanData = { sizeof(hex), hex };
+    UA_Variant variant;
+    UA_Variant_setScalar(&variant, &lastScanData, &UA_TYPES[UA_TYPES_STRING]);
+    UA_Server_writeValue(server, UA_NODEID_NUMERIC(mock.nsRfu, MOCK_LASTSCANDATA_ID), variant);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+static UA_StatusCode scanStartMethod (UA_Server* server, const UA_NodeId* sessionId, void* sessionContext,
+    const UA_NodeId* methodId, void* methodContext, const UA_NodeId* objectId, void* objectContext,
+    size_t inputSize, const UA_Variant* input, size_t outputSize, UA_Variant* output)
+{
+    simulateLatency();
+    if (mock.deviceStatus != RFU6xx_DEVICESTATUSCODE_IDLE) return UA_STATUSCODE_BADINVALIDSTATE;
+
+    // ScanSettings: int32 cycles, double duration (ms), int32 cycle, bool dataAvailable
+    mock.scanEnd = 0;
+    if (inputSize == 1 && UA_Variant_hasScalarType(&input[0], &UA_TYPES[UA_TYPES_EXTENSIONOBJECT]))
+    {
+        const UA_ExtensionObject* eo = (const UA_ExtensionObject*) input[0].data;
+        if (eo->encoding == UA_EXTENSIONOBJECT_ENCODED_BYTESTRING && eo->content.encoded.body.length >= 12)
+        {
+            UA_Double duration;
+            memcpy(&duration, &eo->content.encoded.body.data[4], sizeof(duration));
+            if (duration > 0) mock.scanEnd = UA_DateTime_nowMonotonic() + (UA_DateTime) (duration * UA_DATETIME_MSEC);
+        }
+    }
+    setDeviceStatus(server, RFU6xx_DEVICESTATUSCODE_SCANNING);
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode scanStopMethod (UA_Server* server, const UA_NodeId* sessionId, void* sessionContext,
+    const UA_NodeId* methodId, void* methodContext, const UA_NodeId* objectId, void* objectContext,
+    size_t inputSize, const UA_Variant* input, size_t outputSize, UA_Variant* output)
+{
+    simulateLatency();
+    if (mock.deviceStatus != RFU6xx_DEVICESTATUSCODE_SCANNING) return UA_STATUSCODE_BADINVALIDSTATE;
+    setDeviceStatus(server, RFU6xx_DEVICESTATUSCODE_IDLE);
+    return UA_STATUSCODE_GOOD;
+}
+
+// Checks bank, offset and length of a ReadTag / WriteTag call
+static RFU6xx_StatusCode checkRegion (MockTag* tag, UA_Int16 bank, UA_Int32 offset, size_t length)
+{
+    if (tag == NULL) return RFU6xx_STATUSCODE_REGION_NOT_FOUND;
+    if (bank < 0 || bank >= MOCK_BANK_COUNT) return RFU6xx_STATUSCODE_REGION_NOT_FOUND;
+    if (length > mock.maxTransferSize) return RFU6xx_STATUSCODE_READ_OUT_OF_RANGE;
+    if (offset < 0 || (size_t) offset + length > tag->bankSizes[bank]) return RFU6xx_STATUSCODE_READ_OUT_OF_RANGE;
+    return RFU6xx_STATUSCODE_SUCCESS;
+}
+
+static UA_StatusCode readTagMethod (UA_Server* server, const UA_NodeId* sessionId, void* sessionContext,
+    const UA_NodeId* methodId, void* methodContext, const UA_NodeId* objectId, void* objectContext,
+    size_t inputSize, const UA_Variant* input, size_t outputSize, UA_Variant* output)
+{
+    simulateLatency();
+    if (inputSize != RFU6xx_TAG_CALL_PARAMS_SIZE || outputSize != 2
+        || !UA_Variant_hasScalarType(&input[2], &UA_TYPES[UA_TYPES_INT16])
+        || !UA_Variant_hasScalarType(&input[3], &UA_TYPES[UA_TYPES_INT32])
+        || !UA_Variant_hasScalarType(&input[4], &UA_TYPES[UA_TYPES_INT32]))
+    {
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    }
+    MockTag* tag = findTag(&input[0]);
+    UA_Int16 bank = *(UA_Int16*) input[2].data;
+    UA_Int32 offset = *(UA_Int32*) input[3].data;
+    UA_Int32 length = *(UA_Int32*) input[4].data;
+
+    UA_Boolean binary = isBinaryCodeType(&input[1]);
+    if (binary && mock.rawStringOnly) return UA_STATUSCODE_BADINVALIDARGUMENT;
+
+    UA_ByteString data = UA_STRING_NULL;
+    RFU6xx_StatusCode status = (length < 0) ? RFU6xx_STATUSCODE_READ_OUT_OF_RANGE : checkRegion(tag, bank, offset, (size_t) length);
+    if (status == RFU6xx_STATUSCODE_SUCCESS && length > 0)
+    {
+        // RAW:STRING returns the data as hex digits, RAW:BYTES as bytes
+        if (UA_ByteString_allocBuffer(&data, (binary ? 1 : 2) * (size_t) length) != UA_STATUSCODE_GOOD) return UA_STATUSCODE_BADOUTOFMEMORY;
+        if (binary) memcpy(data.data, &tag->banks[bank][offset], (size_t) length);
+        else hexEncode(&tag->banks[bank][offset], (size_t) length, data.data, 1);
+    }
+
+    UA_Int32 statusValue = (UA_Int32) status;
+    UA_Variant_setScalarCopy(&output[0], &data, &UA_TYPES[UA_TYPES_BYTESTRING]);
+    UA_Variant_setScalarCopy(&output[1], &statusValue, &UA_TYPES[UA_TYPES_INT32]);
+    UA_ByteString_clear(&data);
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode writeTagMethod (UA_Server* server, const UA_NodeId* sessionId, void* sessionContext,
+    const UA_NodeId* methodId, void* methodContext, const UA_NodeId* objectId, void* objectContext,
+    size_t inputSize, const UA_Variant* input, size_t outputSize, UA_Variant* output)
+{
+    simulateLatency();
+    if (inputSize != RFU6xx_TAG_CALL_PARAMS_SIZE || outputSize != 1
+        || !UA_Variant_hasScalarType(&input[2], &UA_TYPES[UA_TYPES_INT16])
+        || !UA_Variant_hasScalarType(&input[3], &UA_TYPES[UA_TYPES_INT32])
+        || !(UA_Variant_hasScalarType(&input[4], &UA_TYPES[UA_TYPES_STRING]) 
+            || UA_Variant_hasScalarType(&input[4], &UA_TYPES[UA_TYPES_BYTESTRING])))
+    {
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    }
+    MockTag* tag = findTag(&input[0]);
+    UA_Int16 bank = *(UA_Int16*) input[2].data;
+    UA_Int32 offset = *(UA_Int32*) input[3].data;
+    const UA_String* data = (const UA_String*) input[4].data;
+    UA_Boolean binary = isBinaryCodeType(&input[1]);
+    if (binary && mock.rawStringOnly) return UA_STATUSCODE_BADINVALIDARGUMENT;
+
+    RFU6xx_StatusCode status = checkRegion(tag, bank, offset, binary ? data->length : data->length / 2);
+    if (status == RFU6xx_STATUSCODE_SUCCESS && bank == MOCK_BANK_TID) status = RFU6xx_STATUSCODE_WRITE_ERROR;
+    if (status == RFU6xx_STATUSCODE_SUCCESS && mock.writeErrorRate > 0 && nextUniform() < mock.writeErrorRate)
+    {
+        status = RFU6xx_STATUSCODE_WRITE_ERROR;
+    }
+    if (status == RFU6xx_STATUSCODE_SUCCESS && binary)
+    {
+        if (data->length > 0) memcpy(&tag->banks[bank][offset], data->data, data->length);
+    }
+    else if (status == RFU6xx_STATUSCODE_SUCCESS && hexDecode(data->data, data->length, &tag->banks[bank][offset]) != 0)
+    {
+        status = RFU6xx_STATUSCODE_WRITE_ERROR;
+    }
+
+    UA_Int32 statusValue = (UA_Int32) status;
+    UA_Variant_setScalarCopy(&output[0], &statusValue, &UA_TYPES[UA_TYPES_INT32]);
+    return UA_STATUSCODE_GOOD;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+static UA_Argument argument (char* name, UA_UInt32 dataTypeId)
+{
+    UA_Argument arg;
+    UA_Argument_init(&arg);
+    arg.name = UA_STRING(name);
+    arg.dataType = UA_NODEID_NUMERIC(0, dataTypeId);
+    arg.valueRank = UA_VALUERANK_SCALAR;
+    return arg;
+}
+
+static UA_StatusCode addMethod (UA_Server* server, UA_UInt32 id, char* name, UA_MethodCallback callback,
+    size_t inputSize, const UA_Argument* input, size_t outputSize, const UA_Argument* output)
+{
+    UA_MethodAttributes attr = UA_MethodAttributes_default;
+    attr.displayName = UA_LOCALIZEDTEXT("en-US", name);
+    attr.executable = true;
+    attr.userExecutable = true;
+    return UA_Server_addMethodNode(server, UA_NODEID_NUMERIC(mock.nsRfu, id),
+        UA_NODEID_NUMERIC(mock.nsRfu, MOCK_RFU6XX_ID), UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+        UA_QUALIFIEDNAME(mock.nsAutoID, name), attr, callback, inputSize, input, outputSize, output, NULL, NULL);
+}
+
+static UA_StatusCode addVariable (UA_Server* server, UA_UInt32 id, char* name, void* value, const UA_DataType* type)
+{
+    UA_VariableAttributes attr = UA_VariableAttributes_default;
+    attr.displayName = UA_LOCALIZEDTEXT("en-US", name);
+    attr.accessLevel = UA_ACCESSLEVELMASK_READ;
+    attr.dataType = type->typeId;
+    UA_Variant_setScalar(&attr.value, value, type);
+    return UA_Server_addVariableNode(server, UA_NODEID_NUMERIC(mock.nsRfu, id),
+        UA_NODEID_NUMERIC(mock.nsRfu, MOCK_RFU6XX_ID), UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+        UA_QUALIFIEDNAME(mock.nsAutoID, name), UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE), attr, NULL, NULL);
+}
+
+#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
+// BaseEventType/AutoIdScanEventType/RfidScanEventType with the ScanResult property
+static UA_StatusCode createScanEventType (UA_Server* server)
+{
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+
+    UA_ObjectTypeAttributes typeAttr = UA_ObjectTypeAttributes_default;
+    typeAttr.displayName = UA_LOCALIZEDTEXT("en-US", "AutoIdScanEventType");
+    typeAttr.isAbstract = true;
+    retval |= UA_Server_addObjectTypeNode(server, UA_NODEID_NUMERIC(mock.nsAutoID, MOCK_AUTOIDSCANEVENTTYPE_ID),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_BASEEVENTTYPE), UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE),
+        UA_QUALIFIEDNAME(mock.nsAutoID, "AutoIdScanEventType"), typeAttr, NULL, NULL);
+    typeAttr.displayName = UA_LOCALIZEDTEXT("en-US", "RfidScanEventType");
+    typeAttr.isAbstract = false;
+    retval |= UA_Server_addObjectTypeNode(server, UA_NODEID_NUMERIC(mock.nsAutoID, MOCK_RFIDSCANEVENTTYPE_ID),
+        UA_NODEID_NUMERIC(mock.nsAutoID, MOCK_AUTOIDSCANEVENTTYPE_ID), UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE),
+        UA_QUALIFIEDNAME(mock.nsAutoID, "RfidScanEventType"), typeAttr, NULL, NULL);
+
+    // Array of RfidScanResult, mandatory so that every event gets it. BaseDataType like the method arguments.
+    UA_VariableAttributes scanResultAttr = UA_VariableAttributes_default;
+    scanResultAttr.displayName = UA_LOCALIZEDTEXT("en-US", "ScanResult");
+    scanResultAttr.dataType = UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATATYPE);
+    scanResultAttr.valueRank = UA_VALUERANK_ONE_DIMENSION;
+    retval |= UA_Server_addVariableNode(server, UA_NODEID_NUMERIC(mock.nsAutoID, MOCK_SCANRESULT_ID),
+        UA_NODEID_NUMERIC(mock.nsAutoID, MOCK_RFIDSCANEVENTTYPE_ID), UA_NODEID_NUMERIC(0, UA_NS0ID_HASPROPERTY),
+        UA_QUALIFIEDNAME(mock.nsAutoID, "ScanResult"), UA_NODEID_NUMERIC(0, UA_NS0ID_PROPERTYTYPE), scanResultAttr, NULL, NULL);
+    retval |= UA_Server_addReference(server, UA_NODEID_NUMERIC(mock.nsAutoID, MOCK_SCANRESULT_ID),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_HASMODELLINGRULE), UA_EXPANDEDNODEID_NUMERIC(0, UA_NS0ID_MODELLINGRULE_MANDATORY), true);
+    return retval;
+}
+#endif
+
+static UA_StatusCode createAddressSpace (UA_Server* server)
+{
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+
+    // DI is registered first, the client expects DeviceSet in namespace 2
+    mock.nsDI = UA_Server_addNamespace(server, "http://opcfoundation.org/UA/DI/");
+    mock.nsAutoID = UA_Server_addNamespace(server, "http://opcfoundation.org/UA/AutoID/");
+    mock.nsRfu = UA_Server_addNamespace(server, "http://www.sick.com/RFU6xx/");
+
+    UA_ObjectAttributes deviceSetAttr = UA_ObjectAttributes_default;
+    deviceSetAttr.displayName = UA_LOCALIZEDTEXT("en-US", "DeviceSet");
+    retval |= UA_Server_addObjectNode(server, UA_NODEID_NUMERIC(mock.nsDI, MOCK_DEVICESET_ID),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER), UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+        UA_QUALIFIEDNAME(mock.nsDI, "DeviceSet"), UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE), deviceSetAttr, NULL, NULL);
+
+    UA_ObjectAttributes rfuAttr = UA_ObjectAttributes_default;
+    rfuAttr.displayName = UA_LOCALIZEDTEXT("en-US", "RFU6xx");
+#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
+    rfuAttr.eventNotifier = UA_EVENTNOTIFIER_SUBSCRIBE_TO_EVENT;
+    retval |= createScanEventType(server);
+#endif
+    retval |= UA_Server_addObjectNode(server, UA_NODEID_NUMERIC(mock.nsRfu, MOCK_RFU6XX_ID),
+        UA_NODEID_NUMERIC(mock.nsDI, MOCK_DEVICESET_ID), UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+        UA_QUALIFIEDNAME(mock.nsRfu, "RFU6xx"), UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE), rfuAttr, NULL, NULL);
+
+    UA_String lastScanData = UA_STRING("");
+    UA_Int32 deviceStatus = RFU6xx_DEVICESTATUSCODE_IDLE;
+    retval |= addVariable(server, MOCK_LASTSCANDATA_ID, "LastScanData", &lastScanData, &UA_TYPES[UA_TYPES_STRING]);
+    retval |= addVariable(server, MOCK_DEVICESTATUS_ID, "DeviceStatus", &deviceStatus, &UA_TYPES[UA_TYPES_INT32]);
+
+    // The structures of the AutoID extension objects are not known to the server, BaseDataType (i=24) accepts them.
+    // Data is also BaseDataType, it is a String for RAW:STRING and a ByteString for RAW:BYTES
+    UA_Argument scanStartInput[1] = { argument("Settings", 24) };
+    UA_Argument readTagInput[RFU6xx_TAG_CALL_PARAMS_SIZE] = { argument("Identifier", 24), argument("CodeType", 12),
+        argument("Region", 4), argument("Offset", 6), argument("Length", 6), argument("Password", 12) };
+    UA_Argument readTagOutput[2] = { argument("ResultData", 15), argument("Status", 6) };
+    UA_Argument writeTagInput[RFU6xx_TAG_CALL_PARAMS_SIZE] = { argument("Identifier", 24), argument("CodeType", 12),
+        argument("Region", 4), argument("Offset", 6), argument("Data", 24), argument("Password", 12) };
+    UA_Argument writeTagOutput[1] = { argument("Status", 6) };
+
+    retval |= addMethod(server, MOCK_SCANSTART_ID, "ScanStart", scanStartMethod, 1, scanStartInput, 0, NULL);
+    retval |= addMethod(server, MOCK_SCANSTOP_ID, "ScanStop", scanStopMethod, 0, NULL, 0, NULL);
+    retval |= addMethod(server, MOCK_READTAG_ID, "ReadTag", readTagMethod,
+        RFU6xx_TAG_CALL_PARAMS_SIZE, readTagInput, 2, readTagOutput);
+    retval |= addMethod(server, MOCK_WRITETAG_ID, "WriteTag", writeTagMethod,
+        RFU6xx_TAG_CALL_PARAMS_SIZE, writeTagInput, 1, writeTagOutput);
+
+#if UA_MULTITHREADING >= 100
+    // The methods are only queued by the server, deliverDelayedCalls answers them
+    if (mock.delayAsync)
+    {
+        UA_UInt32 methodIds[] = { MOCK_SCANSTART_ID, MOCK_SCANSTOP_ID, MOCK_READTAG_ID, MOCK_WRITETAG_ID };
+        for (size_t i = 0; i < sizeof(methodIds) / sizeof(methodIds[0]); i++)
+        {
+            retval |= UA_Server_setMethodNodeAsync(server, UA_NODEID_NUMERIC(mock.nsRfu, methodIds[i]), true);
+        }
+    }
+#endif
+    return retval;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+int main (int argc, char *argv[])
+{
+    int opt;
+
+    mock.port = 4840;
+    mock.tagCount = 100;
+    mock.tagRate = 50;
+    mock.tagsPerCycle = 1;
+    mock.latencyMs = 0;
+    mock.jitterMs = 0;
+    mock.userBankSize = 8192;
+    mock.maxTransferSize = 512;
+    mock.writeErrorRate = 0;
+    mock.rawStringOnly = false;
+    mock.seed = 1;
+
+    while ((opt = getopt(argc, argv, "p:n:r:b:l:j:u:m:w:s:x")) != -1)
+    {
+        switch (opt)
+        {
+            case 'p': mock.port = (UA_UInt16) atoi(optarg); break;
+            case 'n': mock.tagCount = (size_t) atol(optarg); break;
+            case 'r': mock.tagRate = atof(optarg); break;
+            case 'b': mock.tagsPerCycle = (size_t) atol(optarg); break;
+            case 'l': mock.latencyMs = atof(optarg); break;
+            case 'j': mock.jitterMs = atof(optarg); break;
+            case 'u': mock.userBankSize = (size_t) atol(optarg); break;
+            case 'm': mock.maxTransferSize = (size_t) atol(optarg); break;
+            case 'w': mock.writeErrorRate = atof(optarg); break;
+            case 's': mock.seed = (uint64_t) atoll(optarg); break;
+            case 'x': mock.rawStringOnly = true; break;
+            default:
+                fprintf(stderr, "Usage: %s [-p port] [-n tags] [-r cycles/s] [-b tags per cycle] [-l latency ms] [-j jitter ms] "
+                    "[-u user bank bytes] [-m max bytes per read/write] [-w write error probability] [-s seed] [-x]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (mock.tagCount == 0 || mock.tagRate <= 0 || mock.tagsPerCycle == 0 || mock.tagsPerCycle > mock.tagCount
+        || mock.writeErrorRate < 0 || mock.writeErrorRate > 1)
+    {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND,
+            "At least one tag, a positive cycle rate, 1..tags tags per cycle and a write error probability of 0..1 are needed.");
+        return EXIT_FAILURE;
+    }
+    mock.random = mock.seed * 0x9E3779B97F4A7C15ULL + 1;
+    mock.deviceStatus = RFU6xx_DEVICESTATUSCODE_IDLE;
+
+    signal(SIGINT, stopHandler);
+    signal(SIGTERM, stopHandler);
+
+    UA_Server* server = UA_Server_new();
+    UA_ServerConfig_setMinimal(UA_Server_getConfig(server), mock.port, NULL);
+
+    // Without async operations every delayed call blocks the only server thread
+#if UA_MULTITHREADING >= 100
+    // -x answers the rejected calls itself (with the input argument results), so it also needs the queue
+    mock.delayAsync = mock.latencyMs > 0 || mock.jitterMs > 0 || mock.rawStringOnly;
+#else
+    if (mock.latencyMs > 0 || mock.jitterMs > 0)
+    {
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, 
+            "open62541 was built without async operations (UA_MULTITHREADING < 100), method calls are delayed one after another");
+    }
+    if (mock.rawStringOnly)
+    {
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, 
+            "open62541 was built without async operations (UA_MULTITHREADING < 100), RAW:BYTES is rejected without input argument results");
+    }
+#endif
+
+    UA_StatusCode retval = createTags();
+    if (retval == UA_STATUSCODE_GOOD) retval = createAddressSpace(server);
+    if (retval == UA_STATUSCODE_GOOD) retval = UA_Server_addRepeatedCallback(server, scanTick, NULL, 1000.0 / mock.tagRate, NULL);
+#if UA_MULTITHREADING >= 100
+    if (retval == UA_STATUSCODE_GOOD && mock.delayAsync) retval = UA_Server_addRepeatedCallback(server, deliverDelayedCalls, NULL, 1, NULL);
+#endif
+    if (retval != UA_STATUSCODE_GOOD)
+    {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Mock server setup failed. ErrorCode: %x", retval);
+        UA_Server_delete(server);
+        deleteTags();
+        return EXIT_FAILURE;
+    }
+
+    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Mock RFU6xx with %zu tags, %.1f cycles/s of %zu tags, latency %.1f ms + %.1f ms jitter",
+        mock.tagCount, mock.tagRate, mock.tagsPerCycle, mock.latencyMs, mock.jitterMs);
+    retval = UA_Server_run(server, &running);
+
+    UA_Server_delete(server);
+    deleteTags();
+#if UA_MULTITHREADING >= 100
+    UA_free(mock.pending);
+#endif
+    return retval == UA_STATUSCODE_GOOD ? EXIT_SUCCESS : EXIT_FAILURE;
+}
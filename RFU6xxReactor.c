@@ -0,0 +1,378 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+*
+* @contact: sebastian.heidepriem@sick.de
+*/
+
+#include "RFU6xxReactor.h"
+
+#include <errno.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+typedef enum {
+    SOURCE_FD,
+    SOURCE_TIMER,
+    SOURCE_DEVICE,
+    SOURCE_WAKEUP
+} SourceType;
+
+// Everything that is registered in epoll. Removed sources are freed after the dispatch,
+// so events of the same epoll_wait that refer to them can still be skipped safely.
+typedef struct Source {
+    SourceType type;
+    int fd;                                     // Application fd, timerfd (timers, devices) or eventfd (wakeup)
+    UA_Boolean removed;
+    void* context;
+
+    // SOURCE_FD
+    RFU6xx_ReactorFdCallback fdCallback;
+
+    // SOURCE_TIMER
+    RFU6xx_ReactorTimerCallback timerCallback;
+    UA_UInt64 timerId;
+    UA_Boolean repeated;
+
+    // SOURCE_DEVICE
+    RFU6xx_Device* device;
+    UA_UInt32 idleInterval;
+    UA_UInt32 armedInterval;                    // Current period of the timerfd in ms
+    UA_StatusCode lastStatus;
+
+    struct Source* next;
+} Source;
+
+struct RFU6xx_Reactor {
+    int epollFd;
+    Source wakeup;
+    UA_Boolean stop;
+
+    Source* sources;
+    Source* removed;
+    UA_UInt64 nextTimerId;
+
+    RFU6xx_ReactorStats stats;
+};
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+static int setTimer (int fd, UA_UInt32 intervalMs, UA_Boolean repeated)
+{
+    struct itimerspec spec;
+    spec.it_value.tv_sec = intervalMs / 1000;
+    spec.it_value.tv_nsec = (long) (intervalMs % 1000) * 1000000L;
+    if (intervalMs == 0) spec.it_value.tv_nsec = 1;     // 0 would disarm the timer
+    spec.it_interval = repeated ? spec.it_value : (struct timespec) { 0, 0 };
+    return timerfd_settime(fd, 0, &spec, NULL);
+}
+
+static void armDevice (Source* source, UA_UInt32 intervalMs)
+{
+    if (source->armedInterval == intervalMs) return;
+    if (setTimer(source->fd, intervalMs, true) == 0) source->armedInterval = intervalMs;
+}
+
+static UA_StatusCode addSource (RFU6xx_Reactor* reactor, Source* source, UA_UInt32 events)
+{
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.ptr = source;
+    if (epoll_ctl(reactor->epollFd, EPOLL_CTL_ADD, source->fd, &event) != 0)
+    {
+        return errno == EEXIST ? UA_STATUSCODE_BADINVALIDARGUMENT : UA_STATUSCODE_BADINTERNALERROR;
+    }
+    source->next = reactor->sources;
+    reactor->sources = source;
+    return UA_STATUSCODE_GOOD;
+}
+
+static void removeSource (RFU6xx_Reactor* reactor, Source* source)
+{
+    epoll_ctl(reactor->epollFd, EPOLL_CTL_DEL, source->fd, NULL);
+    if (source->type != SOURCE_FD) close(source->fd);
+    source->removed = true;
+
+    Source** link = &reactor->sources;
+    while (*link != source) link = &(*link)->next;
+    *link = source->next;
+    source->next = reactor->removed;
+    reactor->removed = source;
+}
+
+static Source* findSource (RFU6xx_Reactor* reactor, SourceType type, int fd, RFU6xx_Device* device, UA_UInt64 timerId)
+{
+    for (Source* source = reactor->sources; source != NULL; source = source->next)
+    {
+        if (source->type != type) continue;
+        if (type == SOURCE_FD && source->fd == fd) return source;
+        if (type == SOURCE_DEVICE && source->device == device) return source;
+        if (type == SOURCE_TIMER && source->timerId == timerId) return source;
+    }
+    return NULL;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+RFU6xx_Reactor* RFU6xx_Reactor_new (void)
+{
+    RFU6xx_Reactor* reactor = (RFU6xx_Reactor*) UA_calloc(1, sizeof(RFU6xx_Reactor));
+    if (reactor == NULL) return NULL;
+
+    reactor->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    reactor->wakeup.type = SOURCE_WAKEUP;
+    reactor->wakeup.fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    reactor->nextTimerId = 1;
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = &reactor->wakeup;
+    if (reactor->epollFd < 0 || reactor->wakeup.fd < 0 || epoll_ctl(reactor->epollFd, EPOLL_CTL_ADD, reactor->wakeup.fd, &event) != 0)
+    {
+        if (reactor->epollFd >= 0) close(reactor->epollFd);
+        if (reactor->wakeup.fd >= 0) close(reactor->wakeup.fd);
+        UA_free(reactor);
+        return NULL;
+    }
+    return reactor;
+}
+
+static void freeRemoved (RFU6xx_Reactor* reactor)
+{
+    while (reactor->removed != NULL)
+    {
+        Source* source = reactor->removed;
+        reactor->removed = source->next;
+        UA_free(source);
+    }
+}
+
+void RFU6xx_Reactor_delete (RFU6xx_Reactor* reactor)
+{
+    if (reactor == NULL) return;
+    while (reactor->sources != NULL) removeSource(reactor, reactor->sources);
+    freeRemoved(reactor);
+    close(reactor->wakeup.fd);
+    close(reactor->epollFd);
+    UA_free(reactor);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+UA_StatusCode RFU6xx_Reactor_addDevice (RFU6xx_Reactor* reactor, RFU6xx_Device* device, UA_UInt32 idleIntervalMs)
+{
+    if (findSource(reactor, SOURCE_DEVICE, -1, device, 0) != NULL) return UA_STATUSCODE_BADINVALIDARGUMENT;
+
+    Source* source = (Source*) UA_calloc(1, sizeof(Source));
+    if (source == NULL) return UA_STATUSCODE_BADOUTOFMEMORY;
+    source->type = SOURCE_DEVICE;
+    source->device = device;
+    source->idleInterval = idleIntervalMs ? idleIntervalMs : RFU6xx_REACTOR_DEFAULT_IDLE_INTERVAL;
+    source->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (source->fd < 0)
+    {
+        UA_free(source);
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+
+    armDevice(source, device->inFlightCalls > 0 ? RFU6xx_REACTOR_ACTIVE_INTERVAL : source->idleInterval);
+    UA_StatusCode retval = addSource(reactor, source, EPOLLIN);
+    if (retval != UA_STATUSCODE_GOOD)
+    {
+        close(source->fd);
+        UA_free(source);
+    }
+    return retval;
+}
+
+UA_StatusCode RFU6xx_Reactor_removeDevice (RFU6xx_Reactor* reactor, RFU6xx_Device* device)
+{
+    Source* source = findSource(reactor, SOURCE_DEVICE, -1, device, 0);
+    if (source == NULL) return UA_STATUSCODE_BADNOTFOUND;
+    removeSource(reactor, source);
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode RFU6xx_Reactor_addFd (RFU6xx_Reactor* reactor, int fd, UA_UInt32 events, RFU6xx_ReactorFdCallback callback, void* context)
+{
+    if (fd < 0 || callback == NULL) return UA_STATUSCODE_BADINVALIDARGUMENT;
+
+    Source* source = (Source*) UA_calloc(1, sizeof(Source));
+    if (source == NULL) return UA_STATUSCODE_BADOUTOFMEMORY;
+    source->type = SOURCE_FD;
+    source->fd = fd;
+    source->fdCallback = callback;
+    source->context = context;
+
+    UA_StatusCode retval = addSource(reactor, source, events);
+    if (retval != UA_STATUSCODE_GOOD) UA_free(source);
+    return retval;
+}
+
+UA_StatusCode RFU6xx_Reactor_modifyFd (RFU6xx_Reactor* reactor, int fd, UA_UInt32 events)
+{
+    Source* source = findSource(reactor, SOURCE_FD, fd, NULL, 0);
+    if (source == NULL) return UA_STATUSCODE_BADNOTFOUND;
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.ptr = source;
+    return epoll_ctl(reactor->epollFd, EPOLL_CTL_MOD, fd, &event) == 0 ? UA_STATUSCODE_GOOD : UA_STATUSCODE_BADINTERNALERROR;
+}
+
+UA_StatusCode RFU6xx_Reactor_removeFd (RFU6xx_Reactor* reactor, int fd)
+{
+    Source* source = findSource(reactor, SOURCE_FD, fd, NULL, 0);
+    if (source == NULL) return UA_STATUSCODE_BADNOTFOUND;
+    removeSource(reactor, source);
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode RFU6xx_Reactor_addTimer (RFU6xx_Reactor* reactor, UA_UInt32 intervalMs, UA_Boolean repeated,
+    RFU6xx_ReactorTimerCallback callback, void* context, UA_UInt64* timerId)
+{
+    if (callback == NULL) return UA_STATUSCODE_BADINVALIDARGUMENT;
+
+    Source* source = (Source*) UA_calloc(1, sizeof(Source));
+    if (source == NULL) return UA_STATUSCODE_BADOUTOFMEMORY;
+    source->type = SOURCE_TIMER;
+    source->timerCallback = callback;
+    source->context = context;
+    source->repeated = repeated;
+    source->timerId = reactor->nextTimerId++;
+    source->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (source->fd < 0 || setTimer(source->fd, intervalMs, repeated) != 0)
+    {
+        if (source->fd >= 0) close(source->fd);
+        UA_free(source);
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+
+    UA_StatusCode retval = addSource(reactor, source, EPOLLIN);
+    if (retval != UA_STATUSCODE_GOOD)
+    {
+        close(source->fd);
+        UA_free(source);
+        return retval;
+    }
+    if (timerId != NULL) *timerId = source->timerId;
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode RFU6xx_Reactor_removeTimer (RFU6xx_Reactor* reactor, UA_UInt64 timerId)
+{
+    Source* source = findSource(reactor, SOURCE_TIMER, -1, NULL, timerId);
+    if (source == NULL) return UA_STATUSCODE_BADNOTFOUND;
+    removeSource(reactor, source);
+    return UA_STATUSCODE_GOOD;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+static void dispatchDevice (RFU6xx_Reactor* reactor, Source* source)
+{
+    UA_UInt64 expirations;
+    if (read(source->fd, &expirations, sizeof(expirations)) != sizeof(expirations)) return;
+
+    // Receives the pending responses and publish notifications without waiting, their callbacks run here
+    UA_StatusCode retval = runIterate(source->device, 0);
+    reactor->stats.deviceIterations++;
+    if (retval != UA_STATUSCODE_GOOD)
+    {
+        reactor->stats.deviceErrors++;
+        if (source->lastStatus == UA_STATUSCODE_GOOD)
+        {
+            UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Reactor: %s failed with %s",
+                source->device->endpointUrl, UA_StatusCode_name(retval));
+        }
+    }
+    source->lastStatus = retval;
+
+    // A callback may have removed the device
+    if (!source->removed)
+    {
+        armDevice(source, source->device->inFlightCalls > 0 ? RFU6xx_REACTOR_ACTIVE_INTERVAL : source->idleInterval);
+    }
+}
+
+static void dispatchTimer (RFU6xx_Reactor* reactor, Source* source)
+{
+    UA_UInt64 expirations;
+    if (read(source->fd, &expirations, sizeof(expirations)) != sizeof(expirations)) return;
+
+    reactor->stats.timerEvents++;
+    source->timerCallback(reactor, source->timerId, expirations, source->context);
+    if (!source->repeated && !source->removed) removeSource(reactor, source);
+}
+
+UA_StatusCode RFU6xx_Reactor_runOnce (RFU6xx_Reactor* reactor, int timeoutMs)
+{
+    struct epoll_event events[RFU6xx_REACTOR_MAX_EVENTS];
+
+    // Calls started outside of the device dispatch (fd / timer callbacks, before the loop) need the active interval
+    for (Source* source = reactor->sources; source != NULL; source = source->next)
+    {
+        if (source->type == SOURCE_DEVICE && source->device->inFlightCalls > 0) armDevice(source, RFU6xx_REACTOR_ACTIVE_INTERVAL);
+    }
+
+    int count = epoll_wait(reactor->epollFd, events, RFU6xx_REACTOR_MAX_EVENTS, timeoutMs);
+    if (count < 0) return errno == EINTR ? UA_STATUSCODE_GOOD : UA_STATUSCODE_BADINTERNALERROR;
+    if (count > 0) reactor->stats.loops++;
+
+    for (int i = 0; i < count; i++)
+    {
+        Source* source = (Source*) events[i].data.ptr;
+        if (source->removed) continue;
+
+        switch (source->type)
+        {
+            case SOURCE_FD:
+                reactor->stats.fdEvents++;
+                source->fdCallback(reactor, source->fd, events[i].events, source->context);
+                break;
+            case SOURCE_TIMER:
+                dispatchTimer(reactor, source);
+                break;
+            case SOURCE_DEVICE:
+                dispatchDevice(reactor, source);
+                break;
+            case SOURCE_WAKEUP:
+            {
+                UA_UInt64 value;
+                while (read(source->fd, &value, sizeof(value)) == sizeof(value));
+                break;
+            }
+        }
+    }
+    freeRemoved(reactor);
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode RFU6xx_Reactor_run (RFU6xx_Reactor* reactor)
+{
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    while (retval == UA_STATUSCODE_GOOD && !__atomic_load_n(&reactor->stop, __ATOMIC_ACQUIRE))
+    {
+        retval = RFU6xx_Reactor_runOnce(reactor, -1);
+    }
+    __atomic_store_n(&reactor->stop, false, __ATOMIC_RELEASE);
+    return retval;
+}
+
+void RFU6xx_Reactor_stop (RFU6xx_Reactor* reactor)
+{
+    UA_UInt64 one = 1;
+    __atomic_store_n(&reactor->stop, true, __ATOMIC_RELEASE);
+    if (write(reactor->wakeup.fd, &one, sizeof(one)) != sizeof(one)) return;
+}
+
+void RFU6xx_Reactor_getStats (RFU6xx_Reactor* reactor, RFU6xx_ReactorStats* stats)
+{
+    *stats = reactor->stats;
+}
@@ -0,0 +1,247 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+* @contact: sebastian.heidepriem@sick.de
+*
+* Single-threaded event loop (epoll) for many RFU6xx devices and application file descriptors.
+* The reactor drives the UA_Client of every added device with non-blocking runIterate calls, so the
+* callbacks of readTagAsync / writeTagAsync / readTagBank / writeTagBank and of the subscriptions are
+* called from the loop. open62541 1.3 does not expose the socket of a client, therefore every device
+* has a timerfd: while calls are in flight it fires every RFU6xx_REACTOR_ACTIVE_INTERVAL ms, otherwise
+* every idle interval (which must be shorter than the publishing intervals of its subscriptions).
+* Application file descriptors and timers are dispatched from the same epoll_wait.
+* All functions except RFU6xx_Reactor_stop must be called from the thread running the loop
+* (or before it is started). The callbacks may add and remove sources.
+*/
+
+#ifndef RFU6xxREACTOR_H
+#define RFU6xxREACTOR_H
+
+    #include "RFU6xxClient.h"
+
+    #include <sys/epoll.h>
+
+    // Poll interval of a device with calls in flight in ms
+    #define RFU6xx_REACTOR_ACTIVE_INTERVAL 1
+    // Default poll interval of an idle device in ms
+    #define RFU6xx_REACTOR_DEFAULT_IDLE_INTERVAL 20
+    // Events handled per epoll_wait
+    #define RFU6xx_REACTOR_MAX_EVENTS 64
+
+    typedef struct RFU6xx_Reactor RFU6xx_Reactor;
+
+    /*
+    * Callback type for RFU6xx_Reactor_addFd
+    * --------------------
+    *
+    *  parameters:
+    *               -> RFU6xx_Reactor* reactor
+    *               -> int fd
+    *               -> UA_UInt32 events                         /-> EPOLLIN, EPOLLOUT, EPOLLERR, EPOLLHUP, ...
+    *               -> void* context                            /-> User context passed to RFU6xx_Reactor_addFd
+    */
+    typedef void (*RFU6xx_ReactorFdCallback)(RFU6xx_Reactor* reactor, int fd, UA_UInt32 events, void* context);
+
+    /*
+    * Callback type for RFU6xx_Reactor_addTimer
+    * --------------------
+    *
+    *  parameters:
+    *               -> RFU6xx_Reactor* reactor
+    *               -> UA_UInt64 timerId
+    *               -> UA_UInt64 expirations                    /-> > 1 if the loop was late
+    *               -> void* context                            /-> User context passed to RFU6xx_Reactor_addTimer
+    */
+    typedef void (*RFU6xx_ReactorTimerCallback)(RFU6xx_Reactor* reactor, UA_UInt64 timerId, UA_UInt64 expirations, void* context);
+
+    typedef struct {
+        UA_UInt64 loops;                            // epoll_wait calls that returned events
+        UA_UInt64 deviceIterations;                 // runIterate calls
+        UA_UInt64 deviceErrors;                     // runIterate calls that did not return UA_STATUSCODE_GOOD
+        UA_UInt64 fdEvents;
+        UA_UInt64 timerEvents;
+    } RFU6xx_ReactorStats;
+
+    /*
+    * Function:  RFU6xx_Reactor_new
+    * --------------------
+    *
+    *  returns:
+    *               -> RFU6xx_Reactor*                          /-> NULL if epoll could not be set up
+    */
+    RFU6xx_Reactor* RFU6xx_Reactor_new (void);
+
+    /*
+    * Function:  RFU6xx_Reactor_delete
+    * --------------------
+    * Removes all sources and frees the reactor. Devices and application file descriptors are not closed.
+    *
+    *  parameters:
+    *               -> RFU6xx_Reactor* reactor
+    *
+    *  returns:
+    */
+    void RFU6xx_Reactor_delete (RFU6xx_Reactor* reactor);
+
+    /*
+    * Function:  RFU6xx_Reactor_addDevice
+    * --------------------
+    * Drives a connected device from the loop. The device must not be used by other threads afterwards.
+    * A supervised device should use RFU6xx_RECONNECT_FAIL_FAST, with RFU6xx_RECONNECT_WAIT a lost
+    * connection blocks the loop for up to the wait timeout.
+    *
+    *  parameters:
+    *               -> RFU6xx_Reactor* reactor
+    *               -> RFU6xx_Device* device
+    *               -> UA_UInt32 idleIntervalMs                 /-> 0 == RFU6xx_REACTOR_DEFAULT_IDLE_INTERVAL
+    *
+    *  returns:
+    *               -> UA_StatusCode
+    */
+    UA_StatusCode RFU6xx_Reactor_addDevice (RFU6xx_Reactor* reactor, RFU6xx_Device* device, UA_UInt32 idleIntervalMs);
+
+    /*
+    * Function:  RFU6xx_Reactor_removeDevice
+    * --------------------
+    *
+    *  parameters:
+    *               -> RFU6xx_Reactor* reactor
+    *               -> RFU6xx_Device* device
+    *
+    *  returns:
+    *               -> UA_StatusCode                            /-> UA_STATUSCODE_BADNOTFOUND if the device was not added
+    */
+    UA_StatusCode RFU6xx_Reactor_removeDevice (RFU6xx_Reactor* reactor, RFU6xx_Device* device);
+
+    /*
+    * Function:  RFU6xx_Reactor_addFd
+    * --------------------
+    * Calls the callback when one of the events occurs on the file descriptor (level triggered).
+    *
+    *  parameters:
+    *               -> RFU6xx_Reactor* reactor
+    *               -> int fd
+    *               -> UA_UInt32 events                         /-> e.g. EPOLLIN
+    *               -> RFU6xx_ReactorFdCallback callback
+    *               -> void* context                            /-> User context passed to the callback
+    *
+    *  returns:
+    *               -> UA_StatusCode
+    */
+    UA_StatusCode RFU6xx_Reactor_addFd (RFU6xx_Reactor* reactor, int fd, UA_UInt32 events, RFU6xx_ReactorFdCallback callback, void* context);
+
+    /*
+    * Function:  RFU6xx_Reactor_modifyFd
+    * --------------------
+    * Changes the events of a file descriptor, e.g. to wait for EPOLLOUT while data is queued.
+    *
+    *  parameters:
+    *               -> RFU6xx_Reactor* reactor
+    *               -> int fd
+    *               -> UA_UInt32 events
+    *
+    *  returns:
+    *               -> UA_StatusCode                            /-> UA_STATUSCODE_BADNOTFOUND if the fd was not added
+    */
+    UA_StatusCode RFU6xx_Reactor_modifyFd (RFU6xx_Reactor* reactor, int fd, UA_UInt32 events);
+
+    /*
+    * Function:  RFU6xx_Reactor_removeFd
+    * --------------------
+    * Stops watching a file descriptor, remove it before closing it.
+    *
+    *  parameters:
+    *               -> RFU6xx_Reactor* reactor
+    *               -> int fd
+    *
+    *  returns:
+    *               -> UA_StatusCode                            /-> UA_STATUSCODE_BADNOTFOUND if the fd was not added
+    */
+    UA_StatusCode RFU6xx_Reactor_removeFd (RFU6xx_Reactor* reactor, int fd);
+
+    /*
+    * Function:  RFU6xx_Reactor_addTimer
+    * --------------------
+    *
+    *  parameters:
+    *               -> RFU6xx_Reactor* reactor
+    *               -> UA_UInt32 intervalMs                     /-> First expiration and period
+    *               -> UA_Boolean repeated                      /-> false == the timer is removed after the first expiration
+    *               -> RFU6xx_ReactorTimerCallback callback
+    *               -> void* context                            /-> User context passed to the callback
+    *               -> UA_UInt64* timerId                       /-> Id for RFU6xx_Reactor_removeTimer, may be NULL
+    *
+    *  returns:
+    *               -> UA_StatusCode
+    */
+    UA_StatusCode RFU6xx_Reactor_addTimer (RFU6xx_Reactor* reactor, UA_UInt32 intervalMs, UA_Boolean repeated,
+        RFU6xx_ReactorTimerCallback callback, void* context, UA_UInt64* timerId);
+
+    /*
+    * Function:  RFU6xx_Reactor_removeTimer
+    * --------------------
+    *
+    *  parameters:
+    *               -> RFU6xx_Reactor* reactor
+    *               -> UA_UInt64 timerId
+    *
+    *  returns:
+    *               -> UA_StatusCode                            /-> UA_STATUSCODE_BADNOTFOUND if the timer does not exist (any more)
+    */
+    UA_StatusCode RFU6xx_Reactor_removeTimer (RFU6xx_Reactor* reactor, UA_UInt64 timerId);
+
+    /*
+    * Function:  RFU6xx_Reactor_runOnce
+    * --------------------
+    * Waits for events and dispatches them. Devices whose calls were started by a callback
+    * are switched to the active interval before the next wait.
+    *
+    *  parameters:
+    *               -> RFU6xx_Reactor* reactor
+    *               -> int timeoutMs                            /-> -1 == wait until an event occurs
+    *
+    *  returns:
+    *               -> UA_StatusCode                            /-> UA_STATUSCODE_BADINTERNALERROR if epoll_wait failed
+    */
+    UA_StatusCode RFU6xx_Reactor_runOnce (RFU6xx_Reactor* reactor, int timeoutMs);
+
+    /*
+    * Function:  RFU6xx_Reactor_run
+    * --------------------
+    * Runs the loop until RFU6xx_Reactor_stop is called.
+    *
+    *  parameters:
+    *               -> RFU6xx_Reactor* reactor
+    *
+    *  returns:
+    *               -> UA_StatusCode
+    */
+    UA_StatusCode RFU6xx_Reactor_run (RFU6xx_Reactor* reactor);
+
+    /*
+    * Function:  RFU6xx_Reactor_stop
+    * --------------------
+    * Ends RFU6xx_Reactor_run after the current dispatch. Can be called from any thread or a signal handler.
+    *
+    *  parameters:
+    *               -> RFU6xx_Reactor* reactor
+    *
+    *  returns:
+    */
+    void RFU6xx_Reactor_stop (RFU6xx_Reactor* reactor);
+
+    /*
+    * Function:  RFU6xx_Reactor_getStats
+    * --------------------
+    *
+    *  parameters:
+    *               -> RFU6xx_Reactor* reactor
+    *               -> RFU6xx_ReactorStats* stats
+    *
+    *  returns:
+    */
+    void RFU6xx_Reactor_getStats (RFU6xx_Reactor* reactor, RFU6xx_ReactorStats* stats);
+
+#endif
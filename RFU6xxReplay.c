@@ -0,0 +1,521 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+*
+* @contact: sebastian.heidepriem@sick.de
+*
+*
+* Replay of recorded traffic from the scan journal (rfu6xx-replay):
+*   1.) The StartScan, StopScan, ReadTag and WriteTag records in the time range are loaded from the journal.
+*       Scan records are not replayed, the reader produces them itself.
+*   2.) Every recorded device is replayed by one session (recorded device id modulo <devices>,
+*       by default one session per recorded device up to 64).
+*   3.) Each operation is issued at its recorded time relative to the first one, divided by <speed>
+*       (1 == real-time, 10 == ten times faster, 0 == as fast as possible). WriteTag writes a pattern of the recorded length.
+*   4.) Target and achieved rate, the schedule lag (issue time - scheduled time) and the latency distribution
+*       per operation are printed and optionally written as JSON.
+* With -m the recorded EPCs are mapped onto tags seen by the server, so that a stand-in server with other tags
+* executes the tag operations instead of answering them with REGION_NOT_FOUND.
+*
+* Usage: ./rfu6xx-replay [-e endpoint] [-D journal directory] [-f from] [-t to] [-x speed] [-c devices]
+*                        [-o output.json] [-m] [-l]
+*   -l starts ./mockserver as local stand-in for the reader, replays against opc.tcp://localhost:4840 and implies -m.
+*/
+
+#include "RFU6xxClient.h"
+#include "RFU6xxDeviceManager.h"
+#include "RFU6xxHex.h"
+#include "RFU6xxJournal.h"
+#include <open62541/plugin/log_stdout.h>
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define REPLAY_MAX_SERVER_TAGS 256
+#define REPLAY_MAX_DEVICES 64
+#define REPLAY_DISCOVERY_TIME 2e9
+#define REPLAY_START_DELAY 100e6
+
+typedef enum {
+    REPLAY_START_SCAN,
+    REPLAY_STOP_SCAN,
+    REPLAY_READ_TAG,
+    REPLAY_WRITE_TAG,
+    REPLAY_OPERATIONS
+} ReplayOperation;
+
+static const char* replayOperationNames[REPLAY_OPERATIONS] = { "startScan", "stopScan", "readTag", "writeTag" };
+
+typedef struct {
+    double* values;
+    size_t size;
+    size_t capacity;
+} Samples;
+
+// Replay of the records of one device
+typedef struct {
+    const RFU6xx_JournalRecord** records;
+    size_t recordsSize;
+    size_t recordsCapacity;
+
+    Samples latencyUs[REPLAY_OPERATIONS];
+    Samples lagUs;
+    size_t failed[REPLAY_OPERATIONS];           // UA_StatusCode != GOOD
+    size_t rejected[REPLAY_OPERATIONS];         // RFU6xx_StatusCode != SUCCESS
+} ReplayDevice;
+
+typedef struct {
+    UA_DateTime firstTimestamp;
+    double startNs;
+    double speed;
+
+    // Tags of the server the recorded EPCs are mapped onto (hex ids), none == the recorded EPCs are used
+    UA_String serverTags[REPLAY_MAX_SERVER_TAGS];
+    size_t serverTagsSize;
+
+    UA_String writeData;                        // Hex pattern, as long as the longest recorded write
+} ReplayPlan;
+
+typedef struct {
+    ReplayPlan* plan;
+    ReplayDevice* device;
+} ReplayJob;
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+static double nowNs (void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void sleepUntil (double ns)
+{
+    struct timespec ts;
+    ts.tv_sec = (time_t) (ns / 1e9);
+    ts.tv_nsec = (long) (ns - ts.tv_sec * 1e9);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0);
+}
+
+static void addSample (Samples* samples, double value)
+{
+    if (samples->size == samples->capacity)
+    {
+        size_t capacity = samples->capacity ? 2*samples->capacity : 1024;
+        double* values = (double*) realloc(samples->values, capacity * sizeof(double));
+        if (values == NULL) return;
+        samples->values = values;
+        samples->capacity = capacity;
+    }
+    samples->values[samples->size++] = value;
+}
+
+static int compareDouble (const void* a, const void* b)
+{
+    double x = *(const double*) a, y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+static double percentile (const double* sorted, size_t size, double p)
+{
+    if (size == 0) return 0;
+    size_t index = (size_t) (p * (size - 1) + 0.5);
+    return sorted[index];
+}
+
+// Replayed operation of a record, -1 if it is not replayed
+static int replayOperation (const RFU6xx_JournalRecord* record)
+{
+    switch (record->operation)
+    {
+        case RFU6xx_JOURNAL_START_SCAN: return REPLAY_START_SCAN;
+        case RFU6xx_JOURNAL_STOP_SCAN: return REPLAY_STOP_SCAN;
+        case RFU6xx_JOURNAL_READ_TAG: return REPLAY_READ_TAG;
+        case RFU6xx_JOURNAL_WRITE_TAG: return REPLAY_WRITE_TAG;
+        default: return -1;
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+// Id of the tag the record is replayed on: the recorded EPC or a server tag chosen by the EPC hash
+static UA_String tagIdOf (const ReplayPlan* plan, const RFU6xx_JournalRecord* record, UA_Byte* buffer)
+{
+    size_t length = record->epcLength < RFU6xx_JOURNAL_EPC_SIZE ? record->epcLength : RFU6xx_JOURNAL_EPC_SIZE;
+    UA_String id = { 0, buffer };
+
+    if (plan->serverTagsSize > 0)
+    {
+        UA_UInt32 hash = 0x811c9dc5u;
+        for (size_t i = 0; i < length; i++) hash = (hash ^ record->epc[i]) * 0x01000193u;
+        return plan->serverTags[hash % plan->serverTagsSize];
+    }
+    hexEncode(record->epc, length, buffer, 1);
+    id.length = 2*length;
+    return id;
+}
+
+static void replayJob (RFU6xx_Device* device, void* context)
+{
+    ReplayJob* job = (ReplayJob*) context;
+    ReplayPlan* plan = job->plan;
+    ReplayDevice* replay = job->device;
+    UA_Byte idBuffer[2*RFU6xx_JOURNAL_EPC_SIZE];
+
+    for (size_t i = 0; i < replay->recordsSize; i++)
+    {
+        const RFU6xx_JournalRecord* record = replay->records[i];
+        int operation = replayOperation(record);
+
+        // Open loop: the schedule does not wait for late operations, the delay is reported as lag
+        double dueNs = plan->startNs;
+        if (plan->speed > 0) dueNs += (record->timestamp - plan->firstTimestamp) * 100.0 / plan->speed;
+        double start = nowNs();
+        if (dueNs > start)
+        {
+            sleepUntil(dueNs);
+            start = nowNs();
+        }
+        addSample(&replay->lagUs, (start - dueNs) / 1e3);
+
+        UA_StatusCode retval = UA_STATUSCODE_GOOD;
+        RFU6xx_StatusCode serverResponseCode = RFU6xx_STATUSCODE_SUCCESS;
+        UA_String data = UA_STRING_NULL;
+        UA_String writeData = plan->writeData;
+        UA_String id;
+
+        switch (operation)
+        {
+            case REPLAY_START_SCAN:
+                retval = startScan(device, 0, 0, false);
+                break;
+            case REPLAY_STOP_SCAN:
+                retval = stopScan(device);
+                break;
+            case REPLAY_READ_TAG:
+                id = tagIdOf(plan, record, idBuffer);
+                retval = readTag(device, id, record->bank, record->offset, record->length, &data, &serverResponseCode);
+                break;
+            case REPLAY_WRITE_TAG:
+                id = tagIdOf(plan, record, idBuffer);
+                writeData.length = record->length > 0 ? 2 * (size_t) record->length : 0;
+                retval = writeTag(device, id, record->bank, record->offset, writeData, &serverResponseCode);
+                break;
+        }
+        double latencyUs = (nowNs() - start) / 1e3;
+        UA_String_clear(&data);
+
+        if (retval != UA_STATUSCODE_GOOD) replay->failed[operation]++;
+        else if (serverResponseCode != RFU6xx_STATUSCODE_SUCCESS) replay->rejected[operation]++;
+        addSample(&replay->latencyUs[operation], latencyUs);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+typedef struct {
+    ReplayDevice* devices;
+    size_t devicesSize;
+    size_t replayed;
+    size_t skipped;
+    UA_DateTime first;
+    UA_DateTime last;
+    UA_Int32 maxWriteLength;
+} ReplayLoad;
+
+// Distributes the replayed records onto the devices, the records stay in the mapped journal
+static UA_Boolean loadRecord (const RFU6xx_JournalRecord* record, UA_UInt64 sequence, void* context)
+{
+    ReplayLoad* load = (ReplayLoad*) context;
+    if (replayOperation(record) < 0)
+    {
+        load->skipped++;
+        return true;
+    }
+
+    ReplayDevice* device = &load->devices[record->deviceId % load->devicesSize];
+    if (device->recordsSize == device->recordsCapacity)
+    {
+        size_t capacity = device->recordsCapacity ? 2*device->recordsCapacity : 1024;
+        const RFU6xx_JournalRecord** records = (const RFU6xx_JournalRecord**) realloc(device->records, capacity * sizeof(void*));
+        if (records == NULL) return false;
+        device->records = records;
+        device->recordsCapacity = capacity;
+    }
+    device->records[device->recordsSize++] = record;
+
+    if (load->replayed == 0 || record->timestamp < load->first) load->first = record->timestamp;
+    if (load->replayed == 0 || record->timestamp > load->last) load->last = record->timestamp;
+    if (record->operation == RFU6xx_JOURNAL_WRITE_TAG && record->length > load->maxWriteLength) load->maxWriteLength = record->length;
+    load->replayed++;
+    return true;
+}
+
+static UA_Boolean countDevices (const RFU6xx_JournalRecord* record, UA_UInt64 sequence, void* context)
+{
+    UA_UInt32* maxDeviceId = (UA_UInt32*) context;
+    if (replayOperation(record) >= 0 && record->deviceId > *maxDeviceId) *maxDeviceId = record->deviceId;
+    return true;
+}
+
+// Scans until REPLAY_DISCOVERY_TIME has passed and collects the distinct tag ids of LastScanData
+static void discoverTags (RFU6xx_Device* device, ReplayPlan* plan)
+{
+    if (startScan(device, 0, 0, false) != UA_STATUSCODE_GOOD) return;
+
+    double deadline = nowNs() + REPLAY_DISCOVERY_TIME;
+    while (nowNs() < deadline && plan->serverTagsSize < REPLAY_MAX_SERVER_TAGS)
+    {
+        UA_String tagId = UA_STRING_NULL;
+        if (readLastScanData(device, &tagId) == UA_STATUSCODE_GOOD && tagId.length > 0)
+        {
+            size_t i = 0;
+            while (i < plan->serverTagsSize && !UA_String_equal(&plan->serverTags[i], &tagId)) i++;
+            if (i == plan->serverTagsSize)
+            {
+                plan->serverTags[plan->serverTagsSize++] = tagId;
+                continue;
+            }
+        }
+        UA_String_clear(&tagId);
+        usleep(5000);
+    }
+    stopScan(device);
+}
+
+static pid_t startMockServer (void)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        execl("./mockserver", "./mockserver", (char*) NULL);
+        _exit(EXIT_FAILURE);
+    }
+    // Give the server time to open its port
+    if (pid > 0) usleep(500000);
+    return pid;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+// Prints and writes the results of all devices
+static void report (ReplayLoad* load, double speed, double elapsedS, FILE* out)
+{
+    double traceS = (load->last - load->first) / (double) UA_DATETIME_SEC;
+    double targetRate = speed > 0 && traceS > 0 ? load->replayed * speed / traceS : 0;
+    double achievedRate = elapsedS > 0 ? load->replayed / elapsedS : 0;
+
+    // Merge the samples of all devices
+    Samples lag = { NULL, 0, 0 };
+    for (size_t d = 0; d < load->devicesSize; d++)
+    {
+        for (size_t i = 0; i < load->devices[d].lagUs.size; i++) addSample(&lag, load->devices[d].lagUs.values[i]);
+    }
+    if (lag.size > 0) qsort(lag.values, lag.size, sizeof(double), compareDouble);
+
+    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "replayed %zu operations (%zu scan records skipped) of %.1f s trace in %.1f s "
+        "on %zu devices", load->replayed, load->skipped, traceS, elapsedS, load->devicesSize);
+    if (speed > 0)
+    {
+        UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "rate: target %.1f ops/s (speed %gx), achieved %.1f ops/s (%.1f %%)",
+            targetRate, speed, achievedRate, targetRate > 0 ? 100.0 * achievedRate / targetRate : 0);
+    }
+    else
+    {
+        UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "rate: max speed, achieved %.1f ops/s", achievedRate);
+    }
+    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "schedule lag: p50 %.1f us  p99 %.1f us  max %.1f us",
+        percentile(lag.values, lag.size, 0.5), percentile(lag.values, lag.size, 0.99), lag.size ? lag.values[lag.size - 1] : 0);
+
+    if (out != NULL)
+    {
+        fprintf(out, "{\n  \"operations\": %zu,\n  \"skippedScans\": %zu,\n  \"devices\": %zu,\n  \"traceS\": %.3f,\n  \"elapsedS\": %.3f,\n"
+            "  \"speed\": %g,\n  \"targetOpsPerSec\": %.1f,\n  \"achievedOpsPerSec\": %.1f,\n"
+            "  \"lagP50Us\": %.1f,\n  \"lagP99Us\": %.1f,\n  \"lagMaxUs\": %.1f,\n  \"results\": [",
+            load->replayed, load->skipped, load->devicesSize, traceS, elapsedS, speed, targetRate, achievedRate,
+            percentile(lag.values, lag.size, 0.5), percentile(lag.values, lag.size, 0.99), lag.size ? lag.values[lag.size - 1] : 0);
+    }
+    free(lag.values);
+
+    UA_Boolean first = true;
+    for (int op = 0; op < REPLAY_OPERATIONS; op++)
+    {
+        Samples latency = { NULL, 0, 0 };
+        size_t failed = 0, rejected = 0;
+        for (size_t d = 0; d < load->devicesSize; d++)
+        {
+            ReplayDevice* device = &load->devices[d];
+            for (size_t i = 0; i < device->latencyUs[op].size; i++) addSample(&latency, device->latencyUs[op].values[i]);
+            failed += device->failed[op];
+            rejected += device->rejected[op];
+        }
+        if (latency.size == 0) continue;
+        qsort(latency.values, latency.size, sizeof(double), compareDouble);
+
+        double p50 = percentile(latency.values, latency.size, 0.50);
+        double p90 = percentile(latency.values, latency.size, 0.90);
+        double p99 = percentile(latency.values, latency.size, 0.99);
+        double p999 = percentile(latency.values, latency.size, 0.999);
+        double max = latency.values[latency.size - 1];
+
+        UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "%-10s %8zu ops  p50 %8.1f us  p90 %8.1f us  p99 %8.1f us  p999 %8.1f us  "
+            "max %8.1f us  failed %zu  rejected %zu", replayOperationNames[op], latency.size, p50, p90, p99, p999, max, failed, rejected);
+        if (out != NULL)
+        {
+            fprintf(out, "%s\n    {\"operation\": \"%s\", \"ops\": %zu, \"failed\": %zu, \"rejected\": %zu, "
+                "\"p50Us\": %.1f, \"p90Us\": %.1f, \"p99Us\": %.1f, \"p999Us\": %.1f, \"maxUs\": %.1f}",
+                first ? "" : ",", replayOperationNames[op], latency.size, failed, rejected, p50, p90, p99, p999, max);
+        }
+        first = false;
+        free(latency.values);
+    }
+    if (out != NULL) fprintf(out, "\n  ]\n}\n");
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+int main (int argc, char *argv[])
+{
+    const char* endpoint = "opc.tcp://localhost:4840";
+    const char* directory = "journal";
+    const char* outputFile = NULL;
+    RFU6xx_JournalQuery query;
+    size_t deviceCount = 0;
+    UA_Boolean mapTags = false;
+    UA_Boolean localServer = false;
+    ReplayPlan plan;
+    int opt;
+
+    memset(&query, 0, sizeof(query));
+    memset(&plan, 0, sizeof(plan));
+    plan.speed = 1;
+    while ((opt = getopt(argc, argv, "e:D:f:t:x:c:o:ml")) != -1)
+    {
+        switch (opt)
+        {
+            case 'e': endpoint = optarg; break;
+            case 'D': directory = optarg; break;
+            case 'f': query.from = RFU6xx_Journal_parseTime(optarg); if (query.from == 0) opt = '?'; break;
+            case 't': query.to = RFU6xx_Journal_parseTime(optarg); if (query.to == 0) opt = '?'; break;
+            case 'x': plan.speed = atof(optarg); if (plan.speed < 0) opt = '?'; break;
+            case 'c': deviceCount = (size_t) atol(optarg); break;
+            case 'o': outputFile = optarg; break;
+            case 'm': mapTags = true; break;
+            case 'l': localServer = mapTags = true; break;
+            default: opt = '?'; break;
+        }
+        if (opt == '?')
+        {
+            fprintf(stderr, "Usage: %s [-e endpoint] [-D journal directory] [-f from] [-t to] [-x speed (0 == max)] "
+                "[-c devices] [-o output.json] [-m] [-l]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    RFU6xx_JournalReader* reader = RFU6xx_JournalReader_open(directory);
+    if (reader == NULL)
+    {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Can not read the journal in %s", directory);
+        return EXIT_FAILURE;
+    }
+
+    // One session per recorded device unless the number of devices is given
+    if (deviceCount == 0)
+    {
+        UA_UInt32 maxDeviceId = 0;
+        RFU6xx_JournalReader_query(reader, &query, countDevices, &maxDeviceId);
+        deviceCount = maxDeviceId < REPLAY_MAX_DEVICES ? (size_t) maxDeviceId + 1 : REPLAY_MAX_DEVICES;
+    }
+    ReplayLoad load;
+    memset(&load, 0, sizeof(load));
+    load.devicesSize = deviceCount;
+    load.devices = (ReplayDevice*) calloc(deviceCount, sizeof(ReplayDevice));
+    if (load.devices != NULL) RFU6xx_JournalReader_query(reader, &query, loadRecord, &load);
+    if (load.replayed == 0)
+    {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "No replayable records in %s", directory);
+        RFU6xx_JournalReader_close(reader);
+        free(load.devices);
+        return EXIT_FAILURE;
+    }
+
+    pid_t serverPid = 0;
+    if (localServer)
+    {
+        endpoint = "opc.tcp://localhost:4840";
+        serverPid = startMockServer();
+        if (serverPid < 0) UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Could not start ./mockserver");
+    }
+
+    RFU6xx_DeviceManager* manager = RFU6xx_DeviceManager_new(deviceCount);
+    UA_StatusCode retval = manager ? UA_STATUSCODE_GOOD : UA_STATUSCODE_BADOUTOFMEMORY;
+    for (size_t i = 0; i < deviceCount && retval == UA_STATUSCODE_GOOD; i++)
+    {
+        if (RFU6xx_DeviceManager_addDevice(manager, endpoint) == NULL) retval = UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    if (retval == UA_STATUSCODE_GOOD) retval = RFU6xx_DeviceManager_connectAll(manager, NULL, NULL);
+
+    FILE* out = outputFile ? fopen(outputFile, "w") : NULL;
+    if (retval == UA_STATUSCODE_GOOD && outputFile != NULL && out == NULL) retval = UA_STATUSCODE_BADINTERNALERROR;
+
+    // The longest recorded write is prepared once, shorter writes use its beginning
+    if (retval == UA_STATUSCODE_GOOD && load.maxWriteLength > 0)
+    {
+        retval = UA_ByteString_allocBuffer(&plan.writeData, 2 * (size_t) load.maxWriteLength);
+        for (size_t i = 0; i < plan.writeData.length; i++) plan.writeData.data[i] = "0123456789ABCDEF"[i % 16];
+    }
+    if (retval == UA_STATUSCODE_GOOD && mapTags)
+    {
+        discoverTags(RFU6xx_DeviceManager_getDevice(manager, 0), &plan);
+        UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Recorded EPCs are mapped onto %zu tags of the server", plan.serverTagsSize);
+    }
+
+    if (retval == UA_STATUSCODE_GOOD)
+    {
+        ReplayJob* jobs = (ReplayJob*) calloc(deviceCount, sizeof(ReplayJob));
+        plan.firstTimestamp = load.first;
+        plan.startNs = nowNs() + REPLAY_START_DELAY;
+        for (size_t i = 0; jobs != NULL && i < deviceCount; i++)
+        {
+            jobs[i].plan = &plan;
+            jobs[i].device = &load.devices[i];
+            if (load.devices[i].recordsSize > 0) RFU6xx_DeviceManager_submit(manager, RFU6xx_DeviceManager_getDevice(manager, i), replayJob, &jobs[i]);
+        }
+        RFU6xx_DeviceManager_wait(manager);
+        double elapsedS = (nowNs() - plan.startNs) / 1e9;
+
+        report(&load, plan.speed, elapsedS, out);
+        free(jobs);
+    }
+    else
+    {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Replay setup failed. ErrorCode: %x", retval);
+    }
+
+    if (out != NULL) fclose(out);
+    RFU6xx_DeviceManager_delete(manager);
+    if (serverPid > 0)
+    {
+        kill(serverPid, SIGTERM);
+        waitpid(serverPid, NULL, 0);
+    }
+
+    for (size_t d = 0; d < deviceCount; d++)
+    {
+        for (int op = 0; op < REPLAY_OPERATIONS; op++) free(load.devices[d].latencyUs[op].values);
+        free(load.devices[d].lagUs.values);
+        free(load.devices[d].records);
+    }
+    for (size_t i = 0; i < plan.serverTagsSize; i++) UA_String_clear(&plan.serverTags[i]);
+    UA_String_clear(&plan.writeData);
+    free(load.devices);
+    RFU6xx_JournalReader_close(reader);
+    return retval == UA_STATUSCODE_GOOD ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,422 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+*
+* @contact: sebastian.heidepriem@sick.de
+*/
+
+#include "RFU6xxScanEvents.h"
+#include "RFU6xxHex.h"
+#include <open62541/client_subscriptions.h>
+#include <open62541/plugin/log_stdout.h>
+
+// Selected event fields, in the order of the select clauses
+#define SCAN_EVENT_FIELD_TIME 0
+#define SCAN_EVENT_FIELD_SCAN_RESULT 1
+#define SCAN_EVENT_FIELDS 2
+
+// Switch values of the ScanData union
+#define SCAN_DATA_BYTESTRING 1
+#define SCAN_DATA_STRING 2
+#define SCAN_DATA_EPC 3
+#define SCAN_DATA_CUSTOM 4
+
+// Switch values of the Location union
+#define LOCATION_NMEA 1
+#define LOCATION_LOCAL 2
+#define LOCATION_WGS84 3
+#define LOCATION_NAME 4
+
+// Bit of the optional Location field in the encoding mask of RfidScanResult
+#define SCAN_RESULT_HAS_LOCATION 0x01
+// Antenna (Int32), Strength (Int32), Timestamp (DateTime), CurrentPowerLevel (Int32)
+#define SIGHTING_SIZE 20
+// X, Y, Z (Double), Timestamp (DateTime), DilutionOfPrecision (Double), UsefulPrecision (Int32)
+#define LOCAL_COORDINATE_SIZE 44
+
+typedef struct RFU6xx_ScanEventSubscription {
+    RFU6xx_ScanEventCallback callback;
+    void* context;
+    UA_Double publishingInterval;
+    UA_UInt32 queueSize;
+    UA_UInt32 handle;                           // Id returned by subscribeScanEvents (device->nextSubscriptionHandle)
+    UA_UInt32 subscriptionId;                   // Id of the current subscription on the server, 0 if re-creating it failed
+    RFU6xx_ScanResult* results;                 // Decoding buffer, grown to the largest scan cycle
+    size_t resultsCapacity;
+    struct RFU6xx_ScanEventSubscription* next;
+} ScanEventSubscription;
+
+// Read position in an extension object body. Reads past the end return 0 and set the error flag.
+typedef struct {
+    const UA_Byte* pos;
+    const UA_Byte* end;
+    UA_Boolean error;
+} Decoder;
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+static UA_Boolean skip (Decoder* d, size_t length)
+{
+    if (d->error || (size_t) (d->end - d->pos) < length)
+    {
+        d->error = true;
+        return false;
+    }
+    d->pos += length;
+    return true;
+}
+
+// Little endian as in the OPC UA binary encoding
+static UA_UInt16 readUInt16 (Decoder* d)
+{
+    const UA_Byte* p = d->pos;
+    if (!skip(d, 2)) return 0;
+    return (UA_UInt16) (p[0] | (p[1] << 8));
+}
+
+static UA_UInt32 readUInt32 (Decoder* d)
+{
+    const UA_Byte* p = d->pos;
+    if (!skip(d, 4)) return 0;
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((UA_UInt32) p[3] << 24);
+}
+
+static UA_Int64 readInt64 (Decoder* d)
+{
+    const UA_Byte* p = d->pos;
+    if (!skip(d, 8)) return 0;
+    UA_UInt64 value = 0;
+    for (int i = 7; i >= 0; i--) value = (value << 8) | p[i];
+    return (UA_Int64) value;
+}
+
+// String or ByteString: Int32 length (-1 == null) and the bytes, returns a pointer into the body
+static const UA_Byte* readBytes (Decoder* d, size_t* length)
+{
+    UA_Int32 encodedLength = (UA_Int32) readUInt32(d);
+    *length = 0;
+    if (encodedLength == -1) return NULL;
+    if (encodedLength < 0) d->error = true;
+    const UA_Byte* bytes = d->pos;
+    if (!skip(d, (size_t) encodedLength)) return NULL;
+    *length = (size_t) encodedLength;
+    return bytes;
+}
+
+static void skipString (Decoder* d)
+{
+    size_t length;
+    readBytes(d, &length);
+}
+
+static void skipLocation (Decoder* d)
+{
+    switch (readUInt32(d))
+    {
+        case LOCATION_NMEA:
+        case LOCATION_NAME:
+            skipString(d);
+            break;
+        case LOCATION_LOCAL:
+            skip(d, LOCAL_COORDINATE_SIZE);
+            break;
+        case LOCATION_WGS84:
+            // N/S hemisphere, latitude, E/W hemisphere, longitude, altitude, timestamp, dilution of precision, useful precision
+            skipString(d);
+            skip(d, 8);
+            skipString(d);
+            skip(d, 4*8 + 4);
+            break;
+        default:
+            d->error = true;
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+UA_StatusCode decodeRfidScanResult (const UA_ByteString* body, RFU6xx_ScanResult* result)
+{
+    Decoder d = { body->data, body->data + body->length, false };
+    size_t length;
+    const UA_Byte* bytes;
+
+    // Fields: encoding mask, CodeType, ScanData, Timestamp, Location (optional), Sighting[]
+    UA_UInt32 encodingMask = readUInt32(&d);
+    skipString(&d);
+
+    result->pc = 0;
+    switch (readUInt32(&d))
+    {
+        case SCAN_DATA_EPC:
+            result->pc = readUInt16(&d);
+            bytes = readBytes(&d, &length);
+            skip(&d, 2*sizeof(UA_UInt16));      // XPC_W1, XPC_W2
+            break;
+        case SCAN_DATA_BYTESTRING:
+            bytes = readBytes(&d, &length);
+            break;
+        case SCAN_DATA_STRING:
+            bytes = readBytes(&d, &length);
+            if (d.error || length % 2 != 0 || length/2 > RFU6xx_MAX_TAG_ID_SIZE
+                || hexDecode(bytes, length, result->epc) != 0) return UA_STATUSCODE_BADDECODINGERROR;
+            bytes = result->epc;
+            length /= 2;
+            break;
+        case SCAN_DATA_CUSTOM:
+            return UA_STATUSCODE_BADNOTSUPPORTED;
+        default:
+            return UA_STATUSCODE_BADDECODINGERROR;
+    }
+    if (d.error || length > RFU6xx_MAX_TAG_ID_SIZE) return UA_STATUSCODE_BADDECODINGERROR;
+    if (length > 0 && bytes != result->epc) memcpy(result->epc, bytes, length);
+    result->epcLength = (UA_UInt16) length;
+
+    result->timestamp = readInt64(&d);
+    if (encodingMask & SCAN_RESULT_HAS_LOCATION) skipLocation(&d);
+
+    // Antenna and strength of the strongest sighting (the first one if several are equally strong)
+    UA_Int32 sightings = (UA_Int32) readUInt32(&d);
+    if (sightings < 0) sightings = 0;
+    if (d.error || (size_t) (d.end - d.pos) / SIGHTING_SIZE < (size_t) sightings) return UA_STATUSCODE_BADDECODINGERROR;
+    result->antenna = 0;
+    result->strength = 0;
+    result->sightings = sightings > UA_UINT16_MAX ? UA_UINT16_MAX : (UA_UInt16) sightings;
+    for (UA_Int32 i = 0; i < sightings; i++)
+    {
+        UA_Int32 antenna = (UA_Int32) readUInt32(&d);
+        UA_Int32 strength = (UA_Int32) readUInt32(&d);
+        skip(&d, SIGHTING_SIZE - 2*sizeof(UA_Int32));
+        if (i == 0 || strength > result->strength)
+        {
+            result->antenna = antenna;
+            result->strength = strength;
+        }
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+size_t decodeRfidScanResults (const UA_ExtensionObject eos[], size_t eosSize, RFU6xx_ScanResult results[], size_t* malformed)
+{
+    size_t resultsSize = 0;
+    *malformed = 0;
+    for (size_t i = 0; i < eosSize; i++)
+    {
+        if (eos[i].encoding != UA_EXTENSIONOBJECT_ENCODED_BYTESTRING
+            || decodeRfidScanResult(&eos[i].content.encoded.body, &results[resultsSize]) != UA_STATUSCODE_GOOD)
+        {
+            (*malformed)++;
+            continue;
+        }
+        resultsSize++;
+    }
+    return resultsSize;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+static void scanEventReceived (UA_Client* client, UA_UInt32 subId, void* subContext,
+    UA_UInt32 monId, void* monContext, size_t nEventFields, UA_Variant* eventFields)
+{
+    ScanEventSubscription* sub = (ScanEventSubscription*) monContext;
+    RFU6xx_Device* device = (RFU6xx_Device*) UA_Client_getContext(client);
+    if (nEventFields != SCAN_EVENT_FIELDS) return;
+
+    UA_DateTime eventTime = 0;
+    if (UA_Variant_hasScalarType(&eventFields[SCAN_EVENT_FIELD_TIME], &UA_TYPES[UA_TYPES_DATETIME]))
+    {
+        eventTime = *(UA_DateTime*) eventFields[SCAN_EVENT_FIELD_TIME].data;
+    }
+
+    // Other event types of the notifier have no ScanResult field, it is empty
+    const UA_Variant* scanResult = &eventFields[SCAN_EVENT_FIELD_SCAN_RESULT];
+    if (scanResult->type != &UA_TYPES[UA_TYPES_EXTENSIONOBJECT]) return;
+    size_t eosSize = UA_Variant_isScalar(scanResult) ? 1 : scanResult->arrayLength;
+
+    if (eosSize > sub->resultsCapacity)
+    {
+        RFU6xx_ScanResult* results = (RFU6xx_ScanResult*) UA_realloc(sub->results, eosSize * sizeof(RFU6xx_ScanResult));
+        if (results == NULL)
+        {
+            UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Scan event with %zu tags dropped, out of memory", eosSize);
+            return;
+        }
+        sub->results = results;
+        sub->resultsCapacity = eosSize;
+    }
+
+    size_t malformed;
+    size_t resultsSize = decodeRfidScanResults((const UA_ExtensionObject*) scanResult->data, eosSize, sub->results, &malformed);
+    if (malformed > 0)
+    {
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Scan event: %zu of %zu scan results could not be decoded",
+            malformed, eosSize);
+    }
+    sub->callback(device, eventTime, sub->results, resultsSize, sub->context);
+}
+
+// Resolves RfidScanEventType (BaseEventType/AutoIdScanEventType/RfidScanEventType), kept until the node ids are resolved again
+static UA_StatusCode resolveScanEventType (RFU6xx_Device* device)
+{
+    if (device->ndRfidScanEventTypeID != 0) return UA_STATUSCODE_GOOD;
+
+    UA_UInt32 autoIdScanEventTypeID;
+    UA_StatusCode retval = getChildNodeIdByString(device, 0, UA_NS0ID_BASEEVENTTYPE,
+        RFU6xx_AUTOID_SCAN_EVENT_TYPE_NAME, &autoIdScanEventTypeID);
+    if (retval == UA_STATUSCODE_GOOD)
+    {
+        retval = getChildNodeIdByString(device, device->nsAutoID, autoIdScanEventTypeID,
+            RFU6xx_RFID_SCAN_EVENT_TYPE_NAME, &device->ndRfidScanEventTypeID);
+    }
+    if (retval != UA_STATUSCODE_GOOD)
+    {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Could not find node id for RfidScanEventType");
+        return retval;
+    }
+    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Node id RfidScanEventType: %u", device->ndRfidScanEventTypeID);
+    return UA_STATUSCODE_GOOD;
+}
+
+// Creates the subscription and the event monitored item of sub on the server
+static UA_StatusCode createScanEventSubscription (RFU6xx_Device* device, ScanEventSubscription* sub)
+{
+    UA_StatusCode retval = resolveScanEventType(device);
+    if (retval != UA_STATUSCODE_GOOD) return retval;
+
+    UA_CreateSubscriptionRequest subReq = UA_CreateSubscriptionRequest_default();
+    subReq.requestedPublishingInterval = sub->publishingInterval;
+    UA_CreateSubscriptionResponse subResp = UA_Client_Subscriptions_create(device->client, subReq, NULL, NULL, NULL);
+    if (subResp.responseHeader.serviceResult != UA_STATUSCODE_GOOD)
+    {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Could not create subscription for scan events");
+        return subResp.responseHeader.serviceResult;
+    }
+
+    // Event filter: Time of BaseEventType and ScanResult of RfidScanEventType
+    UA_QualifiedName timePath = UA_QUALIFIEDNAME(0, "Time");
+    UA_QualifiedName scanResultPath = UA_QUALIFIEDNAME(device->nsAutoID, "ScanResult");
+    UA_SimpleAttributeOperand selectClauses[SCAN_EVENT_FIELDS];
+    for (size_t i = 0; i < SCAN_EVENT_FIELDS; i++)
+    {
+        UA_SimpleAttributeOperand_init(&selectClauses[i]);
+        selectClauses[i].attributeId = UA_ATTRIBUTEID_VALUE;
+        selectClauses[i].browsePathSize = 1;
+    }
+    selectClauses[SCAN_EVENT_FIELD_TIME].typeDefinitionId = UA_NODEID_NUMERIC(0, UA_NS0ID_BASEEVENTTYPE);
+    selectClauses[SCAN_EVENT_FIELD_TIME].browsePath = &timePath;
+    selectClauses[SCAN_EVENT_FIELD_SCAN_RESULT].typeDefinitionId = UA_NODEID_NUMERIC(device->nsAutoID, device->ndRfidScanEventTypeID);
+    selectClauses[SCAN_EVENT_FIELD_SCAN_RESULT].browsePath = &scanResultPath;
+
+    UA_EventFilter filter;
+    UA_EventFilter_init(&filter);
+    filter.selectClauses = selectClauses;
+    filter.selectClausesSize = SCAN_EVENT_FIELDS;
+
+    // Create event monitored item on the RFU6xx object
+    UA_MonitoredItemCreateRequest monReq;
+    UA_MonitoredItemCreateRequest_init(&monReq);
+    monReq.itemToMonitor.nodeId = UA_NODEID_NUMERIC(device->nsRfu, device->ndRfu6xxNodeID);
+    monReq.itemToMonitor.attributeId = UA_ATTRIBUTEID_EVENTNOTIFIER;
+    monReq.monitoringMode = UA_MONITORINGMODE_REPORTING;
+    monReq.requestedParameters.queueSize = sub->queueSize;
+    monReq.requestedParameters.discardOldest = true;
+    monReq.requestedParameters.filter.encoding = UA_EXTENSIONOBJECT_DECODED;
+    monReq.requestedParameters.filter.content.decoded.type = &UA_TYPES[UA_TYPES_EVENTFILTER];
+    monReq.requestedParameters.filter.content.decoded.data = &filter;
+    UA_MonitoredItemCreateResult monResp = UA_Client_MonitoredItems_createEvent(device->client, subResp.subscriptionId,
+        UA_TIMESTAMPSTORETURN_NEITHER, monReq, sub, scanEventReceived, NULL);
+    retval = monResp.statusCode;
+    if (retval != UA_STATUSCODE_GOOD)
+    {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Could not create monitored item for scan events");
+        UA_Client_Subscriptions_deleteSingle(device->client, subResp.subscriptionId);
+    }
+    else
+    {
+        UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Scan event subscription: %u, monitored item: %u",
+            subResp.subscriptionId, monResp.monitoredItemId);
+        sub->subscriptionId = subResp.subscriptionId;
+    }
+    UA_MonitoredItemCreateResult_clear(&monResp);
+    return retval;
+}
+
+UA_StatusCode subscribeScanEvents (RFU6xx_Device* device, UA_Double publishingInterval, UA_UInt32 queueSize,
+    RFU6xx_ScanEventCallback callback, void* context, UA_UInt32* subscriptionId)
+{
+    UA_StatusCode retval = RFU6xx_Device_checkConnection(device);
+    if (retval != UA_STATUSCODE_GOOD) return retval;
+
+    ScanEventSubscription* sub = (ScanEventSubscription*) UA_calloc(1, sizeof(ScanEventSubscription));
+    if (sub == NULL) return UA_STATUSCODE_BADOUTOFMEMORY;
+    sub->callback = callback;
+    sub->context = context;
+    sub->publishingInterval = publishingInterval;
+    sub->queueSize = queueSize;
+
+    retval = createScanEventSubscription(device, sub);
+    if (retval != UA_STATUSCODE_GOOD)
+    {
+        UA_free(sub);
+        return retval;
+    }
+    sub->handle = device->nextSubscriptionHandle++;
+    sub->next = device->scanEventSubscriptions;
+    device->scanEventSubscriptions = sub;
+
+    *subscriptionId = sub->handle;
+    return UA_STATUSCODE_GOOD;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+UA_StatusCode unsubscribeScanEvents (RFU6xx_Device* device, UA_UInt32 subscriptionId)
+{
+    for (ScanEventSubscription** pSub = &device->scanEventSubscriptions; *pSub != NULL; pSub = &(*pSub)->next)
+    {
+        ScanEventSubscription* sub = *pSub;
+        if (sub->handle != subscriptionId) continue;
+
+        // Deleting the subscription also deletes the monitored item
+        UA_StatusCode retval = UA_STATUSCODE_GOOD;
+        if (sub->subscriptionId != 0) retval = UA_Client_Subscriptions_deleteSingle(device->client, sub->subscriptionId);
+        *pSub = sub->next;
+        UA_free(sub->results);
+        UA_free(sub);
+        return retval;
+    }
+    return UA_STATUSCODE_BADSUBSCRIPTIONIDINVALID;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+UA_StatusCode RFU6xx_ScanEvents_restore (RFU6xx_Device* device, UA_Boolean newSession)
+{
+    // After a new session the old subscriptions are removed from the client first (the server answers 
+    // BadSubscriptionIdInvalid). A failure does not stop the others, the failed ones keep subscriptionId 0.
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    for (ScanEventSubscription* sub = device->scanEventSubscriptions; sub != NULL; sub = sub->next)
+    {
+        if (newSession && sub->subscriptionId != 0)
+        {
+            UA_Client_Subscriptions_deleteSingle(device->client, sub->subscriptionId);
+            sub->subscriptionId = 0;
+        }
+        if (sub->subscriptionId != 0) continue;
+        UA_StatusCode subRetval = createScanEventSubscription(device, sub);
+        if (retval == UA_STATUSCODE_GOOD) retval = subRetval;
+    }
+    return retval;
+}
+
+void RFU6xx_ScanEvents_deleteAll (RFU6xx_Device* device)
+{
+    while (device->scanEventSubscriptions != NULL)
+    {
+        ScanEventSubscription* sub = device->scanEventSubscriptions;
+        device->scanEventSubscriptions = sub->next;
+        UA_free(sub->results);
+        UA_free(sub);
+    }
+}
@@ -0,0 +1,154 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+* @contact: sebastian.heidepriem@sick.de
+*
+* Scan results of the AutoID RfidScanEventType. While scanning, the reader fires one event per scan cycle
+* on the RFU6xx object, its ScanResult field holds every tag seen in the cycle as an array of RfidScanResult
+* structures (LastScanData only holds the last one). The client has no generated AutoID types, so the
+* structures arrive as encoded extension objects. They are decoded in one pass from the body bytes into
+* fixed-size records, without allocations, and the callback gets all tags of a cycle as one batch.
+* Scan event subscriptions are re-created after a new session like the LastScanData subscriptions.
+*/
+
+#ifndef RFU6xxSCANEVENTS_H
+#define RFU6xxSCANEVENTS_H
+
+    #include "RFU6xxClient.h"
+
+    // Browse names of the event types below BaseEventType (AutoID namespace)
+    #define RFU6xx_AUTOID_SCAN_EVENT_TYPE_NAME "AutoIdScanEventType"
+    #define RFU6xx_RFID_SCAN_EVENT_TYPE_NAME "RfidScanEventType"
+
+    /*
+    * Struct:  RFU6xx_ScanResult
+    * --------------------
+    * Fixed-size record of one tag of a scan cycle.
+    */
+    typedef struct {
+        UA_DateTime timestamp;                      // Time the tag was scanned (Timestamp of the RfidScanResult)
+        UA_Int32 antenna;                           // Antenna of the strongest sighting, 0 if there was none
+        UA_Int32 strength;                          // Signal strength (RSSI) of the strongest sighting
+        UA_UInt16 sightings;                        // Number of sightings (reads by an antenna) in the cycle
+        UA_UInt16 pc;                               // Protocol control word, 0 if the scan data is no ScanDataEpc
+        UA_UInt16 epcLength;                        // Number of valid bytes in epc
+        UA_Byte epc[RFU6xx_MAX_TAG_ID_SIZE];        // Binary EPC
+    } RFU6xx_ScanResult;
+
+    /*
+    * Callback type for subscribeScanEvents
+    * --------------------
+    * Called from UA_Client_run_iterate once per scan event with all tags of the scan cycle.
+    * The results are only valid for the duration of the callback. Scan results that could not
+    * be decoded are left out and logged.
+    *
+    *  parameters:
+    *               -> RFU6xx_Device* device
+    *               -> UA_DateTime eventTime                    /-> Time field of the event
+    *               -> const RFU6xx_ScanResult results[]
+    *               -> size_t resultsSize                       /-> Number of tags, 0 for a cycle without tags
+    *               -> void* context                            /-> User context passed to subscribeScanEvents
+    */
+    typedef void (*RFU6xx_ScanEventCallback)(RFU6xx_Device* device, UA_DateTime eventTime,
+        const RFU6xx_ScanResult results[], size_t resultsSize, void* context);
+
+    /*
+    * Function:  subscribeScanEvents
+    * --------------------
+    * Creates a subscription with an event monitored item on the RFU6xx object. The event filter selects
+    * the Time and ScanResult fields of RfidScanEventType, whose node id is resolved by browse name on the
+    * first call. Only continuous scans (startScan with dataAvailable false) report every cycle.
+    *
+    *  parameters:
+    *               -> RFU6xx_Device* device
+    *               -> UA_Double publishingInterval             /-> In ms
+    *               -> UA_UInt32 queueSize                      /-> Number of events the server queues between two publish cycles
+    *               -> RFU6xx_ScanEventCallback callback        /-> Called with the tags of each scan cycle
+    *               -> void* context                            /-> User context passed to the callback
+    *               -> UA_UInt32* subscriptionId                /-> Returns a device-local handle of the subscription (kept after re-creation)
+    *
+    *  returns:
+    *               -> UA_StatusCode                            /-> UA_STATUSCODE_BADNOTFOUND if the server has no RfidScanEventType
+    */
+    UA_StatusCode subscribeScanEvents (RFU6xx_Device* device, UA_Double publishingInterval, UA_UInt32 queueSize,
+        RFU6xx_ScanEventCallback callback, void* context, UA_UInt32* subscriptionId);
+
+    /*
+    * Function:  unsubscribeScanEvents
+    * --------------------
+    * Deletes a subscription created by subscribeScanEvents.
+    *
+    *  parameters:
+    *               -> RFU6xx_Device* device
+    *               -> UA_UInt32 subscriptionId                 /-> Id returned by subscribeScanEvents
+    *
+    *  returns:
+    *               -> UA_StatusCode                            /-> UA_STATUSCODE_BADSUBSCRIPTIONIDINVALID if the id is unknown
+    */
+    UA_StatusCode unsubscribeScanEvents (RFU6xx_Device* device, UA_UInt32 subscriptionId);
+
+    /*
+    * Function:  decodeRfidScanResult
+    * --------------------
+    * Decodes the binary body of a RfidScanResult extension object. The EPC is taken from ScanData
+    * as ScanDataEpc, ByteString or hex String; the location is skipped.
+    *
+    *  parameters:
+    *               -> const UA_ByteString* body
+    *               -> RFU6xx_ScanResult* result
+    *
+    *  returns:
+    *               -> UA_StatusCode                            /-> UA_STATUSCODE_BADDECODINGERROR if the body is truncated or malformed,
+    *                                                               UA_STATUSCODE_BADNOTSUPPORTED for custom scan data
+    */
+    UA_StatusCode decodeRfidScanResult (const UA_ByteString* body, RFU6xx_ScanResult* result);
+
+    /*
+    * Function:  decodeRfidScanResults
+    * --------------------
+    * Decodes an array of RfidScanResult extension objects (the ScanResult field of an event).
+    *
+    *  parameters:
+    *               -> const UA_ExtensionObject eos[]
+    *               -> size_t eosSize
+    *               -> RFU6xx_ScanResult results[]              /-> Buffer for eosSize results
+    *               -> size_t* malformed                        /-> Returns the number of extension objects that were left out
+    *
+    *  returns:
+    *               -> size_t                                   /-> Number of decoded results
+    */
+    size_t decodeRfidScanResults (const UA_ExtensionObject eos[], size_t eosSize, RFU6xx_ScanResult results[], size_t* malformed);
+
+    // ------------------------------------------------------------------------------------------------------------------------
+    // Used by the client functions
+
+    /*
+    * Function:  RFU6xx_ScanEvents_restore
+    * --------------------
+    * Creates the scan event subscriptions of a device again after a new session was created (all of
+    * them) or that could not be created last time (subscriptionId 0). All subscriptions are tried.
+    *
+    *  parameters:
+    *               -> RFU6xx_Device* device
+    *               -> UA_Boolean newSession                    /-> true == the old subscriptions ended with the previous session
+    *
+    *  returns:
+    *               -> UA_StatusCode
+    */
+    UA_StatusCode RFU6xx_ScanEvents_restore (RFU6xx_Device* device, UA_Boolean newSession);
+
+    /*
+    * Function:  RFU6xx_ScanEvents_deleteAll
+    * --------------------
+    * Frees the scan event subscriptions of a device without deleting them on the server.
+    *
+    *  parameters:
+    *               -> RFU6xx_Device* device
+    *
+    *  returns:
+    */
+    void RFU6xx_ScanEvents_deleteAll (RFU6xx_Device* device);
+
+#endif
@@ -0,0 +1,427 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+*
+* @contact: sebastian.heidepriem@sick.de
+*/
+
+#include "RFU6xxTagBus.h"
+#include "RFU6xxHex.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BUS_MAGIC "RFU6xxS2"
+#define CACHE_LINE_SIZE 64
+// The header fills its own page, so readers can map the slots read-only
+#define HEADER_SIZE 4096
+
+// Shared memory layout: header page, then capacity slots
+typedef struct {
+    char magic[8];                              // Written last by the publisher
+    UA_UInt32 slotSize;
+    UA_UInt32 capacity;
+    UA_UInt32 closed;
+    UA_Int32 publisherPid;                      // Process that owns the bus, checked before it is replaced
+    char padding0[CACHE_LINE_SIZE - 24];
+
+    // Written by the publisher
+    UA_UInt64 head;                             // Sequence number of the next event
+    UA_UInt64 invalid;
+    UA_UInt64 wakeups;
+    char padding1[CACHE_LINE_SIZE - 24];
+
+    // Futex of the sleeping readers
+    UA_UInt32 waiters;
+    UA_UInt32 futex;                            // Incremented by the publisher to wake the readers
+} BusHeader;
+
+// A slot holds the event with sequence number (sequence - 1), sequence is 0 while it is written
+typedef struct {
+    UA_UInt64 sequence;
+    RFU6xx_TagEvent event;
+} __attribute__((aligned(CACHE_LINE_SIZE))) BusSlot;
+
+struct RFU6xx_TagBus {
+    BusHeader* header;
+    BusSlot* slots;
+    size_t mask;
+    size_t size;
+    UA_UInt64 head;
+    char name[NAME_MAX];
+};
+
+struct RFU6xx_TagBusReader {
+    BusHeader* header;                          // Read-write mapping of the header page
+    const BusSlot* slots;                       // Read-only mapping of the slots
+    size_t mask;
+    size_t slotsSize;
+    UA_UInt64 cursor;
+    UA_UInt64 peeked;                           // Sequence of the slot returned by peek, 0 == none
+    UA_UInt64 read;
+    UA_UInt64 lost;
+};
+
+_Static_assert(sizeof(BusHeader) <= HEADER_SIZE, "Bus header larger than its page");
+
+static long futex (UA_UInt32* address, int operation, UA_UInt32 value, const struct timespec* timeout)
+{
+    return syscall(SYS_futex, address, operation, value, timeout, NULL, 0);
+}
+
+static void wakeReaders (BusHeader* header)
+{
+    __atomic_fetch_add(&header->futex, 1, __ATOMIC_SEQ_CST);
+    futex(&header->futex, FUTEX_WAKE, INT_MAX, NULL);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+// A bus whose publisher process still runs is never taken over
+static UA_Boolean publisherAlive (const BusHeader* header)
+{
+    pid_t pid = (pid_t) __atomic_load_n(&header->publisherPid, __ATOMIC_ACQUIRE);
+    if (pid <= 0 || __atomic_load_n(&header->closed, __ATOMIC_ACQUIRE) != 0) return false;
+    return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+// Readers of a stale object (e.g. of a crashed publisher) are told that it is closed before it is replaced.
+// Returns -1 with errno EEXIST if the object belongs to a running publisher.
+static int closeExisting (const char* name)
+{
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) return 0;
+    int retval = 0;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size >= HEADER_SIZE)
+    {
+        BusHeader* header = (BusHeader*) mmap(NULL, HEADER_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (header != MAP_FAILED)
+        {
+            if (memcmp(header->magic, BUS_MAGIC, sizeof(header->magic)) == 0)
+            {
+                if (publisherAlive(header))
+                {
+                    retval = -1;
+                }
+                else
+                {
+                    __atomic_store_n(&header->closed, 1, __ATOMIC_SEQ_CST);
+                    wakeReaders(header);
+                }
+            }
+            munmap(header, HEADER_SIZE);
+        }
+    }
+    close(fd);
+    if (retval != 0)
+    {
+        errno = EEXIST;
+        return retval;
+    }
+    shm_unlink(name);
+    return 0;
+}
+
+RFU6xx_TagBus* RFU6xx_TagBus_create (const char* name, size_t capacity, mode_t mode, gid_t group)
+{
+    size_t slots = 2;
+    while (slots < capacity) slots <<= 1;
+    if (slots > UINT32_MAX || strlen(name) >= NAME_MAX) return NULL;
+
+    RFU6xx_TagBus* bus = (RFU6xx_TagBus*) UA_calloc(1, sizeof(RFU6xx_TagBus));
+    if (bus == NULL) return NULL;
+    strcpy(bus->name, name);
+    bus->mask = slots - 1;
+    bus->size = HEADER_SIZE + slots * sizeof(BusSlot);
+
+    if (closeExisting(name) != 0)
+    {
+        UA_free(bus);
+        return NULL;
+    }
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, mode);
+    if (fd < 0)
+    {
+        UA_free(bus);
+        return NULL;
+    }
+
+    // shm_open applies the umask, the mode is set again so the group bits are kept
+    void* memory = MAP_FAILED;
+    if (fchmod(fd, mode) == 0 && (group == RFU6xx_TAGBUS_PUBLISHER_GROUP || fchown(fd, (uid_t) -1, group) == 0)
+        && ftruncate(fd, (off_t) bus->size) == 0)
+    {
+        memory = mmap(NULL, bus->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    int error = errno;
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        shm_unlink(name);
+        UA_free(bus);
+        errno = error;
+        return NULL;
+    }
+
+    // The object is zero filled: all slots are empty, head is 0
+    bus->header = (BusHeader*) memory;
+    bus->slots = (BusSlot*) ((char*) memory + HEADER_SIZE);
+    bus->header->slotSize = sizeof(BusSlot);
+    bus->header->capacity = (UA_UInt32) slots;
+    bus->header->publisherPid = (UA_Int32) getpid();
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(bus->header->magic, BUS_MAGIC, sizeof(bus->header->magic));
+    return bus;
+}
+
+void RFU6xx_TagBus_delete (RFU6xx_TagBus* bus)
+{
+    if (bus == NULL) return;
+    __atomic_store_n(&bus->header->closed, 1, __ATOMIC_SEQ_CST);
+    wakeReaders(bus->header);
+    munmap(bus->header, bus->size);
+    shm_unlink(bus->name);
+    UA_free(bus);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+void RFU6xx_TagBus_publish (RFU6xx_TagBus* bus, const RFU6xx_TagEvent* event)
+{
+    UA_UInt64 sequence = bus->head;
+    BusSlot* slot = &bus->slots[sequence & bus->mask];
+
+    // Readers that see the slot empty or with another sequence after copying discard their copy
+    __atomic_store_n(&slot->sequence, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    slot->event = *event;
+    __atomic_store_n(&slot->sequence, sequence + 1, __ATOMIC_RELEASE);
+
+    // Readers register as waiters before they check head, one of both sees the other
+    bus->head = sequence + 1;
+    __atomic_store_n(&bus->header->head, sequence + 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&bus->header->waiters, __ATOMIC_SEQ_CST) > 0)
+    {
+        __atomic_store_n(&bus->header->wakeups, bus->header->wakeups + 1, __ATOMIC_RELAXED);
+        wakeReaders(bus->header);
+    }
+}
+
+UA_Boolean RFU6xx_TagBus_publishScanData (RFU6xx_TagBus* bus, UA_UInt32 deviceId, const UA_String* scanData)
+{
+    RFU6xx_TagEvent event;
+    if (scanData->length == 0 || scanData->length > 2*RFU6xx_MAX_TAG_ID_SIZE
+        || hexDecode(scanData->data, scanData->length, event.epc) != 0)
+    {
+        __atomic_store_n(&bus->header->invalid, bus->header->invalid + 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    event.epcLength = (UA_UInt16) (scanData->length / 2);
+    event.deviceId = deviceId;
+    event.timestamp = UA_DateTime_now();
+    RFU6xx_TagBus_publish(bus, &event);
+    return true;
+}
+
+void RFU6xx_TagBus_onLastScanData (RFU6xx_Device* device, const UA_String* lastScanData, void* context)
+{
+    RFU6xx_TagBusProducer* producer = (RFU6xx_TagBusProducer*) context;
+    RFU6xx_TagBus_publishScanData(producer->bus, producer->deviceId, lastScanData);
+}
+
+void RFU6xx_TagBus_getStats (RFU6xx_TagBus* bus, RFU6xx_TagBusStats* stats)
+{
+    stats->published = bus->head;
+    stats->invalid = __atomic_load_n(&bus->header->invalid, __ATOMIC_RELAXED);
+    stats->wakeups = __atomic_load_n(&bus->header->wakeups, __ATOMIC_RELAXED);
+    stats->capacity = bus->mask + 1;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+RFU6xx_TagBusReader* RFU6xx_TagBusReader_open (const char* name, UA_Boolean fromOldest)
+{
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) return NULL;
+
+    RFU6xx_TagBusReader* reader = NULL;
+    BusHeader* header = MAP_FAILED;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size >= HEADER_SIZE)
+    {
+        header = (BusHeader*) mmap(NULL, HEADER_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (header != MAP_FAILED && memcmp(header->magic, BUS_MAGIC, sizeof(header->magic)) == 0
+        && header->slotSize == sizeof(BusSlot) && st.st_size == HEADER_SIZE + (off_t) header->capacity * (off_t) sizeof(BusSlot))
+    {
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        reader = (RFU6xx_TagBusReader*) UA_calloc(1, sizeof(RFU6xx_TagBusReader));
+    }
+    if (reader != NULL)
+    {
+        reader->header = header;
+        reader->mask = header->capacity - 1;
+        reader->slotsSize = (size_t) header->capacity * sizeof(BusSlot);
+        void* slots = mmap(NULL, reader->slotsSize, PROT_READ, MAP_SHARED, fd, HEADER_SIZE);
+        if (slots == MAP_FAILED)
+        {
+            UA_free(reader);
+            reader = NULL;
+        }
+        else
+        {
+            reader->slots = (const BusSlot*) slots;
+            UA_UInt64 head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+            reader->cursor = head;
+            if (fromOldest) reader->cursor = head > reader->mask ? head - reader->mask : 0;
+        }
+    }
+    if (reader == NULL && header != MAP_FAILED) munmap(header, HEADER_SIZE);
+    close(fd);
+    return reader;
+}
+
+void RFU6xx_TagBusReader_close (RFU6xx_TagBusReader* reader)
+{
+    if (reader == NULL) return;
+    munmap((void*) reader->slots, reader->slotsSize);
+    munmap(reader->header, HEADER_SIZE);
+    UA_free(reader);
+}
+
+// Moves the cursor past the events that are overwritten or being overwritten. The slot of
+// head - capacity is the one the publisher writes next, so the oldest safe event is one after it.
+static void skipOverwritten (RFU6xx_TagBusReader* reader)
+{
+    UA_UInt64 head = __atomic_load_n(&reader->header->head, __ATOMIC_ACQUIRE);
+    if (head > reader->mask && reader->cursor < head - reader->mask)
+    {
+        reader->lost += head - reader->mask - reader->cursor;
+        reader->cursor = head - reader->mask;
+    }
+}
+
+size_t RFU6xx_TagBusReader_read (RFU6xx_TagBusReader* reader, RFU6xx_TagEvent events[], size_t maxEvents)
+{
+    reader->peeked = 0;
+    skipOverwritten(reader);
+    UA_UInt64 head = __atomic_load_n(&reader->header->head, __ATOMIC_ACQUIRE);
+
+    size_t count = 0;
+    while (count < maxEvents && reader->cursor < head)
+    {
+        const BusSlot* slot = &reader->slots[reader->cursor & reader->mask];
+        UA_UInt64 sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        if (sequence == reader->cursor + 1)
+        {
+            events[count] = slot->event;
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) == sequence)
+            {
+                reader->cursor++;
+                count++;
+                continue;
+            }
+        }
+        // The publisher lapped the cursor
+        skipOverwritten(reader);
+        head = __atomic_load_n(&reader->header->head, __ATOMIC_ACQUIRE);
+    }
+    reader->read += count;
+    return count;
+}
+
+const RFU6xx_TagEvent* RFU6xx_TagBusReader_peek (RFU6xx_TagBusReader* reader)
+{
+    reader->peeked = 0;
+    while (true)
+    {
+        skipOverwritten(reader);
+        if (reader->cursor >= __atomic_load_n(&reader->header->head, __ATOMIC_ACQUIRE)) return NULL;
+
+        const BusSlot* slot = &reader->slots[reader->cursor & reader->mask];
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) == reader->cursor + 1)
+        {
+            reader->peeked = reader->cursor + 1;
+            return &slot->event;
+        }
+    }
+}
+
+UA_Boolean RFU6xx_TagBusReader_consume (RFU6xx_TagBusReader* reader)
+{
+    if (reader->peeked == 0) return false;
+    const BusSlot* slot = &reader->slots[(reader->peeked - 1) & reader->mask];
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    UA_Boolean intact = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) == reader->peeked;
+    reader->peeked = 0;
+
+    reader->cursor++;
+    if (intact) reader->read++;
+    else reader->lost++;
+    return intact;
+}
+
+UA_Boolean RFU6xx_TagBusReader_wait (RFU6xx_TagBusReader* reader, UA_UInt32 timeoutMs)
+{
+    BusHeader* header = reader->header;
+    struct timespec deadline, timeout;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeoutMs / 1000;
+    deadline.tv_nsec += (long) (timeoutMs % 1000) * 1000000L;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+    deadline.tv_nsec %= 1000000000L;
+
+    __atomic_fetch_add(&header->waiters, 1, __ATOMIC_SEQ_CST);
+    UA_Boolean available;
+    while (true)
+    {
+        UA_UInt32 value = __atomic_load_n(&header->futex, __ATOMIC_SEQ_CST);
+        available = reader->cursor < __atomic_load_n(&header->head, __ATOMIC_SEQ_CST);
+        if (available || __atomic_load_n(&header->closed, __ATOMIC_SEQ_CST)) break;
+
+        // FUTEX_WAIT takes a relative timeout, it is recomputed after every wakeup
+        const struct timespec* relative = NULL;
+        if (timeoutMs > 0)
+        {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            timeout.tv_sec = deadline.tv_sec - now.tv_sec;
+            timeout.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+            if (timeout.tv_nsec < 0)
+            {
+                timeout.tv_sec--;
+                timeout.tv_nsec += 1000000000L;
+            }
+            if (timeout.tv_sec < 0) break;
+            relative = &timeout;
+        }
+        if (futex(&header->futex, FUTEX_WAIT, value, relative) != 0 && errno == ETIMEDOUT) break;
+    }
+    __atomic_fetch_sub(&header->waiters, 1, __ATOMIC_SEQ_CST);
+    return available;
+}
+
+UA_Boolean RFU6xx_TagBusReader_isClosed (RFU6xx_TagBusReader* reader)
+{
+    return __atomic_load_n(&reader->header->closed, __ATOMIC_ACQUIRE) != 0;
+}
+
+void RFU6xx_TagBusReader_getStats (RFU6xx_TagBusReader* reader, RFU6xx_TagBusReaderStats* stats)
+{
+    stats->read = reader->read;
+    stats->lost = reader->lost;
+    stats->cursor = reader->cursor;
+    stats->published = __atomic_load_n(&reader->header->head, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,264 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+* @contact: sebastian.heidepriem@sick.de
+*
+* Tag event bus in POSIX shared memory (/dev/shm) for consumer processes on the same controller.
+* One publisher thread writes every scanned tag into a ring of sequence-numbered slots, any number of
+* readers in other processes map the ring read-only and follow it with their own cursor. The publisher
+* never waits for a reader: a reader that falls more than the capacity behind loses the overwritten
+* events, which it detects through the slot sequence numbers and counts. Readers either copy events in
+* batches or use them in place (peek / consume) and can sleep on a futex in the shared header until
+* the next event is published. So one OPC UA session per reader feeds all local consumers.
+*
+* Permissions: readers open the object read-write, because they register as waiters and sleep on the
+* futex in the header page (the slots are mapped read-only). A consumer therefore needs read and write
+* permission on /dev/shm/<name>. The publisher creates the object with the mode given to
+* RFU6xx_TagBus_create (independent of its umask) and may hand it to a group: with the default 0660 the
+* consumer service accounts (e.g. HMI, MES bridge) are put into one group that is passed as group.
+* Write access only allows a consumer to disturb the bus, not the OPC UA session of the publisher.
+*/
+
+#ifndef RFU6xxTAGBUS_H
+#define RFU6xxTAGBUS_H
+
+    #include "RFU6xxTagRing.h"
+
+    #include <sys/types.h>
+
+    // Shared memory object used by main
+    #define RFU6xx_TAGBUS_DEFAULT_NAME "/rfu6xx-tags"
+    // Default number of events in the ring
+    #define RFU6xx_TAGBUS_DEFAULT_CAPACITY 65536
+    // Default access of the shared memory object: publisher user and its group (see permissions above)
+    #define RFU6xx_TAGBUS_DEFAULT_MODE 0660
+    // Group argument of RFU6xx_TagBus_create that keeps the group of the publisher process
+    #define RFU6xx_TAGBUS_PUBLISHER_GROUP ((gid_t) -1)
+
+    typedef struct RFU6xx_TagBus RFU6xx_TagBus;
+    typedef struct RFU6xx_TagBusReader RFU6xx_TagBusReader;
+
+    typedef struct {
+        UA_UInt64 published;                        // Events written into the ring (== next sequence number)
+        UA_UInt64 invalid;                          // Scan data that was no valid hex EPC
+        UA_UInt64 wakeups;                          // Publishes that had to wake sleeping readers
+        size_t capacity;
+    } RFU6xx_TagBusStats;
+
+    typedef struct {
+        UA_UInt64 read;                             // Events taken by this reader
+        UA_UInt64 lost;                             // Events overwritten before this reader took them
+        UA_UInt64 cursor;                           // Sequence number of the next event of this reader
+        UA_UInt64 published;                        // Events published so far
+    } RFU6xx_TagBusReaderStats;
+
+    /*
+    * Struct:  RFU6xx_TagBusProducer
+    * --------------------
+    * Context of RFU6xx_TagBus_onLastScanData: the bus and the id written into the events of a device.
+    * Owned by the caller, it must stay valid while the subscription exists.
+    */
+    typedef struct {
+        RFU6xx_TagBus* bus;
+        UA_UInt32 deviceId;
+    } RFU6xx_TagBusProducer;
+
+    /*
+    * Function:  RFU6xx_TagBus_create
+    * --------------------
+    * Creates the shared memory object of the bus. An existing object of the same name is only replaced
+    * if its publisher process has ended or deleted it (e.g. after a crash), readers still attached to it
+    * see it as closed. The bus of a running publisher is never taken over.
+    *
+    *  parameters:
+    *               -> const char* name                         /-> Shared memory name, e.g. RFU6xx_TAGBUS_DEFAULT_NAME
+    *               -> size_t capacity                          /-> Number of events, rounded up to a power of two
+    *               -> mode_t mode                              /-> Access of the object, e.g. RFU6xx_TAGBUS_DEFAULT_MODE.
+    *                                                               Readers need read and write permission.
+    *               -> gid_t group                              /-> Group of the object (the publisher must be a member)
+    *                                                               or RFU6xx_TAGBUS_PUBLISHER_GROUP
+    *
+    *  returns:
+    *               -> RFU6xx_TagBus*                           /-> NULL if the shared memory could not be created
+    *                                                               (errno EEXIST: another publisher runs on the name)
+    */
+    RFU6xx_TagBus* RFU6xx_TagBus_create (const char* name, size_t capacity, mode_t mode, gid_t group);
+
+    /*
+    * Function:  RFU6xx_TagBus_delete
+    * --------------------
+    * Marks the bus as closed and removes its name. Attached readers keep their mapping
+    * and can still read the events that were not overwritten.
+    *
+    *  parameters:
+    *               -> RFU6xx_TagBus* bus
+    *
+    *  returns:
+    */
+    void RFU6xx_TagBus_delete (RFU6xx_TagBus* bus);
+
+    /*
+    * Function:  RFU6xx_TagBus_publish
+    * --------------------
+    * Copies an event into the next slot and wakes sleeping readers. Must only be called from
+    * one thread at a time, never blocks.
+    *
+    *  parameters:
+    *               -> RFU6xx_TagBus* bus
+    *               -> const RFU6xx_TagEvent* event
+    *
+    *  returns:
+    */
+    void RFU6xx_TagBus_publish (RFU6xx_TagBus* bus, const RFU6xx_TagEvent* event);
+
+    /*
+    * Function:  RFU6xx_TagBus_publishScanData
+    * --------------------
+    * Converts scan data (EPC as hex string) into an event with the current time and publishes it.
+    *
+    *  parameters:
+    *               -> RFU6xx_TagBus* bus
+    *               -> UA_UInt32 deviceId
+    *               -> const UA_String* scanData                /-> EPC as hex string
+    *
+    *  returns:
+    *               -> UA_Boolean                               /-> false if the scan data was invalid
+    */
+    UA_Boolean RFU6xx_TagBus_publishScanData (RFU6xx_TagBus* bus, UA_UInt32 deviceId, const UA_String* scanData);
+
+    /*
+    * Function:  RFU6xx_TagBus_onLastScanData
+    * --------------------
+    * RFU6xx_LastScanDataCallback that publishes every LastScanData notification.
+    * The context is a RFU6xx_TagBusProducer, e.g.:
+    *       subscribeLastScanData(device, 100, 10, RFU6xx_TagBus_onLastScanData, &producer, &subscriptionId);
+    */
+    void RFU6xx_TagBus_onLastScanData (RFU6xx_Device* device, const UA_String* lastScanData, void* context);
+
+    /*
+    * Function:  RFU6xx_TagBus_getStats
+    * --------------------
+    *
+    *  parameters:
+    *               -> RFU6xx_TagBus* bus
+    *               -> RFU6xx_TagBusStats* stats
+    *
+    *  returns:
+    */
+    void RFU6xx_TagBus_getStats (RFU6xx_TagBus* bus, RFU6xx_TagBusStats* stats);
+
+    // ------------------------------------------------------------------------------------------------------------------------
+
+    /*
+    * Function:  RFU6xx_TagBusReader_open
+    * --------------------
+    * Attaches to the bus of a publisher. A reader must only be used by one thread.
+    * The process needs read and write permission on the shared memory object.
+    *
+    *  parameters:
+    *               -> const char* name                         /-> Shared memory name given to RFU6xx_TagBus_create
+    *               -> UA_Boolean fromOldest                    /-> true == start at the oldest event still in the ring,
+    *                                                               false == start with the next published event
+    *
+    *  returns:
+    *               -> RFU6xx_TagBusReader*                     /-> NULL if the bus does not exist (yet) or access is denied (errno)
+    */
+    RFU6xx_TagBusReader* RFU6xx_TagBusReader_open (const char* name, UA_Boolean fromOldest);
+
+    /*
+    * Function:  RFU6xx_TagBusReader_close
+    * --------------------
+    *
+    *  parameters:
+    *               -> RFU6xx_TagBusReader* reader
+    *
+    *  returns:
+    */
+    void RFU6xx_TagBusReader_close (RFU6xx_TagBusReader* reader);
+
+    /*
+    * Function:  RFU6xx_TagBusReader_read
+    * --------------------
+    * Copies up to maxEvents events and advances the cursor. Overwritten events are skipped and counted as lost.
+    *
+    *  parameters:
+    *               -> RFU6xx_TagBusReader* reader
+    *               -> RFU6xx_TagEvent events[]                 /-> Buffer for the events
+    *               -> size_t maxEvents
+    *
+    *  returns:
+    *               -> size_t                                   /-> Number of events copied, 0 if there is no new event
+    */
+    size_t RFU6xx_TagBusReader_read (RFU6xx_TagBusReader* reader, RFU6xx_TagEvent events[], size_t maxEvents);
+
+    /*
+    * Function:  RFU6xx_TagBusReader_peek
+    * --------------------
+    * Zero-copy access to the next event in the shared memory. The publisher may overwrite the slot
+    * while the event is used, RFU6xx_TagBusReader_consume tells afterwards whether it was intact.
+    *
+    *  parameters:
+    *               -> RFU6xx_TagBusReader* reader
+    *
+    *  returns:
+    *               -> const RFU6xx_TagEvent*                   /-> NULL if there is no new event
+    */
+    const RFU6xx_TagEvent* RFU6xx_TagBusReader_peek (RFU6xx_TagBusReader* reader);
+
+    /*
+    * Function:  RFU6xx_TagBusReader_consume
+    * --------------------
+    * Advances the cursor past the event returned by RFU6xx_TagBusReader_peek.
+    *
+    *  parameters:
+    *               -> RFU6xx_TagBusReader* reader
+    *
+    *  returns:
+    *               -> UA_Boolean                               /-> false if the event was overwritten while it was used
+    *                                                               (it is counted as lost, discard what was read from it)
+    */
+    UA_Boolean RFU6xx_TagBusReader_consume (RFU6xx_TagBusReader* reader);
+
+    /*
+    * Function:  RFU6xx_TagBusReader_wait
+    * --------------------
+    * Sleeps until an event after the cursor is published, the bus is closed or the timeout expires.
+    *
+    *  parameters:
+    *               -> RFU6xx_TagBusReader* reader
+    *               -> UA_UInt32 timeoutMs                      /-> 0 == no timeout
+    *
+    *  returns:
+    *               -> UA_Boolean                               /-> true if there is a new event
+    */
+    UA_Boolean RFU6xx_TagBusReader_wait (RFU6xx_TagBusReader* reader, UA_UInt32 timeoutMs);
+
+    /*
+    * Function:  RFU6xx_TagBusReader_isClosed
+    * --------------------
+    * The publisher deleted or replaced the bus. Remaining events can still be read,
+    * afterwards the reader should be closed and opened again.
+    *
+    *  parameters:
+    *               -> RFU6xx_TagBusReader* reader
+    *
+    *  returns:
+    *               -> UA_Boolean
+    */
+    UA_Boolean RFU6xx_TagBusReader_isClosed (RFU6xx_TagBusReader* reader);
+
+    /*
+    * Function:  RFU6xx_TagBusReader_getStats
+    * --------------------
+    *
+    *  parameters:
+    *               -> RFU6xx_TagBusReader* reader
+    *               -> RFU6xx_TagBusReaderStats* stats
+    *
+    *  returns:
+    */
+    void RFU6xx_TagBusReader_getStats (RFU6xx_TagBusReader* reader, RFU6xx_TagBusReaderStats* stats);
+
+#endif
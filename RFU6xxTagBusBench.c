@@ -0,0 +1,211 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+*
+* @contact: sebastian.heidepriem@sick.de
+*
+*
+* Benchmark of the shared-memory tag event bus (RFU6xxTagBus) with reader processes:
+*   1.) <readers> processes attach to the bus, odd readers copy events in batches (read),
+*       even readers use them in place (peek / consume). All sleep on the futex when the bus is empty.
+*   2.) The publisher publishes <events> events at <rate> events/s (0 == as fast as possible).
+*   3.) Each reader checks that the events arrive in order and that every gap was counted as lost,
+*       and reports the latency from publishing to reading. The last reader sleeps <slow us>
+*       after every event to show overrun detection.
+*
+* Usage: ./tagbusbench [readers] [events] [rate] [capacity] [slow us]
+*/
+
+#include "RFU6xxTagBus.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_BUS_NAME "/rfu6xx-tagbusbench"
+#define READ_BATCH 64
+
+static double nowNs (void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int compareDouble (const void* a, const void* b)
+{
+    double x = *(const double*) a, y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+// Checks the order of an event (the publisher writes the sequence number into deviceId) and records its latency
+static void receive (const RFU6xx_TagEvent* event, UA_UInt32* expected, UA_UInt64* gaps, UA_UInt64* disorder,
+    double* latenciesUs, size_t* latenciesSize, size_t latenciesCapacity)
+{
+    if (event->deviceId < *expected) (*disorder)++;
+    else *gaps += event->deviceId - *expected;
+    *expected = event->deviceId + 1;
+    if (*latenciesSize < latenciesCapacity)
+    {
+        latenciesUs[(*latenciesSize)++] = (double) (UA_DateTime_now() - event->timestamp) / UA_DATETIME_USEC;
+    }
+}
+
+static int runReader (int index, size_t events, UA_UInt32 slowUs, int readyFd)
+{
+    RFU6xx_TagBusReader* reader = RFU6xx_TagBusReader_open(BENCH_BUS_NAME, true);
+    if (reader == NULL)
+    {
+        fprintf(stderr, "reader %d: could not open the bus\n", index);
+        return EXIT_FAILURE;
+    }
+    (void) !write(readyFd, "r", 1);
+    close(readyFd);
+
+    UA_Boolean zeroCopy = index % 2 == 0;
+    double* latenciesUs = (double*) malloc(events * sizeof(double));
+    size_t latenciesSize = 0;
+    UA_UInt32 expected = 0;
+    UA_UInt64 gaps = 0, disorder = 0;
+    RFU6xx_TagEvent batch[READ_BATCH];
+
+    while (true)
+    {
+        size_t count = 0;
+        if (zeroCopy)
+        {
+            const RFU6xx_TagEvent* event;
+            while ((event = RFU6xx_TagBusReader_peek(reader)) != NULL)
+            {
+                RFU6xx_TagEvent copy = *event;
+                if (RFU6xx_TagBusReader_consume(reader))
+                {
+                    receive(&copy, &expected, &gaps, &disorder, latenciesUs, &latenciesSize, latenciesUs ? events : 0);
+                }
+                count++;
+                if (slowUs > 0) usleep(slowUs);
+            }
+        }
+        else
+        {
+            size_t n;
+            while ((n = RFU6xx_TagBusReader_read(reader, batch, READ_BATCH)) > 0)
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    receive(&batch[i], &expected, &gaps, &disorder, latenciesUs, &latenciesSize, latenciesUs ? events : 0);
+                    if (slowUs > 0) usleep(slowUs);
+                }
+                count += n;
+            }
+        }
+        if (count == 0 && !RFU6xx_TagBusReader_wait(reader, 100) && RFU6xx_TagBusReader_isClosed(reader)) break;
+    }
+
+    RFU6xx_TagBusReaderStats stats;
+    RFU6xx_TagBusReader_getStats(reader, &stats);
+    RFU6xx_TagBusReader_close(reader);
+
+    double p50 = 0, p99 = 0, max = 0;
+    if (latenciesSize > 0)
+    {
+        qsort(latenciesUs, latenciesSize, sizeof(double), compareDouble);
+        p50 = latenciesUs[(size_t) (0.50 * (latenciesSize - 1))];
+        p99 = latenciesUs[(size_t) (0.99 * (latenciesSize - 1))];
+        max = latenciesUs[latenciesSize - 1];
+    }
+    free(latenciesUs);
+
+    // Lost events not seen as a gap were published after the last event of this reader
+    printf("reader %d (%s%s): %llu read, %llu lost, %llu gaps, %llu out of order, latency p50 %.1f us p99 %.1f us max %.1f us\n",
+        index, zeroCopy ? "peek" : "read", slowUs ? ", slow" : "", (unsigned long long) stats.read, (unsigned long long) stats.lost,
+        (unsigned long long) gaps, (unsigned long long) disorder, p50, p99, max);
+    fflush(stdout);
+    return (disorder == 0 && gaps <= stats.lost && stats.read + stats.lost <= events) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+int main (int argc, char *argv[])
+{
+    int readers = argc > 1 ? atoi(argv[1]) : 3;
+    size_t events = argc > 2 ? (size_t) atol(argv[2]) : 2000000;
+    double rate = argc > 3 ? atof(argv[3]) : 200000;
+    size_t capacity = argc > 4 ? (size_t) atol(argv[4]) : RFU6xx_TAGBUS_DEFAULT_CAPACITY;
+    UA_UInt32 slowUs = argc > 5 ? (UA_UInt32) atol(argv[5]) : 0;
+    if (readers < 0 || events == 0 || events > UINT32_MAX)
+    {
+        fprintf(stderr, "Usage: %s [readers] [events] [rate] [capacity] [slow us]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    RFU6xx_TagBus* bus = RFU6xx_TagBus_create(BENCH_BUS_NAME, capacity, RFU6xx_TAGBUS_DEFAULT_MODE, RFU6xx_TAGBUS_PUBLISHER_GROUP);
+    if (bus == NULL)
+    {
+        perror("Could not create the bus");
+        return EXIT_FAILURE;
+    }
+
+    int ready[2];
+    if (pipe(ready) != 0)
+    {
+        RFU6xx_TagBus_delete(bus);
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < readers; i++)
+    {
+        if (fork() == 0)
+        {
+            close(ready[0]);
+            _exit(runReader(i, events, i == readers - 1 ? slowUs : 0, ready[1]));
+        }
+    }
+    close(ready[1]);
+    char byte;
+    for (int i = 0; i < readers; i++)
+    {
+        if (read(ready[0], &byte, 1) != 1) break;
+    }
+    close(ready[0]);
+
+    // Publish paced against the start time, so a late publisher catches up instead of drifting
+    RFU6xx_TagEvent event;
+    memset(&event, 0, sizeof(event));
+    event.epcLength = 12;
+    double start = nowNs();
+    for (size_t i = 0; i < events; i++)
+    {
+        if (rate > 0)
+        {
+            double due = start + i * 1e9 / rate;
+            while (nowNs() < due);
+        }
+        event.deviceId = (UA_UInt32) i;
+        memcpy(event.epc, &i, sizeof(i));
+        event.timestamp = UA_DateTime_now();
+        RFU6xx_TagBus_publish(bus, &event);
+    }
+    double elapsedS = (nowNs() - start) / 1e9;
+
+    RFU6xx_TagBusStats stats;
+    RFU6xx_TagBus_getStats(bus, &stats);
+    printf("publisher: %llu events in %.2f s (%.0f events/s, %.1f ns/event), %llu wakeups, capacity %zu\n",
+        (unsigned long long) stats.published, elapsedS, stats.published / elapsedS, elapsedS * 1e9 / stats.published,
+        (unsigned long long) stats.wakeups, stats.capacity);
+    fflush(stdout);
+    RFU6xx_TagBus_delete(bus);
+
+    int failures = 0, status;
+    while (wait(&status) > 0)
+    {
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) failures++;
+    }
+    if (failures > 0) printf("%d reader(s) failed\n", failures);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,316 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+*
+* @contact: sebastian.heidepriem@sick.de
+*/
+
+#include "RFU6xxTagCache.h"
+#include "RFU6xxHex.h"
+
+#define NO_ENTRY UINT32_MAX
+
+// Entries are preallocated, linked by index into a hash chain (all ranges of an EPC are in one chain)
+// and into the LRU list. Free entries are chained through hashNext.
+typedef struct {
+    UA_UInt32 hashNext;
+    UA_UInt32 lruPrev;                          // Towards the most recently used entry
+    UA_UInt32 lruNext;
+    UA_UInt32 length;
+    uint64_t hash;
+    UA_Int32 bank;
+    UA_Int32 offset;
+    UA_UInt16 epcLength;
+    UA_Byte epc[RFU6xx_MAX_TAG_ID_SIZE];
+    UA_Byte data[RFU6xx_TAG_CACHE_MAX_DATA_SIZE];
+} CacheEntry;
+
+typedef struct {
+    UA_Int32 bank;
+    UA_Int32 offset;
+    UA_Int32 length;                            // 0 == up to the end of the bank
+} ImmutableRegion;
+
+struct RFU6xx_TagCache {
+    CacheEntry* entries;
+    size_t capacity;
+    UA_UInt32* buckets;
+    size_t bucketMask;
+    UA_UInt32 freeList;
+    UA_UInt32 lruHead;                          // Most recently used
+    UA_UInt32 lruTail;                          // Least recently used, replaced first
+
+    ImmutableRegion regions[RFU6xx_TAG_CACHE_MAX_REGIONS];
+    size_t regionsSize;
+
+    // Single writer (the thread using the device), readers on other threads only need whole values
+    UA_UInt64 hits;
+    UA_UInt64 misses;
+    UA_UInt64 evictions;
+    UA_UInt64 invalidations;
+    size_t size;
+};
+
+#define COUNTER_LOAD(counter) __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+#define COUNTER_STORE(counter, value) __atomic_store_n(&(counter), (value), __ATOMIC_RELAXED)
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+static RFU6xx_TagCache* newCache (size_t capacity)
+{
+    if (capacity == 0 || capacity >= NO_ENTRY) return NULL;
+    size_t buckets = 16;
+    while (buckets < 2 * capacity) buckets <<= 1;
+
+    RFU6xx_TagCache* cache = (RFU6xx_TagCache*) UA_calloc(1, sizeof(RFU6xx_TagCache));
+    if (cache == NULL) return NULL;
+    cache->entries = (CacheEntry*) UA_malloc(capacity * sizeof(CacheEntry));
+    cache->buckets = (UA_UInt32*) UA_malloc(buckets * sizeof(UA_UInt32));
+    if (cache->entries == NULL || cache->buckets == NULL)
+    {
+        RFU6xx_TagCache_delete(cache);
+        return NULL;
+    }
+    cache->capacity = capacity;
+    cache->bucketMask = buckets - 1;
+    cache->regions[0].bank = RFU6xx_TID_BANK;
+    cache->regionsSize = 1;
+
+    // Empty cache: all buckets empty, all entries on the free list
+    for (size_t i = 0; i < buckets; i++) cache->buckets[i] = NO_ENTRY;
+    for (size_t i = 0; i < capacity; i++) cache->entries[i].hashNext = i + 1 < capacity ? (UA_UInt32) (i + 1) : NO_ENTRY;
+    cache->freeList = 0;
+    cache->lruHead = NO_ENTRY;
+    cache->lruTail = NO_ENTRY;
+    return cache;
+}
+
+void RFU6xx_TagCache_delete (RFU6xx_TagCache* cache)
+{
+    if (cache == NULL) return;
+    UA_free(cache->entries);
+    UA_free(cache->buckets);
+    UA_free(cache);
+}
+
+UA_StatusCode RFU6xx_TagCache_enable (RFU6xx_Device* device, size_t capacity)
+{
+    if (capacity == 0) return UA_STATUSCODE_BADINVALIDARGUMENT;
+    RFU6xx_TagCache* cache = newCache(capacity);
+    if (cache == NULL) return UA_STATUSCODE_BADOUTOFMEMORY;
+    RFU6xx_TagCache_delete(device->tagCache);
+    device->tagCache = cache;
+    return UA_STATUSCODE_GOOD;
+}
+
+void RFU6xx_TagCache_disable (RFU6xx_Device* device)
+{
+    RFU6xx_TagCache_delete(device->tagCache);
+    device->tagCache = NULL;
+}
+
+UA_StatusCode RFU6xx_TagCache_addImmutableRegion (RFU6xx_Device* device, UA_Int32 bank, UA_Int32 offset, UA_Int32 length)
+{
+    RFU6xx_TagCache* cache = device->tagCache;
+    if (cache == NULL) return UA_STATUSCODE_BADINVALIDSTATE;
+    if (offset < 0 || length < 0) return UA_STATUSCODE_BADINVALIDARGUMENT;
+    if (cache->regionsSize == RFU6xx_TAG_CACHE_MAX_REGIONS) return UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+
+    ImmutableRegion* region = &cache->regions[cache->regionsSize++];
+    region->bank = bank;
+    region->offset = offset;
+    region->length = length;
+    return UA_STATUSCODE_GOOD;
+}
+
+void RFU6xx_TagCache_getStats (RFU6xx_Device* device, RFU6xx_TagCacheStats* stats)
+{
+    memset(stats, 0, sizeof(RFU6xx_TagCacheStats));
+    RFU6xx_TagCache* cache = device->tagCache;
+    if (cache == NULL) return;
+    stats->hits = COUNTER_LOAD(cache->hits);
+    stats->misses = COUNTER_LOAD(cache->misses);
+    stats->evictions = COUNTER_LOAD(cache->evictions);
+    stats->invalidations = COUNTER_LOAD(cache->invalidations);
+    stats->size = COUNTER_LOAD(cache->size);
+    stats->capacity = cache->capacity;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+// FNV-1a of the binary EPC
+static uint64_t hashEpc (const UA_Byte* epc, size_t length)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= epc[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Decodes the hex id, false if it is no valid EPC
+static UA_Boolean decodeId (UA_String id, UA_Byte epc[RFU6xx_MAX_TAG_ID_SIZE], size_t* epcLength)
+{
+    if (id.length == 0 || id.length > 2*RFU6xx_MAX_TAG_ID_SIZE || hexDecode(id.data, id.length, epc) != 0) return false;
+    *epcLength = id.length / 2;
+    return true;
+}
+
+static UA_Boolean isImmutable (const RFU6xx_TagCache* cache, UA_Int32 bank, UA_Int32 offset, UA_Int32 length)
+{
+    if (offset < 0 || length <= 0 || length > RFU6xx_TAG_CACHE_MAX_DATA_SIZE) return false;
+    for (size_t i = 0; i < cache->regionsSize; i++)
+    {
+        const ImmutableRegion* region = &cache->regions[i];
+        if (region->bank != bank || offset < region->offset) continue;
+        if (region->length == 0 || (int64_t) offset + length <= (int64_t) region->offset + region->length) return true;
+    }
+    return false;
+}
+
+static UA_Boolean sameEpc (const CacheEntry* entry, uint64_t hash, const UA_Byte* epc, size_t epcLength)
+{
+    return entry->hash == hash && entry->epcLength == epcLength && memcmp(entry->epc, epc, epcLength) == 0;
+}
+
+static void lruUnlink (RFU6xx_TagCache* cache, UA_UInt32 index)
+{
+    CacheEntry* entry = &cache->entries[index];
+    if (entry->lruPrev != NO_ENTRY) cache->entries[entry->lruPrev].lruNext = entry->lruNext;
+    else cache->lruHead = entry->lruNext;
+    if (entry->lruNext != NO_ENTRY) cache->entries[entry->lruNext].lruPrev = entry->lruPrev;
+    else cache->lruTail = entry->lruPrev;
+}
+
+static void lruPushFront (RFU6xx_TagCache* cache, UA_UInt32 index)
+{
+    CacheEntry* entry = &cache->entries[index];
+    entry->lruPrev = NO_ENTRY;
+    entry->lruNext = cache->lruHead;
+    if (cache->lruHead != NO_ENTRY) cache->entries[cache->lruHead].lruPrev = index;
+    else cache->lruTail = index;
+    cache->lruHead = index;
+}
+
+// Removes the entry that *link points to from its hash chain and the LRU list and frees it
+static void removeEntry (RFU6xx_TagCache* cache, UA_UInt32* link)
+{
+    UA_UInt32 index = *link;
+    CacheEntry* entry = &cache->entries[index];
+    *link = entry->hashNext;
+    lruUnlink(cache, index);
+    entry->hashNext = cache->freeList;
+    cache->freeList = index;
+    COUNTER_STORE(cache->size, cache->size - 1);
+}
+
+void RFU6xx_TagCache_clear (RFU6xx_Device* device)
+{
+    RFU6xx_TagCache* cache = device->tagCache;
+    if (cache == NULL) return;
+    for (size_t i = 0; i <= cache->bucketMask; i++)
+    {
+        while (cache->buckets[i] != NO_ENTRY) removeEntry(cache, &cache->buckets[i]);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+RFU6xx_TagCacheResult RFU6xx_TagCache_lookup (RFU6xx_TagCache* cache, UA_String id, UA_Int32 bank, UA_Int32 offset,
+    UA_Int32 length, UA_Byte* buffer)
+{
+    UA_Byte epc[RFU6xx_MAX_TAG_ID_SIZE];
+    size_t epcLength;
+    if (cache == NULL || !isImmutable(cache, bank, offset, length) || !decodeId(id, epc, &epcLength)) return RFU6xx_TAG_CACHE_BYPASS;
+
+    // A cached range that contains the requested one answers the read
+    uint64_t hash = hashEpc(epc, epcLength);
+    for (UA_UInt32 index = cache->buckets[hash & cache->bucketMask]; index != NO_ENTRY; index = cache->entries[index].hashNext)
+    {
+        CacheEntry* entry = &cache->entries[index];
+        if (!sameEpc(entry, hash, epc, epcLength) || entry->bank != bank || offset < entry->offset
+            || (int64_t) offset + length > (int64_t) entry->offset + entry->length) continue;
+
+        memcpy(buffer, &entry->data[offset - entry->offset], (size_t) length);
+        lruUnlink(cache, index);
+        lruPushFront(cache, index);
+        COUNTER_STORE(cache->hits, cache->hits + 1);
+        return RFU6xx_TAG_CACHE_HIT;
+    }
+    COUNTER_STORE(cache->misses, cache->misses + 1);
+    return RFU6xx_TAG_CACHE_MISS;
+}
+
+void RFU6xx_TagCache_insert (RFU6xx_TagCache* cache, UA_String id, UA_Int32 bank, UA_Int32 offset, const UA_Byte* data, size_t length)
+{
+    UA_Byte epc[RFU6xx_MAX_TAG_ID_SIZE];
+    size_t epcLength;
+    if (cache == NULL || length > RFU6xx_TAG_CACHE_MAX_DATA_SIZE || !isImmutable(cache, bank, offset, (UA_Int32) length)
+        || !decodeId(id, epc, &epcLength)) return;
+
+    // Ranges of the EPC inside the new one are redundant
+    uint64_t hash = hashEpc(epc, epcLength);
+    UA_UInt32* bucket = &cache->buckets[hash & cache->bucketMask];
+    UA_UInt32* link = bucket;
+    while (*link != NO_ENTRY)
+    {
+        CacheEntry* entry = &cache->entries[*link];
+        if (sameEpc(entry, hash, epc, epcLength) && entry->bank == bank && entry->offset >= offset
+            && (int64_t) entry->offset + entry->length <= (int64_t) offset + (int64_t) length)
+        {
+            removeEntry(cache, link);
+        }
+        else link = &entry->hashNext;
+    }
+
+    // Take a free entry or replace the least recently used one
+    if (cache->freeList == NO_ENTRY)
+    {
+        CacheEntry* victim = &cache->entries[cache->lruTail];
+        link = &cache->buckets[victim->hash & cache->bucketMask];
+        while (*link != cache->lruTail) link = &cache->entries[*link].hashNext;
+        removeEntry(cache, link);
+        COUNTER_STORE(cache->evictions, cache->evictions + 1);
+    }
+    UA_UInt32 index = cache->freeList;
+    CacheEntry* entry = &cache->entries[index];
+    cache->freeList = entry->hashNext;
+
+    entry->hash = hash;
+    entry->epcLength = (UA_UInt16) epcLength;
+    memcpy(entry->epc, epc, epcLength);
+    entry->bank = bank;
+    entry->offset = offset;
+    entry->length = (UA_UInt32) length;
+    memcpy(entry->data, data, length);
+    entry->hashNext = *bucket;
+    *bucket = index;
+    lruPushFront(cache, index);
+    COUNTER_STORE(cache->size, cache->size + 1);
+}
+
+void RFU6xx_TagCache_invalidate (RFU6xx_TagCache* cache, UA_String id, UA_Int32 bank, UA_Int32 offset, size_t length)
+{
+    UA_Byte epc[RFU6xx_MAX_TAG_ID_SIZE];
+    size_t epcLength;
+    if (cache == NULL || cache->size == 0 || !decodeId(id, epc, &epcLength)) return;
+
+    uint64_t hash = hashEpc(epc, epcLength);
+    UA_UInt32* link = &cache->buckets[hash & cache->bucketMask];
+    while (*link != NO_ENTRY)
+    {
+        CacheEntry* entry = &cache->entries[*link];
+        if (sameEpc(entry, hash, epc, epcLength) && entry->bank == bank
+            && (int64_t) entry->offset < (int64_t) offset + (int64_t) length
+            && (int64_t) offset < (int64_t) entry->offset + entry->length)
+        {
+            removeEntry(cache, link);
+            COUNTER_STORE(cache->invalidations, cache->invalidations + 1);
+        }
+        else link = &entry->hashNext;
+    }
+}
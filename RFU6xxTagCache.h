@@ -0,0 +1,184 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+* @contact: sebastian.heidepriem@sick.de
+*
+* Cache of immutable tag memory of a device. Regions that never change for a given chip (the TID bank,
+* permalocked parts of the USER bank) are declared per device, readTag and readTagBytes of a range inside
+* such a region are answered from the cache after the first successful read of the EPC, without a call
+* to the reader. Entries are kept per EPC, bank and range; a read of a part of a cached range is answered
+* from it as well. Every write (writeTag, writeTagBytes, writeTagAsync, writeTagBank, callTagOperations)
+* drops the cached ranges of the EPC it overlaps, whether the write succeeded or not. The cache is bounded,
+* the least recently used entry is replaced when it is full. Like the device, it must only be used by one
+* thread at a time, the counters can be read from any thread.
+*/
+
+#ifndef RFU6xxTAGCACHE_H
+#define RFU6xxTAGCACHE_H
+
+    #include "RFU6xxClient.h"
+
+    // Memory bank of the tag identifier (chip vendor, model and serial number)
+    #define RFU6xx_TID_BANK 2
+    // Largest cached range in bytes, longer reads always go to the reader
+    #define RFU6xx_TAG_CACHE_MAX_DATA_SIZE 128
+    // Immutable regions that can be declared per device
+    #define RFU6xx_TAG_CACHE_MAX_REGIONS 8
+
+    typedef struct RFU6xx_TagCache RFU6xx_TagCache;
+
+    typedef struct {
+        UA_UInt64 hits;                             // Reads answered from the cache
+        UA_UInt64 misses;                           // Reads of an immutable region that went to the reader
+        UA_UInt64 evictions;                        // Entries replaced because the cache was full
+        UA_UInt64 invalidations;                    // Entries dropped by writes
+        size_t size;                                // Entries in the cache
+        size_t capacity;
+    } RFU6xx_TagCacheStats;
+
+    // Result of RFU6xx_TagCache_lookup
+    typedef enum {
+        RFU6xx_TAG_CACHE_HIT,
+        RFU6xx_TAG_CACHE_MISS,                      // Cacheable, insert the data after the read
+        RFU6xx_TAG_CACHE_BYPASS                     // Not in an immutable region (or invalid id), not cached
+    } RFU6xx_TagCacheResult;
+
+    /*
+    * Function:  RFU6xx_TagCache_enable
+    * --------------------
+    * Creates the cache of a device with the TID bank as immutable region. Must be called
+    * before the device is used by other threads. Calling it again replaces the cache and its regions.
+    *
+    *  parameters:
+    *               -> RFU6xx_Device* device
+    *               -> size_t capacity                          /-> Number of cached ranges
+    *
+    *  returns:
+    *               -> UA_StatusCode                            /-> UA_STATUSCODE_BADINVALIDARGUMENT if the capacity is 0
+    */
+    UA_StatusCode RFU6xx_TagCache_enable (RFU6xx_Device* device, size_t capacity);
+
+    /*
+    * Function:  RFU6xx_TagCache_disable
+    * --------------------
+    * Deletes the cache of a device, all reads go to the reader again.
+    *
+    *  parameters:
+    *               -> RFU6xx_Device* device
+    *
+    *  returns:
+    */
+    void RFU6xx_TagCache_disable (RFU6xx_Device* device);
+
+    /*
+    * Function:  RFU6xx_TagCache_addImmutableRegion
+    * --------------------
+    * Declares a region whose content does not change any more, e.g. a permalocked part of the USER bank.
+    * Only declare regions that are locked on every tag, the cache cannot tell a locked from an open tag.
+    *
+    *  parameters:
+    *               -> RFU6xx_Device* device
+    *               -> UA_Int32 bank
+    *               -> UA_Int32 offset                          /-> In bytes
+    *               -> UA_Int32 length                          /-> In bytes, 0 == up to the end of the bank
+    *
+    *  returns:
+    *               -> UA_StatusCode                            /-> UA_STATUSCODE_BADINVALIDSTATE if the cache is not enabled,
+    *                                                               UA_STATUSCODE_BADRESOURCEUNAVAILABLE if all regions are used
+    */
+    UA_StatusCode RFU6xx_TagCache_addImmutableRegion (RFU6xx_Device* device, UA_Int32 bank, UA_Int32 offset, UA_Int32 length);
+
+    /*
+    * Function:  RFU6xx_TagCache_clear
+    * --------------------
+    * Drops all entries, e.g. after tags were exchanged with tags of the same EPC.
+    *
+    *  parameters:
+    *               -> RFU6xx_Device* device
+    *
+    *  returns:
+    */
+    void RFU6xx_TagCache_clear (RFU6xx_Device* device);
+
+    /*
+    * Function:  RFU6xx_TagCache_getStats
+    * --------------------
+    * Reads the counters of the cache of a device (all 0 if it is not enabled). Can be called from any thread.
+    *
+    *  parameters:
+    *               -> RFU6xx_Device* device
+    *               -> RFU6xx_TagCacheStats* stats
+    *
+    *  returns:
+    */
+    void RFU6xx_TagCache_getStats (RFU6xx_Device* device, RFU6xx_TagCacheStats* stats);
+
+    // ------------------------------------------------------------------------------------------------------------------------
+    // Used by the client functions
+
+    /*
+    * Function:  RFU6xx_TagCache_delete
+    * --------------------
+    *
+    *  parameters:
+    *               -> RFU6xx_TagCache* cache                   /-> May be NULL
+    *
+    *  returns:
+    */
+    void RFU6xx_TagCache_delete (RFU6xx_TagCache* cache);
+
+    /*
+    * Function:  RFU6xx_TagCache_lookup
+    * --------------------
+    * Copies the cached bytes of a range into the buffer.
+    *
+    *  parameters:
+    *               -> RFU6xx_TagCache* cache
+    *               -> UA_String id                             /-> EPC as hex string
+    *               -> UA_Int32 bank
+    *               -> UA_Int32 offset
+    *               -> UA_Int32 length
+    *               -> UA_Byte* buffer                          /-> length bytes, filled on RFU6xx_TAG_CACHE_HIT
+    *
+    *  returns:
+    *               -> RFU6xx_TagCacheResult
+    */
+    RFU6xx_TagCacheResult RFU6xx_TagCache_lookup (RFU6xx_TagCache* cache, UA_String id, UA_Int32 bank, UA_Int32 offset,
+        UA_Int32 length, UA_Byte* buffer);
+
+    /*
+    * Function:  RFU6xx_TagCache_insert
+    * --------------------
+    * Stores the bytes read from a range after a RFU6xx_TAG_CACHE_MISS.
+    *
+    *  parameters:
+    *               -> RFU6xx_TagCache* cache
+    *               -> UA_String id                             /-> EPC as hex string
+    *               -> UA_Int32 bank
+    *               -> UA_Int32 offset
+    *               -> const UA_Byte* data
+    *               -> size_t length
+    *
+    *  returns:
+    */
+    void RFU6xx_TagCache_insert (RFU6xx_TagCache* cache, UA_String id, UA_Int32 bank, UA_Int32 offset, const UA_Byte* data, size_t length);
+
+    /*
+    * Function:  RFU6xx_TagCache_invalidate
+    * --------------------
+    * Drops the cached ranges of the EPC that overlap a written range. Called before every write.
+    *
+    *  parameters:
+    *               -> RFU6xx_TagCache* cache                   /-> May be NULL
+    *               -> UA_String id                             /-> EPC as hex string
+    *               -> UA_Int32 bank
+    *               -> UA_Int32 offset
+    *               -> size_t length
+    *
+    *  returns:
+    */
+    void RFU6xx_TagCache_invalidate (RFU6xx_TagCache* cache, UA_String id, UA_Int32 bank, UA_Int32 offset, size_t length);
+
+#endif
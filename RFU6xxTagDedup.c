@@ -0,0 +1,281 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+*
+* @contact: sebastian.heidepriem@sick.de
+*/
+
+#include "RFU6xxTagDedup.h"
+#include "RFU6xxHex.h"
+
+// One cache line per tag
+typedef struct {
+    uint64_t hash;                              // 0 == free slot
+    UA_DateTime firstSeen;
+    UA_DateTime lastSeen;
+    UA_DateTime lastReported;
+    UA_UInt16 epcLength;
+    UA_Byte epc[RFU6xx_DEDUP_INLINE_EPC_SIZE];
+} DedupEntry;
+
+struct RFU6xx_TagDedup {
+    DedupEntry* slots;
+    size_t mask;
+    size_t entries;
+    size_t maxEntries;
+    size_t sweepCursor;
+
+    UA_DateTime ttl;
+    UA_DateTime presentInterval;
+    RFU6xx_TagTransitionCallback callback;
+    void* context;
+
+    UA_UInt64 observed;
+    UA_UInt64 firstSeen;
+    UA_UInt64 present;
+    UA_UInt64 departed;
+    UA_UInt64 overflows;
+};
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+// 64 bit hash of the EPC, 8 bytes per step. Never 0, that marks a free slot.
+static uint64_t hashEpc (const UA_Byte* epc, size_t length)
+{
+    uint64_t hash = 0x9E3779B97F4A7C15ULL ^ (length * 0xFF51AFD7ED558CCDULL);
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, &epc[i], 8);
+        hash = (hash ^ word) * 0xBF58476D1CE4E5B9ULL;
+        hash ^= hash >> 31;
+    }
+    if (i < length)
+    {
+        uint64_t word = 0;
+        memcpy(&word, &epc[i], length - i);
+        hash = (hash ^ word) * 0x94D049BB133111EBULL;
+        hash ^= hash >> 29;
+    }
+    hash ^= hash >> 32;
+    hash *= 0xD6E8FEB86659FD93ULL;
+    hash ^= hash >> 32;
+    return hash ? hash : 1;
+}
+
+static UA_Boolean entryMatches (const DedupEntry* entry, uint64_t hash, const UA_Byte* epc, UA_UInt16 epcLength)
+{
+    size_t inlineLength = epcLength < RFU6xx_DEDUP_INLINE_EPC_SIZE ? epcLength : RFU6xx_DEDUP_INLINE_EPC_SIZE;
+    return entry->hash == hash && entry->epcLength == epcLength && memcmp(entry->epc, epc, inlineLength) == 0;
+}
+
+static void report (RFU6xx_TagDedup* dedup, const DedupEntry* entry, RFU6xx_TagTransition transition)
+{
+    if (dedup->callback == NULL) return;
+    size_t inlineLength = entry->epcLength < RFU6xx_DEDUP_INLINE_EPC_SIZE ? entry->epcLength : RFU6xx_DEDUP_INLINE_EPC_SIZE;
+    dedup->callback(entry->epc, (UA_UInt16) inlineLength, transition, entry->firstSeen, entry->lastSeen, dedup->context);
+}
+
+// Backward shift deletion: entries behind the slot move up if that does not pass their home slot,
+// so lookups never need tombstones
+static void removeAt (RFU6xx_TagDedup* dedup, size_t slot)
+{
+    size_t next = slot;
+    while (true)
+    {
+        next = (next + 1) & dedup->mask;
+        if (dedup->slots[next].hash == 0) break;
+
+        size_t home = dedup->slots[next].hash & dedup->mask;
+        if (((next - home) & dedup->mask) >= ((next - slot) & dedup->mask))
+        {
+            dedup->slots[slot] = dedup->slots[next];
+            slot = next;
+        }
+    }
+    dedup->slots[slot].hash = 0;
+    dedup->entries--;
+}
+
+// Reports and removes the entry if it expired, returns true if it was removed
+static UA_Boolean expireAt (RFU6xx_TagDedup* dedup, size_t slot, UA_DateTime now)
+{
+    DedupEntry* entry = &dedup->slots[slot];
+    if (entry->hash == 0 || now - entry->lastSeen <= dedup->ttl) return false;
+
+    dedup->departed++;
+    report(dedup, entry, RFU6xx_TAG_DEPARTED);
+    removeAt(dedup, slot);
+    return true;
+}
+
+// Called with a full index: removes all expired entries, if there are none the least recently seen tag
+// is reported as departed and evicted
+static void makeRoom (RFU6xx_TagDedup* dedup, UA_DateTime now)
+{
+    if (RFU6xx_TagDedup_expire(dedup, now) > 0) return;
+
+    size_t oldest = 0;
+    UA_Boolean found = false;
+    for (size_t slot = 0; slot <= dedup->mask; slot++)
+    {
+        if (dedup->slots[slot].hash == 0) continue;
+        if (!found || dedup->slots[slot].lastSeen < dedup->slots[oldest].lastSeen)
+        {
+            oldest = slot;
+            found = true;
+        }
+    }
+
+    dedup->overflows++;
+    dedup->departed++;
+    report(dedup, &dedup->slots[oldest], RFU6xx_TAG_DEPARTED);
+    removeAt(dedup, oldest);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+RFU6xx_TagDedup* RFU6xx_TagDedup_new (size_t maxEntries, UA_UInt32 ttlMs, UA_UInt32 presentIntervalMs,
+    RFU6xx_TagTransitionCallback callback, void* context)
+{
+    if (maxEntries == 0) return NULL;
+
+    // Load factor of at most 3/4 keeps the probe sequences short
+    size_t slots = 16;
+    while (slots < maxEntries + maxEntries / 3) slots <<= 1;
+
+    RFU6xx_TagDedup* dedup = (RFU6xx_TagDedup*) UA_calloc(1, sizeof(RFU6xx_TagDedup));
+    if (dedup == NULL) return NULL;
+    dedup->slots = (DedupEntry*) UA_calloc(slots, sizeof(DedupEntry));
+    if (dedup->slots == NULL)
+    {
+        UA_free(dedup);
+        return NULL;
+    }
+    dedup->mask = slots - 1;
+    dedup->maxEntries = maxEntries;
+    dedup->ttl = (UA_DateTime) ttlMs * UA_DATETIME_MSEC;
+    dedup->presentInterval = (UA_DateTime) presentIntervalMs * UA_DATETIME_MSEC;
+    dedup->callback = callback;
+    dedup->context = context;
+    return dedup;
+}
+
+void RFU6xx_TagDedup_delete (RFU6xx_TagDedup* dedup)
+{
+    if (dedup == NULL) return;
+    UA_free(dedup->slots);
+    UA_free(dedup);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+RFU6xx_TagTransition RFU6xx_TagDedup_observe (RFU6xx_TagDedup* dedup, const UA_Byte* epc, UA_UInt16 epcLength, UA_DateTime now)
+{
+    dedup->observed++;
+
+    // Incremental sweep, a removed slot is checked again because an entry was shifted into it
+    for (int step = 0; step < RFU6xx_DEDUP_SWEEP_STEP; step++)
+    {
+        if (!expireAt(dedup, dedup->sweepCursor, now)) dedup->sweepCursor = (dedup->sweepCursor + 1) & dedup->mask;
+    }
+
+    uint64_t hash = hashEpc(epc, epcLength);
+    size_t slot = hash & dedup->mask;
+    while (dedup->slots[slot].hash != 0)
+    {
+        DedupEntry* entry = &dedup->slots[slot];
+        if (entryMatches(entry, hash, epc, epcLength))
+        {
+            // A tag that expired but was not swept yet has departed and returned
+            if (now - entry->lastSeen > dedup->ttl)
+            {
+                dedup->departed++;
+                report(dedup, entry, RFU6xx_TAG_DEPARTED);
+                entry->firstSeen = now;
+                entry->lastSeen = now;
+                entry->lastReported = now;
+                dedup->firstSeen++;
+                report(dedup, entry, RFU6xx_TAG_FIRST_SEEN);
+                return RFU6xx_TAG_FIRST_SEEN;
+            }
+
+            entry->lastSeen = now;
+            if (dedup->presentInterval > 0 && now - entry->lastReported >= dedup->presentInterval)
+            {
+                entry->lastReported = now;
+                dedup->present++;
+                report(dedup, entry, RFU6xx_TAG_PRESENT);
+                return RFU6xx_TAG_PRESENT;
+            }
+            return RFU6xx_TAG_REPEAT;
+        }
+        slot = (slot + 1) & dedup->mask;
+    }
+
+    // New tag, a full index makes room first. Removals shift entries, so the free slot is searched again.
+    if (dedup->entries >= dedup->maxEntries)
+    {
+        makeRoom(dedup, now);
+        slot = hash & dedup->mask;
+        while (dedup->slots[slot].hash != 0) slot = (slot + 1) & dedup->mask;
+    }
+
+    DedupEntry* entry = &dedup->slots[slot];
+    entry->hash = hash;
+    entry->firstSeen = now;
+    entry->lastSeen = now;
+    entry->lastReported = now;
+    entry->epcLength = epcLength;
+    memcpy(entry->epc, epc, epcLength < RFU6xx_DEDUP_INLINE_EPC_SIZE ? epcLength : RFU6xx_DEDUP_INLINE_EPC_SIZE);
+    dedup->entries++;
+
+    dedup->firstSeen++;
+    report(dedup, entry, RFU6xx_TAG_FIRST_SEEN);
+    return RFU6xx_TAG_FIRST_SEEN;
+}
+
+RFU6xx_TagTransition RFU6xx_TagDedup_observeEvent (RFU6xx_TagDedup* dedup, const RFU6xx_TagEvent* event)
+{
+    return RFU6xx_TagDedup_observe(dedup, event->epc, event->epcLength, event->timestamp);
+}
+
+RFU6xx_TagTransition RFU6xx_TagDedup_observeScanData (RFU6xx_TagDedup* dedup, const UA_String* scanData, UA_DateTime now)
+{
+    UA_Byte epc[RFU6xx_MAX_TAG_ID_SIZE];
+
+    if (scanData->length == 0 || scanData->length > 2*RFU6xx_MAX_TAG_ID_SIZE
+        || hexDecode(scanData->data, scanData->length, epc) != 0)
+    {
+        return RFU6xx_TAG_REPEAT;
+    }
+    return RFU6xx_TagDedup_observe(dedup, epc, (UA_UInt16) (scanData->length / 2), now);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+size_t RFU6xx_TagDedup_expire (RFU6xx_TagDedup* dedup, UA_DateTime now)
+{
+    size_t departed = 0;
+    for (size_t slot = 0; slot <= dedup->mask; )
+    {
+        if (expireAt(dedup, slot, now)) departed++;
+        else slot++;
+    }
+    return departed;
+}
+
+void RFU6xx_TagDedup_getStats (RFU6xx_TagDedup* dedup, RFU6xx_TagDedupStats* stats)
+{
+    stats->observed = dedup->observed;
+    stats->firstSeen = dedup->firstSeen;
+    stats->present = dedup->present;
+    stats->departed = dedup->departed;
+    stats->overflows = dedup->overflows;
+    stats->entries = dedup->entries;
+    stats->maxEntries = dedup->maxEntries;
+    stats->memoryBytes = sizeof(RFU6xx_TagDedup) + (dedup->mask + 1) * sizeof(DedupEntry);
+}
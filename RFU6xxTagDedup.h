@@ -0,0 +1,150 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+* @contact: sebastian.heidepriem@sick.de
+*
+* Time-windowed deduplication of scanned tags. A tag that stays in the field is reported
+* as first seen once, as still present at most once per present interval and as departed
+* when it was not seen for the TTL, instead of once per scan.
+* The index is an open-addressing hash table (linear probing, backward shift deletion)
+* on the binary EPC with a fixed number of 64 byte entries, so the memory is bounded.
+* Expired entries are removed by an incremental sweep that runs with every observation.
+* A new tag in a full index evicts the least recently seen tag, which is reported as departed.
+*/
+
+#ifndef RFU6xxTAGDEDUP_H
+#define RFU6xxTAGDEDUP_H
+
+    #include "RFU6xxClient.h"
+    #include "RFU6xxTagRing.h"
+
+    // EPC bytes stored in an entry, longer EPCs are compared by length, these bytes and a 64 bit hash of the whole EPC
+    #define RFU6xx_DEDUP_INLINE_EPC_SIZE 24
+
+    // Slots checked for expiry by each observation (incremental sweep)
+    #define RFU6xx_DEDUP_SWEEP_STEP 2
+
+    typedef enum {
+        RFU6xx_TAG_FIRST_SEEN,                      // Tag was not in the index
+        RFU6xx_TAG_PRESENT,                         // Tag is still in the field (at most once per present interval)
+        RFU6xx_TAG_DEPARTED,                        // Tag was not seen for the TTL
+        RFU6xx_TAG_REPEAT                           // Repeated scan, not reported
+    } RFU6xx_TagTransition;
+
+    /*
+    * Callback type for RFU6xx_TagDedup_new
+    * --------------------
+    * Called for every reported transition from the thread that calls observe / expire.
+    *
+    *  parameters:
+    *               -> const UA_Byte* epc                       /-> Binary EPC (for departed tags only the stored bytes)
+    *               -> UA_UInt16 epcLength                      /-> Length of the EPC
+    *               -> RFU6xx_TagTransition transition
+    *               -> UA_DateTime firstSeen
+    *               -> UA_DateTime lastSeen
+    *               -> void* context                            /-> User context passed to RFU6xx_TagDedup_new
+    */
+    typedef void (*RFU6xx_TagTransitionCallback)(const UA_Byte* epc, UA_UInt16 epcLength, RFU6xx_TagTransition transition,
+        UA_DateTime firstSeen, UA_DateTime lastSeen, void* context);
+
+    typedef struct {
+        UA_UInt64 observed;                         // Scans passed to observe
+        UA_UInt64 firstSeen;
+        UA_UInt64 present;
+        UA_UInt64 departed;
+        UA_UInt64 overflows;                        // Tags evicted before their TTL to make room in a full index
+        size_t entries;                             // Tags currently in the index
+        size_t maxEntries;
+        size_t memoryBytes;
+    } RFU6xx_TagDedupStats;
+
+    typedef struct RFU6xx_TagDedup RFU6xx_TagDedup;
+
+    /*
+    * Function:  RFU6xx_TagDedup_new
+    * --------------------
+    * Creates a dedup index for up to maxEntries tags at once.
+    *
+    *  parameters:
+    *               -> size_t maxEntries                        /-> Tags in the field within one TTL (the table has 4/3 of the slots)
+    *               -> UA_UInt32 ttlMs                          /-> Time without scan after which a tag departed
+    *               -> UA_UInt32 presentIntervalMs              /-> Interval of still present reports, 0 == no reports
+    *               -> RFU6xx_TagTransitionCallback callback    /-> May be NULL
+    *               -> void* context
+    *
+    *  returns:
+    *               -> RFU6xx_TagDedup*                         /-> NULL if out of memory
+    */
+    RFU6xx_TagDedup* RFU6xx_TagDedup_new (size_t maxEntries, UA_UInt32 ttlMs, UA_UInt32 presentIntervalMs,
+        RFU6xx_TagTransitionCallback callback, void* context);
+
+    /*
+    * Function:  RFU6xx_TagDedup_delete
+    * --------------------
+    * Frees the index without reporting the tags that are still present.
+    *
+    *  parameters:
+    *               -> RFU6xx_TagDedup* dedup
+    *
+    *  returns:
+    */
+    void RFU6xx_TagDedup_delete (RFU6xx_TagDedup* dedup);
+
+    /*
+    * Function:  RFU6xx_TagDedup_observe
+    * --------------------
+    * Records one scan of a tag and reports the resulting transition. Not thread-safe.
+    *
+    *  parameters:
+    *               -> RFU6xx_TagDedup* dedup
+    *               -> const UA_Byte* epc                       /-> Binary EPC
+    *               -> UA_UInt16 epcLength
+    *               -> UA_DateTime now                          /-> Time of the scan, must not go backwards
+    *
+    *  returns:
+    *               -> RFU6xx_TagTransition                     /-> RFU6xx_TAG_FIRST_SEEN, RFU6xx_TAG_PRESENT or RFU6xx_TAG_REPEAT
+    */
+    RFU6xx_TagTransition RFU6xx_TagDedup_observe (RFU6xx_TagDedup* dedup, const UA_Byte* epc, UA_UInt16 epcLength, UA_DateTime now);
+
+    /*
+    * Function:  RFU6xx_TagDedup_observeEvent
+    * Function:  RFU6xx_TagDedup_observeScanData
+    * --------------------
+    * RFU6xx_TagDedup_observe for an event of a RFU6xx_TagRing or for scan data (EPC as hex string, e.g. from readLastScanData).
+    *
+    *  returns:
+    *               -> RFU6xx_TagTransition                     /-> RFU6xx_TAG_REPEAT for invalid scan data
+    */
+    RFU6xx_TagTransition RFU6xx_TagDedup_observeEvent (RFU6xx_TagDedup* dedup, const RFU6xx_TagEvent* event);
+    RFU6xx_TagTransition RFU6xx_TagDedup_observeScanData (RFU6xx_TagDedup* dedup, const UA_String* scanData, UA_DateTime now);
+
+    /*
+    * Function:  RFU6xx_TagDedup_expire
+    * --------------------
+    * Reports and removes all tags that were not seen for the TTL. Observations already expire
+    * tags incrementally, this is needed when no scans arrive (e.g. periodically or after a scan ended).
+    *
+    *  parameters:
+    *               -> RFU6xx_TagDedup* dedup
+    *               -> UA_DateTime now
+    *
+    *  returns:
+    *               -> size_t                                   /-> Number of departed tags
+    */
+    size_t RFU6xx_TagDedup_expire (RFU6xx_TagDedup* dedup, UA_DateTime now);
+
+    /*
+    * Function:  RFU6xx_TagDedup_getStats
+    * --------------------
+    *
+    *  parameters:
+    *               -> RFU6xx_TagDedup* dedup
+    *               -> RFU6xx_TagDedupStats* stats
+    *
+    *  returns:
+    */
+    void RFU6xx_TagDedup_getStats (RFU6xx_TagDedup* dedup, RFU6xx_TagDedupStats* stats);
+
+#endif
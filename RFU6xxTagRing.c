@@ -0,0 +1,187 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+*
+* @contact: sebastian.heidepriem@sick.de
+*/
+
+#include "RFU6xxTagRing.h"
+#include "RFU6xxHex.h"
+
+#include <sched.h>
+
+#define CACHE_LINE_SIZE 64
+
+// Producer and consumer state are on separate cache lines, so the two threads do not share a line
+// on every push / drain. Each side keeps a cached copy of the other side's index and only reloads
+// it when the ring looks full (producer) or empty (consumer).
+struct RFU6xx_TagRing {
+    RFU6xx_TagEvent* events;
+    size_t mask;
+    RFU6xx_OverflowPolicy policy;
+    size_t highWaterMark;
+    char padding0[CACHE_LINE_SIZE];
+
+    // Producer
+    size_t head;
+    size_t cachedTail;
+    UA_UInt64 pushed;
+    UA_UInt64 dropped;
+    UA_UInt64 invalid;
+    UA_UInt64 blocked;
+    UA_UInt64 highWaterMarkHits;
+    size_t maxFill;
+    UA_Boolean aboveHighWaterMark;
+    char padding1[CACHE_LINE_SIZE];
+
+    // Consumer
+    size_t tail;
+    size_t cachedHead;
+    UA_UInt64 drained;
+    char padding2[CACHE_LINE_SIZE];
+};
+
+// Counters have a single writer, readers on other threads only need whole values
+#define COUNTER_LOAD(counter) __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+#define COUNTER_STORE(counter, value) __atomic_store_n(&(counter), (value), __ATOMIC_RELAXED)
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+RFU6xx_TagRing* RFU6xx_TagRing_new (size_t capacity, RFU6xx_OverflowPolicy policy, size_t highWaterMark)
+{
+    size_t size = 2;
+    while (size < capacity) size <<= 1;
+
+    RFU6xx_TagRing* ring = (RFU6xx_TagRing*) UA_calloc(1, sizeof(RFU6xx_TagRing));
+    if (ring == NULL) return NULL;
+    ring->events = (RFU6xx_TagEvent*) UA_malloc(size * sizeof(RFU6xx_TagEvent));
+    if (ring->events == NULL)
+    {
+        UA_free(ring);
+        return NULL;
+    }
+    ring->mask = size - 1;
+    ring->policy = policy;
+    ring->highWaterMark = (highWaterMark == 0 || highWaterMark > size) ? size : highWaterMark;
+    return ring;
+}
+
+void RFU6xx_TagRing_delete (RFU6xx_TagRing* ring)
+{
+    if (ring == NULL) return;
+    UA_free(ring->events);
+    UA_free(ring);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+// Tracks the fill level after a push, a high water mark hit is counted once per crossing
+static void trackFill (RFU6xx_TagRing* ring, size_t fill)
+{
+    if (fill > ring->maxFill) COUNTER_STORE(ring->maxFill, fill);
+    if (fill >= ring->highWaterMark)
+    {
+        if (!ring->aboveHighWaterMark) COUNTER_STORE(ring->highWaterMarkHits, ring->highWaterMarkHits + 1);
+        ring->aboveHighWaterMark = true;
+    }
+    else
+    {
+        ring->aboveHighWaterMark = false;
+    }
+}
+
+UA_Boolean RFU6xx_TagRing_push (RFU6xx_TagRing* ring, const RFU6xx_TagEvent* event)
+{
+    size_t head = ring->head;
+
+    if (head - ring->cachedTail > ring->mask)
+    {
+        ring->cachedTail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        if (head - ring->cachedTail > ring->mask)
+        {
+            if (ring->policy == RFU6xx_OVERFLOW_DROP_NEWEST)
+            {
+                COUNTER_STORE(ring->dropped, ring->dropped + 1);
+                return false;
+            }
+
+            // Blocking: wait for the consumer without holding anything it needs
+            COUNTER_STORE(ring->blocked, ring->blocked + 1);
+            do
+            {
+                sched_yield();
+                ring->cachedTail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+            } while (head - ring->cachedTail > ring->mask);
+        }
+    }
+
+    ring->events[head & ring->mask] = *event;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    COUNTER_STORE(ring->pushed, ring->pushed + 1);
+    trackFill(ring, head + 1 - ring->cachedTail);
+    return true;
+}
+
+UA_Boolean RFU6xx_TagRing_pushScanData (RFU6xx_TagRing* ring, UA_UInt32 deviceId, const UA_String* scanData)
+{
+    RFU6xx_TagEvent event;
+
+    if (scanData->length == 0 || scanData->length > 2*RFU6xx_MAX_TAG_ID_SIZE
+        || hexDecode(scanData->data, scanData->length, event.epc) != 0)
+    {
+        COUNTER_STORE(ring->invalid, ring->invalid + 1);
+        return false;
+    }
+    event.epcLength = (UA_UInt16) (scanData->length / 2);
+    event.deviceId = deviceId;
+    event.timestamp = UA_DateTime_now();
+    return RFU6xx_TagRing_push(ring, &event);
+}
+
+void RFU6xx_TagRing_onLastScanData (RFU6xx_Device* device, const UA_String* lastScanData, void* context)
+{
+    RFU6xx_TagRingProducer* producer = (RFU6xx_TagRingProducer*) context;
+    RFU6xx_TagRing_pushScanData(producer->ring, producer->deviceId, lastScanData);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+size_t RFU6xx_TagRing_drain (RFU6xx_TagRing* ring, RFU6xx_TagEvent events[], size_t maxEvents)
+{
+    size_t tail = ring->tail;
+
+    if (ring->cachedHead - tail < maxEvents)
+    {
+        ring->cachedHead = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    }
+    size_t count = ring->cachedHead - tail;
+    if (count > maxEvents) count = maxEvents;
+    if (count == 0) return 0;
+
+    // Copy in at most two contiguous pieces (before and after the wrap around)
+    size_t start = tail & ring->mask;
+    size_t first = ring->mask + 1 - start;
+    if (first > count) first = count;
+    memcpy(events, &ring->events[start], first * sizeof(RFU6xx_TagEvent));
+    memcpy(&events[first], ring->events, (count - first) * sizeof(RFU6xx_TagEvent));
+
+    __atomic_store_n(&ring->tail, tail + count, __ATOMIC_RELEASE);
+    COUNTER_STORE(ring->drained, ring->drained + count);
+    return count;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+void RFU6xx_TagRing_getStats (RFU6xx_TagRing* ring, RFU6xx_TagRingStats* stats)
+{
+    stats->pushed = COUNTER_LOAD(ring->pushed);
+    stats->dropped = COUNTER_LOAD(ring->dropped);
+    stats->invalid = COUNTER_LOAD(ring->invalid);
+    stats->blocked = COUNTER_LOAD(ring->blocked);
+    stats->drained = COUNTER_LOAD(ring->drained);
+    stats->highWaterMarkHits = COUNTER_LOAD(ring->highWaterMarkHits);
+    stats->maxFill = COUNTER_LOAD(ring->maxFill);
+    stats->capacity = ring->mask + 1;
+}
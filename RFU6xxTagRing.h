@@ -0,0 +1,156 @@
+/*
+* Created on 21.01.2022
+*
+* @author: Jakob Vollmer (DH-Student at SICK AG)
+* @author: Sebastian Heidepriem (SICK AG)
+* @contact: sebastian.heidepriem@sick.de
+*
+* Lock-free single-producer / single-consumer ring of tag events.
+* The thread that drives the OPC UA client pushes the scanned tags, one consumer thread
+* drains them in batches. The ring is preallocated, pushing never allocates or takes a lock,
+* so a slow consumer never stalls the session.
+*/
+
+#ifndef RFU6xxTAGRING_H
+#define RFU6xxTAGRING_H
+
+    #include "RFU6xxClient.h"
+
+    /*
+    * Struct:  RFU6xx_TagEvent
+    * --------------------
+    * Fixed-size record of one scanned tag.
+    */
+    typedef struct {
+        UA_DateTime timestamp;                      // Time the scan data was received
+        UA_UInt32 deviceId;                         // Id given to the producer of the device
+        UA_UInt16 epcLength;                        // Number of valid bytes in epc
+        UA_Byte epc[RFU6xx_MAX_TAG_ID_SIZE];        // Binary EPC
+    } RFU6xx_TagEvent;
+
+    // Behaviour of a push into a full ring
+    typedef enum {
+        RFU6xx_OVERFLOW_DROP_NEWEST,                // The new event is dropped and counted
+        RFU6xx_OVERFLOW_BLOCK                       // The producer waits until the consumer made room
+    } RFU6xx_OverflowPolicy;
+
+    typedef struct {
+        UA_UInt64 pushed;                           // Events written into the ring
+        UA_UInt64 dropped;                          // Events dropped because the ring was full
+        UA_UInt64 invalid;                          // Scan data that was no valid hex EPC
+        UA_UInt64 blocked;                          // Pushes that had to wait (RFU6xx_OVERFLOW_BLOCK)
+        UA_UInt64 drained;                          // Events taken by the consumer
+        UA_UInt64 highWaterMarkHits;                // Number of times the fill level reached the high water mark
+        size_t maxFill;                             // Highest fill level seen by the producer (upper bound, it uses
+                                                    // its cached copy of the consumer index)
+        size_t capacity;
+    } RFU6xx_TagRingStats;
+
+    typedef struct RFU6xx_TagRing RFU6xx_TagRing;
+
+    /*
+    * Struct:  RFU6xx_TagRingProducer
+    * --------------------
+    * Context of RFU6xx_TagRing_onLastScanData: the ring and the id written into the events of a device.
+    * Owned by the caller, it must stay valid while the subscription exists.
+    */
+    typedef struct {
+        RFU6xx_TagRing* ring;
+        UA_UInt32 deviceId;
+    } RFU6xx_TagRingProducer;
+
+    /*
+    * Function:  RFU6xx_TagRing_new
+    * --------------------
+    * Creates a ring. The capacity is rounded up to a power of two.
+    *
+    *  parameters:
+    *               -> size_t capacity                          /-> Number of events
+    *               -> RFU6xx_OverflowPolicy policy
+    *               -> size_t highWaterMark                     /-> Fill level counted in highWaterMarkHits, 0 == capacity
+    *
+    *  returns:
+    *               -> RFU6xx_TagRing*                          /-> NULL if out of memory
+    */
+    RFU6xx_TagRing* RFU6xx_TagRing_new (size_t capacity, RFU6xx_OverflowPolicy policy, size_t highWaterMark);
+
+    /*
+    * Function:  RFU6xx_TagRing_delete
+    * --------------------
+    * Frees the ring. Producer and consumer must have stopped.
+    *
+    *  parameters:
+    *               -> RFU6xx_TagRing* ring
+    *
+    *  returns:
+    */
+    void RFU6xx_TagRing_delete (RFU6xx_TagRing* ring);
+
+    /*
+    * Function:  RFU6xx_TagRing_push
+    * --------------------
+    * Copies an event into the ring. Must only be called from the producer thread.
+    *
+    *  parameters:
+    *               -> RFU6xx_TagRing* ring
+    *               -> const RFU6xx_TagEvent* event
+    *
+    *  returns:
+    *               -> UA_Boolean                               /-> false if the event was dropped
+    */
+    UA_Boolean RFU6xx_TagRing_push (RFU6xx_TagRing* ring, const RFU6xx_TagEvent* event);
+
+    /*
+    * Function:  RFU6xx_TagRing_pushScanData
+    * --------------------
+    * Converts scan data (EPC as hex string) into an event with the current time and pushes it.
+    * Must only be called from the producer thread.
+    *
+    *  parameters:
+    *               -> RFU6xx_TagRing* ring
+    *               -> UA_UInt32 deviceId
+    *               -> const UA_String* scanData                /-> EPC as hex string
+    *
+    *  returns:
+    *               -> UA_Boolean                               /-> false if the scan data was invalid or dropped
+    */
+    UA_Boolean RFU6xx_TagRing_pushScanData (RFU6xx_TagRing* ring, UA_UInt32 deviceId, const UA_String* scanData);
+
+    /*
+    * Function:  RFU6xx_TagRing_onLastScanData
+    * --------------------
+    * RFU6xx_LastScanDataCallback that pushes every LastScanData notification into a ring.
+    * The context is a RFU6xx_TagRingProducer, e.g.:
+    *       subscribeLastScanData(device, 100, 10, RFU6xx_TagRing_onLastScanData, &producer, &subscriptionId);
+    */
+    void RFU6xx_TagRing_onLastScanData (RFU6xx_Device* device, const UA_String* lastScanData, void* context);
+
+    /*
+    * Function:  RFU6xx_TagRing_drain
+    * --------------------
+    * Takes up to maxEvents events out of the ring. Must only be called from the consumer thread.
+    *
+    *  parameters:
+    *               -> RFU6xx_TagRing* ring
+    *               -> RFU6xx_TagEvent events[]                 /-> Buffer for the events
+    *               -> size_t maxEvents
+    *
+    *  returns:
+    *               -> size_t                                   /-> Number of events taken, 0 if the ring is empty
+    */
+    size_t RFU6xx_TagRing_drain (RFU6xx_TagRing* ring, RFU6xx_TagEvent events[], size_t maxEvents);
+
+    /*
+    * Function:  RFU6xx_TagRing_getStats
+    * --------------------
+    * Reads the counters of the ring. Can be called from any thread.
+    *
+    *  parameters:
+    *               -> RFU6xx_TagRing* ring
+    *               -> RFU6xx_TagRingStats* stats
+    *
+    *  returns:
+    */
+    void RFU6xx_TagRing_getStats (RFU6xx_TagRing* ring, RFU6xx_TagRingStats* stats);
+
+#endif
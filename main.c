@@ -12,12 +12,15 @@
 *   2.) The StartScan function of the RFU6xx is called up.
 *   3.) The last scanned ID of a tag is read out.
 *   4.) The StopScan function of the RFU6xx is called up.
-*   5.) The WriteTag function is called and writes data at the last scanned tag.
-*   5.) The ReadTag function is called and reads out the previously overwritten memory area.
+*   5.) The WriteTag function writes data at the last scanned tag and the ReadTag function reads
+*       the overwritten memory area back in the same request to verify it (writeTagVerified, as bytes
+*       or as hex digits on readers that do not support RAW:BYTES).
 *   6.) The connection is closed.
+* Every step is recorded in the scan journal in ./journal (see ./journalquery).
 */
 
 #include "RFU6xxClient.h"
+#include "RFU6xxJournal.h"
 #include <open62541/client_config_default.h>
 #include <open62541/client_highlevel.h>
 #include <open62541/plugin/log_stdout.h>
@@ -25,9 +28,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-int abort_program (UA_Client* client, const char* abortMessage, int abortStatusCode)
+// Journal of the scanned tags and tag operations, NULL if it could not be opened
+static RFU6xx_Journal* journal = NULL;
+
+int abort_program (RFU6xx_Device* device, const char* abortMessage, int abortStatusCode)
 {
-    UA_Client_delete(client);
+    RFU6xx_Journal_close(journal);
+    RFU6xx_Device_delete(device);
     UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, abortMessage, abortStatusCode);
     return abortStatusCode;
 }
@@ -37,7 +44,6 @@ int main(int argc, char *argv[]) {
     //char* serverUrl = "opc.tcp://ip:port"; // Default port is 4840
     char* serverUrl = "opc.tcp://";
     UA_StatusCode retval;
-    RFU6xx_StatusCode serverResponseCode;
 
 for (int i = 0; i < argc; i++)
         printf("argv[%d] = %s\n", i, argv[i]);
@@ -60,74 +66,99 @@ for (int i = 0; i < argc; i++)
         return UA_STATUSCODE_BAD;
     }
 
-    // Create client and set default configuration settings
-    UA_Client *client = UA_Client_new();
-    UA_ClientConfig_setDefault(UA_Client_getConfig(client));
+    // Create device context (client with default configuration settings)
+    RFU6xx_Device* device = RFU6xx_Device_new(serverUrl);
+    if (device == NULL)
+    {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Could not create device context.");
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
 
     // Connect to server
-    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Client connect to server: %s", serverUrl);
-    retval = UA_Client_connect(client, serverUrl);
+    retval = RFU6xx_Device_connect(device);
     if(retval != UA_STATUSCODE_GOOD) 
     {
-        return abort_program(client, "Failed to connect to server. ErrorCode: %x", (int)retval);
+        return abort_program(device, "Failed to connect to server. ErrorCode: %x", (int)retval);
     }
 
-    // Init client
-    retval = init(client);
+    // Init client (namespace indices and node ids are cached between runs)
+    retval = initCached(device, "RFU6xxNodeIds.cache");
     if(retval != UA_STATUSCODE_GOOD) 
     {
-        return abort_program(client, "Init Failed. ErrorCode: %x", (int)retval);
+        return abort_program(device, "Init Failed. ErrorCode: %x", (int)retval);
     }  
 
+    // Reconnect automatically if the reader reboots or the network is interrupted,
+    // the following calls wait up to 10 s for the connection
+    retval = RFU6xx_Device_supervise(device, RFU6xx_RECONNECT_WAIT, RFU6xx_DEFAULT_RECONNECT_WAIT);
+    if(retval != UA_STATUSCODE_GOOD) 
+    {
+        return abort_program(device, "Supervision setup failed. ErrorCode: %x", (int)retval);
+    }
+
+    // Open the scan journal, the program also runs without it
+    journal = RFU6xx_Journal_open("journal", 0, 0);
+    if (journal == NULL)
+    {
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Could not open the scan journal.");
+    }
+
     // Call methode StartScan    
-    retval = startScan(client, 0, 0, false);
+    retval = startScan(device, 0, 0, false);
+    RFU6xx_Journal_appendTagOperation(journal, 0, RFU6xx_JOURNAL_START_SCAN, UA_STRING_NULL, 0, 0, 0, retval, RFU6xx_STATUSCODE_SUCCESS, 0);
     if(retval != UA_STATUSCODE_GOOD) 
     {
-        return abort_program(client, "Methode call StartScan failed. ErrorCode: %x", (int)retval);
+        return abort_program(device, "Methode call StartScan failed. ErrorCode: %x", (int)retval);
     }
 
     // Read last scan data
     UA_String lastScanData;
-    retval = readLastScanData(client, &lastScanData);
+    retval = readLastScanData(device, &lastScanData);
     if(retval != UA_STATUSCODE_GOOD) 
     {
-        return abort_program(client, "Read Last data Failed. ErrorCode: %x", (int)retval);
+        return abort_program(device, "Read Last data Failed. ErrorCode: %x", (int)retval);
     }
     UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Last scan data: %.*s", (int) lastScanData.length, lastScanData.data);
+    RFU6xx_Journal_appendTagOperation(journal, 0, RFU6xx_JOURNAL_SCAN, lastScanData, 0, 0, 0, retval, RFU6xx_STATUSCODE_SUCCESS, 0);
     
     // Call methode StopScan
-    retval = stopScan(client);
+    retval = stopScan(device);
+    RFU6xx_Journal_appendTagOperation(journal, 0, RFU6xx_JOURNAL_STOP_SCAN, UA_STRING_NULL, 0, 0, 0, retval, RFU6xx_STATUSCODE_SUCCESS, 0);
     if(retval != UA_STATUSCODE_GOOD) 
     {
-        return abort_program(client, "Methode call StopScan failed. ErrorCode: %x", (int)retval);
+        return abort_program(device, "Methode call StopScan failed. ErrorCode: %x", (int)retval);
     }
 
-    // Call methode WriteTag
-    UA_String tagWriteData = UA_String_fromChars("affedeafbeadaffe");
-    retval = writeTag(client, lastScanData, 3, 0, tagWriteData, &serverResponseCode);    
-    if(retval != UA_STATUSCODE_GOOD) 
+    // Call methode WriteTag and ReadTag of the written area in one request
+    UA_Byte tagWriteData[] = { 0xaf, 0xfe, 0xde, 0xaf, 0xbe, 0xad, 0xaf, 0xfe };
+    RFU6xx_WriteVerifyResult writeResult;
+    retval = writeTagVerified(device, lastScanData, 3, 0, tagWriteData, sizeof(tagWriteData), &writeResult);
+    RFU6xx_Journal_appendTagOperation(journal, 0, RFU6xx_JOURNAL_WRITE_TAG, lastScanData, 3, 0, sizeof(tagWriteData),
+        retval, writeResult.writeResponseCode, 0);
+    RFU6xx_Journal_appendTagOperation(journal, 0, RFU6xx_JOURNAL_READ_TAG, lastScanData, 3, 0, sizeof(tagWriteData),
+        retval, writeResult.readResponseCode, 0);
+    if (retval != UA_STATUSCODE_GOOD) 
     {
-        return abort_program(client, "Methode call WriteTag failed. ErrorCode: %x", (int)retval);
+        return abort_program(device, "Methode call WriteTag failed. ErrorCode: %x", (int)retval);
     }
-    if (serverResponseCode != RFU6xx_STATUSCODE_SUCCESS)
+    if (writeResult.writeResponseCode != RFU6xx_STATUSCODE_SUCCESS)
     {
-        return abort_program(client, "Something went wrong during the WriteTag process. ServerResponse: %i", (int)retval);
+        return abort_program(device, "Something went wrong during the WriteTag process. ServerResponse: %i", (int)writeResult.writeResponseCode);
     }
-
-    // Call methode ReadTag
-    UA_String tagReadData;
-    retval = readTag(client, lastScanData, 3, 0, 16, &tagReadData, &serverResponseCode);    
-    if (retval != UA_STATUSCODE_GOOD) 
+    if (writeResult.readResponseCode != RFU6xx_STATUSCODE_SUCCESS)
     {
-        return abort_program(client, "Methode call ReadTag failed. ErrorCode: %x", (int)retval);
+        return abort_program(device, "Something went wrong during the ReadTag process. ServerResponse: %i", (int)writeResult.readResponseCode);
     }
-    if (serverResponseCode != RFU6xx_STATUSCODE_SUCCESS)
+    if (!writeResult.verified)
     {
-        return abort_program(client, "Something went wrong during the ReadTag process. ServerResponse: %i", (int)retval);
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Tag data differs from the written data at byte %i", (int)writeResult.mismatchOffset);
+        return abort_program(device, "Write could not be verified. ErrorCode: %x", (int)UA_STATUSCODE_BAD);
     }
-    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Tag read data: %.*s",(int) tagReadData.length, tagReadData.data);
+    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Tag data written and verified after %u attempt(s)", writeResult.attempts);
+    UA_String_clear(&lastScanData);
 
-    // Close connection and leave program
-    UA_Client_delete(client);
+    // Close journal and connection and leave program
+    RFU6xx_Journal_close(journal);
+    RFU6xx_Device_delete(device);
     return EXIT_SUCCESS;
 }